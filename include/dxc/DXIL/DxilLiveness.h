@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilLiveness.h                                                            //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Live values and register pressure of DXIL functions.                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include <map>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Type;
+class Value;
+}
+
+namespace hlsl {
+
+// Number of 32-bit registers needed to hold a value of type Ty. Pointers and
+// resource handles don't occupy any.
+unsigned GetScalarCount(llvm::Type *Ty);
+
+// Number of registers V needs. Only the elements read from dx.op results
+// returned as structs take registers.
+unsigned GetValueScalarCount(llvm::Value *V);
+
+// Set of live values that keeps track of the registers they need.
+class DxilLiveSet {
+  typedef llvm::SmallDenseMap<llvm::Value *, unsigned, 32> ValueMap;
+  ValueMap m_Values;
+  unsigned m_Scalars = 0;
+
+public:
+  // Inserts V if it is an instruction or argument that takes registers.
+  bool insert(llvm::Value *V);
+  void erase(llvm::Value *V);
+  bool count(llvm::Value *V) const { return m_Values.count(V) != 0; }
+  unsigned scalars() const { return m_Scalars; }
+
+  class const_iterator {
+    ValueMap::const_iterator m_It;
+  public:
+    const_iterator(ValueMap::const_iterator It) : m_It(It) {}
+    llvm::Value *operator*() const { return m_It->first; }
+    const_iterator &operator++() { ++m_It; return *this; }
+    bool operator!=(const const_iterator &O) const { return m_It != O.m_It; }
+  };
+  const_iterator begin() const { return m_Values.begin(); }
+  const_iterator end() const { return m_Values.end(); }
+};
+
+// Values live on entry to each block of a function, computed by iterating to
+// a fixed point. Callers find the values live at each instruction by walking
+// a block backwards from its live-out set.
+class DxilLiveness {
+  std::map<llvm::BasicBlock *, DxilLiveSet> m_LiveIn;
+  // Values that phis in successors read on the edge out of each block.
+  std::map<llvm::BasicBlock *, DxilLiveSet> m_PhiUses;
+
+public:
+  explicit DxilLiveness(llvm::Function &F);
+  void GetLiveOut(llvm::BasicBlock *BB, DxilLiveSet &LiveOut);
+};
+
+} // namespace hlsl
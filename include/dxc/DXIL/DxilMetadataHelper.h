@@ -217,6 +217,9 @@ public:
   // NonUniform attribute.
   static const char kDxilNonUniformAttributeMDName[];
 
+  // Uniform attribute, from uniformity analysis.
+  static const char kDxilUniformAttributeMDName[];
+
   // Validator version.
   static const char kDxilValidatorVersionMDName[];
   // Validator version uses the same constants for fields as kDxilVersion*
@@ -484,6 +487,8 @@ public:
   static void MarkPrecise(llvm::Instruction *inst);
   static bool IsMarkedNonUniform(const llvm::Instruction *inst);
   static void MarkNonUniform(llvm::Instruction *inst);
+  static bool IsMarkedUniform(const llvm::Instruction *inst);
+  static void MarkUniform(llvm::Instruction *inst);
 
 private:
   llvm::LLVMContext &m_Ctx;
@@ -13,6 +13,7 @@
 
 #include "dxc/DXIL/DxilSignatureElement.h"
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -36,6 +37,11 @@ public:
 
   unsigned AppendElement(std::unique_ptr<DxilSignatureElement> pSE, bool bSetID = true);
 
+  // Removes the elements with the given IDs and renumbers the remaining ones.
+  // Returns the new ID for each old ID, or DxilSignatureElement::kUndefinedID
+  // for deleted elements.
+  std::vector<unsigned> DeleteElements(const std::set<unsigned> &deleteIDs);
+
   DxilSignatureElement &GetElement(unsigned idx);
   const DxilSignatureElement &GetElement(unsigned idx) const;
   const std::vector<std::unique_ptr<DxilSignatureElement> > &GetElements() const;
@@ -95,6 +95,7 @@ enum DxilFourCC {
   DFCC_PipelineStateValidation  = DXIL_FOURCC('P', 'S', 'V', '0'),
   DFCC_RuntimeData              = DXIL_FOURCC('R', 'D', 'A', 'T'),
   DFCC_ShaderHash               = DXIL_FOURCC('H', 'A', 'S', 'H'),
+  DFCC_ShaderCost               = DXIL_FOURCC('C', 'O', 'S', 'T'),
 };
 
 #undef DXIL_FOURCC
@@ -103,6 +104,28 @@ struct DxilShaderFeatureInfo {
   uint64_t FeatureFlags;
 };
 
+/// Static cost estimate of the entry points in a container (DFCC_ShaderCost).
+/// Operation counts are weighted by the loop trip counts known at compile time.
+struct DxilShaderCostHeader {
+  uint32_t EntryCount;  // Number of DxilShaderCostEntry records.
+  uint32_t EntrySize;   // Size of each DxilShaderCostEntry record.
+  // Followed by DxilShaderCostEntry[EntryCount], then the null-terminated
+  // entry names.
+};
+
+struct DxilShaderCostEntry {
+  uint32_t NameOffset;          // Offset to entry name from start of part.
+  uint32_t ShaderKind;          // DXIL::ShaderKind
+  uint32_t AluOps;              // Arithmetic, conversion and wave operations.
+  uint32_t TextureOps;          // Sample, gather, texture load and LOD operations.
+  uint32_t MemoryOps;           // Buffer, constant buffer, groupshared, local array and atomic accesses.
+  uint32_t MaxLiveScalars;      // Peak number of live 32-bit values.
+  uint32_t LoopCount;
+  uint32_t UnboundedLoopCount;  // Loops without a known trip count bound.
+  uint32_t MaxLoopTripCount;    // Largest known trip count bound.
+  uint32_t GroupSharedBytes;
+};
+
 // DXIL program information.
 struct DxilBitcodeHeader {
   uint32_t DxilMagic;       // ACSII "DXIL".
@@ -410,6 +433,7 @@ enum class SerializeDxilFlags : uint32_t {
   DebugNameDependOnSource     = 1 << 2, // Make the debug name depend on source (and not just final module).
   StripReflectionFromDxilPart = 1 << 3, // Strip Reflection info from DXIL part.
   IncludeReflectionPart       = 1 << 4, // Include reflection in STAT part.
+  IncludeShaderCostPart       = 1 << 5, // Include static cost estimate in COST part.
 };
 inline SerializeDxilFlags& operator |=(SerializeDxilFlags& l, const SerializeDxilFlags& r) {
   l = static_cast<SerializeDxilFlags>(static_cast<int>(l) | static_cast<int>(r));
@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderCost.h                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Static cost estimate of the entry points of a DXIL module.                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/DxilContainer/DxilContainer.h"
+#include <string>
+#include <vector>
+
+namespace hlsl {
+
+class DxilModule;
+
+struct DxilEntryCost {
+  std::string Name;
+  DxilShaderCostEntry Cost; // NameOffset is left zero.
+};
+
+// Estimates the cost of each entry point of DM, which must be final DXIL.
+// Operations in loops are counted once per iteration when the loop's trip
+// count is bounded, and once otherwise. Costs of called functions are
+// included in their callers.
+std::vector<DxilEntryCost> ComputeShaderCost(DxilModule &DM);
+
+} // namespace hlsl
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilDebugTraceReplay.h                                                    //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Declares the plan shared by minimal debug instrumentation and the         //
+// offline replay that rebuilds a full step trace from a minimal one.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Instruction;
+class Value;
+}  // namespace llvm
+
+namespace pix_dxil {
+
+// Decides what minimal debug instrumentation records for a function that
+// has been annotated with virtual registers.
+//
+// A full trace has a step for every instruction with a virtual register and
+// every store to an alloca register. A minimal trace only has:
+// - a block entry step (a void step naming the first instruction in the
+//   block) for each block reached through a multi-way terminator, and
+// - a value step for each instruction whose value can't be recomputed from
+//   other values in the trace (loads, inputs, resource and wave operations,
+//   floating-point intrinsics whose GPU precision isn't known offline, ...).
+// Everything else is recomputed by ReplayMinimalDebugTrace.
+class MinimalDebugTracePlan {
+public:
+  explicit MinimalDebugTracePlan(llvm::Function &F);
+
+  bool IsBlockEntryRecorded(const llvm::BasicBlock *BB) const;
+  bool IsInstructionRecorded(const llvm::Instruction *I) const {
+    return m_Recorded.count(I) != 0;
+  }
+  // Returns true if a full trace has a step for this instruction.
+  static bool HasStep(llvm::Instruction *I);
+  // Returns true if replay can compute I from its operands.
+  static bool IsComputable(const llvm::Instruction *I);
+
+private:
+  llvm::DenseSet<const llvm::Instruction *> m_Recorded;
+};
+
+// One decoded step of a trace for a single invocation. Value holds the bits
+// written to the debug UAV (zero-extended for narrow integers).
+struct DebugTraceStep {
+  std::uint32_t InstNum = 0;
+  bool HasValue = false;
+  std::uint64_t Value = 0;
+  std::uint32_t ValueOrdinal = 0;
+  std::uint32_t ValueOrdinalIndex = 0;
+};
+
+// Rebuilds the full step trace of one invocation of F from the steps a
+// minimal instrumentation of F recorded. Returns false and sets Error if the
+// recorded steps don't match the control flow of F.
+bool ReplayMinimalDebugTrace(llvm::Function &F,
+                             llvm::ArrayRef<DebugTraceStep> Recorded,
+                             std::vector<DebugTraceStep> &Full,
+                             std::string &Error);
+
+}  // namespace pix_dxil
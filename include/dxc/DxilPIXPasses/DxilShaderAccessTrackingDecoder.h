@@ -0,0 +1,224 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderAccessTrackingDecoder.h                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Describes the layout of the buffer written by shader access tracking      //
+// instrumentation, and decodes it on the CPU.                               //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace pix_dxil {
+
+// These types are taken from PIX's ShaderAccessHelpers.h
+
+enum class ShaderAccessFlags : uint32_t
+{
+  None = 0,
+  Read = 1 << 0,
+  Write = 1 << 1,
+
+  // "Counter" access is only applicable to UAVs; it means the counter buffer attached to the UAV
+  // was accessed, but not necessarily the UAV resource.
+  Counter = 1 << 2,
+
+  // Descriptor-only read (if any), but not the resource contents (if any).
+  // Used for GetDimensions, samplers, and secondary texture for sampler feedback.
+  // TODO: Make this a unique value if supported in PIX, then enable GetDimensions
+  DescriptorRead = 1 << 0,
+};
+
+// Each slot of the tracking buffer holds one DWORD per access type, which is
+// non-zero if the resource in that slot was accessed that way. Slot zero
+// collects out-of-bounds accesses.
+constexpr uint32_t DWORDsPerResource = 3;
+constexpr uint32_t BytesPerDWORD = 4;
+
+// Returns the DWORD within a slot that records the given access, or -1.
+inline int OffsetFromAccess(ShaderAccessFlags access) {
+  switch (access) {
+  case ShaderAccessFlags::Read:
+    return 0;
+  case ShaderAccessFlags::Write:
+    return 1;
+  case ShaderAccessFlags::Counter:
+    return 2;
+  default:
+    return -1;
+  }
+}
+
+// This enum doesn't have to match PIX's version, because the values are received from PIX encoded in ASCII.
+// However, for ease of comparing this code with PIX, and to be less confusing to future maintainers, this
+// enum does indeed match the same-named enum in PIX.
+enum class RegisterType
+{
+  CBV,
+  SRV,
+  UAV,
+  RTV, // not used.
+  DSV, // not used.
+  Sampler,
+  SOV, // not used.
+  Invalid,
+  Terminator
+};
+
+struct RegisterTypeAndSpace
+{
+  bool operator < (const RegisterTypeAndSpace & o) const {
+    return static_cast<int>(Type) < static_cast<int>(o.Type) ||
+      (static_cast<int>(Type) == static_cast<int>(o.Type) && Space < o.Space);
+  }
+  RegisterType Type;
+  unsigned     Space;
+};
+
+struct SlotRange
+{
+  unsigned startSlot;
+  unsigned numSlots;
+
+  // Number of slots needed if no descriptors from unbounded ranges are included
+  unsigned numInvariableSlots;
+};
+
+typedef std::map<RegisterTypeAndSpace, SlotRange> SlotAssignments;
+
+inline RegisterType ParseRegisterType(char c) {
+  switch (c)
+  {
+  case 'C': return RegisterType::CBV;
+  case 'S': return RegisterType::SRV;
+  case 'U': return RegisterType::UAV;
+  case 'M': return RegisterType::Sampler;
+  case 'I': return RegisterType::Invalid;
+  default: return RegisterType::Terminator;
+  }
+}
+
+inline char EncodeRegisterType(RegisterType r) {
+  switch (r)
+  {
+  case RegisterType::CBV:     return 'C';
+  case RegisterType::SRV:     return 'S';
+  case RegisterType::UAV:     return 'U';
+  case RegisterType::Sampler: return 'M';
+  case RegisterType::Invalid: return 'I';
+  default: break;
+  }
+  return '.';
+}
+
+// Parses slot assignments, as serialized by PIX's ShaderAccessHelpers.cpp
+// (TrackingConfiguration::SerializedRepresentation), e.g. "S0:1:1i1;U0:2:10i0;."
+// Returns false if the configuration is malformed.
+inline bool ParseSlotAssignments(const std::string &config, SlotAssignments &slots) {
+  size_t pos = 0;
+  auto parseInt = [&]() {
+    unsigned i = 0;
+    while (pos < config.size() && isdigit(static_cast<unsigned char>(config[pos]))) {
+      i = i * 10 + (config[pos] - '0');
+      ++pos;
+    }
+    return i;
+  };
+  auto parseDelimiter = [&](char d) {
+    if (pos >= config.size() || config[pos] != d)
+      return false;
+    ++pos;
+    return true;
+  };
+
+  for (;;) {
+    if (pos >= config.size())
+      return false;
+    RegisterType rt = ParseRegisterType(config[pos++]);
+    if (rt == RegisterType::Terminator)
+      return true;
+
+    RegisterTypeAndSpace rst;
+    rst.Type = rt;
+    rst.Space = parseInt();
+    SlotRange sr;
+    if (!parseDelimiter(':'))
+      return false;
+    sr.startSlot = parseInt();
+    if (!parseDelimiter(':'))
+      return false;
+    sr.numSlots = parseInt();
+    if (!parseDelimiter('i'))
+      return false;
+    sr.numInvariableSlots = parseInt();
+    if (!parseDelimiter(';'))
+      return false;
+    slots[rst] = sr;
+  }
+}
+
+struct ShaderAccess
+{
+  RegisterType Type;
+  unsigned     Space;
+  unsigned     Index;  // relative to the start of the range in this space
+  uint32_t     Flags;  // combination of ShaderAccessFlags
+};
+
+struct DecodedShaderAccesses
+{
+  std::vector<ShaderAccess> Accesses;
+  // Accesses that fell outside their range, which are all written to slot zero.
+  uint32_t OutOfBoundsFlags = 0;
+};
+
+// Decodes a tracking buffer written by instrumentation configured with the
+// given slot assignments. Returns false if the buffer is too small to hold
+// every assigned slot.
+inline bool DecodeShaderAccessTrackingBuffer(const SlotAssignments &slots,
+                                             const void *pData, size_t size,
+                                             DecodedShaderAccesses &decoded) {
+  const uint32_t *pDWords = static_cast<const uint32_t *>(pData);
+  const size_t numDWords = size / BytesPerDWORD;
+  static const ShaderAccessFlags accessTypes[] = {
+    ShaderAccessFlags::Read, ShaderAccessFlags::Write, ShaderAccessFlags::Counter };
+
+  auto readFlags = [&](size_t slot) {
+    uint32_t flags = 0;
+    for (ShaderAccessFlags access : accessTypes) {
+      if (pDWords[slot * DWORDsPerResource + OffsetFromAccess(access)] != 0)
+        flags |= static_cast<uint32_t>(access);
+    }
+    return flags;
+  };
+
+  bool slotZeroAssigned = false;
+  for (auto &assignment : slots) {
+    const SlotRange &range = assignment.second;
+    if ((static_cast<size_t>(range.startSlot) + range.numSlots) * DWORDsPerResource > numDWords)
+      return false;
+    if (range.startSlot == 0 && range.numSlots != 0)
+      slotZeroAssigned = true;
+    for (unsigned i = 0; i < range.numSlots; ++i) {
+      uint32_t flags = readFlags(range.startSlot + i);
+      if (flags != 0)
+        decoded.Accesses.push_back({ assignment.first.Type, assignment.first.Space, i, flags });
+    }
+  }
+
+  if (!slotZeroAssigned && numDWords >= DWORDsPerResource)
+    decoded.OutOfBoundsFlags = readFlags(0);
+  return true;
+}
+
+} // namespace pix_dxil
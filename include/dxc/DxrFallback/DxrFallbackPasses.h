@@ -0,0 +1,22 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxrFallbackPasses.h                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// This file provides passes to exercise the DXR fallback layer transforms.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+namespace llvm {
+class ModulePass;
+class PassRegistry;
+
+ModulePass *createDxrStateFunctionTransformPass();
+
+void initializeDxrStateFunctionTransformPass(llvm::PassRegistry&);
+
+}
@@ -11,15 +11,23 @@
 
 #pragma once
 
+#include <functional>
+#include <string>
+#include <vector>
+
 namespace llvm {
 class Module;
 class ModulePass;
 class Function;
 class FunctionPass;
 class Instruction;
+class Value;
 class PassRegistry;
 class StringRef;
 struct PostDominatorTree;
+namespace legacy {
+class PassManagerBase;
+}
 }
 
 namespace hlsl {
@@ -32,6 +40,16 @@ public:
   virtual bool IsWaveSensitive(llvm::Instruction *op) = 0;
 };
 
+// Finds the values that are the same in every active lane of a wave, and the
+// branches that every active lane takes the same way.
+class DxilUniformityAnalysis {
+public:
+  static DxilUniformityAnalysis* create(llvm::PostDominatorTree &PDT);
+  virtual ~DxilUniformityAnalysis() { }
+  virtual void Analyze(llvm::Function *F) = 0;
+  virtual bool IsUniform(llvm::Value *V) = 0;
+};
+
 class HLSLExtensionsCodegenHelper;
 
 // Pause/resume support.
@@ -67,6 +85,15 @@ ModulePass *createDxilLegalizeResources();
 ModulePass *createDxilLegalizeEvalOperationsPass();
 FunctionPass *createDxilLegalizeSampleOffsetPass();
 FunctionPass *createDxilSimpleGVNHoistPass();
+FunctionPass *createDxilCoalesceBufferLoadsPass();
+FunctionPass *createDxilUniformityPass();
+FunctionPass *createDxilRematerializePass();
+ModulePass *createDxilGroupSharedLayoutPass();
+FunctionPass *createDxilLoopInvariantHoistPass();
+ModulePass *createDxilSpecializeConstantsPass(const std::vector<std::string> &Values);
+ModulePass *createDxilParallelFunctionPassesPass(
+    unsigned Threads,
+    std::function<void(legacy::PassManagerBase &)> AddPasses);
 ModulePass *createInvalidateUndefResourcesPass();
 FunctionPass *createSimplifyInstPass();
 ModulePass *createDxilTranslateRawBuffer();
@@ -100,6 +127,12 @@ void initializeDxilLegalizeResourcesPass(llvm::PassRegistry&);
 void initializeDxilLegalizeEvalOperationsPass(llvm::PassRegistry&);
 void initializeDxilLegalizeSampleOffsetPassPass(llvm::PassRegistry&);
 void initializeDxilSimpleGVNHoistPass(llvm::PassRegistry&);
+void initializeDxilCoalesceBufferLoadsPass(llvm::PassRegistry&);
+void initializeDxilUniformityPass(llvm::PassRegistry&);
+void initializeDxilRematerializePass(llvm::PassRegistry&);
+void initializeDxilGroupSharedLayoutPass(llvm::PassRegistry&);
+void initializeDxilLoopInvariantHoistPass(llvm::PassRegistry&);
+void initializeDxilSpecializeConstantsPass(llvm::PassRegistry&);
 void initializeInvalidateUndefResourcesPass(llvm::PassRegistry&);
 void initializeSimplifyInstPass(llvm::PassRegistry&);
 void initializeDxilTranslateRawBufferPass(llvm::PassRegistry&);
@@ -16,6 +16,8 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringMap.h"
 #include <memory>
+#include <string>
+#include <vector>
 #include "llvm/Support/ErrorOr.h"
 #include "dxc/HLSL/DxilExportMap.h"
 
@@ -38,6 +40,9 @@ public:
   static DxilLinker *CreateLinker(llvm::LLVMContext &Ctx, unsigned valMajor, unsigned valMinor);
 
   void SetValidatorVersion(unsigned valMajor, unsigned valMinor) { m_valMajor = valMajor, m_valMinor = valMinor; }
+  // Constant buffer fields replaced by constants in linked modules, as
+  // "name=value[,component...]".
+  void SetSpecializationConstants(const std::vector<std::string> &values) { m_specConstants = values; }
   virtual bool HasLibNameRegistered(llvm::StringRef name) = 0;
   virtual bool RegisterLib(llvm::StringRef name,
                            std::unique_ptr<llvm::Module> pModule,
@@ -53,6 +58,7 @@ protected:
   DxilLinker(llvm::LLVMContext &Ctx, unsigned valMajor, unsigned valMinor) : m_ctx(Ctx), m_valMajor(valMajor), m_valMinor(valMinor) {}
   llvm::LLVMContext &m_ctx;
   unsigned m_valMajor, m_valMinor;
+  std::vector<std::string> m_specConstants;
 };
 
 } // namespace hlsl
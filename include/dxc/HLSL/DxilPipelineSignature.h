@@ -0,0 +1,27 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPipelineSignature.h                                                   //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Optimizes the signatures between consecutive stages of a pipeline.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+namespace hlsl {
+
+class DxilModule;
+
+// Removes the arbitrary outputs of Producer (a vertex, domain or geometry
+// shader) that Consumer (a pixel shader) never reads, along with the code
+// computing them, then packs the remaining outputs and Consumer's inputs
+// together so their locations still match.
+// Producer's outputs must not be used for stream output.
+// Returns true if either module changed; both modules' metadata is updated
+// and they are ready to be serialized.
+bool OptimizePipelineSignatures(DxilModule &Producer, DxilModule &Consumer);
+
+} // namespace hlsl
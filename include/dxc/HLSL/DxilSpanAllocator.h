@@ -14,6 +14,7 @@
 #include "dxc/Support/Global.h"
 #include <set>
 #include <map>
+#include <algorithm>
 
 namespace hlsl {
 
@@ -50,15 +51,15 @@ public:
     DXASSERT_NOMSG(size);
     if (size - 1 > m_Max - m_Min)
       return false;
-    if (pos < m_FirstFree)
-      pos = m_FirstFree;
-    if (!UpdatePos(pos, size, align))
-      return false;
-    T_index end = pos + (size - 1);
-    auto next = m_Spans.lower_bound(Span(nullptr, pos, end));
-    if (next == m_Spans.end() || end < next->start)
-      return true;  // it fits here
-    return Find(size, next, pos, align);
+    // Skip the range already known not to contain a large enough gap.
+    T_index firstFit = GetFirstFitBound(size);
+    bool bFromFirstFit = pos <= firstFit;
+    if (bFromFirstFit)
+      pos = firstFit;
+    bool bFound = FindFrom(size, pos, align);
+    if (bFromFirstFit && align == 1)
+      UpdateFirstFitBound(size, bFound ? pos : m_Max);
+    return bFound;
   }
 
   // Finds the farthest position at which an element could be allocated.
@@ -79,7 +80,7 @@ public:
       return false;
     if (m_AllocationFull)
       return false;
-    pos = m_FirstFree;
+    pos = GetFirstFitBound(size);
     if (!UpdatePos(pos, size, align))
       return false;
     auto result = m_Spans.emplace(element, pos, pos + (size - 1));
@@ -88,7 +89,10 @@ public:
       return true;
     }
     // Collision, find a gap from iterator
-    if (!Find(size, result.first, pos, align))
+    bool bFound = Find(size, result.first, pos, align);
+    if (align == 1)
+      UpdateFirstFitBound(size, bFound ? pos : m_Max);
+    if (!bFound)
       return false;
     result = m_Spans.emplace(element, pos, pos + (size - 1));
     return result.second;
@@ -142,6 +146,41 @@ public:
   }
 
 private:
+  // Find size gap starting at pos without consulting first fit bounds
+  bool FindFrom(T_index size, T_index &pos, T_index align) {
+    if (pos < m_FirstFree)
+      pos = m_FirstFree;
+    if (!UpdatePos(pos, size, align))
+      return false;
+    T_index end = pos + (size - 1);
+    auto next = m_Spans.lower_bound(Span(nullptr, pos, end));
+    if (next == m_Spans.end() || end < next->start)
+      return true;  // it fits here
+    return Find(size, next, pos, align);
+  }
+
+  // Spans are never removed, so once a first-fit search for some size has
+  // reached pos, no gap of that size or larger can ever exist before pos.
+  // m_FirstFit maps size to such a bound, with bounds increasing with size,
+  // so repeated allocations don't rescan the same small gaps.
+  T_index GetFirstFitBound(T_index size) const {
+    auto it = m_FirstFit.upper_bound(size);
+    if (it == m_FirstFit.begin())
+      return m_FirstFree;
+    --it;
+    return std::max(it->second, m_FirstFree);
+  }
+
+  void UpdateFirstFitBound(T_index size, T_index pos) {
+    if (pos <= GetFirstFitBound(size))
+      return;
+    // Drop bounds for larger sizes that this one now dominates.
+    auto it = m_FirstFit.lower_bound(size);
+    while (it != m_FirstFit.end() && it->second <= pos)
+      it = m_FirstFit.erase(it);
+    m_FirstFit[size] = pos;
+  }
+
   // Find size gap starting at iterator, updating pos, and returning true if successful
   bool Find(T_index size, typename SpanSet::const_iterator it, T_index &pos, T_index align = 1) {
     pos = it->end;
@@ -195,6 +234,7 @@ private:
 
 private:
   SpanSet m_Spans;
+  std::map<T_index, T_index> m_FirstFit;
   T_index m_Min, m_Max, m_FirstFree;
   const T_element *m_Unbounded;
   bool m_AllocationFull;
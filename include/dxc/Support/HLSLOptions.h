@@ -111,7 +111,9 @@ public:
   llvm::StringRef RootSignatureDefine; // OPT_rootsig_define
   llvm::StringRef FloatDenormalMode; // OPT_denorm
   std::vector<std::string> Exports; // OPT_exports
+  std::vector<std::string> Specializations; // OPT_specialize
   llvm::StringRef DefaultLinkage; // OPT_default_linkage
+  llvm::StringRef LibCache; // OPT_lib_cache
 
   bool AllResourcesBound = false; // OPT_all_resources_bound
   bool AstDump = false; // OPT_ast_dump
@@ -156,6 +158,7 @@ public:
   bool StripReflection = false; // OPT_Qstrip_reflect
   bool KeepReflectionInDxil = false; // OPT_Qkeep_reflect_in_dxil
   bool StripReflectionFromDxil = false; // OPT_Qstrip_reflect_from_dxil
+  bool EmbedShaderCost = false; // OPT_Qembed_cost
   bool ExtractRootSignature = false; // OPT_extractrootsignature
   bool DisassembleColorCoded = false; // OPT_Cc
   bool DisassembleInstNumbers = false; //OPT_Ni
@@ -164,6 +167,7 @@ public:
   bool LegacyMacroExpansion = false; // OPT_flegacy_macro_expansion
   bool LegacyResourceReservation = false; // OPT_flegacy_resource_reservation
   unsigned long AutoBindingSpace = UINT_MAX; // OPT_auto_binding_space
+  unsigned long LibThreads = 0; // OPT_lib_threads
   bool ExportShadersOnly = false; // OPT_export_shaders_only
   bool ResMayAlias = false; // OPT_res_may_alias
   unsigned long ValVerMajor = UINT_MAX, ValVerMinor = UINT_MAX; // OPT_validator_version
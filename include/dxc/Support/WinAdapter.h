@@ -280,6 +280,7 @@
 #define _Outptr_opt_result_z_
 #define _Out_opt_
 #define _Out_writes_(size)
+#define _Out_writes_opt_(size)
 #define _Out_write_bytes_(size)
 #define _Out_writes_z_(size)
 #define _Out_writes_all_(size)
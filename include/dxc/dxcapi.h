@@ -233,6 +233,20 @@ IDxcCompiler2 : public IDxcCompiler {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcCompiler2)
 };
 
+struct __declspec(uuid("490dba34-e813-4dfe-80b5-61878c6a55bb"))
+IDxcRootSignatureCompiler : public IUnknown {
+  // Compile a root signature string, as written in a RootSignature attribute,
+  // into a root signature container without preprocessing any source.
+  // Identical root signatures return the same container blob.
+  virtual HRESULT STDMETHODCALLTYPE CompileRootSignature(
+    _In_ IDxcBlob *pRootSignature,                // Root signature text
+    _In_ LPCWSTR pTargetProfile,                  // rootsig_1_0 or rootsig_1_1
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Compiler output status, buffer, and errors
+  ) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcRootSignatureCompiler)
+};
+
 struct __declspec(uuid("F1B5BE2A-62DD-4327-A1C2-42AC1E1E78E6"))
 IDxcLinker : public IUnknown {
 public:
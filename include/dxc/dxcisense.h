@@ -597,12 +597,30 @@ enum DxcCompletionChunkKind
   DxcCompletionChunk_VerticalSpace = 20,
 };
 
+enum DxcIntelliSenseOperation
+{
+  DxcIntelliSenseOperation_Parse = 0,
+  DxcIntelliSenseOperation_Reparse = 1,
+  DxcIntelliSenseOperation_CodeComplete = 2,
+  DxcIntelliSenseOperation_Count = 3,
+};
+
+struct DxcIntelliSenseLatency
+{
+  unsigned Count;           // Number of times the operation ran.
+  unsigned SkippedCount;    // Number of times it was skipped because no input changed.
+  double LastMilliseconds;
+  double MaxMilliseconds;
+  double TotalMilliseconds;
+};
+
 struct IDxcCursor;
 struct IDxcDiagnostic;
 struct IDxcFile;
 struct IDxcInclusion;
 struct IDxcIntelliSense;
 struct IDxcIndex;
+struct IDxcIndex2;
 struct IDxcSourceLocation;
 struct IDxcSourceRange;
 struct IDxcToken;
@@ -719,6 +737,17 @@ IDxcIndex : public IUnknown
       _Out_ IDxcTranslationUnit** pTranslationUnit) = 0;
 };
 
+struct __declspec(uuid("dcb1336f-65ab-4f9e-80e8-e6fc49e74366"))
+IDxcIndex2 : public IDxcIndex
+{
+  /// <summary>Gets the latency of an operation on translation units parsed by this index.</summary>
+  virtual HRESULT STDMETHODCALLTYPE GetLatency(
+    DxcIntelliSenseOperation operation,
+    _Out_ DxcIntelliSenseLatency* pResult) = 0;
+  /// <summary>Clears the latency of all operations.</summary>
+  virtual HRESULT STDMETHODCALLTYPE ResetLatency() = 0;
+};
+
 struct __declspec(uuid("8e7ddf1c-d7d3-4d69-b286-85fccba1e0cf"))
 IDxcSourceLocation : public IUnknown
 {
@@ -80,4 +80,21 @@ IDxcRewriter2 : public IDxcRewriter {
   DECLARE_CROSS_PLATFORM_UUIDOF(IDxcRewriter2)
 };
 
+struct __declspec(uuid("19d6e779-1521-49d4-a95f-966818ed577c"))
+IDxcRewriter3 : public IDxcRewriter2 {
+
+  // Removes the globals and functions that none of the entry points use,
+  // parsing the source once.
+  virtual HRESULT STDMETHODCALLTYPE RemoveUnusedGlobalsForEntryPoints(_In_ IDxcBlobEncoding *pSource,
+                                                     _In_count_(entryPointCount) LPCWSTR *pEntryPoints,
+                                                     _In_ UINT32 entryPointCount,
+                                                     _In_count_(defineCount) DxcDefine *pDefines,
+                                                     _In_ UINT32 defineCount,
+                                                     // Optional results with the globals and functions each entry point doesn't use removed
+                                                     _Out_writes_opt_(entryPointCount) IDxcOperationResult **ppEntryPointResults,
+                                                     _COM_Outptr_ IDxcOperationResult **ppResult) = 0;
+
+  DECLARE_CROSS_PLATFORM_UUIDOF(IDxcRewriter3)
+};
+
 #endif
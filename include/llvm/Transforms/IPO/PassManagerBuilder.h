@@ -129,6 +129,7 @@ public:
   bool HLSLHighLevel = false; // HLSL Change
   hlsl::HLSLExtensionsCodegenHelper *HLSLExtensionsCodeGen = nullptr; // HLSL Change
   bool HLSLResMayAlias = false; // HLSL Change
+  unsigned HLSLLibThreads = 0; // HLSL Change
 
 private:
   /// ExtensionList - This is list of all of the extensions that are registered.
@@ -147,6 +148,7 @@ private:
   void addExtensionsToPM(ExtensionPointTy ETy,
                          legacy::PassManagerBase &PM) const;
   void addInitialAliasAnalysisPasses(legacy::PassManagerBase &PM) const;
+  void addFunctionSimplificationPasses(legacy::PassManagerBase &MPM); // HLSL Change
   void addLTOOptimizationPasses(legacy::PassManagerBase &PM);
   void addLateLTOOptimizationPasses(legacy::PassManagerBase &PM);
 
@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 #include "llvm/Analysis/DxilConstantFolding.h"
 #include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
@@ -404,6 +405,20 @@ static Constant *ConstantFoldTernaryIntIntrinsic(OP::OpCode opcode, Type *Ty, Co
   }
   case OP::OpCode::Ubfe: return ComputeBFE(Ty, C1, C2, C3, [](APInt val, APInt amt) {return val.lshr(amt); });
   case OP::OpCode::Ibfe: return ComputeBFE(Ty, C1, C2, C3, [](APInt val, APInt amt) {return val.ashr(amt); });
+  case OP::OpCode::Msad: {
+    // Sum the absolute differences of the bytes of src (C2) from the bytes of
+    // ref (C1) that are not zero, and add them to the accumulator (C3).
+    uint64_t ref = C1.getZExtValue();
+    uint64_t src = C2.getZExtValue();
+    uint64_t result = C3.getZExtValue();
+    for (unsigned i = 0; i < 4; ++i) {
+      uint64_t refByte = (ref >> (i * 8)) & 0xff;
+      uint64_t srcByte = (src >> (i * 8)) & 0xff;
+      if (refByte)
+        result += refByte > srcByte ? refByte - srcByte : srcByte - refByte;
+    }
+    return ConstantInt::get(Ty, result);
+  }
   }
 
   return nullptr;
@@ -434,6 +449,214 @@ static Constant *ConstantFoldQuaternaryIntInstrinsic(OP::OpCode opcode, Type *Ty
   return ConstantInt::get(Ty, result);
 }
 
+// Constant fold intrinsics returning two integers.
+// IMul and UMul return the high and low halves of the full product, UDiv the
+// quotient and remainder, and UAddc and USubb the result and the carry or
+// borrow bit.
+static Constant *ConstantFoldBinaryWithTwoOutsIntrinsic(OP::OpCode opcode, Type *Ty, ConstantInt *Op1, ConstantInt *Op2) {
+  StructType *ST = dyn_cast<StructType>(Ty);
+  if (!ST || ST->getNumElements() != 2)
+    return nullptr;
+
+  APInt C1 = Op1->getValue();
+  APInt C2 = Op2->getValue();
+  unsigned bitwidth = C1.getBitWidth();
+  APInt out0, out1;
+  switch (opcode) {
+  default: return nullptr;
+  case OP::OpCode::IMul:
+  case OP::OpCode::UMul: {
+    APInt product = opcode == OP::OpCode::IMul
+                        ? C1.sext(bitwidth * 2) * C2.sext(bitwidth * 2)
+                        : C1.zext(bitwidth * 2) * C2.zext(bitwidth * 2);
+    out0 = product.lshr(bitwidth).trunc(bitwidth);
+    out1 = product.trunc(bitwidth);
+    break;
+  }
+  case OP::OpCode::UDiv:
+    // Divide by zero returns all ones for both quotient and remainder.
+    if (C2 == 0) {
+      out0 = out1 = APInt::getAllOnesValue(bitwidth);
+    } else {
+      out0 = C1.udiv(C2);
+      out1 = C1.urem(C2);
+    }
+    break;
+  case OP::OpCode::UAddc:
+    out0 = C1 + C2;
+    out1 = APInt(1, out0.ult(C1));
+    break;
+  case OP::OpCode::USubb:
+    out0 = C1 - C2;
+    out1 = APInt(1, C1.ult(C2));
+    break;
+  }
+
+  Constant *outs[] = { ConstantInt::get(ST->getElementType(0), out0.getZExtValue()),
+                       ConstantInt::get(ST->getElementType(1), out1.getZExtValue()) };
+  return ConstantStruct::get(ST, outs);
+}
+
+// Constant fold floating point classification intrinsics.
+// Unlike other floating point intrinsics these fold NaN and infinity too.
+static Constant *ConstantFoldIsSpecialFloatIntrinsic(OP::OpCode opcode, Type *Ty, ConstantFP *Op) {
+  if (!Op)
+    return nullptr;
+
+  const APFloat &APF = Op->getValueAPF();
+  switch (opcode) {
+  default: break;
+  case OP::OpCode::IsNaN:    return ConstantInt::get(Ty, APF.isNaN());
+  case OP::OpCode::IsInf:    return ConstantInt::get(Ty, APF.isInfinity());
+  case OP::OpCode::IsFinite: return ConstantInt::get(Ty, APF.isFinite());
+  case OP::OpCode::IsNormal: return ConstantInt::get(Ty, APF.isNormal());
+  }
+
+  return nullptr;
+}
+
+// Constant fold dot products with accumulate.
+static Constant *ConstantFoldDotAddIntrinsic(OP::OpCode opcode, Type *Ty, const DxilIntrinsicOperands &operands) {
+  switch (opcode) {
+  default: break;
+  case OP::OpCode::Dot2AddHalf: {
+    ConstantFP *Acc = operands.GetConstantFloat(0);
+    ConstantFP *Ax = operands.GetConstantFloat(1);
+    ConstantFP *Ay = operands.GetConstantFloat(2);
+    ConstantFP *Bx = operands.GetConstantFloat(3);
+    ConstantFP *By = operands.GetConstantFloat(4);
+    if (!AllValidOps({ Acc, Ax, Ay, Bx, By }))
+      return nullptr;
+
+    // The half products are exact in the accumulator's precision.
+    APFloat::roundingMode roundingMode = APFloat::roundingMode::rmNearestTiesToEven;
+    const fltSemantics &sem = Acc->getValueAPF().getSemantics();
+    bool losesInfo;
+    APFloat X(Ax->getValueAPF()), Y(Ay->getValueAPF());
+    APFloat BxF(Bx->getValueAPF()), ByF(By->getValueAPF());
+    X.convert(sem, roundingMode, &losesInfo);
+    Y.convert(sem, roundingMode, &losesInfo);
+    BxF.convert(sem, roundingMode, &losesInfo);
+    ByF.convert(sem, roundingMode, &losesInfo);
+    X.multiply(BxF, roundingMode);
+    Y.multiply(ByF, roundingMode);
+    X.add(Y, roundingMode);
+    X.add(Acc->getValueAPF(), roundingMode);
+    return ConstantFP::get(Ty->getContext(), X);
+  }
+  case OP::OpCode::Dot4AddI8Packed:
+  case OP::OpCode::Dot4AddU8Packed: {
+    ConstantInt *Acc = operands.GetConstantInt(0);
+    ConstantInt *A = operands.GetConstantInt(1);
+    ConstantInt *B = operands.GetConstantInt(2);
+    if (!Acc || !A || !B)
+      return nullptr;
+
+    bool isSigned = opcode == OP::OpCode::Dot4AddI8Packed;
+    uint32_t a = static_cast<uint32_t>(A->getZExtValue());
+    uint32_t b = static_cast<uint32_t>(B->getZExtValue());
+    uint32_t result = static_cast<uint32_t>(Acc->getZExtValue());
+    for (unsigned i = 0; i < 4; ++i) {
+      uint32_t aByte = (a >> (i * 8)) & 0xff;
+      uint32_t bByte = (b >> (i * 8)) & 0xff;
+      if (isSigned)
+        result += static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(aByte)) *
+                                        static_cast<int32_t>(static_cast<int8_t>(bByte)));
+      else
+        result += aByte * bByte;
+    }
+    return ConstantInt::get(Ty, result);
+  }
+  }
+
+  return nullptr;
+}
+
+// Constant fold intrinsics converting between types.
+// Legacy conversions are only folded when the hardware can't round or flush
+// the result differently.
+static Constant *ConstantFoldConversionIntrinsic(OP::OpCode opcode, Type *Ty, const DxilIntrinsicOperands &operands) {
+  LLVMContext &Ctx = Ty->getContext();
+  switch (opcode) {
+  default: break;
+  case OP::OpCode::MakeDouble: {
+    ConstantInt *Lo = operands.GetConstantInt(0);
+    ConstantInt *Hi = operands.GetConstantInt(1);
+    if (!Lo || !Hi)
+      return nullptr;
+    APInt bits = Hi->getValue().zext(64).shl(32) | Lo->getValue().zext(64);
+    return ConstantFP::get(Ctx, APFloat(APFloat::IEEEdouble, bits));
+  }
+  case OP::OpCode::SplitDouble: {
+    StructType *ST = dyn_cast<StructType>(Ty);
+    ConstantFP *Op = operands.GetConstantFloat(0);
+    if (!ST || ST->getNumElements() != 2 || !Op)
+      return nullptr;
+    APInt bits = Op->getValueAPF().bitcastToAPInt();
+    Constant *outs[] = { ConstantInt::get(ST->getElementType(0), bits.trunc(32)),
+                         ConstantInt::get(ST->getElementType(1), bits.lshr(32).trunc(32)) };
+    return ConstantStruct::get(ST, outs);
+  }
+  case OP::OpCode::BitcastI16toF16:
+  case OP::OpCode::BitcastF16toI16:
+  case OP::OpCode::BitcastI32toF32:
+  case OP::OpCode::BitcastF32toI32:
+  case OP::OpCode::BitcastI64toF64:
+  case OP::OpCode::BitcastF64toI64: {
+    Constant *Op = operands[0];
+    if (!isa<ConstantInt>(Op) && !isa<ConstantFP>(Op))
+      return nullptr;
+    return ConstantExpr::getBitCast(Op, Ty);
+  }
+  case OP::OpCode::LegacyF32ToF16: {
+    ConstantFP *Op = operands.GetConstantFloat(0);
+    if (!IsValidOp(Op))
+      return nullptr;
+    APFloat half = Op->getValueAPF();
+    bool losesInfo;
+    if (half.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven, &losesInfo) != APFloat::opOK ||
+        half.isDenormal())
+      return nullptr;
+    return ConstantInt::get(Ty, half.bitcastToAPInt().getZExtValue());
+  }
+  case OP::OpCode::LegacyF16ToF32: {
+    ConstantInt *Op = operands.GetConstantInt(0);
+    if (!Op)
+      return nullptr;
+    APFloat half(APFloat::IEEEhalf, Op->getValue().trunc(16));
+    if (!half.isFinite() || half.isDenormal())
+      return nullptr;
+    bool losesInfo;
+    half.convert(Ty->getFltSemantics(), APFloat::rmNearestTiesToEven, &losesInfo);
+    return ConstantFP::get(Ctx, half);
+  }
+  case OP::OpCode::LegacyDoubleToFloat: {
+    ConstantFP *Op = operands.GetConstantFloat(0);
+    if (!IsValidOp(Op))
+      return nullptr;
+    APFloat val = Op->getValueAPF();
+    bool losesInfo;
+    APFloat::opStatus status = val.convert(Ty->getFltSemantics(), APFloat::rmNearestTiesToEven, &losesInfo);
+    if ((status & (APFloat::opOverflow | APFloat::opUnderflow)) || val.isDenormal())
+      return nullptr;
+    return ConstantFP::get(Ctx, val);
+  }
+  case OP::OpCode::LegacyDoubleToSInt32:
+  case OP::OpCode::LegacyDoubleToUInt32: {
+    ConstantFP *Op = operands.GetConstantFloat(0);
+    if (!IsValidOp(Op))
+      return nullptr;
+    APSInt result(Ty->getIntegerBitWidth(), opcode == OP::OpCode::LegacyDoubleToUInt32);
+    bool isExact;
+    if (Op->getValueAPF().convertToInteger(result, APFloat::rmTowardZero, &isExact) & APFloat::opInvalidOp)
+      return nullptr;
+    return ConstantInt::get(Ty, result);
+  }
+  }
+
+  return nullptr;
+}
+
 // Top level function to constant fold floating point intrinsics.
 static Constant *ConstantFoldFPIntrinsic(OP::OpCode opcode, Type *Ty, const DxilIntrinsicOperands &IntrinsicOperands) {
   if (!Ty->isHalfTy() && !Ty->isFloatTy() && !Ty->isDoubleTy())
@@ -542,6 +765,38 @@ Constant *hlsl::ConstantFoldScalarCall(StringRef Name, Type *Ty, ArrayRef<Consta
   if (GetDxilOpcode(Name, RawOperands, opcode)) {
     DxilIntrinsicOperands IntrinsicOperands(RawOperands);
 
+    // Intrinsics whose result type differs from their operand types.
+    switch (OP::GetOpCodeClass(opcode)) {
+    default: break;
+    case OP::OpCodeClass::IsSpecialFloat:
+      return ConstantFoldIsSpecialFloatIntrinsic(opcode, Ty, IntrinsicOperands.GetConstantFloat(0));
+    case OP::OpCodeClass::BinaryWithTwoOuts:
+    case OP::OpCodeClass::BinaryWithCarryOrBorrow: {
+      ConstantInt *Op1 = IntrinsicOperands.GetConstantInt(0);
+      ConstantInt *Op2 = IntrinsicOperands.GetConstantInt(1);
+      if (!Op1 || !Op2)
+        return nullptr;
+      return ConstantFoldBinaryWithTwoOutsIntrinsic(opcode, Ty, Op1, Op2);
+    }
+    case OP::OpCodeClass::Dot2AddHalf:
+    case OP::OpCodeClass::Dot4AddPacked:
+      return ConstantFoldDotAddIntrinsic(opcode, Ty, IntrinsicOperands);
+    case OP::OpCodeClass::MakeDouble:
+    case OP::OpCodeClass::SplitDouble:
+    case OP::OpCodeClass::BitcastI16toF16:
+    case OP::OpCodeClass::BitcastF16toI16:
+    case OP::OpCodeClass::BitcastI32toF32:
+    case OP::OpCodeClass::BitcastF32toI32:
+    case OP::OpCodeClass::BitcastI64toF64:
+    case OP::OpCodeClass::BitcastF64toI64:
+    case OP::OpCodeClass::LegacyF32ToF16:
+    case OP::OpCodeClass::LegacyF16ToF32:
+    case OP::OpCodeClass::LegacyDoubleToFloat:
+    case OP::OpCodeClass::LegacyDoubleToSInt32:
+    case OP::OpCodeClass::LegacyDoubleToUInt32:
+      return ConstantFoldConversionIntrinsic(opcode, Ty, IntrinsicOperands);
+    }
+
     if (Ty->isFloatingPointTy()) {
       return ConstantFoldFPIntrinsic(opcode, Ty, IntrinsicOperands);
     }
@@ -587,6 +842,24 @@ bool hlsl::CanConstantFoldCallTo(const Function *F) {
     case OP::OpCodeClass::Dot2:
     case OP::OpCodeClass::Dot3:
     case OP::OpCodeClass::Dot4:
+    case OP::OpCodeClass::IsSpecialFloat:
+    case OP::OpCodeClass::BinaryWithTwoOuts:
+    case OP::OpCodeClass::BinaryWithCarryOrBorrow:
+    case OP::OpCodeClass::Dot2AddHalf:
+    case OP::OpCodeClass::Dot4AddPacked:
+    case OP::OpCodeClass::MakeDouble:
+    case OP::OpCodeClass::SplitDouble:
+    case OP::OpCodeClass::BitcastI16toF16:
+    case OP::OpCodeClass::BitcastF16toI16:
+    case OP::OpCodeClass::BitcastI32toF32:
+    case OP::OpCodeClass::BitcastF32toI32:
+    case OP::OpCodeClass::BitcastI64toF64:
+    case OP::OpCodeClass::BitcastF64toI64:
+    case OP::OpCodeClass::LegacyF32ToF16:
+    case OP::OpCodeClass::LegacyF16ToF32:
+    case OP::OpCodeClass::LegacyDoubleToFloat:
+    case OP::OpCodeClass::LegacyDoubleToSInt32:
+    case OP::OpCodeClass::LegacyDoubleToUInt32:
       return true;
     }
   }
@@ -711,8 +711,11 @@ static Comdat::SelectionKind getDecodedComdatSelectionKind(unsigned Val) {
 
 static FastMathFlags getDecodedFastMathFlags(unsigned Val) {
   FastMathFlags FMF;
+  // HLSL Change Begin - unsafe algebra doesn't imply no NaNs in HLSL, so
+  // only set the flags that were written.
   if (0 != (Val & FastMathFlags::UnsafeAlgebra))
-    FMF.setUnsafeAlgebra();
+    FMF.setUnsafeAlgebraHLSL();
+  // HLSL Change End
   if (0 != (Val & FastMathFlags::NoNaNs))
     FMF.setNoNaNs();
   if (0 != (Val & FastMathFlags::NoInfs))
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilLiveness.cpp                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Live values and register pressure of DXIL functions.                      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DXIL/DxilLiveness.h"
+
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace llvm;
+
+namespace hlsl {
+
+unsigned GetScalarCount(Type *Ty) {
+  if (Ty->isIntegerTy() || Ty->isFloatingPointTy())
+    return std::max(1u, Ty->getPrimitiveSizeInBits() / 32);
+  if (StructType *ST = dyn_cast<StructType>(Ty)) {
+    unsigned Count = 0;
+    for (Type *EltTy : ST->elements())
+      Count += GetScalarCount(EltTy);
+    return Count;
+  }
+  if (ArrayType *AT = dyn_cast<ArrayType>(Ty))
+    return AT->getNumElements() * GetScalarCount(AT->getElementType());
+  if (VectorType *VT = dyn_cast<VectorType>(Ty))
+    return VT->getNumElements() * GetScalarCount(VT->getElementType());
+  return 0;
+}
+
+unsigned GetValueScalarCount(Value *V) {
+  StructType *ST = dyn_cast<StructType>(V->getType());
+  if (!ST)
+    return GetScalarCount(V->getType());
+  std::set<unsigned> Elements;
+  for (User *U : V->users()) {
+    ExtractValueInst *EV = dyn_cast<ExtractValueInst>(U);
+    if (!EV)
+      return GetScalarCount(ST);
+    Elements.insert(EV->getIndices()[0]);
+  }
+  unsigned Count = 0;
+  for (unsigned i : Elements)
+    Count += GetScalarCount(ST->getElementType(i));
+  return Count;
+}
+
+bool DxilLiveSet::insert(Value *V) {
+  if (!isa<Instruction>(V) && !isa<Argument>(V))
+    return false;
+  if (m_Values.count(V))
+    return false;
+  unsigned Count = GetValueScalarCount(V);
+  if (Count == 0)
+    return false;
+  m_Values[V] = Count;
+  m_Scalars += Count;
+  return true;
+}
+
+void DxilLiveSet::erase(Value *V) {
+  auto It = m_Values.find(V);
+  if (It == m_Values.end())
+    return;
+  m_Scalars -= It->second;
+  m_Values.erase(It);
+}
+
+DxilLiveness::DxilLiveness(Function &F) {
+  // Values used in each block before being defined there.
+  std::map<BasicBlock *, DxilLiveSet> Uses;
+  for (BasicBlock &BB : F) {
+    DxilLiveSet &BBUses = Uses[&BB];
+    for (Instruction &I : BB) {
+      if (PHINode *Phi = dyn_cast<PHINode>(&I)) {
+        for (unsigned i = 0; i < Phi->getNumIncomingValues(); ++i)
+          m_PhiUses[Phi->getIncomingBlock(i)].insert(Phi->getIncomingValue(i));
+        continue;
+      }
+      for (Value *Op : I.operands()) {
+        Instruction *OpI = dyn_cast<Instruction>(Op);
+        if (!OpI || OpI->getParent() != &BB)
+          BBUses.insert(Op);
+      }
+    }
+  }
+
+  // Visit blocks in reverse so that most successors are seen before their
+  // predecessors.
+  bool bChanged = true;
+  while (bChanged) {
+    bChanged = false;
+    for (auto It = F.getBasicBlockList().rbegin(),
+              E = F.getBasicBlockList().rend();
+         It != E; ++It) {
+      BasicBlock *BB = &*It;
+      DxilLiveSet Live;
+      GetLiveOut(BB, Live);
+      for (Value *V : Uses[BB])
+        Live.insert(V);
+      DxilLiveSet &In = m_LiveIn[BB];
+      for (Value *V : Live) {
+        Instruction *I = dyn_cast<Instruction>(V);
+        if (I && I->getParent() == BB && !isa<PHINode>(I))
+          continue;
+        bChanged |= In.insert(V);
+      }
+      // Phis defined here are live on entry.
+      for (Instruction &I : *BB) {
+        if (!isa<PHINode>(I))
+          break;
+        bChanged |= In.insert(&I);
+      }
+    }
+  }
+}
+
+void DxilLiveness::GetLiveOut(BasicBlock *BB, DxilLiveSet &LiveOut) {
+  for (Value *V : m_PhiUses[BB])
+    LiveOut.insert(V);
+  for (BasicBlock *Succ : successors(BB)) {
+    for (Value *V : m_LiveIn[Succ]) {
+      PHINode *Phi = dyn_cast<PHINode>(V);
+      if (!Phi || Phi->getParent() != Succ)
+        LiveOut.insert(V);
+    }
+  }
+}
+
+} // namespace hlsl
@@ -49,6 +49,7 @@ const char DxilMDHelper::kDxilTypeSystemHelperVariablePrefix[]        = "dx.type
 const char DxilMDHelper::kDxilControlFlowHintMDName[]                 = "dx.controlflow.hints";
 const char DxilMDHelper::kDxilPreciseAttributeMDName[]                = "dx.precise";
 const char DxilMDHelper::kDxilNonUniformAttributeMDName[]             = "dx.nonuniform";
+const char DxilMDHelper::kDxilUniformAttributeMDName[]                = "dx.uniform";
 const char DxilMDHelper::kHLDxilResourceAttributeMDName[]             = "dx.hl.resource.attribute";
 const char DxilMDHelper::kDxilValidatorVersionMDName[]                = "dx.valver";
 
@@ -2401,4 +2402,22 @@ void DxilMDHelper::MarkNonUniform(Instruction *I) {
   I->setMetadata(DxilMDHelper::kDxilNonUniformAttributeMDName, preciseNode);
 }
 
+bool DxilMDHelper::IsMarkedUniform(const Instruction *inst) {
+  int32_t val = 0;
+  if (MDNode *uniform = inst->getMetadata(kDxilUniformAttributeMDName)) {
+    assert(uniform->getNumOperands() == 1);
+    val = ConstMDToInt32(uniform->getOperand(0));
+  }
+  return val;
+}
+
+void DxilMDHelper::MarkUniform(Instruction *I) {
+  LLVMContext &Ctx = I->getContext();
+  MDNode *uniformNode = MDNode::get(
+    Ctx,
+    { ConstantAsMetadata::get(ConstantInt::get(Type::getInt32Ty(Ctx), 1)) });
+
+  I->setMetadata(DxilMDHelper::kDxilUniformAttributeMDName, uniformNode);
+}
+
 } // namespace hlsl
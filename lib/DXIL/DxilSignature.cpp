@@ -74,6 +74,21 @@ unsigned DxilSignature::AppendElement(std::unique_ptr<DxilSignatureElement> pSE,
   return Id;
 }
 
+vector<unsigned> DxilSignature::DeleteElements(const std::set<unsigned> &deleteIDs) {
+  vector<unsigned> newIDs(m_Elements.size(), DxilSignatureElement::kUndefinedID);
+  vector<unique_ptr<DxilSignatureElement> > elements;
+  elements.swap(m_Elements);
+  for (auto &SE : elements) {
+    unsigned oldID = SE->GetID();
+    if (deleteIDs.count(oldID))
+      continue;
+    unsigned newID = AppendElement(std::move(SE));
+    if (oldID < newIDs.size())
+      newIDs[oldID] = newID;
+  }
+  return newIDs;
+}
+
 DxilSignatureElement &DxilSignature::GetElement(unsigned idx) {
   return *m_Elements[idx];
 }
@@ -476,7 +476,17 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     }
   }
 
+  llvm::StringRef lib_threads = Args.getLastArgValue(OPT_lib_threads);
+  if (!lib_threads.empty()) {
+    if (lib_threads.getAsInteger(10, opts.LibThreads)) {
+      errors << "Unsupported value '" << lib_threads << "' for lib threads.";
+      return 1;
+    }
+  }
+
+  opts.LibCache = Args.getLastArgValue(OPT_lib_cache);
   opts.Exports = Args.getAllArgValues(OPT_exports);
+  opts.Specializations = Args.getAllArgValues(OPT_specialize);
 
   opts.DefaultLinkage = Args.getLastArgValue(OPT_default_linkage);
   if (!opts.DefaultLinkage.empty()) {
@@ -555,6 +565,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.StripReflection = Args.hasFlag(OPT_Qstrip_reflect, OPT_INVALID, false);
   opts.KeepReflectionInDxil = Args.hasFlag(OPT_Qkeep_reflect_in_dxil, OPT_INVALID, false);
   opts.StripReflectionFromDxil = Args.hasFlag(OPT_Qstrip_reflect_from_dxil, OPT_INVALID, false);
+  opts.EmbedShaderCost = Args.hasFlag(OPT_Qembed_cost, OPT_INVALID, false);
   opts.ExtractRootSignature = Args.hasFlag(OPT_extractrootsignature, OPT_INVALID, false);
   opts.DisassembleColorCoded = Args.hasFlag(OPT_Cc, OPT_INVALID, false);
   opts.DisassembleInstNumbers = Args.hasFlag(OPT_Ni, OPT_INVALID, false);
@@ -9,6 +9,7 @@
 //                                                                           //
 ///////////////////////////////////////////////////////////////////////////////
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/IR/Module.h"
@@ -34,8 +35,10 @@
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/DxilContainer/DxilPipelineStateValidation.h"
 #include "dxc/DxilContainer/DxilRuntimeReflection.h"
+#include "dxc/DxilContainer/DxilShaderCost.h"
 #include <algorithm>
 #include <functional>
+#include <unordered_set>
 
 using namespace llvm;
 using namespace hlsl;
@@ -399,6 +402,38 @@ DxilPartWriter *hlsl::NewFeatureInfoWriter(const DxilModule &M) {
   return new DxilFeatureInfoWriter(M);
 }
 
+class DxilShaderCostWriter : public DxilPartWriter  {
+private:
+  std::vector<DxilEntryCost> m_Entries;
+  uint32_t m_UnpaddedSize;
+public:
+  DxilShaderCostWriter(DxilModule &M) : m_Entries(ComputeShaderCost(M)) {
+    m_UnpaddedSize = sizeof(DxilShaderCostHeader) +
+                     m_Entries.size() * sizeof(DxilShaderCostEntry);
+    for (DxilEntryCost &Entry : m_Entries) {
+      Entry.Cost.NameOffset = m_UnpaddedSize;
+      m_UnpaddedSize += Entry.Name.size() + 1;
+    }
+  }
+  uint32_t size() const override {
+    return PSVALIGN4(m_UnpaddedSize);
+  }
+  void write(AbstractMemoryStream *pStream) override {
+    DxilShaderCostHeader Header;
+    Header.EntryCount = m_Entries.size();
+    Header.EntrySize = sizeof(DxilShaderCostEntry);
+    IFT(WriteStreamValue(pStream, Header));
+    for (const DxilEntryCost &Entry : m_Entries)
+      IFT(WriteStreamValue(pStream, Entry.Cost));
+    ULONG cbWritten;
+    for (const DxilEntryCost &Entry : m_Entries)
+      IFT(pStream->Write(Entry.Name.c_str(), Entry.Name.size() + 1, &cbWritten));
+    const uint8_t Padding[4] = {0, 0, 0, 0};
+    if (size() != m_UnpaddedSize)
+      IFT(pStream->Write(Padding, size() - m_UnpaddedSize, &cbWritten));
+  }
+};
+
 class DxilPSVWriter : public DxilPartWriter  {
 private:
   const DxilModule &m_Module;
@@ -954,28 +989,30 @@ struct IndexArraysPart : public RDATPart {
 private:
   std::vector<uint32_t> m_IndexBuffer;
 
-  // Use m_IndexSet with CmpIndices to avoid duplicate index arrays
-  struct CmpIndices {
+  // Use m_IndexSet with HashIndices and EqualIndices to avoid duplicate index
+  // arrays. Entries are offsets of arrays, hashed by their contents.
+  struct HashIndices {
     const IndexArraysPart &Table;
-    CmpIndices(const IndexArraysPart &table) : Table(table) {}
+    HashIndices(const IndexArraysPart &table) : Table(table) {}
+    size_t operator()(uint32_t offset) const {
+      const uint32_t *pArray = Table.m_IndexBuffer.data() + offset;
+      return llvm::hash_combine_range(pArray, pArray + *pArray + 1);
+    }
+  };
+  struct EqualIndices {
+    const IndexArraysPart &Table;
+    EqualIndices(const IndexArraysPart &table) : Table(table) {}
     bool operator()(uint32_t left, uint32_t right) const {
       const uint32_t *pLeft = Table.m_IndexBuffer.data() + left;
       const uint32_t *pRight = Table.m_IndexBuffer.data() + right;
-      if (*pLeft != *pRight)
-        return (*pLeft < *pRight);
-      uint32_t count = *pLeft;
-      for (unsigned i = 0; i < count; i++) {
-        ++pLeft; ++pRight;
-        if (*pLeft != *pRight)
-          return (*pLeft < *pRight);
-      }
-      return false;
+      return std::equal(pLeft, pLeft + *pLeft + 1, pRight);
     }
   };
-  std::set<uint32_t, CmpIndices> m_IndexSet;
+  std::unordered_set<uint32_t, HashIndices, EqualIndices> m_IndexSet;
 
 public:
-  IndexArraysPart() : m_IndexBuffer(), m_IndexSet(*this) {}
+  IndexArraysPart()
+      : m_IndexBuffer(), m_IndexSet(16, HashIndices(*this), EqualIndices(*this)) {}
   template <class iterator>
   uint32_t AddIndex(iterator begin, iterator end) {
     uint32_t newOffset = m_IndexBuffer.size();
@@ -1004,20 +1041,34 @@ public:
 class RawBytesPart : public RDATPart {
 private:
   std::unordered_map<const void *, uint32_t> m_PtrMap;
+  StringMap<uint32_t> m_DataMap;
   std::vector<char> m_DataBuffer;
+  bool m_bDeduplicate;
 public:
-  RawBytesPart() : m_DataBuffer() {}
+  RawBytesPart() : m_DataBuffer(), m_bDeduplicate(false) {}
+  // Share the bytes of identical blobs, such as root signatures used by
+  // several subobjects.
+  void SetDeduplicate(bool bDeduplicate) { m_bDeduplicate = bDeduplicate; }
   uint32_t Insert(const void *pData, size_t dataSize) {
     auto it = m_PtrMap.find(pData);
     if (it != m_PtrMap.end())
       return it->second;
 
+    StringRef data((const char *)pData, dataSize);
+    if (m_bDeduplicate) {
+      auto found = m_DataMap.find(data);
+      if (found != m_DataMap.end())
+        return found->second;
+    }
+
     if (dataSize + m_DataBuffer.size() > UINT_MAX)
       return UINT_MAX;
     uint32_t offset = (uint32_t)m_DataBuffer.size();
     m_DataBuffer.reserve(m_DataBuffer.size() + dataSize);
     m_DataBuffer.insert(m_DataBuffer.end(),
       (const char*)pData, (const char*)pData + dataSize);
+    if (m_bDeduplicate)
+      m_DataMap[data] = offset;
     return offset;
   }
   RuntimeDataPartType GetType() const { return RuntimeDataPartType::RawBytes; }
@@ -1363,6 +1414,9 @@ public:
     module.GetValidatorVersion(m_ValMajor, m_ValMinor);
 
     CreateParts();
+    // Validators up to 1.5 regenerate RDAT with a copy of each raw blob, so
+    // only share them in modules that won't be validated.
+    m_pRawBytesPart->SetDeduplicate(m_ValMajor == 0);
     UpdateResourceInfo(module);
     UpdateFunctionInfo(module);
     UpdateSubobjectInfo(module);
@@ -1646,6 +1700,15 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     }
   }
 
+  // Write the static cost estimate (COST) part.
+  std::unique_ptr<DxilShaderCostWriter> pCostWriter = nullptr;
+  if (Flags & SerializeDxilFlags::IncludeShaderCostPart) {
+    pCostWriter = llvm::make_unique<DxilShaderCostWriter>(*pModule);
+    writer.AddPart(
+        DFCC_ShaderCost, pCostWriter->size(),
+        [&](AbstractMemoryStream *pStream) { pCostWriter->write(pStream); });
+  }
+
   // If metadata was stripped, re-serialize the input module.
   CComPtr<AbstractMemoryStream> pInputProgramStream = pModuleBitcode;
   if (bMetadataStripped) {
@@ -0,0 +1,400 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderCost.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Static cost estimate of the entry points of a DXIL module.                //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DxilContainer/DxilShaderCost.h"
+#include "dxc/DXIL/DxilFunctionProps.h"
+#include "dxc/DXIL/DxilLiveness.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Counts are clamped so that the product of two of them fits in 64 bits.
+uint64_t Saturate(uint64_t V) {
+  return std::min<uint64_t>(V, UINT32_MAX);
+}
+
+enum class OpCost { None, Alu, Texture, Memory };
+
+OpCost GetDxilOpCost(DXIL::OpCode opcode) {
+  switch (OP::GetOpCodeClass(opcode)) {
+  case DXIL::OpCodeClass::Unary:
+  case DXIL::OpCodeClass::UnaryBits:
+  case DXIL::OpCodeClass::IsSpecialFloat:
+  case DXIL::OpCodeClass::Binary:
+  case DXIL::OpCodeClass::BinaryWithCarryOrBorrow:
+  case DXIL::OpCodeClass::BinaryWithTwoOuts:
+  case DXIL::OpCodeClass::Tertiary:
+  case DXIL::OpCodeClass::Quaternary:
+  case DXIL::OpCodeClass::Dot2:
+  case DXIL::OpCodeClass::Dot3:
+  case DXIL::OpCodeClass::Dot4:
+  case DXIL::OpCodeClass::Dot2AddHalf:
+  case DXIL::OpCodeClass::Dot4AddPacked:
+  case DXIL::OpCodeClass::LegacyF32ToF16:
+  case DXIL::OpCodeClass::LegacyF16ToF32:
+  case DXIL::OpCodeClass::LegacyDoubleToFloat:
+  case DXIL::OpCodeClass::LegacyDoubleToSInt32:
+  case DXIL::OpCodeClass::LegacyDoubleToUInt32:
+  case DXIL::OpCodeClass::MakeDouble:
+  case DXIL::OpCodeClass::SplitDouble:
+  case DXIL::OpCodeClass::QuadOp:
+  case DXIL::OpCodeClass::QuadReadLaneAt:
+  case DXIL::OpCodeClass::WaveActiveAllEqual:
+  case DXIL::OpCodeClass::WaveActiveBallot:
+  case DXIL::OpCodeClass::WaveActiveBit:
+  case DXIL::OpCodeClass::WaveActiveOp:
+  case DXIL::OpCodeClass::WaveAllOp:
+  case DXIL::OpCodeClass::WaveAllTrue:
+  case DXIL::OpCodeClass::WaveAnyTrue:
+  case DXIL::OpCodeClass::WaveMatch:
+  case DXIL::OpCodeClass::WaveMultiPrefixBitCount:
+  case DXIL::OpCodeClass::WaveMultiPrefixOp:
+  case DXIL::OpCodeClass::WavePrefixOp:
+  case DXIL::OpCodeClass::WaveReadLaneAt:
+  case DXIL::OpCodeClass::WaveReadLaneFirst:
+    return OpCost::Alu;
+  case DXIL::OpCodeClass::Sample:
+  case DXIL::OpCodeClass::SampleBias:
+  case DXIL::OpCodeClass::SampleCmp:
+  case DXIL::OpCodeClass::SampleCmpLevelZero:
+  case DXIL::OpCodeClass::SampleGrad:
+  case DXIL::OpCodeClass::SampleLevel:
+  case DXIL::OpCodeClass::TextureGather:
+  case DXIL::OpCodeClass::TextureGatherCmp:
+  case DXIL::OpCodeClass::TextureLoad:
+  case DXIL::OpCodeClass::CalculateLOD:
+  case DXIL::OpCodeClass::WriteSamplerFeedback:
+  case DXIL::OpCodeClass::WriteSamplerFeedbackBias:
+  case DXIL::OpCodeClass::WriteSamplerFeedbackGrad:
+  case DXIL::OpCodeClass::WriteSamplerFeedbackLevel:
+    return OpCost::Texture;
+  case DXIL::OpCodeClass::BufferLoad:
+  case DXIL::OpCodeClass::BufferStore:
+  case DXIL::OpCodeClass::BufferUpdateCounter:
+  case DXIL::OpCodeClass::CBufferLoad:
+  case DXIL::OpCodeClass::CBufferLoadLegacy:
+  case DXIL::OpCodeClass::RawBufferLoad:
+  case DXIL::OpCodeClass::RawBufferStore:
+  case DXIL::OpCodeClass::TextureStore:
+  case DXIL::OpCodeClass::AtomicBinOp:
+  case DXIL::OpCodeClass::AtomicCompareExchange:
+    return OpCost::Memory;
+  default:
+    return OpCost::None;
+  }
+}
+
+OpCost GetInstructionCost(Instruction &I) {
+  if (isa<BinaryOperator>(I) || isa<CmpInst>(I) || isa<SelectInst>(I))
+    return OpCost::Alu;
+  if (isa<CastInst>(I))
+    return isa<BitCastInst>(I) || I.getType()->isPointerTy() ? OpCost::None
+                                                              : OpCost::Alu;
+  if (isa<LoadInst>(I) || isa<StoreInst>(I) || isa<AtomicRMWInst>(I) ||
+      isa<AtomicCmpXchgInst>(I))
+    return OpCost::Memory;
+  if (OP::IsDxilOpFuncCallInst(&I))
+    return GetDxilOpCost(OP::GetDxilOpFuncCallInst(&I));
+  return OpCost::None;
+}
+
+Value *GetMemoryPointer(Instruction &I) {
+  if (LoadInst *LI = dyn_cast<LoadInst>(&I))
+    return LI->getPointerOperand();
+  if (StoreInst *SI = dyn_cast<StoreInst>(&I))
+    return SI->getPointerOperand();
+  if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(&I))
+    return RMW->getPointerOperand();
+  if (AtomicCmpXchgInst *CX = dyn_cast<AtomicCmpXchgInst>(&I))
+    return CX->getPointerOperand();
+  return nullptr;
+}
+
+// Cost of one function, not including the functions it calls.
+struct FunctionCost {
+  struct Call {
+    Function *Callee;
+    uint64_t Weight;     // Times the call runs per run of the caller.
+    unsigned LiveAcross; // Scalars live across the call.
+  };
+  uint64_t AluOps = 0;
+  uint64_t TextureOps = 0;
+  uint64_t MemoryOps = 0;
+  unsigned MaxLiveScalars = 0;
+  unsigned LoopCount = 0;
+  unsigned UnboundedLoopCount = 0;
+  unsigned MaxLoopTripCount = 0;
+  std::set<GlobalVariable *> GroupShared;
+  std::vector<Call> Calls;
+};
+
+typedef std::map<Function *, FunctionCost> FunctionCostMap;
+
+class DxilShaderCostPass : public FunctionPass {
+public:
+  static char ID;
+  DxilShaderCostPass(FunctionCostMap &Costs)
+      : FunctionPass(ID), m_Costs(Costs) {}
+
+  const char *getPassName() const override { return "DXIL shader cost"; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<ScalarEvolution>();
+    AU.setPreservesAll();
+  }
+
+  bool runOnFunction(Function &F) override {
+    LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    ScalarEvolution &SE = getAnalysis<ScalarEvolution>();
+    FunctionCost &FC = m_Costs[&F];
+    ComputeLoopBounds(LI, SE, FC);
+    CountOperations(F, LI, FC);
+    ComputeLiveness(F, LI, FC);
+    return false;
+  }
+
+private:
+  FunctionCostMap &m_Costs;
+  // Maximum trip count of each loop, or zero if it isn't known.
+  DenseMap<Loop *, uint64_t> m_TripBounds;
+
+  void ComputeLoopBounds(LoopInfo &LI, ScalarEvolution &SE, FunctionCost &FC);
+  uint64_t GetBlockWeight(LoopInfo &LI, BasicBlock *BB);
+  void CountOperations(Function &F, LoopInfo &LI, FunctionCost &FC);
+  void ComputeLiveness(Function &F, LoopInfo &LI, FunctionCost &FC);
+};
+
+char DxilShaderCostPass::ID = 0;
+
+void DxilShaderCostPass::ComputeLoopBounds(LoopInfo &LI, ScalarEvolution &SE,
+                                           FunctionCost &FC) {
+  m_TripBounds.clear();
+  std::vector<Loop *> Loops(LI.begin(), LI.end());
+  while (!Loops.empty()) {
+    Loop *L = Loops.back();
+    Loops.pop_back();
+    Loops.insert(Loops.end(), L->begin(), L->end());
+
+    uint64_t Bound = 0;
+    const SCEV *MaxBTC = SE.getMaxBackedgeTakenCount(L);
+    if (const SCEVConstant *C = dyn_cast<SCEVConstant>(MaxBTC)) {
+      const APInt &BTC = C->getValue()->getValue();
+      Bound = BTC.getActiveBits() < 32 ? BTC.getZExtValue() + 1 : UINT32_MAX;
+    }
+    m_TripBounds[L] = Bound;
+
+    FC.LoopCount++;
+    if (Bound == 0)
+      FC.UnboundedLoopCount++;
+    FC.MaxLoopTripCount =
+        std::max(FC.MaxLoopTripCount, static_cast<unsigned>(Bound));
+  }
+}
+
+uint64_t DxilShaderCostPass::GetBlockWeight(LoopInfo &LI, BasicBlock *BB) {
+  uint64_t Weight = 1;
+  for (Loop *L = LI.getLoopFor(BB); L; L = L->getParentLoop()) {
+    uint64_t Bound = m_TripBounds.lookup(L);
+    if (Bound)
+      Weight = Saturate(Weight * Bound);
+  }
+  return Weight;
+}
+
+void DxilShaderCostPass::CountOperations(Function &F, LoopInfo &LI,
+                                         FunctionCost &FC) {
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  for (BasicBlock &BB : F) {
+    uint64_t Weight = GetBlockWeight(LI, &BB);
+    for (Instruction &I : BB) {
+      switch (GetInstructionCost(I)) {
+      case OpCost::Alu:
+        FC.AluOps = Saturate(FC.AluOps + Weight);
+        break;
+      case OpCost::Texture:
+        FC.TextureOps = Saturate(FC.TextureOps + Weight);
+        break;
+      case OpCost::Memory:
+        FC.MemoryOps = Saturate(FC.MemoryOps + Weight);
+        break;
+      case OpCost::None:
+        break;
+      }
+
+      if (Value *Ptr = GetMemoryPointer(I)) {
+        GlobalVariable *GV =
+            dyn_cast<GlobalVariable>(GetUnderlyingObject(Ptr, DL));
+        if (GV && GV->getType()->getPointerAddressSpace() ==
+                      DXIL::kTGSMAddrSpace)
+          FC.GroupShared.insert(GV);
+      }
+    }
+  }
+}
+
+void DxilShaderCostPass::ComputeLiveness(Function &F, LoopInfo &LI,
+                                         FunctionCost &FC) {
+  DxilLiveness Liveness(F);
+
+  // Walk each block backwards from its live-out set to find the peak.
+  unsigned MaxLive = 0;
+  for (BasicBlock &BB : F) {
+    uint64_t Weight = GetBlockWeight(LI, &BB);
+    DxilLiveSet Live;
+    Liveness.GetLiveOut(&BB, Live);
+    MaxLive = std::max(MaxLive, Live.scalars());
+    for (auto It = BB.rbegin(), E = BB.rend(); It != E; ++It) {
+      Instruction &I = *It;
+      if (isa<PHINode>(I))
+        break;
+      // A value is live where it is defined, even if it is never used.
+      Live.insert(&I);
+      MaxLive = std::max(MaxLive, Live.scalars());
+      Live.erase(&I);
+
+      if (CallInst *CI = dyn_cast<CallInst>(&I)) {
+        Function *Callee = CI->getCalledFunction();
+        if (Callee && !Callee->isDeclaration())
+          FC.Calls.push_back({Callee, Weight, Live.scalars()});
+      }
+
+      for (Value *Op : I.operands())
+        Live.insert(Op);
+      MaxLive = std::max(MaxLive, Live.scalars());
+    }
+  }
+  FC.MaxLiveScalars = MaxLive;
+}
+
+struct EntryCostBuilder {
+  const FunctionCostMap &Costs;
+  std::set<Function *> Stack;
+  uint64_t AluOps = 0;
+  uint64_t TextureOps = 0;
+  uint64_t MemoryOps = 0;
+  unsigned LoopCount = 0;
+  unsigned UnboundedLoopCount = 0;
+  unsigned MaxLoopTripCount = 0;
+  std::set<GlobalVariable *> GroupShared;
+
+  EntryCostBuilder(const FunctionCostMap &Costs) : Costs(Costs) {}
+
+  // Adds the cost of Weight runs of F, and returns the peak number of live
+  // scalars while F runs.
+  unsigned Add(Function *F, uint64_t Weight) {
+    auto It = Costs.find(F);
+    // Recursion isn't allowed in DXIL; just stop there if we find any.
+    if (It == Costs.end() || !Stack.insert(F).second)
+      return 0;
+    const FunctionCost &FC = It->second;
+    AluOps = Saturate(AluOps + FC.AluOps * Weight);
+    TextureOps = Saturate(TextureOps + FC.TextureOps * Weight);
+    MemoryOps = Saturate(MemoryOps + FC.MemoryOps * Weight);
+    LoopCount += FC.LoopCount;
+    UnboundedLoopCount += FC.UnboundedLoopCount;
+    MaxLoopTripCount = std::max(MaxLoopTripCount, FC.MaxLoopTripCount);
+    GroupShared.insert(FC.GroupShared.begin(), FC.GroupShared.end());
+
+    unsigned MaxLive = FC.MaxLiveScalars;
+    for (const FunctionCost::Call &C : FC.Calls) {
+      unsigned CalleeLive = Add(C.Callee, Saturate(Weight * C.Weight));
+      MaxLive = std::max(MaxLive, C.LiveAcross + CalleeLive);
+    }
+    Stack.erase(F);
+    return MaxLive;
+  }
+};
+
+DxilEntryCost GetEntryCost(DxilModule &DM, const FunctionCostMap &Costs,
+                           StringRef Name, DXIL::ShaderKind Kind,
+                           Function *F, Function *PatchConstantF) {
+  EntryCostBuilder Builder(Costs);
+  unsigned MaxLive = Builder.Add(F, 1);
+  if (PatchConstantF)
+    MaxLive = std::max(MaxLive, Builder.Add(PatchConstantF, 1));
+
+  const DataLayout &DL = DM.GetModule()->getDataLayout();
+  uint64_t GroupSharedBytes = 0;
+  for (GlobalVariable *GV : Builder.GroupShared)
+    GroupSharedBytes +=
+        DL.getTypeAllocSize(GV->getType()->getPointerElementType());
+
+  DxilEntryCost Entry;
+  Entry.Name = Name;
+  DxilShaderCostEntry &Cost = Entry.Cost;
+  Cost.NameOffset = 0;
+  Cost.ShaderKind = static_cast<uint32_t>(Kind);
+  Cost.AluOps = static_cast<uint32_t>(Builder.AluOps);
+  Cost.TextureOps = static_cast<uint32_t>(Builder.TextureOps);
+  Cost.MemoryOps = static_cast<uint32_t>(Builder.MemoryOps);
+  Cost.MaxLiveScalars = MaxLive;
+  Cost.LoopCount = Builder.LoopCount;
+  Cost.UnboundedLoopCount = Builder.UnboundedLoopCount;
+  Cost.MaxLoopTripCount = Builder.MaxLoopTripCount;
+  Cost.GroupSharedBytes = static_cast<uint32_t>(Saturate(GroupSharedBytes));
+  return Entry;
+}
+
+} // namespace
+
+std::vector<DxilEntryCost> hlsl::ComputeShaderCost(DxilModule &DM) {
+  Module &M = *DM.GetModule();
+  FunctionCostMap Costs;
+  legacy::FunctionPassManager FPM(&M);
+  FPM.add(new DxilShaderCostPass(Costs));
+  FPM.doInitialization();
+  for (Function &F : M) {
+    if (!F.isDeclaration())
+      FPM.run(F);
+  }
+  FPM.doFinalization();
+
+  std::vector<DxilEntryCost> Entries;
+  const ShaderModel *SM = DM.GetShaderModel();
+  if (SM->IsLib()) {
+    for (Function &F : M) {
+      if (F.isDeclaration() || !DM.HasDxilFunctionProps(&F))
+        continue;
+      const DxilFunctionProps &Props = DM.GetDxilFunctionProps(&F);
+      Function *PatchConstantF =
+          Props.IsHS() ? Props.ShaderProps.HS.patchConstantFunc : nullptr;
+      Entries.emplace_back(GetEntryCost(DM, Costs, F.getName(),
+                                        Props.shaderKind, &F, PatchConstantF));
+    }
+  } else if (Function *F = DM.GetEntryFunction()) {
+    Function *PatchConstantF = SM->IsHS() ? DM.GetPatchConstantFunction()
+                                          : nullptr;
+    Entries.emplace_back(GetEntryCost(DM, Costs, DM.GetEntryFunctionName(),
+                                      SM->GetKind(), F, PatchConstantF));
+  }
+  return Entries;
+}
@@ -188,7 +188,10 @@ void DxilAnnotateWithVirtualRegister::AnnotateAlloca(llvm::AllocaInst *pAlloca)
 }
 
 void DxilAnnotateWithVirtualRegister::AnnotateGeneric(llvm::Instruction *pI) {
-  if (!pI->getType()->isFloatTy() && !pI->getType()->isIntegerTy()) {
+  // The scalar types the debug instrumentation knows how to write.
+  llvm::Type *pTy = pI->getType();
+  if (!pTy->isFloatTy() && !pTy->isHalfTy() && !pTy->isDoubleTy() &&
+      !pTy->isIntegerTy()) {
     return;
   }
   AssignNewDxilRegister(pI);
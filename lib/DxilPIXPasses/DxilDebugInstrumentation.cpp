@@ -13,6 +13,7 @@
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/DXIL/DxilOperations.h"
 #include "dxc/DxilPIXPasses/DxilPIXPasses.h"
+#include "dxc/DxilPIXPasses/DxilDebugTraceReplay.h"
 #include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
 #include "dxc/DXIL/DxilUtil.h"
 
@@ -69,6 +70,11 @@ using namespace hlsl;
 // close to the end of the power-of-two size of the UAV. If this value has been overwritten, the debug session
 // is deemed to have overflowed the UAV. The caller will than allocate a UAV that is twice the size and
 // try again, up to a predefined maximum.
+//
+// In minimal mode (option "minimal"), only the steps that can't be recomputed offline are written:
+// values that come from outside the shader's arithmetic (loads, inputs, resource and wave operations
+// and so on), plus a void step naming the first instruction of each block reached through a conditional
+// terminator. pix_dxil::ReplayMinimalDebugTrace rebuilds the full trace from these and the module.
 
 // Keep this in sync with the same-named value in the debugger application's WinPixShaderUtils.h
 constexpr uint64_t DebugBufferDumpingGroundSize = 64 * 1024;
@@ -184,6 +190,7 @@ private:
   };
 
   uint64_t m_UAVSize = 1024*1024;
+  bool m_MinimalInstrumentation = false;
   Value * m_SelectionCriterion = nullptr;
   CallInst * m_HandleForUAV = nullptr;
   Value * m_InvocationId = nullptr;
@@ -232,6 +239,7 @@ private:
   void reserveDebugEntrySpace(BuilderContext &BC, uint32_t SpaceInDwords);
   void addStoreStepDebugEntry(BuilderContext &BC, StoreInst *Inst);
   void addStepDebugEntry(BuilderContext &BC, Instruction *Inst);
+  void addBlockEntryDebugEntry(BuilderContext &BC, BasicBlock *BB);
   void addStepDebugEntryValue(BuilderContext &BC, std::uint32_t InstNum, Value *V, std::uint32_t ValueOrdinal, Value *ValueOrdinalIndex);
   uint32_t UAVDumpingGroundOffset();
   template<typename ReturnType>
@@ -244,6 +252,7 @@ void DxilDebugInstrumentation::applyOptions(PassOptions O) {
   GetPassOptionUnsigned(O, "parameter1", &m_Parameters.Parameters[1], 0);
   GetPassOptionUnsigned(O, "parameter2", &m_Parameters.Parameters[2], 0);
   GetPassOptionUInt64(O, "UAVSize", &m_UAVSize, 1024 * 1024);
+  GetPassOptionBool(O, "minimal", &m_MinimalInstrumentation, false);
 }
 
 uint32_t DxilDebugInstrumentation::UAVDumpingGroundOffset() {
@@ -698,6 +707,19 @@ void DxilDebugInstrumentation::addStepDebugEntry(BuilderContext &BC, Instruction
   addStepDebugEntryValue(BC, InstNum, Inst, RegNum, BC.Builder.getInt32(0));
 }
 
+void DxilDebugInstrumentation::addBlockEntryDebugEntry(BuilderContext &BC, BasicBlock *BB) {
+  // Replay can't follow the branch into a block it can't name.
+  std::uint32_t InstNum;
+  if (!pix_dxil::PixDxilInstNum::FromInst(&BB->front(), &InstNum)) {
+    BC.Ctx.emitError(&BB->front(), "minimal debug instrumentation requires "
+                                   "the first instruction of each branch "
+                                   "target to be numbered");
+    return;
+  }
+
+  addStepEntryForType<void>(DebugShaderModifierRecordTypeDXILStepVoid, BC, InstNum, nullptr, 0, nullptr);
+}
+
 void DxilDebugInstrumentation::addStepDebugEntryValue(BuilderContext &BC, std::uint32_t InstNum, Value *V, std::uint32_t ValueOrdinal, Value *ValueOrdinalIndex) {
   const Type::TypeID ID = V->getType()->getTypeID();
 
@@ -768,6 +790,18 @@ bool DxilDebugInstrumentation::runOnModule(Module &M) {
     AllInstructions.push_back(&*I);
   }
 
+  // In minimal mode, decide what to record before any instrumentation is added:
+  std::unique_ptr<pix_dxil::MinimalDebugTracePlan> MinimalPlan;
+  std::vector<BasicBlock*> RecordedBlocks;
+  if (m_MinimalInstrumentation) {
+    MinimalPlan = llvm::make_unique<pix_dxil::MinimalDebugTracePlan>(*DM.GetEntryFunction());
+    for (BasicBlock &BB : *DM.GetEntryFunction()) {
+      if (MinimalPlan->IsBlockEntryRecorded(&BB)) {
+        RecordedBlocks.push_back(&BB);
+      }
+    }
+  }
+
   // Branchless instrumentation requires taking care of a few things:
   // -Each invocation of the shader will be either of interest or not of interest
   //    -If of interest, the offset into the output UAV will be as expected
@@ -787,8 +821,18 @@ bool DxilDebugInstrumentation::runOnModule(Module &M) {
   addInvocationSelectionProlog(BC, SystemValues);
   addInvocationStartMarker(BC);
 
+  // Instrument entry to blocks whose predecessor can't be deduced offline:
+  for (auto & BB : RecordedBlocks) {
+    IRBuilder<> Builder(BB->getFirstInsertionPt());
+    BuilderContext BC2{ BC.M, BC.DM, BC.Ctx, BC.HlslOP, Builder };
+    addBlockEntryDebugEntry(BC2, BB);
+  }
+
   // Instrument original instructions:
   for (auto & Inst : AllInstructions) {
+    if (MinimalPlan && !MinimalPlan->IsInstructionRecorded(Inst)) {
+      continue;
+    }
     // Instrumentation goes after the instruction if it is not a terminator. Otherwise,
     // Instrumentation goes prior to the instruction.
     if (!Inst->isTerminator()) {
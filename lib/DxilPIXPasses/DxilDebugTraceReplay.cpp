@@ -0,0 +1,373 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilDebugTraceReplay.cpp                                                  //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Decides what minimal debug instrumentation records, and rebuilds the      //
+// full per-instruction trace from a minimal one.                            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DxilPIXPasses/DxilDebugTraceReplay.h"
+#include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace pix_dxil;
+
+bool MinimalDebugTracePlan::HasStep(Instruction *I) {
+  std::uint32_t InstNum;
+  if (!PixDxilInstNum::FromInst(I, &InstNum))
+    return false;
+
+  if (auto *St = dyn_cast<StoreInst>(I)) {
+    std::uint32_t RegBase, RegSize;
+    Value *Index;
+    return PixAllocaRegWrite::FromInst(St, &RegBase, &RegSize, &Index);
+  }
+
+  // Phis aren't stepped, as there is nowhere to put instrumentation for them.
+  std::uint32_t RegNum;
+  return !isa<PHINode>(I) && PixDxilReg::FromInst(I, &RegNum);
+}
+
+bool MinimalDebugTracePlan::IsComputable(const Instruction *I) {
+  if (isa<StoreInst>(I) || isa<TerminatorInst>(I))
+    return true;
+
+  // Pointers are never evaluated; only the values loaded through them are,
+  // and loads are always recorded.
+  if (I->getType()->isPointerTy())
+    return isa<GetElementPtrInst>(I) || isa<AllocaInst>(I);
+  for (const Value *Op : I->operands()) {
+    if (Op->getType()->isPointerTy() && !isa<Function>(Op))
+      return false;
+  }
+
+  if (isa<PHINode>(I) || isa<BinaryOperator>(I) || isa<CmpInst>(I) ||
+      isa<SelectInst>(I) || isa<CastInst>(I) || isa<ExtractValueInst>(I) ||
+      isa<InsertValueInst>(I))
+    return true;
+
+  // Only integer dxil intrinsics are bit-exact when evaluated on the CPU.
+  if (const CallInst *CI = dyn_cast<CallInst>(I)) {
+    const Function *F = CI->getCalledFunction();
+    return F && hlsl::OP::IsDxilOpFunc(F) && CI->getType()->isIntegerTy() &&
+           canConstantFoldCallTo(F);
+  }
+
+  return false;
+}
+
+MinimalDebugTracePlan::MinimalDebugTracePlan(Function &F) {
+  // Values that are neither recorded nor computable from recorded values.
+  DenseSet<const Value *> Unavailable;
+  SmallVector<Instruction *, 16> Worklist;
+
+  auto MarkUnavailable = [&](Instruction *I) {
+    if (isa<TerminatorInst>(I) || I->getType()->isPointerTy())
+      return;
+    if (HasStep(I))
+      m_Recorded.insert(I);
+    else if (Unavailable.insert(I).second)
+      Worklist.push_back(I);
+  };
+
+  for (Instruction &I : inst_range(F)) {
+    if (!IsComputable(&I))
+      MarkUnavailable(&I);
+  }
+
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.pop_back_val();
+    for (User *U : I->users()) {
+      if (auto *UI = dyn_cast<Instruction>(U))
+        MarkUnavailable(UI);
+    }
+  }
+
+  // The register index of a store is read through its GEP.
+  for (Instruction &I : inst_range(F)) {
+    auto *St = dyn_cast<StoreInst>(&I);
+    if (St == nullptr || !HasStep(St))
+      continue;
+    std::uint32_t RegBase, RegSize;
+    Value *Index;
+    PixAllocaRegWrite::FromInst(St, &RegBase, &RegSize, &Index);
+    if (Unavailable.count(Index))
+      m_Recorded.insert(St);
+  }
+}
+
+bool MinimalDebugTracePlan::IsBlockEntryRecorded(const BasicBlock *BB) const {
+  for (const BasicBlock *Pred : predecessors(BB)) {
+    if (Pred->getTerminator()->getNumSuccessors() > 1)
+      return true;
+  }
+  return false;
+}
+
+namespace {
+
+class TraceReplayer {
+public:
+  TraceReplayer(Function &F, ArrayRef<DebugTraceStep> Recorded,
+                std::vector<DebugTraceStep> &Full, std::string &Error)
+      : m_Plan(F), m_DL(F.getParent()->getDataLayout()), m_Recorded(Recorded),
+        m_Full(Full), m_Error(Error) {}
+
+  bool Run(Function &F);
+
+private:
+  Constant *GetValue(Value *V) {
+    if (Constant *C = dyn_cast<Constant>(V))
+      return C;
+    auto It = m_Values.find(V);
+    return It == m_Values.end() ? nullptr : It->second;
+  }
+  Constant *Evaluate(Instruction *I);
+  bool ReplayBlock(BasicBlock *BB, BasicBlock *Pred);
+  bool Fail(const Twine &Message) {
+    m_Error = Message.str();
+    return false;
+  }
+  bool AtEnd() const { return m_Next == m_Recorded.size(); }
+
+  static Constant *FromBits(Type *Ty, std::uint64_t Bits);
+  static bool ToBits(Constant *C, std::uint64_t *pBits);
+  static std::uint32_t InstNum(Instruction *I) {
+    std::uint32_t Num = UINT32_MAX;
+    PixDxilInstNum::FromInst(I, &Num);
+    return Num;
+  }
+
+  MinimalDebugTracePlan m_Plan;
+  const DataLayout &m_DL;
+  ArrayRef<DebugTraceStep> m_Recorded;
+  size_t m_Next = 0;
+  bool m_Truncated = false;
+  std::vector<DebugTraceStep> &m_Full;
+  std::string &m_Error;
+  DenseMap<const Value *, Constant *> m_Values;
+};
+
+// Values are recorded the way DxilDebugInstrumentation writes them: integers
+// zero-extended, doubles as their 64 bits, and halves widened to float.
+Constant *TraceReplayer::FromBits(Type *Ty, std::uint64_t Bits) {
+  if (Ty->isIntegerTy())
+    return ConstantInt::get(Ty, Bits);
+  if (Ty->isFloatTy() || Ty->isHalfTy()) {
+    APFloat F(APFloat::IEEEsingle, APInt(32, Bits));
+    if (Ty->isHalfTy()) {
+      bool LosesInfo;
+      F.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven, &LosesInfo);
+    }
+    return ConstantFP::get(Ty->getContext(), F);
+  }
+  if (Ty->isDoubleTy())
+    return ConstantFP::get(Ty->getContext(),
+                           APFloat(APFloat::IEEEdouble, APInt(64, Bits)));
+  return nullptr;
+}
+
+bool TraceReplayer::ToBits(Constant *C, std::uint64_t *pBits) {
+  if (auto *CI = dyn_cast<ConstantInt>(C)) {
+    *pBits = CI->getZExtValue();
+    return true;
+  }
+  if (auto *CF = dyn_cast<ConstantFP>(C)) {
+    APFloat F = CF->getValueAPF();
+    if (CF->getType()->isHalfTy()) {
+      bool LosesInfo;
+      F.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &LosesInfo);
+    }
+    *pBits = F.bitcastToAPInt().getZExtValue();
+    return true;
+  }
+  if (isa<UndefValue>(C)) {
+    *pBits = 0;
+    return true;
+  }
+  return false;
+}
+
+Constant *TraceReplayer::Evaluate(Instruction *I) {
+  if (auto *St = dyn_cast<StoreInst>(I))
+    return GetValue(St->getValueOperand());
+
+  SmallVector<Constant *, 8> Ops;
+  if (auto *CI = dyn_cast<CallInst>(I)) {
+    for (Value *Arg : CI->arg_operands()) {
+      Constant *C = GetValue(Arg);
+      if (!C)
+        return nullptr;
+      Ops.push_back(C);
+    }
+    return ConstantFoldCall(CI->getCalledFunction(), Ops);
+  }
+
+  for (Value *Op : I->operands()) {
+    Constant *C = GetValue(Op);
+    if (!C)
+      return nullptr;
+    Ops.push_back(C);
+  }
+
+  if (auto *Cmp = dyn_cast<CmpInst>(I))
+    return ConstantFoldCompareInstOperands(Cmp->getPredicate(), Ops[0], Ops[1],
+                                           m_DL);
+  if (auto *EVI = dyn_cast<ExtractValueInst>(I))
+    return ConstantExpr::getExtractValue(Ops[0], EVI->getIndices());
+  if (auto *IVI = dyn_cast<InsertValueInst>(I))
+    return ConstantExpr::getInsertValue(Ops[0], Ops[1], IVI->getIndices());
+  return ConstantFoldInstOperands(I->getOpcode(), I->getType(), Ops, m_DL);
+}
+
+bool TraceReplayer::ReplayBlock(BasicBlock *BB, BasicBlock *Pred) {
+  // Phis read their incoming values simultaneously.
+  SmallVector<std::pair<PHINode *, Constant *>, 4> PhiValues;
+  for (Instruction &I : *BB) {
+    auto *Phi = dyn_cast<PHINode>(&I);
+    if (!Phi)
+      break;
+    Constant *C = Pred ? GetValue(Phi->getIncomingValueForBlock(Pred)) : nullptr;
+    PhiValues.emplace_back(Phi, C);
+  }
+  for (auto &PhiValue : PhiValues) {
+    if (PhiValue.second)
+      m_Values[PhiValue.first] = PhiValue.second;
+    else
+      m_Values.erase(PhiValue.first);
+  }
+
+  for (Instruction &I : *BB) {
+    if (isa<PHINode>(I) || isa<TerminatorInst>(I) ||
+        I.getType()->isPointerTy())
+      continue;
+
+    Constant *Result = nullptr;
+    if (m_Plan.IsInstructionRecorded(&I)) {
+      if (AtEnd()) {
+        m_Truncated = true;
+        return true;
+      }
+      const DebugTraceStep &Step = m_Recorded[m_Next++];
+      if (Step.InstNum != InstNum(&I) || !Step.HasValue)
+        return Fail(Twine("expected value step for instruction ") +
+                    Twine(InstNum(&I)) + ", found instruction " +
+                    Twine(Step.InstNum));
+      Type *Ty = isa<StoreInst>(I)
+                     ? cast<StoreInst>(I).getValueOperand()->getType()
+                     : I.getType();
+      Result = FromBits(Ty, Step.Value);
+      if (!Result)
+        return Fail(Twine("cannot read recorded value of instruction ") +
+                    Twine(Step.InstNum));
+    } else if (MinimalDebugTracePlan::IsComputable(&I)) {
+      Result = Evaluate(&I);
+    }
+
+    if (!isa<StoreInst>(I)) {
+      if (Result)
+        m_Values[&I] = Result;
+      else
+        m_Values.erase(&I);
+    }
+
+    if (!MinimalDebugTracePlan::HasStep(&I))
+      continue;
+
+    DebugTraceStep Step;
+    Step.InstNum = InstNum(&I);
+    Step.HasValue = true;
+    if (!Result || !ToBits(Result, &Step.Value))
+      return Fail(Twine("cannot recompute instruction ") + Twine(Step.InstNum));
+    if (auto *St = dyn_cast<StoreInst>(&I)) {
+      std::uint32_t RegSize;
+      Value *Index;
+      PixAllocaRegWrite::FromInst(St, &Step.ValueOrdinal, &RegSize, &Index);
+      auto *IndexValue = dyn_cast_or_null<ConstantInt>(GetValue(Index));
+      if (!IndexValue)
+        return Fail(Twine("cannot recompute register index of instruction ") +
+                    Twine(Step.InstNum));
+      Step.ValueOrdinalIndex = IndexValue->getZExtValue() & 0xFFFF;
+    } else {
+      PixDxilReg::FromInst(&I, &Step.ValueOrdinal);
+    }
+    m_Full.push_back(Step);
+  }
+  return true;
+}
+
+bool TraceReplayer::Run(Function &F) {
+  BasicBlock *BB = &F.getEntryBlock();
+  BasicBlock *Pred = nullptr;
+  for (;;) {
+    if (!ReplayBlock(BB, Pred))
+      return false;
+    // A trace cut short (e.g. by UAV overflow) yields a partial replay.
+    if (m_Truncated)
+      return true;
+
+    TerminatorInst *T = BB->getTerminator();
+    if (T->getNumSuccessors() == 0) {
+      if (!AtEnd())
+        return Fail("trace continues past the end of the function");
+      return true;
+    }
+
+    BasicBlock *Succ = T->getSuccessor(0);
+    if (T->getNumSuccessors() == 1 && !m_Plan.IsBlockEntryRecorded(Succ)) {
+      Pred = BB;
+      BB = Succ;
+      continue;
+    }
+
+    if (AtEnd())
+      return true;
+    const DebugTraceStep &Step = m_Recorded[m_Next++];
+    Succ = nullptr;
+    for (unsigned i = 0; i < T->getNumSuccessors(); ++i) {
+      // Block entry steps name the first instruction of the block, so
+      // without a number the trace can't say which way the branch went.
+      std::uint32_t SuccNum;
+      if (!PixDxilInstNum::FromInst(&T->getSuccessor(i)->front(), &SuccNum))
+        return Fail(Twine("successor ") + Twine(i) + " of instruction " +
+                    Twine(InstNum(T)) +
+                    " starts with an instruction that has no number");
+      if (!Step.HasValue && SuccNum == Step.InstNum) {
+        Succ = T->getSuccessor(i);
+        break;
+      }
+    }
+    if (!Succ)
+      return Fail(Twine("expected block entry step after instruction ") +
+                  Twine(InstNum(T)) + ", found instruction " +
+                  Twine(Step.InstNum));
+    Pred = BB;
+    BB = Succ;
+  }
+}
+
+} // namespace
+
+bool pix_dxil::ReplayMinimalDebugTrace(Function &F,
+                                       ArrayRef<DebugTraceStep> Recorded,
+                                       std::vector<DebugTraceStep> &Full,
+                                       std::string &Error) {
+  TraceReplayer Replayer(F, Recorded, Full, Error);
+  return Replayer.Run(F);
+}
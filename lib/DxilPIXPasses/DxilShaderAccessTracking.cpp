@@ -15,12 +15,16 @@
 #include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/DXIL/DxilModule.h"
 #include "dxc/DxilPIXPasses/DxilPIXPasses.h"
+#include "dxc/DxilPIXPasses/DxilShaderAccessTrackingDecoder.h"
 #include "dxc/HLSL/DxilSpanAllocator.h"
 
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
-#include <deque>
+#include <tuple>
 
 #ifdef _WIN32
 #include <winerror.h>
@@ -28,6 +32,7 @@
 
 using namespace llvm;
 using namespace hlsl;
+using namespace pix_dxil;
 
 
 void ThrowIf(bool a)
@@ -37,57 +42,6 @@ void ThrowIf(bool a)
   }
 }
 
-//---------------------------------------------------------------------------------------------------------------------------------
-// These types are taken from PIX's ShaderAccessHelpers.h
-
-enum class ShaderAccessFlags : uint32_t
-{
-  None = 0,
-  Read = 1 << 0,
-  Write = 1 << 1,
-
-  // "Counter" access is only applicable to UAVs; it means the counter buffer attached to the UAV
-  // was accessed, but not necessarily the UAV resource.
-  Counter = 1 << 2,
-
-  // Descriptor-only read (if any), but not the resource contents (if any).
-  // Used for GetDimensions, samplers, and secondary texture for sampler feedback.
-  // TODO: Make this a unique value if supported in PIX, then enable GetDimensions
-  DescriptorRead = 1 << 0,
-};
-
-constexpr uint32_t DWORDsPerResource = 3;
-constexpr uint32_t BytesPerDWORD = 4;
-
-static uint32_t OffsetFromAccess(ShaderAccessFlags access) {
-  switch (access) {
-  case ShaderAccessFlags::Read:
-    return 0;
-  case ShaderAccessFlags::Write:
-    return 1;
-  case ShaderAccessFlags::Counter:
-    return 2;
-  default:
-    throw ::hlsl::Exception(E_INVALIDARG);
-  }
-}
-
-// This enum doesn't have to match PIX's version, because the values are received from PIX encoded in ASCII.
-// However, for ease of comparing this code with PIX, and to be less confusing to future maintainers, this
-// enum does indeed match the same-named enum in PIX.
-enum class RegisterType
-{
-  CBV,
-  SRV,
-  UAV,
-  RTV, // not used. 
-  DSV, // not used. 
-  Sampler,
-  SOV, // not used.
-  Invalid,
-  Terminator
-};
-
 RegisterType RegisterTypeFromResourceClass(DXIL::ResourceClass c) {
   switch (c)
   {
@@ -102,16 +56,6 @@ RegisterType RegisterTypeFromResourceClass(DXIL::ResourceClass c) {
   }
 }
 
-struct RegisterTypeAndSpace
-{
-  bool operator < (const RegisterTypeAndSpace & o) const {
-    return static_cast<int>(Type) < static_cast<int>(o.Type) ||
-      (static_cast<int>(Type) == static_cast<int>(o.Type) && Space < o.Space);
-  }
-  RegisterType Type;
-  unsigned     Space;
-};
-
 // Identifies a bind point as defined by the root signature
 struct RSRegisterIdentifier
 {
@@ -127,22 +71,20 @@ struct RSRegisterIdentifier
   }
 };
 
-struct SlotRange
-{
-  unsigned startSlot;
-  unsigned numSlots;
-
-  // Number of slots needed if no descriptors from unbounded ranges are included
-  unsigned numInvariableSlots;
-};
-
-
 struct DxilResourceAndClass {
   DxilResourceBase * resource;
   Value * index;
   DXIL::ResourceClass resClass;
 };
 
+// An access to be instrumented when aggregating: accesses are hoisted out of
+// loops and deduplicated before any instrumentation is emitted.
+struct QueuedAccess {
+  DxilResourceAndClass res;
+  Instruction * insertBefore;
+  ShaderAccessFlags readWrite;
+};
+
 //---------------------------------------------------------------------------------------------------------------------------------
 
 class DxilShaderAccessTracking : public ModulePass {
@@ -156,96 +98,39 @@ public:
 private:
   void EmitAccess(LLVMContext & Ctx, OP *HlslOP, IRBuilder<> &, Value *slot, ShaderAccessFlags access);
   bool EmitResourceAccess(DxilResourceAndClass &res, Instruction * instruction, OP * HlslOP, LLVMContext & Ctx, ShaderAccessFlags readWrite);
+  void QueueResourceAccess(DxilResourceAndClass &res, Instruction * instruction, ShaderAccessFlags readWrite);
+  bool EmitQueuedAccesses(OP * HlslOP, LLVMContext & Ctx);
 
 private:
+  struct FunctionLoops {
+    DominatorTree DT;
+    LoopInfo LI;
+  };
+  FunctionLoops &GetLoops(Function &F);
+
   bool m_CheckForDynamicIndexing = false;
+  // Aggregate accesses: hoist loop-invariant accesses out of loops, emit each
+  // access once per block, and have only one lane per distinct slot in a
+  // wave write to the tracking UAV.
+  bool m_AggregateAccesses = false;
+  std::vector<QueuedAccess> m_QueuedAccesses;
+  std::map<std::tuple<BasicBlock*, DxilResourceBase*, Value*, unsigned>, size_t> m_QueuedAccessIndices;
+  std::map<Function*, std::unique_ptr<FunctionLoops>> m_FunctionLoops;
   std::map<RegisterTypeAndSpace, SlotRange> m_slotAssignments;
   std::map<llvm::Function*, CallInst *> m_FunctionToUAVHandle;
   std::set<RSRegisterIdentifier> m_DynamicallyIndexedBindPoints;
 };
 
-static unsigned DeserializeInt(std::deque<char> & q) {
-  unsigned i = 0;
-
-  while(!q.empty() && isdigit(q.front()))
-  {
-    i *= 10;
-    i += q.front() - '0';
-    q.pop_front();
-  }
-  return i;
-}
-
-static char DequeFront(std::deque<char> & q) {
-  ThrowIf(q.empty());
-  auto c = q.front();
-  q.pop_front();
-  return c;
-}
-
-static RegisterType ParseRegisterType(std::deque<char> & q) {
-  switch (DequeFront(q))
-  {
-  case 'C': return RegisterType::CBV;
-  case 'S': return RegisterType::SRV;
-  case 'U': return RegisterType::UAV;
-  case 'M': return RegisterType::Sampler;
-  case 'I': return RegisterType::Invalid;
-  default: return RegisterType::Terminator;
-  }
-}
-
-static char EncodeRegisterType(RegisterType r) {
-  switch (r)
-  {
-  case RegisterType::CBV:     return 'C';
-  case RegisterType::SRV:     return 'S';
-  case RegisterType::UAV:     return 'U';
-  case RegisterType::Sampler: return 'M';
-  case RegisterType::Invalid: return 'I';
-  }
-  return '.';
-}
-
-static void ValidateDelimiter(std::deque<char> & q, char d) {
-  ThrowIf(q.front() != d);
-  q.pop_front();
-}
-
 void DxilShaderAccessTracking::applyOptions(PassOptions O) {
   int checkForDynamic;
   GetPassOptionInt(O, "checkForDynamicIndexing", &checkForDynamic, 0);
   m_CheckForDynamicIndexing = checkForDynamic != 0;
 
+  GetPassOptionBool(O, "aggregate", &m_AggregateAccesses, false);
+
   StringRef configOption;
   if (GetPassOption(O, "config", &configOption)) {
-    std::deque<char> config;
-    config.assign(configOption.begin(), configOption.end());
-
-    // Parse slot assignments. Compare with PIX's ShaderAccessHelpers.cpp (TrackingConfiguration::SerializedRepresentation)
-    RegisterType rt = ParseRegisterType(config);
-    while (rt != RegisterType::Terminator) {
-
-      RegisterTypeAndSpace rst;
-      rst.Type = rt;
-
-      rst.Space = DeserializeInt(config);
-      ValidateDelimiter(config, ':');
-
-      SlotRange sr;
-      sr.startSlot = DeserializeInt(config);
-      ValidateDelimiter(config, ':');
-
-      sr.numSlots = DeserializeInt(config);
-      ValidateDelimiter(config, 'i');
-
-      sr.numInvariableSlots = DeserializeInt(config);
-      ValidateDelimiter(config, ';');
-
-      m_slotAssignments[rst] = sr;
-
-      rt = ParseRegisterType(config);
-    }
+    ThrowIf(!ParseSlotAssignments(configOption.str(), m_slotAssignments));
   }
 }
 
@@ -254,9 +139,28 @@ void DxilShaderAccessTracking::EmitAccess(LLVMContext &Ctx, OP *HlslOP,
                                           Value *ByteIndex,
                                           ShaderAccessFlags access) {
   
-  unsigned OffsetForAccessType = static_cast<unsigned>(OffsetFromAccess(access) * BytesPerDWORD);
+  int AccessOffset = OffsetFromAccess(access);
+  ThrowIf(AccessOffset < 0);
+  unsigned OffsetForAccessType = static_cast<unsigned>(AccessOffset * BytesPerDWORD);
   auto OffsetByteIndex = Builder.CreateAdd(ByteIndex, HlslOP->GetU32Const(OffsetForAccessType), "OffsetByteIndex");
 
+  if (m_AggregateAccesses) {
+    // All lanes of the wave that access the same slot as the first active lane
+    // leave the write to that lane.
+    Function* IsFirstLaneFunc = HlslOP->GetOpFunc(OP::OpCode::WaveIsFirstLane, Type::getVoidTy(Ctx));
+    Constant* IsFirstLaneOpcode = HlslOP->GetU32Const((unsigned)OP::OpCode::WaveIsFirstLane);
+    Value* ShouldWrite = Builder.CreateCall(IsFirstLaneFunc, { IsFirstLaneOpcode }, "IsFirstLane");
+    if (!isa<Constant>(ByteIndex)) {
+      Function* ReadLaneFirstFunc = HlslOP->GetOpFunc(OP::OpCode::WaveReadLaneFirst, Type::getInt32Ty(Ctx));
+      Constant* ReadLaneFirstOpcode = HlslOP->GetU32Const((unsigned)OP::OpCode::WaveReadLaneFirst);
+      auto FirstLaneByteIndex = Builder.CreateCall(ReadLaneFirstFunc, { ReadLaneFirstOpcode, ByteIndex }, "FirstLaneByteIndex");
+      auto DiffersFromFirstLane = Builder.CreateICmpNE(ByteIndex, FirstLaneByteIndex, "DiffersFromFirstLane");
+      ShouldWrite = Builder.CreateOr(ShouldWrite, DiffersFromFirstLane, "ShouldWriteAccess");
+    }
+    TerminatorInst* WriteTerm = SplitBlockAndInsertIfThen(ShouldWrite, &*Builder.GetInsertPoint(), false);
+    Builder.SetInsertPoint(WriteTerm);
+  }
+
   UndefValue* UndefIntArg = UndefValue::get(Type::getInt32Ty(Ctx));
   Constant* LiteralOne = HlslOP->GetU32Const(1);
   Constant* ElementMask = HlslOP->GetI8Const(1);
@@ -325,6 +229,66 @@ bool DxilShaderAccessTracking::EmitResourceAccess(DxilResourceAndClass &res, Ins
 }
 
 
+DxilShaderAccessTracking::FunctionLoops &DxilShaderAccessTracking::GetLoops(Function &F) {
+  auto &Loops = m_FunctionLoops[&F];
+  if (!Loops) {
+    Loops = llvm::make_unique<FunctionLoops>();
+    Loops->DT.recalculate(F);
+    Loops->LI.Analyze(Loops->DT);
+  }
+  return *Loops;
+}
+
+void DxilShaderAccessTracking::QueueResourceAccess(DxilResourceAndClass &res, Instruction * instruction, ShaderAccessFlags readWrite) {
+  FunctionLoops &Loops = GetLoops(*instruction->getParent()->getParent());
+
+  // Hoist the access to the preheader of each enclosing loop whose iterations
+  // all perform it with the same index. The access must execute before any
+  // exit from the loop, so that entering the loop implies the access.
+  Instruction * insertBefore = instruction;
+  for (Loop * L = Loops.LI.getLoopFor(instruction->getParent()); L; L = L->getParentLoop()) {
+    BasicBlock * Preheader = L->getLoopPreheader();
+    if (!Preheader || !L->isLoopInvariant(res.index))
+      break;
+    SmallVector<BasicBlock *, 4> ExitingBlocks;
+    L->getExitingBlocks(ExitingBlocks);
+    bool DominatesExits = true;
+    for (BasicBlock * Exiting : ExitingBlocks) {
+      DominatesExits &= Loops.DT.dominates(instruction->getParent(), Exiting);
+    }
+    if (!DominatesExits)
+      break;
+    insertBefore = Preheader->getTerminator();
+  }
+
+  // The same access need only be recorded once per block, by its first occurrence.
+  auto key = std::make_tuple(insertBefore->getParent(), res.resource, res.index, static_cast<unsigned>(readWrite));
+  auto existing = m_QueuedAccessIndices.find(key);
+  if (existing != m_QueuedAccessIndices.end()) {
+    QueuedAccess &queued = m_QueuedAccesses[existing->second];
+    if (Loops.DT.dominates(insertBefore, queued.insertBefore))
+      queued.insertBefore = insertBefore;
+    return;
+  }
+  m_QueuedAccessIndices[key] = m_QueuedAccesses.size();
+  m_QueuedAccesses.push_back({ res, insertBefore, readWrite });
+}
+
+bool DxilShaderAccessTracking::EmitQueuedAccesses(OP * HlslOP, LLVMContext & Ctx) {
+  // Splitting blocks invalidates the dominator trees and loop info.
+  m_FunctionLoops.clear();
+  m_QueuedAccessIndices.clear();
+
+  bool Modified = false;
+  for (QueuedAccess &queued : m_QueuedAccesses) {
+    if (EmitResourceAccess(queued.res, queued.insertBefore, HlslOP, Ctx, queued.readWrite)) {
+      Modified = true;
+    }
+  }
+  m_QueuedAccesses.clear();
+  return Modified;
+}
+
 DxilResourceAndClass GetResourceFromHandle(Value * resHandle, DxilModule &DM) {
 
   DxilResourceAndClass ret{ nullptr, nullptr, DXIL::ResourceClass::Invalid };
@@ -509,7 +473,10 @@ bool DxilShaderAccessTracking::runOnModule(Module &M)
           if (res.resClass == DXIL::ResourceClass::UAV && res.resource->GetSpaceID() == (unsigned)-2) {
             break;
           }
-          if (EmitResourceAccess(res, Call, HlslOP, Ctx, readWrite)) {
+          if (m_AggregateAccesses) {
+            QueueResourceAccess(res, Call, readWrite);
+          }
+          else if (EmitResourceAccess(res, Call, HlslOP, Ctx, readWrite)) {
             Modified = true;
           }
           // Remaining resources are DescriptorRead.
@@ -518,6 +485,13 @@ bool DxilShaderAccessTracking::runOnModule(Module &M)
       }
     }
 
+    if (m_AggregateAccesses) {
+      if (EmitQueuedAccesses(HlslOP, Ctx)) {
+        Modified = true;
+        DM.m_ShaderFlags.SetWaveOps(true);
+      }
+    }
+
     if (OSOverride != nullptr) {
       formatted_raw_ostream FOS(*OSOverride);
       FOS << "DynamicallyIndexedBindPoints=";
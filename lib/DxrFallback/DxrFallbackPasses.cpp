@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxrFallbackPasses.cpp                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides SetupRegistryPassForDxrFallback.                                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/Support/Global.h"
+#include "dxc/DxrFallback/DxrFallbackPasses.h"
+
+#include "llvm/Pass.h"
+#include "llvm/PassInfo.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace hlsl {
+
+HRESULT SetupRegistryPassForDxrFallback() {
+  try
+  {
+    PassRegistry &Registry = *PassRegistry::getPassRegistry();
+    /* <py::lines('INIT-PASSES')>hctdb_instrhelp.get_init_passes(set(["dxrfallback"]))</py>*/
+    // INIT-PASSES:BEGIN
+    initializeDxrStateFunctionTransformPass(Registry);
+    // INIT-PASSES:END
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+}
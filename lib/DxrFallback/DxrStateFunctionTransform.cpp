@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxrStateFunctionTransform.cpp                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a pass that runs StateFunctionTransform on a module, so that     //
+// stack frame layout and callsite save/restore can be tested on IR.         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DxrFallback/DxrFallbackPasses.h"
+
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+#include "StateFunctionTransform.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Transforms the functions named by the candidates option, in order, into
+// state functions. Candidates that are only declared are callees that are
+// treated as continuations. State IDs are left as dummyStateId placeholders,
+// since they depend on the other shaders linked into the fallback compute
+// shader.
+class DxrStateFunctionTransform : public ModulePass {
+  std::vector<std::string> m_Candidates;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxrStateFunctionTransform() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXR fallback state function transform";
+  }
+
+  void applyOptions(PassOptions O) override {
+    StringRef Candidates;
+    if (GetPassOption(O, "candidates", &Candidates)) {
+      SmallVector<StringRef, 4> Names;
+      Candidates.split(Names, ";", -1, false);
+      for (StringRef Name : Names)
+        m_Candidates.emplace_back(Name.trim().str());
+    }
+  }
+
+  bool runOnModule(Module &M) override;
+};
+
+char DxrStateFunctionTransform::ID = 0;
+
+// Matches the unmangled names StateFunctionTransform uses for candidates.
+StringRef GetCandidateName(StringRef Name) {
+  if (!Name.startswith("\x1?"))
+    return Name;
+  size_t Pos = Name.find("@@");
+  if (Pos == StringRef::npos)
+    return Name;
+  return Name.substr(2, Pos - 2);
+}
+
+bool DxrStateFunctionTransform::runOnModule(Module &M) {
+  std::vector<Function *> Functions;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    StringRef Name = GetCandidateName(F.getName());
+    if (std::find(m_Candidates.begin(), m_Candidates.end(), Name) !=
+        m_Candidates.end())
+      Functions.emplace_back(&F);
+  }
+  if (Functions.empty())
+    return false;
+
+  // Use the runtime's type for the runtime data argument when the runtime is
+  // present.
+  Type *RuntimeDataArgTy = Type::getInt8PtrTy(M.getContext());
+  if (Function *StackIntPtr = M.getFunction("stackIntPtr"))
+    RuntimeDataArgTy = StackIntPtr->arg_begin()->getType();
+
+  std::set<Value *> Resources;
+  if (M.HasDxilModule()) {
+    DxilModule &DM = M.GetDxilModule();
+    for (auto &R : DM.GetCBuffers())
+      Resources.insert(R->GetGlobalSymbol());
+    for (auto &R : DM.GetUAVs())
+      Resources.insert(R->GetGlobalSymbol());
+    for (auto &R : DM.GetSRVs())
+      Resources.insert(R->GetGlobalSymbol());
+    for (auto &R : DM.GetSamplers())
+      Resources.insert(R->GetGlobalSymbol());
+  }
+
+  for (Function *F : Functions) {
+    StateFunctionTransform SFT(F, m_Candidates, RuntimeDataArgTy);
+    SFT.setResourceGlobals(Resources);
+    std::vector<Function *> StateFunctions;
+    unsigned int ShaderStackSize = 0;
+    SFT.run(StateFunctions, ShaderStackSize);
+  }
+  return true;
+}
+
+}
+
+ModulePass *llvm::createDxrStateFunctionTransformPass() {
+  return new DxrStateFunctionTransform();
+}
+
+INITIALIZE_PASS(DxrStateFunctionTransform, "hlsl-dxr-state-functions",
+                "DXR fallback state function transform", false, false)
@@ -1,5 +1,6 @@
 #include "StateFunctionTransform.h"
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/InstIterator.h"
@@ -509,16 +510,19 @@ public:
   Rematerializer(
     DenseMap<AllocaInst*, Instruction*>& allocaToVal,
     const InstructionSetVector& liveHere,
-    const std::set<Value*>& resources
+    const std::set<Value*>& resources,
+    const DataLayout& DL
   )
     : m_allocaToVal(allocaToVal)
     , m_liveHere(liveHere)
     , m_resources(resources)
+    , m_DL(DL)
   {}
 
 
-  // Returns true if inst can be rematerialized.
-  bool canRematerialize(Instruction* inst)
+  // Returns true if inst must be rematerialized because it can't be saved to
+  // the stack, or because rematerializing it is trivially cheap.
+  bool mustRematerialize(Instruction* inst)
   {
     if (CallInst* call = dyn_cast<CallInst>(inst))
     {
@@ -550,10 +554,33 @@ public:
   }
 
 
+  // Returns true if inst can be rematerialized, and doing so is cheaper than
+  // saving and restoring it.
+  bool canRematerialize(Instruction* inst)
+  {
+    if (mustRematerialize(inst))
+      return true;
+
+    auto it = m_decisions.find(inst);
+    if (it != m_decisions.end())
+      return it->second.remat;
+
+    // Mark as not rematerialized while computing the cost to break cycles
+    // through reg2mem'd values.
+    m_decisions[inst] = Decision();
+    Decision decision;
+    decision.spillCost = getSpillCost(inst);
+    decision.rematCost = getRematCost(inst, decision.height);
+    decision.remat = decision.rematCost < decision.spillCost;
+    m_decisions[inst] = decision;
+    return decision.remat;
+  }
+
+
   // Rematerialize the given instruction and its dependency graph, adding 
   // any nonrematerializable values that are live in the function, but not 
   // at this callsite to the work list to insure that their values are restored.
-  Instruction* rematerialize(Instruction* inst, std::vector<Instruction *> workList, Instruction* insertBefore, int depth = 0)
+  Instruction* rematerialize(Instruction* inst, std::vector<Instruction *>& workList, Instruction* insertBefore, int depth = 0)
   {
     // Signal if we hit a complex case. Deep rematerialization needs more analysis.
     // To make this robust we would need to make it possible to run the current
@@ -610,6 +637,22 @@ public:
   }
 
 
+  // Prints the cost-based decisions made at this callsite.
+  void printDecisions(raw_ostream& out) const
+  {
+    for (auto& kv : m_decisions)
+    {
+      const Decision& decision = kv.second;
+      out << (decision.remat ? "remat" : "spill");
+      if (decision.rematCost == InfiniteCost)
+        out << " (remat cost: n/a";
+      else
+        out << " (remat cost: " << decision.rematCost;
+      out << ", spill cost: " << decision.spillCost << "): " << *kv.first << "\n";
+    }
+  }
+
+
   Instruction* getRematerializedValueFor(Instruction* val)
   {
     auto it = m_rematMap.find(val);
@@ -621,10 +664,96 @@ public:
 
 
 private:
+  // Costs are in units of ALU instructions.
+  static const unsigned InfiniteCost = ~0u;
+  static const unsigned MemoryAccessCost = 4; // per DWORD of stack memory
+  static const unsigned MaxRematDepth = 4;
+
+  struct Decision
+  {
+    bool     remat = false;
+    unsigned rematCost = InfiniteCost;
+    unsigned spillCost = InfiniteCost;
+    unsigned height = 0;
+  };
+
   DenseMap<Instruction*, Instruction*> m_rematMap;    // Map instructions to their rematerialized counterparts
   DenseMap<AllocaInst*, Instruction*>& m_allocaToVal; // Map allocas for reg2mem'd live values back to the value
   const InstructionSetVector& m_liveHere;             // Values live at this callsite
   const std::set<Value*>& m_resources;                // Values for resources like SRVs, UAVs, etc.
+  const DataLayout& m_DL;
+  MapVector<Instruction*, Decision> m_decisions;      // Cost-based decisions for values at this callsite
+
+
+  // Cost of a store to and a load from the stack for inst.
+  unsigned getSpillCost(Instruction* inst) const
+  {
+    uint64_t dwords = (m_DL.getTypeAllocSize(inst->getType()) + 3) / 4;
+    return static_cast<unsigned>(2 * dwords * MemoryAccessCost);
+  }
+
+  // Only side-effect free arithmetic on values that can be kept on the stack
+  // is optionally rematerialized.
+  static bool isRematCandidate(Instruction* inst)
+  {
+    if (inst->getType()->isPointerTy())
+      return false;
+    return isa<BinaryOperator>(inst) || isa<CastInst>(inst) || isa<CmpInst>(inst) || isa<SelectInst>(inst);
+  }
+
+  // Cost of recomputing inst after the callsite, including restoring operands
+  // that would otherwise not be live here. height is set to the depth of the
+  // rematerialized dependency graph, which is bounded by MaxRematDepth.
+  unsigned getRematCost(Instruction* inst, unsigned& height)
+  {
+    height = 0;
+    if (!isRematCandidate(inst))
+      return InfiniteCost;
+
+    uint64_t cost = 1;
+    for (Value* op : inst->operands())
+    {
+      Instruction* opInst = dyn_cast<Instruction>(op);
+      if (!opInst)
+        continue;
+
+      unsigned opHeight = 1;
+      // Loads of reg2mem'd values
+      LoadInst* load = dyn_cast<LoadInst>(opInst);
+      AllocaInst* alloc = load ? dyn_cast<AllocaInst>(load->getPointerOperand()) : nullptr;
+      auto it = alloc ? m_allocaToVal.find(alloc) : m_allocaToVal.end();
+      if (it != m_allocaToVal.end())
+      {
+        Instruction* val = it->second;
+        opHeight = 2; // the load and the alloca
+        if (mustRematerialize(val))
+          cost += 1;
+        else if (canRematerialize(val))
+        {
+          cost += m_decisions[val].rematCost;
+          opHeight += m_decisions[val].height;
+        }
+        else if (!m_liveHere.count(val))
+          cost += getSpillCost(val);
+      }
+      else if (mustRematerialize(opInst))
+      {
+        cost += 1;
+      }
+      else
+      {
+        // Values that are not live at any callsite are recomputed as well.
+        unsigned subHeight = 0;
+        cost += getRematCost(opInst, subHeight);
+        opHeight += subHeight;
+      }
+
+      height = std::max(height, opHeight);
+      if (cost >= InfiniteCost || height > MaxRematDepth)
+        return InfiniteCost;
+    }
+    return static_cast<unsigned>(std::min<uint64_t>(cost, InfiniteCost));
+  }
 };
 
 
@@ -862,6 +991,170 @@ static void extendAllocaLifetimes(LiveValues& lv)
 }
 
 
+// Returns the blocks in which the contents of alloc may be needed, i.e. the
+// blocks on a path from one access of alloc to another.
+static void getAllocaLiveBlocks(AllocaInst* alloc, BasicBlockSet& liveBlocks)
+{
+  BasicBlockSet useBlocks;
+  std::set<Value*> visited;
+  std::vector<Value*> worklist(1, alloc);
+  while (!worklist.empty())
+  {
+    Value* ptr = worklist.back();
+    worklist.pop_back();
+    if (!visited.insert(ptr).second)
+      continue;
+
+    for (User* U : ptr->users())
+    {
+      Instruction* user = cast<Instruction>(U);
+      useBlocks.insert(user->getParent());
+      // Follow pointers derived from alloc
+      if (user->getType()->isPointerTy() && !isa<LoadInst>(user))
+        worklist.push_back(user);
+    }
+  }
+
+  // Blocks reachable from an access
+  BasicBlockSet reachable;
+  std::vector<BasicBlock*> blocks(useBlocks.begin(), useBlocks.end());
+  while (!blocks.empty())
+  {
+    BasicBlock* B = blocks.back();
+    blocks.pop_back();
+    if (!reachable.insert(B).second)
+      continue;
+    for (BasicBlock* S : successors(B))
+      blocks.push_back(S);
+  }
+
+  // ... that also reach an access
+  BasicBlockSet reaching;
+  blocks.assign(useBlocks.begin(), useBlocks.end());
+  while (!blocks.empty())
+  {
+    BasicBlock* B = blocks.back();
+    blocks.pop_back();
+    if (!reaching.insert(B).second)
+      continue;
+    if (reachable.count(B))
+      liveBlocks.insert(B);
+    for (BasicBlock* P : predecessors(B))
+      blocks.push_back(P);
+  }
+}
+
+static bool intersects(const BasicBlockSet& a, const BasicBlockSet& b)
+{
+  const BasicBlockSet& smaller = a.size() < b.size() ? a : b;
+  const BasicBlockSet& larger = a.size() < b.size() ? b : a;
+  for (BasicBlock* B : smaller)
+  {
+    if (larger.count(B))
+      return true;
+  }
+  return false;
+}
+
+// Assigns each alloca an offset in the stack frame starting at baseOffsetInBytes
+// and returns the end of the allocated region. Allocas that are not live in
+// any common block are colored into the same slot. Allocas are placed largest
+// first so that later, smaller allocas can reuse their slots, and slots are laid
+// out by decreasing alignment to minimize padding.
+uint64_t StateFunctionTransform::packAllocas(
+  const std::vector<AllocaInst*>& allocas,
+  const std::set<AllocaInst*>&    unsharedAllocas,
+  DataLayout&                     DL,
+  uint64_t                        baseOffsetInBytes,
+  std::map<AllocaInst*, uint64_t>& offsets)
+{
+  struct AllocaInfo
+  {
+    AllocaInst*   alloc;
+    uint64_t      size;
+    unsigned      alignment;
+    BasicBlockSet liveBlocks;
+  };
+  struct StackSlot
+  {
+    uint64_t      size;
+    unsigned      alignment;
+    bool          shared;
+    BasicBlockSet liveBlocks;
+    std::vector<AllocaInst*> allocas;
+  };
+
+  std::vector<AllocaInfo> infos(allocas.size());
+  for (size_t i = 0; i < allocas.size(); ++i)
+  {
+    AllocaInfo& info = infos[i];
+    info.alloc = allocas[i];
+    info.size = DL.getTypeAllocSize(info.alloc->getAllocatedType());
+    info.alignment = info.alloc->getAlignment();
+    if (info.alignment == 0)
+      info.alignment = DL.getPrefTypeAlignment(info.alloc->getType());
+    if (!unsharedAllocas.count(info.alloc))
+      getAllocaLiveBlocks(info.alloc, info.liveBlocks);
+  }
+  std::stable_sort(infos.begin(), infos.end(), [](const AllocaInfo& a, const AllocaInfo& b) {
+    if (a.size != b.size)
+      return a.size > b.size;
+    return a.alignment > b.alignment;
+  });
+
+  // Color allocas into slots, first fit.
+  std::vector<StackSlot> slots;
+  uint64_t unpackedSizeInBytes = 0;
+  for (AllocaInfo& info : infos)
+  {
+    unpackedSizeInBytes += info.size;
+    bool shared = !unsharedAllocas.count(info.alloc);
+    StackSlot* slot = nullptr;
+    if (shared)
+    {
+      for (StackSlot& candidate : slots)
+      {
+        if (candidate.shared && candidate.size >= info.size && !intersects(candidate.liveBlocks, info.liveBlocks))
+        {
+          slot = &candidate;
+          break;
+        }
+      }
+    }
+    if (!slot)
+    {
+      slots.push_back(StackSlot{ info.size, info.alignment, shared, BasicBlockSet(), std::vector<AllocaInst*>() });
+      slot = &slots.back();
+    }
+    slot->alignment = std::max(slot->alignment, info.alignment);
+    slot->liveBlocks.insert(info.liveBlocks.begin(), info.liveBlocks.end());
+    slot->allocas.push_back(info.alloc);
+  }
+
+  // Lay out the slots.
+  std::stable_sort(slots.begin(), slots.end(), [](const StackSlot& a, const StackSlot& b) {
+    return a.alignment > b.alignment;
+  });
+  uint64_t offsetInBytes = baseOffsetInBytes;
+  for (StackSlot& slot : slots)
+  {
+    offsetInBytes = RoundUpToAlignment(offsetInBytes, slot.alignment);
+    for (AllocaInst* alloc : slot.allocas)
+      offsets[alloc] = offsetInBytes;
+    offsetInBytes += slot.size;
+  }
+
+  if (m_verbose)
+  {
+    DBGS() << "stack frame allocas --------------------\n";
+    DBGS() << "Count:" << allocas.size() << "  Slots:" << slots.size()
+           << "  Bytes:" << offsetInBytes - baseOffsetInBytes
+           << "  Unpacked bytes:" << unpackedSizeInBytes << "\n\n";
+  }
+
+  return offsetInBytes;
+}
+
 void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned int &shaderStackSize)
 {
   if (m_callSites.empty())
@@ -912,24 +1205,34 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
   offsetInBytes += m_maxCallerArgFrameSizeInBytes;
 
 
-  // ... live allocas. 
+  // ... live allocas. Allocas whose contents are never needed at the same
+  // time share a slot.
   Module* module = m_function->getParent();
   DataLayout DL(module);
-  DenseMap<Instruction*, Instruction*> allocaToStack;
-  Instruction* insertBefore = getInstructionAfter(m_stackFrameOffset);
+  std::vector<AllocaInst*> liveAllocas;
   for (Instruction* inst : lv.getAllLiveValues())
   {
-    AllocaInst* alloc = dyn_cast<AllocaInst>(inst);
-    if (!alloc)
-      continue;
+    if (AllocaInst* alloc = dyn_cast<AllocaInst>(inst))
+      liveAllocas.push_back(alloc);
+  }
+  std::set<AllocaInst*> unsharedAllocas;
+  for (CallInst* call : m_movePayloadToStackCalls)
+  {
+    // The payload is accessed by callees through its stack offset, so its uses
+    // in this function don't describe its lifetime.
+    if (AllocaInst* payloadAlloca = dyn_cast<AllocaInst>(call->getArgOperand(0)))
+      unsharedAllocas.insert(payloadAlloca);
+  }
+  std::map<AllocaInst*, uint64_t> allocaOffsets;
+  offsetInBytes = packAllocas(liveAllocas, unsharedAllocas, DL, offsetInBytes, allocaOffsets);
 
-    // Allocate a slot in the stack frame for the alloca
-    offsetInBytes = align(offsetInBytes, inst, DL);
-    Instruction* stackAlloca = createStackPtr(m_stackFrameOffset, alloc, offsetInBytes, insertBefore);
+  DenseMap<Instruction*, Instruction*> allocaToStack;
+  Instruction* insertBefore = getInstructionAfter(m_stackFrameOffset);
+  for (AllocaInst* alloc : liveAllocas)
+  {
+    Instruction* stackAlloca = createStackPtr(m_stackFrameOffset, alloc, allocaOffsets[alloc], insertBefore);
     alloc->replaceAllUsesWith(stackAlloca);
-    allocaToStack[inst] = stackAlloca;
-
-    offsetInBytes += DL.getTypeAllocSize(alloc->getAllocatedType());
+    allocaToStack[alloc] = stackAlloca;
   }
   lv.remapLiveValues(allocaToStack); // replace old allocas with stackAllocas
   for (auto& kv : allocaToStack)
@@ -970,7 +1273,7 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
     const InstructionSetVector& liveHere = lv.getLiveValues(i);
     std::vector<Instruction*> workList(liveHere.begin(), liveHere.end());
     std::set<Instruction*> visited;
-    Rematerializer R(allocaToVal, liveHere, *m_resources);
+    Rematerializer R(allocaToVal, liveHere, *m_resources, DL);
     Instruction* saveInsertBefore = m_callSites[i];
     Instruction* restoreInsertBefore = getInstructionAfter(m_callSites[i]);
     Instruction* rematInsertBefore = nullptr; // create only if needed
@@ -1022,6 +1325,13 @@ void StateFunctionTransform::preserveLiveValuesAcrossCallsites(_Out_ unsigned in
       }
     }
 
+    if (m_verbose)
+    {
+      DBGS() << "remat decisions at callsite " << i << " --------------------\n";
+      R.printDecisions(DBGS());
+      DBGS() << "\n";
+    }
+
     // Take the max offset over all call sites
     maxOffsetInBytes = std::max(maxOffsetInBytes, offsetInBytes);
   }
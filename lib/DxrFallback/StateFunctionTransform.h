@@ -4,6 +4,7 @@
 #include "llvm/ADT/SetVector.h"
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -12,6 +13,7 @@ namespace llvm
   class AllocaInst;
   class BasicBlock;
   class CallInst;
+  class DataLayout;
   class Function;
   class FunctionType;
   class Instruction;
@@ -278,6 +280,8 @@ private:
   llvm::Instruction* createStackPtr(llvm::Value* baseOffset, llvm::Value* val, int offsetInBytes, llvm::Instruction* insertBefore);
   llvm::Instruction* createStackPtr(llvm::Value* baseOffset, llvm::Type* valTy, llvm::Value* intIndex, llvm::Instruction* insertBefore);
   void rewriteDummyStackSize(uint64_t frameSizeInBytes);
+  uint64_t packAllocas(const std::vector<llvm::AllocaInst*>& allocas, const std::set<llvm::AllocaInst*>& unsharedAllocas,
+                       llvm::DataLayout& DL, uint64_t baseOffsetInBytes, std::map<llvm::AllocaInst*, uint64_t>& offsets);
 
   BasicBlockVector replaceCallSites();
   llvm::Function* split(llvm::Function* baseFunc, llvm::BasicBlock* subStateEntryBlock, int substateIndex);
@@ -86,6 +86,7 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDeadInstEliminationPass(Registry);
     initializeDxilAllocateResourcesForLibPass(Registry);
     initializeDxilCleanupAddrSpaceCastPass(Registry);
+    initializeDxilCoalesceBufferLoadsPass(Registry);
     initializeDxilCondenseResourcesPass(Registry);
     initializeDxilConditionalMem2RegPass(Registry);
     initializeDxilConvergentClearPass(Registry);
@@ -98,18 +99,23 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDxilFinalizeModulePass(Registry);
     initializeDxilFixConstArrayInitializerPass(Registry);
     initializeDxilGenerationPassPass(Registry);
+    initializeDxilGroupSharedLayoutPass(Registry);
     initializeDxilLegalizeEvalOperationsPass(Registry);
     initializeDxilLegalizeResourcesPass(Registry);
     initializeDxilLegalizeSampleOffsetPassPass(Registry);
     initializeDxilLoadMetadataPass(Registry);
+    initializeDxilLoopInvariantHoistPass(Registry);
     initializeDxilLoopUnrollPass(Registry);
     initializeDxilLowerCreateHandleForLibPass(Registry);
     initializeDxilPrecisePropagatePassPass(Registry);
     initializeDxilPreserveAllOutputsPass(Registry);
     initializeDxilPromoteLocalResourcesPass(Registry);
     initializeDxilPromoteStaticResourcesPass(Registry);
+    initializeDxilRematerializePass(Registry);
     initializeDxilSimpleGVNHoistPass(Registry);
+    initializeDxilSpecializeConstantsPass(Registry);
     initializeDxilTranslateRawBufferPass(Registry);
+    initializeDxilUniformityPass(Registry);
     initializeDynamicIndexingVectorToArrayPass(Registry);
     initializeEarlyCSELegacyPassPass(Registry);
     initializeEliminateAvailableExternallyPass(Registry);
@@ -193,10 +199,15 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   static const LPCSTR CFGSimplifyPassArgs[] = { "Threshold", "Ftor", "bonus-inst-threshold" };
   static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "force-early-z", "add-pixel-cost", "rt-width", "sv-position-index", "num-pixels" };
   static const LPCSTR DxilConditionalMem2RegArgs[] = { "NoOpt" };
-  static const LPCSTR DxilDebugInstrumentationArgs[] = { "UAVSize", "parameter0", "parameter1", "parameter2" };
+  static const LPCSTR DxilDebugInstrumentationArgs[] = { "UAVSize", "parameter0", "parameter1", "parameter2", "minimal" };
   static const LPCSTR DxilGenerationPassArgs[] = { "NotOptimized" };
+  static const LPCSTR DxilGroupSharedLayoutArgs[] = { "banks" };
   static const LPCSTR DxilOutputColorBecomesConstantArgs[] = { "mod-mode", "constant-red", "constant-green", "constant-blue", "constant-alpha" };
-  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "config", "checkForDynamicIndexing" };
+  static const LPCSTR DxilRematerializeArgs[] = { "pressure-threshold" };
+  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "config", "checkForDynamicIndexing", "aggregate" };
+  static const LPCSTR DxilSpecializeConstantsArgs[] = { "values" };
+  static const LPCSTR DxilUniformityArgs[] = { "annotate" };
+  static const LPCSTR DxrStateFunctionTransformArgs[] = { "candidates" };
   static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "ReplaceAllVectors" };
   static const LPCSTR Float2IntArgs[] = { "float2int-max-integer-bw" };
   static const LPCSTR GVNArgs[] = { "noloads", "enable-pre", "enable-load-pre", "max-recurse-depth" };
@@ -229,8 +240,13 @@ static ArrayRef<LPCSTR> GetPassArgNames(LPCSTR passName) {
   if (strcmp(passName, "dxil-cond-mem2reg") == 0) return ArrayRef<LPCSTR>(DxilConditionalMem2RegArgs, _countof(DxilConditionalMem2RegArgs));
   if (strcmp(passName, "hlsl-dxil-debug-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilDebugInstrumentationArgs, _countof(DxilDebugInstrumentationArgs));
   if (strcmp(passName, "dxilgen") == 0) return ArrayRef<LPCSTR>(DxilGenerationPassArgs, _countof(DxilGenerationPassArgs));
+  if (strcmp(passName, "dxil-tgsm-layout") == 0) return ArrayRef<LPCSTR>(DxilGroupSharedLayoutArgs, _countof(DxilGroupSharedLayoutArgs));
   if (strcmp(passName, "hlsl-dxil-constantColor") == 0) return ArrayRef<LPCSTR>(DxilOutputColorBecomesConstantArgs, _countof(DxilOutputColorBecomesConstantArgs));
+  if (strcmp(passName, "dxil-remat") == 0) return ArrayRef<LPCSTR>(DxilRematerializeArgs, _countof(DxilRematerializeArgs));
   if (strcmp(passName, "hlsl-dxil-pix-shader-access-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilShaderAccessTrackingArgs, _countof(DxilShaderAccessTrackingArgs));
+  if (strcmp(passName, "dxil-specialize-constants") == 0) return ArrayRef<LPCSTR>(DxilSpecializeConstantsArgs, _countof(DxilSpecializeConstantsArgs));
+  if (strcmp(passName, "dxil-uniformity") == 0) return ArrayRef<LPCSTR>(DxilUniformityArgs, _countof(DxilUniformityArgs));
+  if (strcmp(passName, "hlsl-dxr-state-functions") == 0) return ArrayRef<LPCSTR>(DxrStateFunctionTransformArgs, _countof(DxrStateFunctionTransformArgs));
   if (strcmp(passName, "dynamic-vector-to-array") == 0) return ArrayRef<LPCSTR>(DynamicIndexingVectorToArrayArgs, _countof(DynamicIndexingVectorToArrayArgs));
   if (strcmp(passName, "float2int") == 0) return ArrayRef<LPCSTR>(Float2IntArgs, _countof(Float2IntArgs));
   if (strcmp(passName, "gvn") == 0) return ArrayRef<LPCSTR>(GVNArgs, _countof(GVNArgs));
@@ -268,10 +284,15 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   static const LPCSTR CFGSimplifyPassArgs[] = { "None", "None", "Control the number of bonus instructions (default = 1)" };
   static const LPCSTR DxilAddPixelHitInstrumentationArgs[] = { "None", "None", "None", "None", "None" };
   static const LPCSTR DxilConditionalMem2RegArgs[] = { "None" };
-  static const LPCSTR DxilDebugInstrumentationArgs[] = { "None", "None", "None", "None" };
+  static const LPCSTR DxilDebugInstrumentationArgs[] = { "None", "None", "None", "None", "None" };
   static const LPCSTR DxilGenerationPassArgs[] = { "None" };
+  static const LPCSTR DxilGroupSharedLayoutArgs[] = { "Number of 32-bit groupshared memory banks strides are padded for; 0 disables padding (default = 32)" };
   static const LPCSTR DxilOutputColorBecomesConstantArgs[] = { "None", "None", "None", "None", "None" };
-  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "None", "None" };
+  static const LPCSTR DxilRematerializeArgs[] = { "Live scalars above which cheap values are recomputed at their uses (default = 64)" };
+  static const LPCSTR DxilShaderAccessTrackingArgs[] = { "None", "None", "None" };
+  static const LPCSTR DxilSpecializeConstantsArgs[] = { "Fields to replace: name=value[,component...][;...]" };
+  static const LPCSTR DxilUniformityArgs[] = { "None" };
+  static const LPCSTR DxrStateFunctionTransformArgs[] = { "Functions that are or will be state functions: name[;name...]" };
   static const LPCSTR DynamicIndexingVectorToArrayArgs[] = { "None" };
   static const LPCSTR Float2IntArgs[] = { "Max integer bitwidth to consider in float2int" };
   static const LPCSTR GVNArgs[] = { "None", "None", "None", "Max recurse depth" };
@@ -304,8 +325,13 @@ static ArrayRef<LPCSTR> GetPassArgDescriptions(LPCSTR passName) {
   if (strcmp(passName, "dxil-cond-mem2reg") == 0) return ArrayRef<LPCSTR>(DxilConditionalMem2RegArgs, _countof(DxilConditionalMem2RegArgs));
   if (strcmp(passName, "hlsl-dxil-debug-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilDebugInstrumentationArgs, _countof(DxilDebugInstrumentationArgs));
   if (strcmp(passName, "dxilgen") == 0) return ArrayRef<LPCSTR>(DxilGenerationPassArgs, _countof(DxilGenerationPassArgs));
+  if (strcmp(passName, "dxil-tgsm-layout") == 0) return ArrayRef<LPCSTR>(DxilGroupSharedLayoutArgs, _countof(DxilGroupSharedLayoutArgs));
   if (strcmp(passName, "hlsl-dxil-constantColor") == 0) return ArrayRef<LPCSTR>(DxilOutputColorBecomesConstantArgs, _countof(DxilOutputColorBecomesConstantArgs));
+  if (strcmp(passName, "dxil-remat") == 0) return ArrayRef<LPCSTR>(DxilRematerializeArgs, _countof(DxilRematerializeArgs));
   if (strcmp(passName, "hlsl-dxil-pix-shader-access-instrumentation") == 0) return ArrayRef<LPCSTR>(DxilShaderAccessTrackingArgs, _countof(DxilShaderAccessTrackingArgs));
+  if (strcmp(passName, "dxil-specialize-constants") == 0) return ArrayRef<LPCSTR>(DxilSpecializeConstantsArgs, _countof(DxilSpecializeConstantsArgs));
+  if (strcmp(passName, "dxil-uniformity") == 0) return ArrayRef<LPCSTR>(DxilUniformityArgs, _countof(DxilUniformityArgs));
+  if (strcmp(passName, "hlsl-dxr-state-functions") == 0) return ArrayRef<LPCSTR>(DxrStateFunctionTransformArgs, _countof(DxrStateFunctionTransformArgs));
   if (strcmp(passName, "dynamic-vector-to-array") == 0) return ArrayRef<LPCSTR>(DynamicIndexingVectorToArrayArgs, _countof(DynamicIndexingVectorToArrayArgs));
   if (strcmp(passName, "float2int") == 0) return ArrayRef<LPCSTR>(Float2IntArgs, _countof(Float2IntArgs));
   if (strcmp(passName, "gvn") == 0) return ArrayRef<LPCSTR>(GVNArgs, _countof(GVNArgs));
@@ -360,7 +386,11 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("Threshold")
     ||  S.equals("UAVSize")
     ||  S.equals("add-pixel-cost")
+    ||  S.equals("aggregate")
+    ||  S.equals("annotate")
+    ||  S.equals("banks")
     ||  S.equals("bonus-inst-threshold")
+    ||  S.equals("candidates")
     ||  S.equals("checkForDynamicIndexing")
     ||  S.equals("config")
     ||  S.equals("constant-alpha")
@@ -385,6 +415,7 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("max-reroll-increment")
     ||  S.equals("maxElements")
     ||  S.equals("mergefunc-sanity")
+    ||  S.equals("minimal")
     ||  S.equals("mod-mode")
     ||  S.equals("no-discriminators")
     ||  S.equals("noloads")
@@ -393,6 +424,7 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("parameter1")
     ||  S.equals("parameter2")
     ||  S.equals("pragma-unroll-threshold")
+    ||  S.equals("pressure-threshold")
     ||  S.equals("reroll-num-tolerated-failed-matches")
     ||  S.equals("rewrite-map-file")
     ||  S.equals("rotation-max-header-size")
@@ -410,6 +442,7 @@ static bool IsPassOptionName(StringRef S) {
     ||  S.equals("unroll-percent-dynamic-cost-saved-threshold")
     ||  S.equals("unroll-runtime")
     ||  S.equals("unroll-threshold")
+    ||  S.equals("values")
     ||  S.equals("vector-library")
     ||  S.equals("verify-debug-info");
   // ISPASSOPTIONNAME:END
@@ -0,0 +1,355 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCoalesceBufferLoads.cpp                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Merges scalarized buffer loads back into wider loads after lowering.      //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+// A rawBufferLoad whose result is only read through extractvalue of the
+// loaded components.
+struct RawLoad {
+  CallInst *Load;
+  Value *OffsetBase;  // nullptr for constant offsets
+  int64_t Offset;     // in bytes, relative to OffsetBase
+  unsigned NumComps;
+};
+
+// Splits V into Base + Offset when Offset is a known constant.
+void DecomposeOffset(Value *V, const DataLayout &DL, Value *&Base,
+                     int64_t &Offset) {
+  Base = V;
+  Offset = 0;
+  if (ConstantInt *CI = dyn_cast<ConstantInt>(V)) {
+    Base = nullptr;
+    Offset = CI->getSExtValue();
+    return;
+  }
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  if (!BO)
+    return;
+  ConstantInt *CI = dyn_cast<ConstantInt>(BO->getOperand(1));
+  if (!CI)
+    return;
+  if (BO->getOpcode() == Instruction::Add ||
+      (BO->getOpcode() == Instruction::Or &&
+       haveNoCommonBitsSet(BO->getOperand(0), CI, DL))) {
+    Base = BO->getOperand(0);
+    Offset = CI->getSExtValue();
+  }
+}
+
+// Returns the number of components loaded, or 0 if the mask doesn't select
+// a prefix of the components.
+unsigned GetNumLoadedComps(CallInst *Load) {
+  DxilInst_RawBufferLoad RBL(Load);
+  ConstantInt *Mask = dyn_cast<ConstantInt>(RBL.get_mask());
+  if (!Mask)
+    return 0;
+  uint64_t MaskVal = Mask->getZExtValue();
+  switch (MaskVal) {
+  case 1: return 1;
+  case 3: return 2;
+  case 7: return 3;
+  case 15: return 4;
+  default: return 0;
+  }
+}
+
+// Returns true if the status is not used and all uses are extracts.
+bool OnlyComponentsUsed(CallInst *Load) {
+  for (User *U : Load->users()) {
+    ExtractValueInst *EV = dyn_cast<ExtractValueInst>(U);
+    if (!EV || EV->getNumIndices() != 1 ||
+        EV->getIndices()[0] >= DXIL::kResRetStatusIndex)
+      return false;
+  }
+  return true;
+}
+
+// Merges loads of adjacent components of a raw or structured buffer within a
+// basic block, e.g.
+//   %a = rawBufferLoad(%h, %i, 0, mask 1)
+//   %b = rawBufferLoad(%h, %i, 4, mask 3)
+// into
+//   %ab = rawBufferLoad(%h, %i, 0, mask 7)
+// Loads are only merged when no instruction that may write memory lies
+// between them.
+class DxilCoalesceBufferLoads : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCoalesceBufferLoads() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL coalesce buffer loads";
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  // Loads in the same segment of a block, on the same handle, index (for
+  // structured buffers), overload and offset base.
+  typedef std::tuple<unsigned, Value *, Value *, Type *, Value *> RawLoadKey;
+  typedef MapVector<RawLoadKey, std::vector<RawLoad>,
+                    std::map<RawLoadKey, unsigned>>
+      RawLoadGroups;
+
+  bool coalesceRawBufferLoads(BasicBlock &BB, const DataLayout &DL);
+  bool coalesceGroup(std::vector<RawLoad> &Loads, const DataLayout &DL,
+                     DenseMap<Instruction *, unsigned> &Order);
+  void mergeRun(ArrayRef<RawLoad> Run, unsigned NumComps, unsigned CompSize,
+                DenseMap<Instruction *, unsigned> &Order);
+  bool dedupeCBufferLoads(Function &F);
+};
+
+char DxilCoalesceBufferLoads::ID = 0;
+
+bool DxilCoalesceBufferLoads::runOnFunction(Function &F) {
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  bool bUpdated = false;
+  for (BasicBlock &BB : F)
+    bUpdated |= coalesceRawBufferLoads(BB, DL);
+  bUpdated |= dedupeCBufferLoads(F);
+  return bUpdated;
+}
+
+bool DxilCoalesceBufferLoads::coalesceRawBufferLoads(BasicBlock &BB,
+                                                     const DataLayout &DL) {
+  DenseMap<Instruction *, unsigned> Order;
+  RawLoadGroups Groups;
+  // Loads separated by a potential memory write are kept apart.
+  unsigned Segment = 0;
+
+  for (Instruction &I : BB) {
+    Order[&I] = Order.size();
+
+    if (!OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::RawBufferLoad)) {
+      if (I.mayWriteToMemory())
+        ++Segment;
+      continue;
+    }
+
+    CallInst *Load = cast<CallInst>(&I);
+    DxilInst_RawBufferLoad RBL(Load);
+    unsigned NumComps = GetNumLoadedComps(Load);
+    if (NumComps == 0 || !OnlyComponentsUsed(Load))
+      continue;
+
+    // Raw buffers are addressed by index alone, structured buffers by index
+    // and element offset.
+    bool bStructured = !isa<UndefValue>(RBL.get_elementOffset());
+    Value *Index = bStructured ? RBL.get_index() : nullptr;
+    Value *OffsetVal =
+        bStructured ? RBL.get_elementOffset() : RBL.get_index();
+
+    RawLoad RL;
+    RL.Load = Load;
+    RL.NumComps = NumComps;
+    DecomposeOffset(OffsetVal, DL, RL.OffsetBase, RL.Offset);
+    Type *CompTy = Load->getType()->getStructElementType(0);
+    Groups[std::make_tuple(Segment, RBL.get_srv(), Index, CompTy,
+                           RL.OffsetBase)]
+        .push_back(RL);
+  }
+
+  bool bUpdated = false;
+  for (auto &Group : Groups)
+    if (Group.second.size() > 1)
+      bUpdated |= coalesceGroup(Group.second, DL, Order);
+  return bUpdated;
+}
+
+bool DxilCoalesceBufferLoads::coalesceGroup(
+    std::vector<RawLoad> &Loads, const DataLayout &DL,
+    DenseMap<Instruction *, unsigned> &Order) {
+  Type *CompTy = Loads[0].Load->getType()->getStructElementType(0);
+  unsigned CompSize = DL.getTypeAllocSize(CompTy);
+
+  std::stable_sort(Loads.begin(), Loads.end(),
+                   [](const RawLoad &A, const RawLoad &B) {
+                     return A.Offset < B.Offset;
+                   });
+
+  bool bUpdated = false;
+  size_t RunBegin = 0;
+  unsigned RunComps = Loads[0].NumComps;
+  for (size_t i = 1; i <= Loads.size(); ++i) {
+    if (i < Loads.size()) {
+      // Extend the run if this load overlaps or directly follows it, and all
+      // components still fit in one load.
+      int64_t Delta = Loads[i].Offset - Loads[RunBegin].Offset;
+      if (Delta % CompSize == 0 && Delta / CompSize <= RunComps &&
+          Delta / CompSize + Loads[i].NumComps <= 4) {
+        RunComps = std::max<unsigned>(RunComps,
+                                      Delta / CompSize + Loads[i].NumComps);
+        continue;
+      }
+    }
+    if (i - RunBegin > 1) {
+      mergeRun(ArrayRef<RawLoad>(Loads).slice(RunBegin, i - RunBegin),
+               RunComps, CompSize, Order);
+      bUpdated = true;
+    }
+    if (i < Loads.size()) {
+      RunBegin = i;
+      RunComps = Loads[i].NumComps;
+    }
+  }
+  return bUpdated;
+}
+
+void DxilCoalesceBufferLoads::mergeRun(
+    ArrayRef<RawLoad> Run, unsigned NumComps, unsigned CompSize,
+    DenseMap<Instruction *, unsigned> &Order) {
+  // The merged load goes where the first load of the run in program order is.
+  CallInst *InsertPt = Run[0].Load;
+  for (const RawLoad &RL : Run)
+    if (Order[RL.Load] < Order[InsertPt])
+      InsertPt = RL.Load;
+
+  // The lowest offset is loaded; its offset must be available at InsertPt.
+  const RawLoad &First = Run[0];
+  DxilInst_RawBufferLoad FirstRBL(First.Load);
+  bool bStructured = !isa<UndefValue>(FirstRBL.get_elementOffset());
+  unsigned OffsetOpIdx = bStructured ? DxilInst_RawBufferLoad::arg_elementOffset
+                                     : DxilInst_RawBufferLoad::arg_index;
+  Value *OffsetVal = First.Load->getArgOperand(OffsetOpIdx);
+  Instruction *OffsetInst = dyn_cast<Instruction>(OffsetVal);
+  if (OffsetInst && OffsetInst->getParent() == InsertPt->getParent() &&
+      Order[OffsetInst] > Order[InsertPt]) {
+    // Every offset in the run is derived from First.OffsetBase, so it is
+    // available at InsertPt.
+    OffsetVal = BinaryOperator::CreateAdd(
+        First.OffsetBase,
+        ConstantInt::get(OffsetVal->getType(), First.Offset), "", InsertPt);
+  }
+
+  CallInst *Merged = cast<CallInst>(First.Load->clone());
+  Merged->setArgOperand(OffsetOpIdx, OffsetVal);
+  DxilInst_RawBufferLoad(Merged).set_mask_val((1 << NumComps) - 1);
+  Merged->insertBefore(InsertPt);
+  Merged->takeName(First.Load);
+
+  for (const RawLoad &RL : Run) {
+    unsigned CompOffset =
+        static_cast<unsigned>((RL.Offset - First.Offset) / CompSize);
+    for (auto UI = RL.Load->user_begin(); UI != RL.Load->user_end();) {
+      ExtractValueInst *EV = cast<ExtractValueInst>(*(UI++));
+      Value *NewEV = ExtractValueInst::Create(
+          Merged, {EV->getIndices()[0] + CompOffset}, EV->getName(), EV);
+      EV->replaceAllUsesWith(NewEV);
+      EV->eraseFromParent();
+    }
+    RL.Load->eraseFromParent();
+  }
+}
+
+// cbufferLoadLegacy of the same row and overload is replaced by a single load
+// in the nearest common dominator of the loads. Constant buffers can't change
+// during a shader, so the load can be moved freely.
+bool DxilCoalesceBufferLoads::dedupeCBufferLoads(Function &F) {
+  typedef std::tuple<Value *, Value *, Function *> RowKey;
+  MapVector<RowKey, SmallVector<CallInst *, 4>, std::map<RowKey, unsigned>>
+      Rows;
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (!OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::CBufferLoadLegacy))
+        continue;
+      // A row read as i32 and as f16 takes two loads of different types.
+      CallInst *CI = cast<CallInst>(&I);
+      DxilInst_CBufferLoadLegacy CBL(CI);
+      Rows[std::make_tuple(CBL.get_handle(), CBL.get_regIndex(),
+                           CI->getCalledFunction())]
+          .push_back(CI);
+    }
+  }
+
+  DominatorTree DT;
+  bool bDTComputed = false;
+  bool bUpdated = false;
+  for (auto &Row : Rows) {
+    SmallVector<CallInst *, 4> &Loads = Row.second;
+    if (Loads.size() < 2)
+      continue;
+    if (!bDTComputed) {
+      DT.recalculate(F);
+      bDTComputed = true;
+    }
+
+    BasicBlock *DomBB = Loads[0]->getParent();
+    for (CallInst *Load : Loads) {
+      if (!DT.isReachableFromEntry(Load->getParent())) {
+        DomBB = nullptr;
+        break;
+      }
+      DomBB = DT.findNearestCommonDominator(DomBB, Load->getParent());
+    }
+    if (!DomBB)
+      continue;
+
+    // Reuse the first load in DomBB, or create one at its end.
+    CallInst *Kept = nullptr;
+    for (Instruction &I : *DomBB) {
+      if (std::find(Loads.begin(), Loads.end(), &I) != Loads.end()) {
+        Kept = cast<CallInst>(&I);
+        break;
+      }
+    }
+    if (!Kept) {
+      Instruction *InsertPt = DomBB->getTerminator();
+      bool bAvailable = true;
+      for (Value *Op : Loads[0]->arg_operands()) {
+        if (Instruction *OpInst = dyn_cast<Instruction>(Op))
+          bAvailable &= DT.dominates(OpInst, InsertPt);
+      }
+      if (!bAvailable)
+        continue;
+      Kept = cast<CallInst>(Loads[0]->clone());
+      Kept->insertBefore(InsertPt);
+      Kept->takeName(Loads[0]);
+    }
+
+    for (CallInst *Load : Loads) {
+      if (Load == Kept)
+        continue;
+      Load->replaceAllUsesWith(Kept);
+      Load->eraseFromParent();
+    }
+    bUpdated = true;
+  }
+  return bUpdated;
+}
+
+}
+
+FunctionPass *llvm::createDxilCoalesceBufferLoadsPass() {
+  return new DxilCoalesceBufferLoads();
+}
+
+INITIALIZE_PASS(DxilCoalesceBufferLoads, "dxil-coalesce-buffer-loads",
+                "DXIL coalesce buffer loads", false, false)
@@ -0,0 +1,600 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilGroupSharedLayout.cpp                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Optimizes the layout of groupshared arrays based on how they are indexed. //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+// Deepest index expression looked through for a bound.
+const unsigned kMaxBoundDepth = 8;
+
+// Collects the GEPs through which the groupshared array GV is accessed. Fails
+// unless every use of GV is a GEP of the form [0, Index].
+bool CollectArrayGEPs(GlobalVariable *GV, std::vector<GEPOperator *> &GEPs) {
+  if (!GV->getType()->getPointerElementType()->isArrayTy())
+    return false;
+  for (User *U : GV->users()) {
+    GEPOperator *GEP = dyn_cast<GEPOperator>(U);
+    if (!GEP || GEP->getNumIndices() != 2)
+      return false;
+    ConstantInt *Zero = dyn_cast<ConstantInt>(GEP->getOperand(1));
+    if (!Zero || !Zero->isZero())
+      return false;
+    GEPs.push_back(GEP);
+  }
+  return !GEPs.empty();
+}
+
+// Creates an array global like GV with Size elements, placed before GV.
+GlobalVariable *CreateArrayGlobal(GlobalVariable *GV, uint64_t Size) {
+  ArrayType *AT = cast<ArrayType>(GV->getType()->getPointerElementType());
+  ArrayType *NewTy = ArrayType::get(AT->getElementType(), Size);
+  GlobalVariable *NewGV = new GlobalVariable(
+      *GV->getParent(), NewTy, /*isConstant*/ false, GV->getLinkage(),
+      UndefValue::get(NewTy), GV->getName(), GV, GV->getThreadLocalMode(),
+      DXIL::kTGSMAddrSpace);
+  NewGV->setAlignment(GV->getAlignment());
+  return NewGV;
+}
+
+// Points GEP at NewGV with NewIndex as its array index.
+void RebaseGEP(GEPOperator *GEP, GlobalVariable *NewGV, Value *NewIndex) {
+  Value *Indices[] = {GEP->getOperand(1), NewIndex};
+  if (GetElementPtrInst *GEPInst = dyn_cast<GetElementPtrInst>(GEP)) {
+    IRBuilder<> Builder(GEPInst);
+    Value *NewGEP = GEP->isInBounds()
+                        ? Builder.CreateInBoundsGEP(NewGV, Indices)
+                        : Builder.CreateGEP(NewGV, Indices);
+    NewGEP->takeName(GEPInst);
+    GEPInst->replaceAllUsesWith(NewGEP);
+    GEPInst->eraseFromParent();
+    return;
+  }
+  ConstantExpr *CE = cast<ConstantExpr>(GEP);
+  Constant *ConstIndices[] = {cast<Constant>(Indices[0]),
+                              cast<Constant>(NewIndex)};
+  Constant *NewGEP = ConstantExpr::getGetElementPtr(
+      nullptr, NewGV, ConstIndices, GEP->isInBounds());
+  CE->replaceAllUsesWith(NewGEP);
+  CE->destroyConstant();
+}
+
+// Points the debug info of GV at NewGV. Arrays merged into one global all
+// keep their own variable, and like other passes that change the layout of a
+// global, the declared type is kept.
+void TransferDebugInfo(GlobalVariable *GV, GlobalVariable *NewGV,
+                       DebugInfoFinder *Finder) {
+  if (!Finder)
+    return;
+  LLVMContext &Ctx = GV->getContext();
+  for (DICompileUnit *CU : Finder->compile_units()) {
+    MDTuple *GVs = cast_or_null<MDTuple>(CU->getRawGlobalVariables());
+    if (!GVs)
+      continue;
+    std::vector<Metadata *> NewGVs;
+    bool bChanged = false;
+    for (const MDOperand &Op : GVs->operands()) {
+      DIGlobalVariable *DIGV = cast<DIGlobalVariable>(Op);
+      if (DIGV->getVariable() == GV) {
+        DIGV = DIGlobalVariable::get(
+            Ctx, DIGV->getScope(), DIGV->getName(), DIGV->getLinkageName(),
+            DIGV->getFile(), DIGV->getLine(), DIGV->getType(),
+            DIGV->isLocalToUnit(), DIGV->isDefinition(), NewGV,
+            DIGV->getStaticDataMemberDeclaration());
+        bChanged = true;
+      }
+      NewGVs.push_back(DIGV);
+    }
+    if (bChanged)
+      CU->replaceGlobalVariables(MDTuple::get(Ctx, NewGVs));
+  }
+}
+
+// Moves all accesses of GV to NewGV, keeping their indices, and deletes GV.
+void ReplaceArrayGlobal(GlobalVariable *GV, GlobalVariable *NewGV,
+                        DebugInfoFinder *Finder) {
+  std::vector<GEPOperator *> GEPs;
+  CollectArrayGEPs(GV, GEPs);
+  for (GEPOperator *GEP : GEPs)
+    RebaseGEP(GEP, NewGV, GEP->getOperand(2));
+  NewGV->setAlignment(std::max(NewGV->getAlignment(), GV->getAlignment()));
+  TransferDebugInfo(GV, NewGV, Finder);
+  GV->eraseFromParent();
+}
+
+// Instructions that read or write memory through their pointer operand Ptr.
+bool IsMemoryAccessOf(User *U, Value *Ptr) {
+  if (LoadInst *LI = dyn_cast<LoadInst>(U))
+    return LI->getPointerOperand() == Ptr;
+  if (StoreInst *SI = dyn_cast<StoreInst>(U))
+    return SI->getPointerOperand() == Ptr;
+  if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(U))
+    return RMW->getPointerOperand() == Ptr;
+  if (AtomicCmpXchgInst *CX = dyn_cast<AtomicCmpXchgInst>(U))
+    return CX->getPointerOperand() == Ptr;
+  return false;
+}
+
+// Whether I waits for the whole group and makes its groupshared writes
+// visible.
+bool IsGroupSharedBarrier(Instruction *I) {
+  if (!OP::IsDxilOpFuncCallInst(I, DXIL::OpCode::Barrier))
+    return false;
+  DxilInst_Barrier Barrier(I);
+  ConstantInt *Mode = dyn_cast<ConstantInt>(Barrier.get_barrierMode());
+  if (!Mode)
+    return false;
+  uint64_t Flags = Mode->getZExtValue();
+  return (Flags & (unsigned)DXIL::BarrierMode::SyncThreadGroup) &&
+         (Flags & (unsigned)DXIL::BarrierMode::TGSMFence);
+}
+
+// Numbers the regions of a function separated by groupshared barriers. Every
+// thread of a group runs the barriers of a region before any thread enters
+// the next, so memory accessed only in different regions can be shared.
+class BarrierEpochs {
+  DenseMap<Instruction *, unsigned> m_Epochs;
+  bool m_bValid = false;
+
+public:
+  explicit BarrierEpochs(Function &F) {
+    DenseMap<BasicBlock *, unsigned> EntryEpochs;
+    DenseMap<BasicBlock *, unsigned> ExitEpochs;
+    ReversePostOrderTraversal<Function *> RPOT(&F);
+    for (BasicBlock *BB : RPOT) {
+      unsigned Epoch = 0;
+      for (BasicBlock *Pred : predecessors(BB)) {
+        auto It = ExitEpochs.find(Pred);
+        if (It != ExitEpochs.end()) {
+          Epoch = It->second;
+          break;
+        }
+      }
+      EntryEpochs[BB] = Epoch;
+      for (Instruction &I : *BB) {
+        if (IsGroupSharedBarrier(&I))
+          ++Epoch;
+        m_Epochs[&I] = Epoch;
+      }
+      ExitEpochs[BB] = Epoch;
+    }
+
+    // Barriers in loops, or on some paths only, leave no single epoch number
+    // for the blocks where control flow joins.
+    for (BasicBlock *BB : RPOT) {
+      for (BasicBlock *Succ : successors(BB)) {
+        if (EntryEpochs[Succ] != ExitEpochs[BB])
+          return;
+      }
+    }
+    m_bValid = true;
+  }
+
+  bool IsValid() const { return m_bValid; }
+
+  // Epoch I runs in. Fails for unreachable instructions.
+  bool GetEpoch(Instruction *I, unsigned &Epoch) const {
+    auto It = m_Epochs.find(I);
+    if (It == m_Epochs.end())
+      return false;
+    Epoch = It->second;
+    return true;
+  }
+};
+
+// Groupshared array global and the barrier epochs it is accessed in.
+struct ArrayLifetime {
+  GlobalVariable *GV;
+  unsigned FirstEpoch;
+  unsigned LastEpoch;
+};
+
+// Arrays sharing storage, and the last epoch any of them is accessed in.
+struct SharedSlot {
+  std::vector<GlobalVariable *> Members;
+  unsigned LastEpoch;
+  uint64_t Size;
+};
+
+class DxilGroupSharedLayout : public ModulePass {
+  unsigned m_Banks = 32;
+  DxilModule *m_DM = nullptr;
+  const DataLayout *m_DL = nullptr;
+  DebugInfoFinder *m_pFinder = nullptr;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilGroupSharedLayout() : ModulePass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL groupshared layout";
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUnsigned(O, "banks", &m_Banks, 32);
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  uint64_t GetIndexBound(Value *V, unsigned Depth);
+  bool ShrinkArray(GlobalVariable *&GV);
+  bool OverlapArrays(std::vector<GlobalVariable *> &Arrays, Function &F);
+  bool PadArray(GlobalVariable *&GV, uint64_t &TotalSize, uint64_t MaxSize);
+  uint64_t GetConflictingStride(Value *Index);
+  uint64_t GetGroupSharedSize(Module &M);
+};
+
+char DxilGroupSharedLayout::ID = 0;
+
+// Returns an upper bound of the unsigned integer V. Unknown values are bounded
+// by their type.
+uint64_t DxilGroupSharedLayout::GetIndexBound(Value *V, unsigned Depth) {
+  IntegerType *Ty = dyn_cast<IntegerType>(V->getType());
+  if (!Ty || Ty->getBitWidth() > 32)
+    return UINT64_MAX;
+  uint64_t Mask = Ty->getBitMask();
+  if (ConstantInt *C = dyn_cast<ConstantInt>(V))
+    return C->getZExtValue();
+
+  // Known zero bits alone bound masked values.
+  APInt KnownZero(Ty->getBitWidth(), 0), KnownOne(Ty->getBitWidth(), 0);
+  computeKnownBits(V, KnownZero, KnownOne, *m_DL);
+  uint64_t Bound = (~KnownZero).getZExtValue();
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I || Depth >= kMaxBoundDepth)
+    return Bound;
+
+  if (OP::IsDxilOpFuncCallInst(I, DXIL::OpCode::ThreadIdInGroup)) {
+    DxilInst_ThreadIdInGroup TID(I);
+    if (ConstantInt *Comp = dyn_cast<ConstantInt>(TID.get_component()))
+      if (Comp->getZExtValue() < 3)
+        return std::min<uint64_t>(
+            Bound, m_DM->GetNumThreads(Comp->getZExtValue()) - 1);
+    return Bound;
+  }
+  if (OP::IsDxilOpFuncCallInst(I, DXIL::OpCode::FlattenedThreadIdInGroup)) {
+    uint64_t Threads = (uint64_t)m_DM->GetNumThreads(0) *
+                       m_DM->GetNumThreads(1) * m_DM->GetNumThreads(2);
+    return std::min<uint64_t>(Bound, Threads - 1);
+  }
+
+  if (PHINode *Phi = dyn_cast<PHINode>(V)) {
+    uint64_t PhiBound = 0;
+    for (Value *Incoming : Phi->incoming_values())
+      PhiBound = std::max(PhiBound, GetIndexBound(Incoming, Depth + 1));
+    return std::min(Bound, PhiBound);
+  }
+  if (SelectInst *Sel = dyn_cast<SelectInst>(V)) {
+    return std::min(Bound,
+                    std::max(GetIndexBound(Sel->getTrueValue(), Depth + 1),
+                             GetIndexBound(Sel->getFalseValue(), Depth + 1)));
+  }
+  if (CastInst *Cast = dyn_cast<CastInst>(V)) {
+    if (Cast->getOpcode() == Instruction::ZExt ||
+        Cast->getOpcode() == Instruction::Trunc)
+      return std::min(Bound, GetIndexBound(Cast->getOperand(0), Depth + 1));
+    return Bound;
+  }
+
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  if (!BO)
+    return Bound;
+  uint64_t A = GetIndexBound(BO->getOperand(0), Depth + 1);
+  uint64_t B = GetIndexBound(BO->getOperand(1), Depth + 1);
+  uint64_t Result = Mask;
+  switch (BO->getOpcode()) {
+  // Both bounds fit in 32 bits, so these can't overflow before the check.
+  case Instruction::Add:
+    Result = A + B;
+    break;
+  case Instruction::Mul:
+    Result = A * B;
+    break;
+  case Instruction::Shl:
+    if (B < 32)
+      Result = A << B;
+    break;
+  case Instruction::LShr:
+    if (ConstantInt *Shift = dyn_cast<ConstantInt>(BO->getOperand(1)))
+      Result = Shift->getZExtValue() < 32 ? A >> Shift->getZExtValue() : 0;
+    else
+      Result = A;
+    break;
+  case Instruction::UDiv:
+    Result = A;
+    break;
+  case Instruction::URem:
+    Result = B ? std::min(A, B - 1) : A;
+    break;
+  case Instruction::And:
+    Result = std::min(A, B);
+    break;
+  case Instruction::Or:
+  case Instruction::Xor:
+    Result = NextPowerOf2(std::max(A, B)) - 1;
+    break;
+  default:
+    break;
+  }
+  // Wrapped results are bounded by the type only.
+  if (Result > Mask)
+    Result = Mask;
+  return std::min(Bound, Result);
+}
+
+// Shrinks GV to the elements that can be indexed.
+bool DxilGroupSharedLayout::ShrinkArray(GlobalVariable *&GV) {
+  std::vector<GEPOperator *> GEPs;
+  if (!CollectArrayGEPs(GV, GEPs))
+    return false;
+  uint64_t MaxIndex = 0;
+  for (GEPOperator *GEP : GEPs)
+    MaxIndex = std::max(MaxIndex, GetIndexBound(GEP->getOperand(2), 0));
+  ArrayType *AT = cast<ArrayType>(GV->getType()->getPointerElementType());
+  if (MaxIndex >= AT->getNumElements() - 1)
+    return false;
+
+  GlobalVariable *NewGV = CreateArrayGlobal(GV, MaxIndex + 1);
+  NewGV->takeName(GV);
+  ReplaceArrayGlobal(GV, NewGV, m_pFinder);
+  GV = NewGV;
+  return true;
+}
+
+// Lets arrays of the same element type that are accessed in disjoint barrier
+// epochs of F share one global.
+bool DxilGroupSharedLayout::OverlapArrays(
+    std::vector<GlobalVariable *> &Arrays, Function &F) {
+  BarrierEpochs Epochs(F);
+  if (!Epochs.IsValid())
+    return false;
+
+  std::vector<ArrayLifetime> Lifetimes;
+  for (GlobalVariable *GV : Arrays) {
+    std::vector<GEPOperator *> GEPs;
+    if (!CollectArrayGEPs(GV, GEPs))
+      continue;
+    ArrayLifetime Lifetime = {GV, UINT_MAX, 0};
+    bool bKnown = true;
+    for (GEPOperator *GEP : GEPs) {
+      for (User *U : GEP->users()) {
+        Instruction *I = dyn_cast<Instruction>(U);
+        unsigned Epoch = 0;
+        if (!I || I->getParent()->getParent() != &F ||
+            !IsMemoryAccessOf(I, GEP) || !Epochs.GetEpoch(I, Epoch)) {
+          bKnown = false;
+          break;
+        }
+        Lifetime.FirstEpoch = std::min(Lifetime.FirstEpoch, Epoch);
+        Lifetime.LastEpoch = std::max(Lifetime.LastEpoch, Epoch);
+      }
+      if (!bKnown)
+        break;
+    }
+    if (bKnown && Lifetime.FirstEpoch <= Lifetime.LastEpoch)
+      Lifetimes.push_back(Lifetime);
+  }
+
+  std::stable_sort(Lifetimes.begin(), Lifetimes.end(),
+                   [](const ArrayLifetime &A, const ArrayLifetime &B) {
+                     return A.FirstEpoch < B.FirstEpoch;
+                   });
+
+  std::vector<SharedSlot> Slots;
+  for (const ArrayLifetime &Lifetime : Lifetimes) {
+    ArrayType *AT =
+        cast<ArrayType>(Lifetime.GV->getType()->getPointerElementType());
+    SharedSlot *Slot = nullptr;
+    for (SharedSlot &Candidate : Slots) {
+      ArrayType *SlotTy = cast<ArrayType>(
+          Candidate.Members[0]->getType()->getPointerElementType());
+      if (SlotTy->getElementType() == AT->getElementType() &&
+          Candidate.LastEpoch < Lifetime.FirstEpoch) {
+        Slot = &Candidate;
+        break;
+      }
+    }
+    if (!Slot) {
+      Slots.push_back({{}, 0, 0});
+      Slot = &Slots.back();
+    }
+    Slot->Members.push_back(Lifetime.GV);
+    Slot->LastEpoch = Lifetime.LastEpoch;
+    Slot->Size = std::max(Slot->Size, AT->getNumElements());
+  }
+
+  bool bUpdated = false;
+  for (SharedSlot &Slot : Slots) {
+    if (Slot.Members.size() < 2)
+      continue;
+    GlobalVariable *NewGV = CreateArrayGlobal(Slot.Members[0], Slot.Size);
+    NewGV->setName(Slot.Members[0]->getName() + ".shared");
+    for (GlobalVariable *GV : Slot.Members) {
+      Arrays.erase(std::find(Arrays.begin(), Arrays.end(), GV));
+      ReplaceArrayGlobal(GV, NewGV, m_pFinder);
+    }
+    Arrays.push_back(NewGV);
+    bUpdated = true;
+  }
+  return bUpdated;
+}
+
+// Returns the power of two stride, a multiple of the bank count, Index steps
+// through the array with, or zero. Threads reading such a column all hit the
+// same bank.
+uint64_t DxilGroupSharedLayout::GetConflictingStride(Value *Index) {
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(Index);
+  if (BO && (BO->getOpcode() == Instruction::Add ||
+             BO->getOpcode() == Instruction::Or)) {
+    if (isa<ConstantInt>(BO->getOperand(1)))
+      BO = dyn_cast<BinaryOperator>(BO->getOperand(0));
+    else if (isa<ConstantInt>(BO->getOperand(0)))
+      BO = dyn_cast<BinaryOperator>(BO->getOperand(1));
+  }
+  if (!BO)
+    return 0;
+
+  uint64_t Stride = 0;
+  if (BO->getOpcode() == Instruction::Shl) {
+    if (ConstantInt *Shift = dyn_cast<ConstantInt>(BO->getOperand(1)))
+      if (Shift->getZExtValue() < 32)
+        Stride = 1ULL << Shift->getZExtValue();
+  } else if (BO->getOpcode() == Instruction::Mul) {
+    if (ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(1)))
+      Stride = C->getZExtValue();
+    else if (ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(0)))
+      Stride = C->getZExtValue();
+  }
+  if (!isPowerOf2_64(Stride) || Stride % m_Banks != 0)
+    return 0;
+  return Stride;
+}
+
+// Inserts a padding element after every Stride elements of GV if it is read
+// with a stride that conflicts on every bank, so that element i moves to
+// i + i / Stride.
+bool DxilGroupSharedLayout::PadArray(GlobalVariable *&GV, uint64_t &TotalSize,
+                                     uint64_t MaxSize) {
+  std::vector<GEPOperator *> GEPs;
+  if (!CollectArrayGEPs(GV, GEPs))
+    return false;
+  // Banks are 32 bits wide.
+  ArrayType *AT = cast<ArrayType>(GV->getType()->getPointerElementType());
+  Type *EltTy = AT->getElementType();
+  if (!EltTy->isSingleValueType() || m_DL->getTypeAllocSize(EltTy) != 4)
+    return false;
+
+  uint64_t Stride = 0;
+  for (GEPOperator *GEP : GEPs) {
+    uint64_t GEPStride = GetConflictingStride(GEP->getOperand(2));
+    if (GEPStride && (!Stride || GEPStride < Stride))
+      Stride = GEPStride;
+  }
+  uint64_t Size = AT->getNumElements();
+  if (!Stride || Stride >= Size)
+    return false;
+  uint64_t NewSize = Size + (Size - 1) / Stride;
+  uint64_t NewTotalSize = TotalSize + (NewSize - Size) * 4;
+  if (NewTotalSize > MaxSize)
+    return false;
+
+  unsigned Shift = Log2_64(Stride);
+  GlobalVariable *NewGV = CreateArrayGlobal(GV, NewSize);
+  NewGV->takeName(GV);
+  for (GEPOperator *GEP : GEPs) {
+    Value *Index = GEP->getOperand(2);
+    Value *NewIndex = nullptr;
+    if (ConstantInt *C = dyn_cast<ConstantInt>(Index)) {
+      uint64_t Idx = C->getZExtValue();
+      NewIndex = ConstantInt::get(C->getType(), Idx + (Idx >> Shift));
+    } else {
+      IRBuilder<> Builder(cast<Instruction>(GEP));
+      Value *Pad = Builder.CreateLShr(Index, Shift);
+      NewIndex = Builder.CreateAdd(Index, Pad);
+    }
+    RebaseGEP(GEP, NewGV, NewIndex);
+  }
+  TransferDebugInfo(GV, NewGV, m_pFinder);
+  GV->eraseFromParent();
+  GV = NewGV;
+  TotalSize = NewTotalSize;
+  return true;
+}
+
+uint64_t DxilGroupSharedLayout::GetGroupSharedSize(Module &M) {
+  uint64_t Size = 0;
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.getType()->getAddressSpace() == DXIL::kTGSMAddrSpace)
+      Size += m_DL->getTypeAllocSize(GV.getType()->getElementType());
+  }
+  return Size;
+}
+
+bool DxilGroupSharedLayout::runOnModule(Module &M) {
+  m_DM = &M.GetOrCreateDxilModule();
+  m_DL = &M.getDataLayout();
+  m_pFinder = getDebugMetadataVersionFromModule(M) != 0
+                  ? &m_DM->GetOrCreateDebugInfoFinder()
+                  : nullptr;
+  const ShaderModel *pSM = m_DM->GetShaderModel();
+  if (!(pSM->IsCS() || pSM->IsMS() || pSM->IsAS()))
+    return false;
+  Function *EntryFn = m_DM->GetEntryFunction();
+  if (!EntryFn || EntryFn->isDeclaration())
+    return false;
+
+  std::vector<GlobalVariable *> Arrays;
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.getType()->getAddressSpace() == DXIL::kTGSMAddrSpace &&
+        GV.getType()->getPointerElementType()->isArrayTy() &&
+        !GV.use_empty())
+      Arrays.push_back(&GV);
+  }
+  if (Arrays.empty())
+    return false;
+
+  uint64_t SizeBefore = GetGroupSharedSize(M);
+  bool bUpdated = false;
+  for (GlobalVariable *&GV : Arrays)
+    bUpdated |= ShrinkArray(GV);
+  bUpdated |= OverlapArrays(Arrays, *EntryFn);
+
+  if (m_Banks) {
+    uint64_t TotalSize = GetGroupSharedSize(M);
+    uint64_t MaxSize = pSM->IsMS() ? DXIL::kMaxMSSMSize : DXIL::kMaxTGSMSize;
+    for (GlobalVariable *&GV : Arrays)
+      bUpdated |= PadArray(GV, TotalSize, MaxSize);
+  }
+
+  if (bUpdated) {
+    std::string Msg;
+    raw_string_ostream OS(Msg);
+    OS << "groupshared memory " << SizeBefore << " -> "
+       << GetGroupSharedSize(M) << " bytes";
+    emitOptimizationRemark(M.getContext(), "dxil-tgsm-layout", *EntryFn,
+                           DebugLoc(), OS.str());
+  }
+  return bUpdated;
+}
+
+}
+
+ModulePass *llvm::createDxilGroupSharedLayoutPass() {
+  return new DxilGroupSharedLayout();
+}
+
+INITIALIZE_PASS(DxilGroupSharedLayout, "dxil-tgsm-layout",
+                "DXIL groupshared layout", false, false)
@@ -20,6 +20,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/IRBuilder.h"
@@ -159,7 +160,7 @@ private:
   bool AttachLib(DxilLib *lib);
   bool DetachLib(DxilLib *lib);
   bool AddFunctions(SmallVector<StringRef, 4> &workList,
-                    DenseSet<DxilLib *> &libSet, StringSet<> &addedFunctionSet,
+                    SetVector<DxilLib *> &libSet, StringSet<> &addedFunctionSet,
                     DxilLinkJob &linkJob, bool bLazyLoadDone,
                     bool bAllowFuncionDecls);
   // Attached libs to link.
@@ -333,9 +334,10 @@ namespace {
 // Create module from link defines.
 struct DxilLinkJob {
   DxilLinkJob(LLVMContext &Ctx, dxilutil::ExportMap &exportMap,
-              unsigned valMajor, unsigned valMinor)
+              unsigned valMajor, unsigned valMinor,
+              const std::vector<std::string> &specConstants)
       : m_ctx(Ctx), m_exportMap(exportMap), m_valMajor(valMajor),
-        m_valMinor(valMinor) {}
+        m_valMinor(valMinor), m_specConstants(specConstants) {}
   std::unique_ptr<llvm::Module>
   Link(std::pair<DxilFunctionLinkInfo *, DxilLib *> &entryLinkPair,
        const ShaderModel *pSM);
@@ -353,7 +355,8 @@ private:
   void AddFunctions(DxilModule &DM, ValueToValueMapTy &vmap);
   bool AddResource(DxilResourceBase *res, llvm::GlobalVariable *GV);
   void AddResourceToDM(DxilModule &DM);
-  std::unordered_map<DxilFunctionLinkInfo *, DxilLib *> m_functionDefs;
+  // MapVector for deterministic iteration.
+  llvm::MapVector<DxilFunctionLinkInfo *, DxilLib *> m_functionDefs;
   llvm::StringMap<llvm::Function *> m_functionDecls;
   // New created functions.
   llvm::StringMap<llvm::Function *> m_newFunctions;
@@ -365,6 +368,7 @@ private:
   LLVMContext &m_ctx;
   dxilutil::ExportMap &m_exportMap;
   unsigned m_valMajor, m_valMinor;
+  const std::vector<std::string> &m_specConstants;
 };
 } // namespace
 
@@ -840,6 +844,21 @@ DxilLinkJob::LinkToLib(const ShaderModel *pSM) {
   }
   DM.ResetEntryPropsMap(std::move(EntryPropMap));
 
+  // Point hull shaders at the new patch constant functions.
+  for (auto &it : m_functionDefs) {
+    DxilModule &tmpDM = it.second->GetDxilModule();
+    Function *F = it.first->func;
+    if (!tmpDM.HasDxilFunctionProps(F))
+      continue;
+    DxilFunctionProps &props = tmpDM.GetDxilFunctionProps(F);
+    if (props.IsHS() && props.ShaderProps.HS.patchConstantFunc) {
+      Function *patchConstantFunc = props.ShaderProps.HS.patchConstantFunc;
+      DM.SetPatchConstantFunctionForHS(
+          m_newFunctions[F->getName()],
+          m_newFunctions[patchConstantFunc->getName()]);
+    }
+  }
+
   // Add global
   bool bSuccess = AddGlobals(DM, vmap);
   if (!bSuccess)
@@ -864,16 +883,35 @@ DxilLinkJob::LinkToLib(const ShaderModel *pSM) {
     m_exportMap.BeginProcessing();
 
     DM.ClearDxilMetadata(*pM);
+    SmallVector<Function *, 4> patchConstantFuncs;
     for (auto it = pM->begin(); it != pM->end();) {
       Function *F = it++;
       if (F->isDeclaration())
         continue;
       if (!m_exportMap.ProcessFunction(F, true)) {
+        // Patch constant functions are only removed with their hull shaders.
+        if (DM.IsPatchConstantShader(F)) {
+          patchConstantFuncs.emplace_back(F);
+          continue;
+        }
         // Remove Function not in exportMap.
         DM.RemoveFunction(F);
         F->eraseFromParent();
       }
     }
+    SmallPtrSet<Function *, 4> usedPatchConstantFuncs;
+    for (Function &F : *pM) {
+      if (DM.HasDxilFunctionProps(&F) && DM.GetDxilFunctionProps(&F).IsHS())
+        usedPatchConstantFuncs.insert(
+            DM.GetDxilFunctionProps(&F).ShaderProps.HS.patchConstantFunc);
+    }
+    for (Function *F : patchConstantFuncs) {
+      // Kept for an exported hull shader, like the compiler does.
+      if (usedPatchConstantFuncs.count(F))
+        continue;
+      DM.RemoveFunction(F);
+      F->eraseFromParent();
+    }
 
     if(!m_exportMap.EndProcessing()) {
       for (auto &name : m_exportMap.GetNameCollisions()) {
@@ -1038,9 +1076,18 @@ void DxilLinkJob::RunPreparePass(Module &M) {
   PM.add(createScalarizerPass());
   PM.add(createPromoteMemoryToRegisterPass());
 
+  // Replace specialized constants, then remove the code they make dead.
+  if (!m_specConstants.empty()) {
+    PM.add(createDxilSpecializeConstantsPass(m_specConstants));
+    PM.add(createSCCPPass());
+  }
+
   PM.add(createSimplifyInstPass());
   PM.add(createCFGSimplificationPass());
 
+  if (!m_specConstants.empty())
+    PM.add(createDxilEraseDeadRegionPass());
+
   PM.add(createDeadCodeEliminationPass());
   PM.add(createGlobalDCEPass());
 
@@ -1168,7 +1215,7 @@ bool DxilLinkerImpl::DetachLib(DxilLib *lib) {
 }
 
 bool DxilLinkerImpl::AddFunctions(SmallVector<StringRef, 4> &workList,
-                                  DenseSet<DxilLib *> &libSet,
+                                  SetVector<DxilLib *> &libSet,
                                   StringSet<> &addedFunctionSet,
                                   DxilLinkJob &linkJob, bool bLazyLoadDone,
                                   bool bAllowFuncionDecls) {
@@ -1239,9 +1286,11 @@ DxilLinkerImpl::Link(StringRef entry, StringRef profile, dxilutil::ExportMap &ex
     return nullptr;
   }
 
-  DxilLinkJob linkJob(m_ctx, exportMap, m_valMajor, m_valMinor);
+  DxilLinkJob linkJob(m_ctx, exportMap, m_valMajor, m_valMinor,
+                      m_specConstants);
 
-  DenseSet<DxilLib *> libSet;
+  // SetVector for deterministic iteration.
+  SetVector<DxilLib *> libSet;
   StringSet<> addedFunctionSet;
 
   bool bIsLib = pSM->IsLib();
@@ -0,0 +1,297 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilLoopInvariantHoist.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Hoists loop invariant DXIL operations, such as resource loads and         //
+// samples, out of loops.                                                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Scalar.h"
+
+#include <memory>
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+// LICM leaves dx.op calls in loops: calls aren't safe to speculate in general,
+// and resource reads are blocked by any write in the loop. Resources bound as
+// SRVs or constant buffers can't be written by the shader, so reads of them
+// can be moved to the loop preheader. UAVs are never read early, even when
+// this loop doesn't write them: other threads may, and globallycoherent reads
+// must observe those writes.
+//
+// Only operations in blocks run on every iteration that reaches an exit are
+// hoisted, so the preheader doesn't run work the loop would have skipped.
+//
+// Operations using gradients are only hoisted when every branch on the way to
+// them from the loop header is uniform, so the preheader runs them with the
+// same lanes of each quad.
+class DxilLoopInvariantHoist : public FunctionPass {
+  DominatorTree *m_DT = nullptr;
+  DxilModule *m_DM = nullptr;
+  std::unique_ptr<PostDominatorTree> m_PDT;
+  std::unique_ptr<DxilUniformityAnalysis> m_Uniformity;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilLoopInvariantHoist() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL loop invariant hoist";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool HoistLoop(Loop *L);
+  bool IsGuaranteedToExecute(BasicBlock *BB,
+                             ArrayRef<BasicBlock *> ExitBlocks);
+  bool CanHoist(CallInst *CI, Loop *L);
+  bool ReadsOnlyReadOnlyResources(CallInst *CI);
+  bool IsReadOnlyHandle(Value *Handle, SmallPtrSetImpl<Value *> &Visited);
+  bool IsReachedUniformly(BasicBlock *BB, Loop *L);
+};
+
+char DxilLoopInvariantHoist::ID = 0;
+
+bool IsReadOnlyResourceClass(DXIL::ResourceClass RC) {
+  return RC == DXIL::ResourceClass::SRV ||
+         RC == DXIL::ResourceClass::CBuffer ||
+         RC == DXIL::ResourceClass::Sampler;
+}
+
+// Whether Handle can only refer to resources the shader can't write.
+bool DxilLoopInvariantHoist::IsReadOnlyHandle(
+    Value *Handle, SmallPtrSetImpl<Value *> &Visited) {
+  if (!Visited.insert(Handle).second)
+    return true;
+  if (PHINode *Phi = dyn_cast<PHINode>(Handle)) {
+    for (Value *Incoming : Phi->incoming_values()) {
+      if (!IsReadOnlyHandle(Incoming, Visited))
+        return false;
+    }
+    return true;
+  }
+  if (SelectInst *Sel = dyn_cast<SelectInst>(Handle)) {
+    return IsReadOnlyHandle(Sel->getTrueValue(), Visited) &&
+           IsReadOnlyHandle(Sel->getFalseValue(), Visited);
+  }
+
+  Instruction *I = dyn_cast<Instruction>(Handle);
+  if (!I)
+    return false;
+  if (OP::IsDxilOpFuncCallInst(I, DXIL::OpCode::CreateHandle)) {
+    DxilInst_CreateHandle CH(I);
+    ConstantInt *RC = dyn_cast<ConstantInt>(CH.get_resourceClass());
+    return RC &&
+           IsReadOnlyResourceClass((DXIL::ResourceClass)RC->getZExtValue());
+  }
+  if (OP::IsDxilOpFuncCallInst(I, DXIL::OpCode::CreateHandleForLib)) {
+    DxilInst_CreateHandleForLib CH(I);
+    LoadInst *LI = dyn_cast<LoadInst>(CH.get_Resource());
+    if (!LI)
+      return false;
+    Value *GV = GetUnderlyingObject(LI->getPointerOperand(),
+                                    m_DM->GetModule()->getDataLayout());
+    for (auto &SRV : m_DM->GetSRVs()) {
+      if (SRV->GetGlobalSymbol() == GV)
+        return true;
+    }
+    for (auto &CB : m_DM->GetCBuffers()) {
+      if (CB->GetGlobalSymbol() == GV)
+        return true;
+    }
+    for (auto &Sampler : m_DM->GetSamplers()) {
+      if (Sampler->GetGlobalSymbol() == GV)
+        return true;
+    }
+  }
+  return false;
+}
+
+// Whether CI reads resources, all of which are read-only.
+bool DxilLoopInvariantHoist::ReadsOnlyReadOnlyResources(CallInst *CI) {
+  Type *HandleTy = m_DM->GetOP()->GetHandleType();
+  bool bReadsResource = false;
+  for (Value *Arg : CI->arg_operands()) {
+    if (Arg->getType() != HandleTy)
+      continue;
+    SmallPtrSet<Value *, 4> Visited;
+    if (!IsReadOnlyHandle(Arg, Visited))
+      return false;
+    bReadsResource = true;
+  }
+  return bReadsResource;
+}
+
+// Whether the lanes reaching BB from the header of L on its first iteration
+// are either all the lanes entering L or none of them.
+bool DxilLoopInvariantHoist::IsReachedUniformly(BasicBlock *BB, Loop *L) {
+  if (!m_Uniformity) {
+    Function *F = BB->getParent();
+    m_PDT.reset(new PostDominatorTree());
+    m_PDT->runOnFunction(*F);
+    m_Uniformity.reset(DxilUniformityAnalysis::create(*m_PDT));
+    m_Uniformity->Analyze(F);
+  }
+
+  SmallVector<BasicBlock *, 8> Worklist;
+  SmallPtrSet<BasicBlock *, 8> Visited;
+  Worklist.push_back(BB);
+  Visited.insert(BB);
+  while (!Worklist.empty()) {
+    BasicBlock *Cur = Worklist.pop_back_val();
+    if (Cur != BB) {
+      TerminatorInst *TI = Cur->getTerminator();
+      if (TI->getNumSuccessors() > 1 && !m_Uniformity->IsUniform(TI))
+        return false;
+    }
+    if (Cur == L->getHeader())
+      continue;
+    for (BasicBlock *Pred : predecessors(Cur)) {
+      if (L->contains(Pred) && Visited.insert(Pred).second)
+        Worklist.push_back(Pred);
+    }
+  }
+  return true;
+}
+
+// Whether BB runs whenever the loop is left, as in LICM's
+// isGuaranteedToExecute.
+bool DxilLoopInvariantHoist::IsGuaranteedToExecute(
+    BasicBlock *BB, ArrayRef<BasicBlock *> ExitBlocks) {
+  // A loop without exits proves nothing about the blocks in it.
+  if (ExitBlocks.empty())
+    return false;
+  for (BasicBlock *Exit : ExitBlocks) {
+    if (!m_DT->dominates(BB, Exit))
+      return false;
+  }
+  return true;
+}
+
+bool DxilLoopInvariantHoist::CanHoist(CallInst *CI, Loop *L) {
+  OP::OpCode Opcode = OP::GetDxilOpFuncCallInst(CI);
+  // Wave operations depend on the lanes that run them.
+  if (OP::IsDxilOpWave(Opcode))
+    return false;
+
+  Function *F = CI->getCalledFunction();
+  if (!F->doesNotAccessMemory()) {
+    if (!F->onlyReadsMemory() || !ReadsOnlyReadOnlyResources(CI))
+      return false;
+  }
+
+  if (OP::IsDxilOpGradient(Opcode) && !IsReachedUniformly(CI->getParent(), L))
+    return false;
+  return true;
+}
+
+bool DxilLoopInvariantHoist::HoistLoop(Loop *L) {
+  BasicBlock *Preheader = L->getLoopPreheader();
+  if (!Preheader)
+    return false;
+  Instruction *InsertPt = Preheader->getTerminator();
+
+  SmallVector<BasicBlock *, 8> ExitBlocks;
+  L->getExitBlocks(ExitBlocks);
+
+  // Visit blocks in dominator order, so that hoisted handles and results let
+  // the operations using them follow.
+  bool bUpdated = false;
+  SmallVector<DomTreeNode *, 16> Worklist;
+  Worklist.push_back(m_DT->getNode(L->getHeader()));
+  while (!Worklist.empty()) {
+    DomTreeNode *N = Worklist.pop_back_val();
+    BasicBlock *BB = N->getBlock();
+    if (!L->contains(BB))
+      continue;
+    // Children of a skipped block can't be guaranteed to execute either.
+    if (!IsGuaranteedToExecute(BB, ExitBlocks))
+      continue;
+    for (auto It = BB->begin(), E = BB->end(); It != E;) {
+      Instruction *I = It++;
+      CallInst *CI = dyn_cast<CallInst>(I);
+      if (!CI || !OP::IsDxilOpFuncCallInst(CI)) {
+        // Plain instructions using hoisted results, such as extracts of
+        // sample results, follow when they are safe to speculate.
+        bool bChanged = false;
+        L->makeLoopInvariant(I, bChanged, InsertPt);
+        bUpdated |= bChanged;
+        continue;
+      }
+      if (!L->hasLoopInvariantOperands(CI) || !CanHoist(CI, L))
+        continue;
+      CI->moveBefore(InsertPt);
+      bUpdated = true;
+    }
+    for (DomTreeNode *Child : N->getChildren())
+      Worklist.push_back(Child);
+  }
+  return bUpdated;
+}
+
+bool DxilLoopInvariantHoist::runOnFunction(Function &F) {
+  m_DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  m_DM = &F.getParent()->GetOrCreateDxilModule();
+  m_Uniformity.reset();
+  m_PDT.reset();
+
+  // Inner loops first, so their invariants can keep moving out.
+  LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  SmallVector<Loop *, 8> Loops;
+  SmallVector<Loop *, 8> Worklist(LI.begin(), LI.end());
+  while (!Worklist.empty()) {
+    Loop *L = Worklist.pop_back_val();
+    Loops.push_back(L);
+    Worklist.append(L->begin(), L->end());
+  }
+
+  bool bUpdated = false;
+  for (auto It = Loops.rbegin(), E = Loops.rend(); It != E; ++It)
+    bUpdated |= HoistLoop(*It);
+  return bUpdated;
+}
+
+}
+
+FunctionPass *llvm::createDxilLoopInvariantHoistPass() {
+  return new DxilLoopInvariantHoist();
+}
+
+INITIALIZE_PASS_BEGIN(DxilLoopInvariantHoist, "dxil-licm",
+                      "DXIL loop invariant hoist", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_END(DxilLoopInvariantHoist, "dxil-licm",
+                    "DXIL loop invariant hoist", false, false)
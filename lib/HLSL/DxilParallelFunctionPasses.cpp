@@ -0,0 +1,862 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilParallelFunctionPasses.cpp                                            //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Runs the call graph SCC and function passes of a library on several       //
+// threads, with the same result as running them on the whole module.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilShaderModel.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/CallGraphSCCPass.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/TypeFinder.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/IR/ValueMap.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+// A use of a constant by an instruction, or by a constant the instruction
+// reaches through its operands, after the passes. Uses the passes left alone
+// keep their place in the use list; new ones are ranked by their position.
+struct ConstantUseOrder {
+  unsigned Inst;
+  SmallVector<unsigned, 2> Operands; // From the instruction down.
+  bool bOriginal;
+  unsigned OriginalInst; // Index of the instruction before the passes.
+  unsigned Rank;
+};
+
+// Functions optimized together on one thread, and what the thread produced.
+struct FunctionGroup {
+  std::vector<std::string> Names;
+  unsigned Size = 0;
+  std::string Bitcode;
+  // Declarations the passes created, by the function they were optimizing.
+  StringMap<std::vector<std::string>> NewFunctions;
+  StringMap<std::vector<ConstantUseOrder>> UseOrders;
+  bool bFailed = false;
+};
+
+// Instructions the passes haven't deleted, with their index before the passes.
+struct OriginalInstConfig : ValueMapConfig<Instruction *> {
+  enum { FollowRAUW = false };
+};
+typedef ValueMap<Instruction *, unsigned, OriginalInstConfig> OriginalInstMap;
+
+// Records the functions in the order the call graph SCC passes visit them,
+// with the last function of the module when each visit starts.
+class RecordFunctionVisits : public CallGraphSCCPass {
+  std::vector<std::pair<Function *, Function *>> &m_Visits;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit RecordFunctionVisits(
+      std::vector<std::pair<Function *, Function *>> &Visits)
+      : CallGraphSCCPass(ID), m_Visits(Visits) {}
+
+  const char *getPassName() const override {
+    return "DXIL record function visits";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    CallGraphSCCPass::getAnalysisUsage(AU);
+    AU.setPreservesAll();
+  }
+
+  bool runOnSCC(CallGraphSCC &SCC) override {
+    for (CallGraphNode *Node : SCC) {
+      Function *F = Node->getFunction();
+      if (F && !F->isDeclaration())
+        m_Visits.emplace_back(F, &F->getParent()->getFunctionList().back());
+    }
+    return false;
+  }
+};
+
+char RecordFunctionVisits::ID = 0;
+
+// Maps the identified struct types of a group's module, renamed with a prefix
+// so they don't clash in the context of the module, to the module's types.
+class PrefixedTypeMapper : public ValueMapTypeRemapper {
+  Module &m_Module;
+  std::string m_Prefix;
+  DenseMap<Type *, Type *> m_Types;
+
+public:
+  bool bFailed = false;
+  PrefixedTypeMapper(Module &M, StringRef Prefix)
+      : m_Module(M), m_Prefix(Prefix) {}
+
+  Type *remapType(Type *Ty) override {
+    auto It = m_Types.find(Ty);
+    if (It != m_Types.end())
+      return It->second;
+    Type *Mapped = Ty;
+    if (StructType *ST = dyn_cast<StructType>(Ty)) {
+      if (!ST->isLiteral()) {
+        StringRef Name = ST->getName();
+        Mapped = Name.startswith(m_Prefix)
+                     ? m_Module.getTypeByName(Name.substr(m_Prefix.size()))
+                     : nullptr;
+        if (!Mapped) {
+          bFailed = true;
+          Mapped = Ty;
+        }
+      } else {
+        SmallVector<Type *, 8> Elements;
+        for (Type *EltTy : ST->elements())
+          Elements.emplace_back(remapType(EltTy));
+        Mapped = StructType::get(Ty->getContext(), Elements, ST->isPacked());
+      }
+    } else if (PointerType *PT = dyn_cast<PointerType>(Ty)) {
+      Mapped = PointerType::get(remapType(PT->getElementType()),
+                                PT->getAddressSpace());
+    } else if (ArrayType *AT = dyn_cast<ArrayType>(Ty)) {
+      Mapped = ArrayType::get(remapType(AT->getElementType()),
+                              AT->getNumElements());
+    } else if (FunctionType *FT = dyn_cast<FunctionType>(Ty)) {
+      SmallVector<Type *, 8> Params;
+      for (Type *ParamTy : FT->params())
+        Params.emplace_back(remapType(ParamTy));
+      Mapped = FunctionType::get(remapType(FT->getReturnType()), Params,
+                                 FT->isVarArg());
+    }
+    m_Types[Ty] = Mapped;
+    return Mapped;
+  }
+};
+
+// The passes added by the callback only change a function while the call
+// graph SCC passes visit it, and read little else of the module. When no
+// defined function is called or referenced by another, each function is
+// optimized the same way whether the others were optimized before it or not.
+// Groups of functions are optimized on threads, each in a copy of the module
+// with the bodies of the other groups deleted, and the results are cloned
+// back in the order a serial run visits the functions. Anything the copies
+// can't reproduce exactly falls back to running the passes on the module.
+class DxilParallelFunctionPasses : public ModulePass {
+  unsigned m_Threads;
+  std::function<void(legacy::PassManagerBase &)> m_AddPasses;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  DxilParallelFunctionPasses(
+      unsigned Threads,
+      std::function<void(legacy::PassManagerBase &)> AddPasses)
+      : ModulePass(ID), m_Threads(Threads), m_AddPasses(AddPasses) {}
+
+  const char *getPassName() const override {
+    return "DXIL parallel function passes";
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool runSerial(Module &M);
+  bool canSplit(Module &M, std::vector<Function *> &Order);
+  void optimizeGroup(FunctionGroup &Group, unsigned Index, StringRef Bitcode,
+                     const ShaderModel *SM, bool bUseMinPrecision,
+                     const ShaderFlags &Flags);
+  bool loadGroups(Module &M, std::vector<FunctionGroup> &Groups,
+                  std::vector<std::unique_ptr<Module>> &Results,
+                  std::vector<std::unique_ptr<PrefixedTypeMapper>> &Mappers);
+  bool spliceGroups(Module &M, std::vector<Function *> &Order,
+                    std::vector<FunctionGroup> &Groups);
+};
+
+char DxilParallelFunctionPasses::ID = 0;
+
+StringRef GetTypePrefix(unsigned Index, std::string &Storage) {
+  raw_string_ostream OS(Storage);
+  OS << "dx.parallel." << Index << ".";
+  return OS.str();
+}
+
+void FailGroupOnDiagnostic(const DiagnosticInfo &DI, void *Context) {
+  // Warnings and remarks are reported by the serial run too.
+  static_cast<FunctionGroup *>(Context)->bFailed = true;
+}
+
+// Adds C and the constants it's built from, other than globals, to Constants.
+void CollectConstants(Value *V, SmallPtrSetImpl<Constant *> &Visited,
+                      std::vector<Constant *> &Constants) {
+  Constant *C = dyn_cast<Constant>(V);
+  if (!C || !Visited.insert(C).second)
+    return;
+  Constants.emplace_back(C);
+  if (isa<GlobalValue>(C))
+    return;
+  for (Value *Op : C->operands())
+    CollectConstants(Op, Visited, Constants);
+}
+
+// Collects the constants used by the instructions and global initializers of
+// M.
+void CollectModuleConstants(Module &M, SmallPtrSetImpl<Constant *> &Visited,
+                            std::vector<Constant *> &Constants) {
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.hasInitializer())
+      CollectConstants(GV.getInitializer(), Visited, Constants);
+  }
+  for (Function &F : M) {
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB)
+        for (Value *Op : I.operands())
+          CollectConstants(Op, Visited, Constants);
+  }
+}
+
+// Calls Fn with each use of a constant reached from the operands of I, and
+// the operand numbers leading to it.
+void ForEachConstantUse(
+    Instruction &I, SmallPtrSetImpl<const Use *> &Visited,
+    const std::function<void(Use &, ArrayRef<unsigned>)> &Fn) {
+  SmallVector<unsigned, 4> Path;
+  std::function<void(Use &)> Visit = [&](Use &U) {
+    Constant *C = dyn_cast<Constant>(U.get());
+    if (!C || !Visited.insert(&U).second)
+      return;
+    Fn(U, Path);
+    if (isa<GlobalValue>(C))
+      return;
+    for (Use &Op : C->operands()) {
+      Path.emplace_back(Op.getOperandNo());
+      Visit(Op);
+      Path.pop_back();
+    }
+  };
+  for (Use &Op : I.operands()) {
+    Path.emplace_back(Op.getOperandNo());
+    Visit(Op);
+    Path.pop_back();
+  }
+}
+
+// Whether C is only used by constants that are themselves unused.
+bool IsDeadConstant(Constant *C) {
+  for (User *U : C->users()) {
+    Constant *UC = dyn_cast<Constant>(U);
+    if (!UC || isa<GlobalValue>(UC) || !IsDeadConstant(UC))
+      return false;
+  }
+  return true;
+}
+
+void DestroyDeadConstant(Constant *C) {
+  while (!C->use_empty())
+    DestroyDeadConstant(cast<Constant>(C->user_back()));
+  C->destroyConstant();
+}
+
+// Destroys the unused constants built from C, other than through the uses
+// in Keep.
+void RemoveDeadUsers(Constant *C, const DenseMap<const Use *, unsigned> &Keep) {
+  SmallVector<Constant *, 4> Dead;
+  for (const Use &U : C->uses()) {
+    Constant *UC = dyn_cast<Constant>(U.getUser());
+    if (UC && !isa<GlobalValue>(UC) && !Keep.count(&U) && IsDeadConstant(UC))
+      Dead.emplace_back(UC);
+  }
+  for (Constant *UC : Dead)
+    DestroyDeadConstant(UC);
+}
+
+// Orders the uses of the values cloned from Src like the uses in Src, which
+// the passes left in the order a serial run would have.
+void CopyUseListOrder(Function &Src, ValueToValueMapTy &VMap) {
+  auto CopyOrder = [&VMap](Value *SrcV) {
+    Value *V = VMap.lookup(SrcV);
+    if (!V || V->use_empty() || V->hasOneUse())
+      return;
+    DenseMap<const Use *, unsigned> Order;
+    unsigned Index = 0;
+    for (const Use &U : SrcV->uses()) {
+      Instruction *I = dyn_cast_or_null<Instruction>(VMap.lookup(U.getUser()));
+      if (I)
+        Order[&I->getOperandUse(U.getOperandNo())] = Index++;
+    }
+    V->sortUseList([&Order](const Use &L, const Use &R) {
+      return Order.lookup(&L) < Order.lookup(&R);
+    });
+  };
+  for (Argument &Arg : Src.args())
+    CopyOrder(&Arg);
+  for (BasicBlock &BB : Src) {
+    CopyOrder(&BB);
+    for (Instruction &I : BB)
+      CopyOrder(&I);
+  }
+}
+
+bool DxilParallelFunctionPasses::runSerial(Module &M) {
+  legacy::PassManager PM;
+  m_AddPasses(PM);
+  return PM.run(M);
+}
+
+bool DxilParallelFunctionPasses::canSplit(Module &M,
+                                          std::vector<Function *> &Order) {
+  if (m_Threads < 2 || !M.HasDxilModule() ||
+      M.getNamedMetadata("llvm.dbg.cu") || !M.alias_empty())
+    return false;
+  for (GlobalVariable &GV : M.globals()) {
+    if (!GV.hasName())
+      return false;
+  }
+  for (Function &F : M) {
+    if (!F.hasName())
+      return false;
+    if (F.isDeclaration())
+      continue;
+    if (F.hasPersonalityFn() || F.hasPrefixData() || F.hasPrologueData())
+      return false;
+    for (BasicBlock &BB : F) {
+      for (Instruction &I : BB) {
+        for (Value *Op : I.operands()) {
+          Function *Callee = dyn_cast<Function>(Op->stripPointerCasts());
+          if (Callee && !Callee->isDeclaration())
+            return false;
+        }
+      }
+    }
+  }
+
+  CallGraph CG(M);
+  for (scc_iterator<CallGraph *> It = scc_begin(&CG); !It.isAtEnd(); ++It) {
+    for (CallGraphNode *Node : *It) {
+      Function *F = Node->getFunction();
+      if (F && !F->isDeclaration())
+        Order.emplace_back(F);
+    }
+  }
+  return Order.size() > 1;
+}
+
+void DxilParallelFunctionPasses::optimizeGroup(FunctionGroup &Group,
+                                               unsigned Index,
+                                               StringRef Bitcode,
+                                               const ShaderModel *SM,
+                                               bool bUseMinPrecision,
+                                               const ShaderFlags &Flags) {
+  LLVMContext Ctx;
+  Ctx.setDiagnosticHandler(FailGroupOnDiagnostic, &Group);
+  std::string DiagStr;
+  std::unique_ptr<Module> M =
+      dxilutil::LoadModuleFromBitcode(Bitcode, Ctx, DiagStr);
+  if (!M) {
+    Group.bFailed = true;
+    return;
+  }
+
+  StringMap<bool> InGroup;
+  for (const std::string &Name : Group.Names)
+    InGroup[Name] = true;
+  for (Function &F : *M) {
+    if (!F.isDeclaration() && !InGroup.count(F.getName()))
+      F.deleteBody();
+  }
+  DxilModule &DM = M->GetOrCreateDxilModule(/*skipInit*/ true);
+  DM.SetShaderModel(SM, bUseMinPrecision);
+  DM.m_ShaderFlags = Flags;
+
+  std::vector<Function *> Functions;
+  for (Function &F : *M)
+    Functions.emplace_back(&F);
+  std::vector<GlobalVariable *> Globals;
+  std::vector<unsigned> Alignments;
+  for (GlobalVariable &GV : M->globals()) {
+    Globals.emplace_back(&GV);
+    Alignments.emplace_back(GV.getAlignment());
+  }
+
+  // The uses of constants before the passes. The passes only add uses to
+  // the front of a use list, so the uses they leave alone stay at the back,
+  // in this order.
+  OriginalInstMap OriginalInsts;
+  std::vector<WeakVH> Constants;
+  DenseMap<const Use *, unsigned> OriginalPositions;
+  {
+    SmallPtrSet<Constant *, 64> Visited;
+    std::vector<Constant *> Reached;
+    for (const std::string &Name : Group.Names) {
+      unsigned InstIndex = 0;
+      for (BasicBlock &BB : *M->getFunction(Name)) {
+        for (Instruction &I : BB) {
+          OriginalInsts[&I] = InstIndex++;
+          for (Value *Op : I.operands())
+            CollectConstants(Op, Visited, Reached);
+        }
+      }
+    }
+    for (Constant *C : Reached) {
+      Constants.emplace_back(C);
+      unsigned Position = 0;
+      for (const Use &U : C->uses())
+        OriginalPositions[&U] = Position++;
+    }
+  }
+
+  std::vector<std::pair<Function *, Function *>> Visits;
+  legacy::PassManager PM;
+  PM.add(new RecordFunctionVisits(Visits));
+  m_AddPasses(PM);
+  PM.run(*M);
+  if (Group.bFailed)
+    return;
+
+  // The group's functions must be visited in the order of the serial run,
+  // and nothing else in the module may change.
+  bool bSameOrder = Visits.size() == Group.Names.size();
+  for (unsigned i = 0; bSameOrder && i < Visits.size(); ++i)
+    bSameOrder = Visits[i].first->getName() == Group.Names[i];
+  unsigned GlobalCount = 0;
+  for (GlobalVariable &GV : M->globals()) {
+    if (GlobalCount >= Globals.size() || Globals[GlobalCount] != &GV ||
+        Alignments[GlobalCount] != GV.getAlignment()) {
+      bSameOrder = false;
+      break;
+    }
+    ++GlobalCount;
+  }
+  if (!bSameOrder || GlobalCount != Globals.size()) {
+    Group.bFailed = true;
+    return;
+  }
+
+  // Functions the passes created are appended to the module, so the visit
+  // that created one is the last that started before it.
+  auto FnIt = M->begin();
+  for (Function *F : Functions) {
+    if (FnIt == M->end() || &*FnIt != F) {
+      Group.bFailed = true;
+      return;
+    }
+    ++FnIt;
+  }
+  DenseMap<Function *, unsigned> Positions;
+  for (Function &F : *M) {
+    unsigned Position = Positions.size();
+    Positions[&F] = Position;
+  }
+  unsigned Visit = 0;
+  for (; FnIt != M->end(); ++FnIt) {
+    Function *NewF = &*FnIt;
+    unsigned Position = Positions[NewF];
+    while (Visit + 1 < Visits.size() &&
+           Positions[Visits[Visit + 1].second] < Position)
+      ++Visit;
+    if (!NewF->isDeclaration() || !NewF->hasName() ||
+        Positions[Visits[Visit].second] >= Position) {
+      Group.bFailed = true;
+      return;
+    }
+    Group.NewFunctions[Visits[Visit].first->getName()].emplace_back(
+        NewF->getName());
+  }
+
+  // Walk each use list from the back for as long as the uses are still in
+  // their original order.
+  DenseMap<const Use *, unsigned> OriginalUses;
+  for (WeakVH &VH : Constants) {
+    Constant *C = cast_or_null<Constant>(VH);
+    if (!C)
+      continue;
+    SmallVector<const Use *, 16> Uses;
+    for (const Use &U : C->uses())
+      Uses.emplace_back(&U);
+    unsigned Last = UINT_MAX;
+    for (auto It = Uses.rbegin(); It != Uses.rend(); ++It) {
+      auto PosIt = OriginalPositions.find(*It);
+      if (PosIt == OriginalPositions.end() || PosIt->second >= Last)
+        break;
+      unsigned InstIndex = UINT_MAX;
+      if (Instruction *I = dyn_cast<Instruction>((*It)->getUser())) {
+        auto InstIt = OriginalInsts.find(I);
+        if (InstIt == OriginalInsts.end())
+          break;
+        InstIndex = InstIt->second;
+      }
+      OriginalUses[*It] = InstIndex;
+      Last = PosIt->second;
+    }
+  }
+  DenseMap<const Use *, unsigned> Ranks;
+  SmallPtrSet<Constant *, 64> Ranked;
+  for (const std::string &Name : Group.Names) {
+    std::vector<ConstantUseOrder> &UseOrders = Group.UseOrders[Name];
+    SmallPtrSet<const Use *, 64> Visited;
+    unsigned InstIndex = 0;
+    for (BasicBlock &BB : *M->getFunction(Name)) {
+      for (Instruction &I : BB) {
+        ForEachConstantUse(I, Visited, [&](Use &U, ArrayRef<unsigned> Path) {
+          Constant *C = cast<Constant>(U.get());
+          if (Ranked.insert(C).second) {
+            unsigned Rank = 0;
+            for (const Use &CU : C->uses())
+              Ranks[&CU] = Rank++;
+          }
+          ConstantUseOrder Order;
+          Order.Inst = InstIndex;
+          Order.Operands.append(Path.begin(), Path.end());
+          auto OrigIt = OriginalUses.find(&U);
+          Order.bOriginal = OrigIt != OriginalUses.end();
+          Order.OriginalInst = Order.bOriginal ? OrigIt->second : UINT_MAX;
+          Order.Rank = Ranks[&U];
+          UseOrders.emplace_back(std::move(Order));
+        });
+        ++InstIndex;
+      }
+    }
+  }
+
+  std::string PrefixStorage;
+  StringRef Prefix = GetTypePrefix(Index, PrefixStorage);
+  TypeFinder Types;
+  Types.run(*M, /*onlyNamed*/ false);
+  for (StructType *ST : Types) {
+    if (!ST->hasName()) {
+      Group.bFailed = true;
+      return;
+    }
+    ST->setName((Prefix + ST->getName()).str());
+  }
+
+  raw_string_ostream OS(Group.Bitcode);
+  WriteBitcodeToFile(M.get(), OS, /*ShouldPreserveUseListOrder*/ true);
+  OS.flush();
+}
+
+// Loads the module each group produced into the context of M, and checks
+// that it only refers to what M has or the passes created.
+bool DxilParallelFunctionPasses::loadGroups(
+    Module &M, std::vector<FunctionGroup> &Groups,
+    std::vector<std::unique_ptr<Module>> &Results,
+    std::vector<std::unique_ptr<PrefixedTypeMapper>> &Mappers) {
+  for (unsigned i = 0; i < Groups.size(); ++i) {
+    std::string DiagStr;
+    Results.emplace_back(
+        dxilutil::LoadModuleFromBitcode(Groups[i].Bitcode, M.getContext(),
+                                        DiagStr));
+    Module *R = Results.back().get();
+    if (!R)
+      return false;
+    std::string PrefixStorage;
+    Mappers.emplace_back(
+        new PrefixedTypeMapper(M, GetTypePrefix(i, PrefixStorage)));
+    TypeFinder Types;
+    Types.run(*R, /*onlyNamed*/ false);
+    for (StructType *ST : Types)
+      Mappers.back()->remapType(ST);
+    if (Mappers.back()->bFailed)
+      return false;
+
+    StringMap<bool> NewNames;
+    for (auto &It : Groups[i].NewFunctions)
+      for (const std::string &Name : It.second)
+        NewNames[Name] = true;
+    for (GlobalVariable &GV : R->globals()) {
+      if (!M.getGlobalVariable(GV.getName(), /*AllowInternal*/ true))
+        return false;
+    }
+    for (Function &F : *R) {
+      Function *MF = M.getFunction(F.getName());
+      if (!MF && !NewNames.count(F.getName()))
+        return false;
+      // Declarations are visited by every group, with the same result.
+      if (MF && MF->isDeclaration() &&
+          F.getAttributes() !=
+              Results[0]->getFunction(F.getName())->getAttributes())
+        return false;
+    }
+  }
+  return true;
+}
+
+bool DxilParallelFunctionPasses::spliceGroups(
+    Module &M, std::vector<Function *> &Order,
+    std::vector<FunctionGroup> &Groups) {
+
+  // Where the uses of constants are before the splice. Uses by instructions
+  // are found again by the index of the instruction and the operand.
+  std::map<std::tuple<unsigned, unsigned, unsigned>, unsigned> InstPositions;
+  DenseMap<const Use *, unsigned> ConstantPositions;
+  std::vector<Constant *> Reached;
+  {
+    DenseMap<Instruction *, std::pair<unsigned, unsigned>> InstIndices;
+    for (unsigned k = 0; k < Order.size(); ++k) {
+      unsigned InstIndex = 0;
+      for (BasicBlock &BB : *Order[k])
+        for (Instruction &I : BB)
+          InstIndices[&I] = std::make_pair(k, InstIndex++);
+    }
+    SmallPtrSet<Constant *, 64> Visited;
+    CollectModuleConstants(M, Visited, Reached);
+    for (Constant *C : Reached) {
+      unsigned Position = 0;
+      for (const Use &U : C->uses()) {
+        Instruction *I = dyn_cast<Instruction>(U.getUser());
+        if (!I) {
+          ConstantPositions[&U] = Position;
+        } else {
+          auto It = InstIndices.find(I);
+          if (It != InstIndices.end())
+            InstPositions[std::make_tuple(It->second.first, It->second.second,
+                                          U.getOperandNo())] = Position;
+        }
+        ++Position;
+      }
+    }
+  }
+
+  // Loading the groups' modules in the context of the module creates
+  // constants a serial run wouldn't have, which stay around as users.
+  std::vector<std::unique_ptr<Module>> Results;
+  auto RemoveLoadedConstants = [&]() {
+    Results.clear();
+    SmallPtrSet<Constant *, 64> Visited;
+    std::vector<Constant *> Constants;
+    CollectModuleConstants(M, Visited, Constants);
+    for (Constant *C : Constants)
+      RemoveDeadUsers(C, ConstantPositions);
+  };
+
+  // Check everything before changing the module, so a failure can still
+  // fall back to the serial run.
+  std::vector<std::unique_ptr<PrefixedTypeMapper>> Mappers;
+  if (!loadGroups(M, Groups, Results, Mappers)) {
+    RemoveLoadedConstants();
+    return false;
+  }
+
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      F.setAttributes(Results[0]->getFunction(F.getName())->getAttributes());
+  }
+
+  std::vector<ValueToValueMapTy> VMaps(Groups.size());
+  for (unsigned i = 0; i < Groups.size(); ++i) {
+    for (GlobalVariable &GV : Results[i]->globals())
+      VMaps[i][&GV] = M.getGlobalVariable(GV.getName(), /*AllowInternal*/ true);
+    for (Function &F : *Results[i]) {
+      if (Function *MF = M.getFunction(F.getName()))
+        VMaps[i][&F] = MF;
+    }
+  }
+  StringMap<unsigned> GroupOf;
+  for (unsigned i = 0; i < Groups.size(); ++i)
+    for (const std::string &Name : Groups[i].Names)
+      GroupOf[Name] = i;
+
+  for (Function *F : Order) {
+    unsigned i = GroupOf[F->getName()];
+    Module *R = Results[i].get();
+    ValueToValueMapTy &VMap = VMaps[i];
+    auto NewIt = Groups[i].NewFunctions.find(F->getName());
+    if (NewIt != Groups[i].NewFunctions.end()) {
+      for (const std::string &Name : NewIt->second) {
+        Function *RF = R->getFunction(Name);
+        Function *NewF = M.getFunction(Name);
+        if (!NewF) {
+          NewF = Function::Create(
+              cast<FunctionType>(Mappers[i]->remapType(RF->getFunctionType())),
+              RF->getLinkage(), Name, &M);
+          NewF->copyAttributesFrom(RF);
+        }
+        VMap[RF] = NewF;
+      }
+    }
+
+    Function *RF = R->getFunction(F->getName());
+    auto ArgIt = F->arg_begin();
+    for (Argument &Arg : RF->args()) {
+      ArgIt->setName(Arg.getName());
+      VMap[&Arg] = &*(ArgIt++);
+    }
+    F->dropAllReferences();
+    SmallVector<ReturnInst *, 4> Returns;
+    CloneFunctionInto(F, RF, VMap, /*ModuleLevelChanges*/ true, Returns, "",
+                      nullptr, Mappers[i].get());
+    F->setAttributes(RF->getAttributes());
+    CopyUseListOrder(*RF, VMap);
+  }
+  VMaps.clear();
+  RemoveLoadedConstants();
+
+  // A serial run leaves the uses of a constant created while optimizing each
+  // function in front of those of the functions before it, and the uses that
+  // were there before at the back, in their original order.
+  typedef std::tuple<unsigned, unsigned, unsigned> UseKey;
+  DenseMap<const Use *, UseKey> Keys;
+  SmallPtrSet<Value *, 64> Visited;
+  std::vector<Value *> Constants;
+  for (unsigned k = 0; k < Order.size(); ++k) {
+    std::vector<Instruction *> Insts;
+    for (BasicBlock &BB : *Order[k])
+      for (Instruction &I : BB)
+        Insts.emplace_back(&I);
+    FunctionGroup &Group = Groups[GroupOf[Order[k]->getName()]];
+    for (ConstantUseOrder &UseOrder : Group.UseOrders[Order[k]->getName()]) {
+      if (UseOrder.Inst >= Insts.size())
+        continue;
+      User *UseUser = Insts[UseOrder.Inst];
+      Use *U = nullptr;
+      for (unsigned OpNo : UseOrder.Operands) {
+        if (!UseUser || OpNo >= UseUser->getNumOperands()) {
+          U = nullptr;
+          break;
+        }
+        U = &UseUser->getOperandUse(OpNo);
+        UseUser = dyn_cast<Constant>(U->get());
+      }
+      // A constant first created by an earlier function keeps its place.
+      if (!U || !isa<Constant>(U->get()) || Keys.count(U))
+        continue;
+      UseKey Key(0, Order.size() - 1 - k, UseOrder.Rank);
+      if (UseOrder.bOriginal) {
+        if (UseOrder.Operands.size() == 1) {
+          auto It = InstPositions.find(std::make_tuple(
+              k, UseOrder.OriginalInst, UseOrder.Operands[0]));
+          if (It != InstPositions.end())
+            Key = UseKey(1, It->second, 0);
+        } else {
+          auto It = ConstantPositions.find(U);
+          if (It != ConstantPositions.end())
+            Key = UseKey(1, It->second, 0);
+        }
+      }
+      Keys[U] = Key;
+      if (Visited.insert(U->get()).second)
+        Constants.emplace_back(U->get());
+    }
+  }
+  auto GetKey = [&](const Use &U) {
+    auto It = Keys.find(&U);
+    if (It != Keys.end())
+      return It->second;
+    auto PosIt = ConstantPositions.find(&U);
+    return UseKey(1, PosIt != ConstantPositions.end() ? PosIt->second
+                                                     : UINT_MAX, 0);
+  };
+  for (Value *C : Constants) {
+    if (!C->hasOneUse())
+      C->sortUseList([&GetKey](const Use &L, const Use &R) {
+        return GetKey(L) < GetKey(R);
+      });
+  }
+
+  M.GetDxilModule().GetOP()->RefreshCache();
+  return true;
+}
+
+bool DxilParallelFunctionPasses::runOnModule(Module &M) {
+  std::vector<Function *> Order;
+  if (!canSplit(M, Order))
+    return runSerial(M);
+
+  // Balance the groups by instruction count, largest functions first.
+  std::vector<std::pair<unsigned, unsigned>> Sizes;
+  for (unsigned i = 0; i < Order.size(); ++i) {
+    unsigned Size = 0;
+    for (BasicBlock &BB : *Order[i])
+      Size += BB.size();
+    Sizes.emplace_back(Size, i);
+  }
+  std::stable_sort(Sizes.begin(), Sizes.end(),
+                   [](const std::pair<unsigned, unsigned> &L,
+                      const std::pair<unsigned, unsigned> &R) {
+                     return L.first > R.first;
+                   });
+  std::vector<FunctionGroup> Groups(
+      std::min<size_t>(m_Threads, Order.size()));
+  std::vector<unsigned> GroupOf(Order.size());
+  for (auto &It : Sizes) {
+    FunctionGroup *Target = &Groups[0];
+    for (FunctionGroup &Group : Groups) {
+      if (Group.Size < Target->Size)
+        Target = &Group;
+    }
+    Target->Size += It.first;
+    GroupOf[It.second] = Target - Groups.data();
+  }
+  for (unsigned i = 0; i < Order.size(); ++i)
+    Groups[GroupOf[i]].Names.emplace_back(Order[i]->getName());
+
+  std::string Bitcode;
+  {
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS, /*ShouldPreserveUseListOrder*/ true);
+  }
+
+  DxilModule &DM = M.GetDxilModule();
+  const ShaderModel *SM = DM.GetShaderModel();
+  bool bUseMinPrecision = DM.GetUseMinPrecision();
+  ShaderFlags Flags = DM.m_ShaderFlags;
+  IMalloc *pMalloc = DxcGetThreadMallocNoRef();
+  std::vector<std::thread> Threads;
+  for (unsigned i = 0; i < Groups.size(); ++i) {
+    Threads.emplace_back([&, i]() {
+      DxcThreadMalloc TM(pMalloc);
+      try {
+        optimizeGroup(Groups[i], i, Bitcode, SM, bUseMinPrecision, Flags);
+      } catch (...) {
+        Groups[i].bFailed = true;
+      }
+    });
+  }
+  for (std::thread &Thread : Threads)
+    Thread.join();
+
+  for (FunctionGroup &Group : Groups) {
+    if (Group.bFailed)
+      return runSerial(M);
+  }
+  if (!spliceGroups(M, Order, Groups))
+    return runSerial(M);
+  return true;
+}
+
+} // namespace
+
+ModulePass *llvm::createDxilParallelFunctionPassesPass(
+    unsigned Threads,
+    std::function<void(legacy::PassManagerBase &)> AddPasses) {
+  return new DxilParallelFunctionPasses(Threads, AddPasses);
+}
@@ -0,0 +1,231 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilPipelineSignature.cpp                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Optimizes the signatures between consecutive stages of a pipeline.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilPipelineSignature.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilSignature.h"
+#include "dxc/HLSL/ComputeViewIdState.h"
+#include "dxc/HLSL/DxilPackSignatureElement.h"
+#include "dxc/HLSL/DxilSignatureAllocator.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Packs a producer output with the interpolation mode its consumer reads it
+// with, so that the packed rows are valid for the consumer too.
+class PipelinePackElement : public DxilPackElement {
+  DXIL::InterpolationMode m_InterpMode;
+
+public:
+  PipelinePackElement(DxilSignatureElement *pSE, bool useMinPrecision,
+                      DXIL::InterpolationMode interpMode)
+      : DxilPackElement(pSE, useMinPrecision), m_InterpMode(interpMode) {}
+  DXIL::InterpolationMode GetInterpolationMode() const override {
+    return m_InterpMode;
+  }
+};
+
+// A consumer input and the producer output it reads.
+struct SignatureLink {
+  DxilSignatureElement *pInput;
+  DxilSignatureElement *pOutput;
+  unsigned RowOffset;
+};
+
+DxilSignatureElement *FindProducerOutput(DxilSignature &Outputs,
+                                         DxilSignatureElement &Input,
+                                         unsigned &RowOffset) {
+  for (auto &SE : Outputs.GetElements()) {
+    if (SE->GetKind() != Input.GetKind() ||
+        !SE->GetSemanticName().equals_lower(Input.GetSemanticName()))
+      continue;
+    unsigned Start = SE->GetSemanticStartIndex();
+    unsigned InputStart = Input.GetSemanticStartIndex();
+    if (InputStart < Start ||
+        InputStart + Input.GetRows() > Start + SE->GetRows() ||
+        Input.GetCols() > SE->GetCols())
+      continue;
+    RowOffset = InputStart - Start;
+    return SE.get();
+  }
+  return nullptr;
+}
+
+// Removes stores to deleted outputs, and any code only they used, and updates
+// the signature element IDs of the remaining stores.
+void RemoveDeadOutputStores(DxilModule &DM,
+                            const std::vector<unsigned> &NewIDs) {
+  std::vector<CallInst *> Stores;
+  for (Function &F : *DM.GetModule()) {
+    for (BasicBlock &BB : F) {
+      for (Instruction &I : BB) {
+        if (OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::StoreOutput))
+          Stores.push_back(cast<CallInst>(&I));
+      }
+    }
+  }
+
+  for (CallInst *Store : Stores) {
+    DxilInst_StoreOutput SO(Store);
+    unsigned OldID =
+        cast<ConstantInt>(SO.get_outputSigId())->getLimitedValue();
+    DXASSERT_NOMSG(OldID < NewIDs.size());
+    unsigned NewID = NewIDs[OldID];
+    if (NewID == DxilSignatureElement::kUndefinedID) {
+      Value *StoredVal = SO.get_value();
+      Value *RowIndex = SO.get_rowIndex();
+      Store->eraseFromParent();
+      RecursivelyDeleteTriviallyDeadInstructions(StoredVal);
+      RecursivelyDeleteTriviallyDeadInstructions(RowIndex);
+    } else if (NewID != OldID) {
+      Store->setArgOperand(DxilInst_StoreOutput::arg_outputSigId,
+                           ConstantInt::get(SO.get_outputSigId()->getType(),
+                                            NewID));
+    }
+  }
+}
+
+// Packs the producer outputs for the consumer and moves the consumer inputs
+// to match. Returns false, leaving both signatures unchanged, if that isn't
+// possible.
+bool PackPipelineSignatures(DxilModule &Producer,
+                            const std::vector<SignatureLink> &Links) {
+  DxilSignature &Outputs = Producer.GetOutputSignature();
+
+  std::map<DxilSignatureElement *, DXIL::InterpolationMode> InterpModes;
+  for (const SignatureLink &Link : Links) {
+    DXIL::InterpolationMode Mode =
+        Link.pInput->GetInterpolationMode()->GetKind();
+    auto Inserted = InterpModes.insert(std::make_pair(Link.pOutput, Mode));
+    if (!Inserted.second && Inserted.first->second != Mode)
+      return false;
+  }
+
+  std::vector<PipelinePackElement> PackElements;
+  std::vector<std::pair<int, int>> OldLocations;
+  for (auto &SE : Outputs.GetElements()) {
+    if (!DxilSignature::ShouldBeAllocated(SE->GetInterpretation()))
+      continue;
+    auto It = InterpModes.find(SE.get());
+    DXIL::InterpolationMode Mode = It != InterpModes.end()
+                                       ? It->second
+                                       : SE->GetInterpolationMode()->GetKind();
+    PackElements.emplace_back(SE.get(), Outputs.UseMinPrecision(), Mode);
+    OldLocations.emplace_back(SE->GetStartRow(), SE->GetStartCol());
+  }
+
+  std::vector<DxilSignatureAllocator::PackElement *> Elements;
+  for (auto &PE : PackElements)
+    Elements.push_back(&PE);
+  DxilSignatureAllocator Alloc(32, Outputs.UseMinPrecision());
+  Alloc.PackOptimized(Elements, 0, 32);
+
+  bool bAllocated = true;
+  for (auto &PE : PackElements)
+    bAllocated &= PE.IsAllocated();
+  if (!bAllocated) {
+    for (size_t i = 0; i < PackElements.size(); ++i)
+      PackElements[i].SetLocation(OldLocations[i].first,
+                                  OldLocations[i].second);
+    return false;
+  }
+
+  for (const SignatureLink &Link : Links) {
+    Link.pInput->SetStartRow(Link.pOutput->GetStartRow() + Link.RowOffset);
+    Link.pInput->SetStartCol(Link.pOutput->GetStartCol());
+  }
+  return true;
+}
+
+// Signature locations feed the ViewID state, so it is recomputed before the
+// metadata is emitted.
+void UpdateModule(DxilModule &DM) {
+  legacy::PassManager PM;
+  PM.add(createComputeViewIdStatePass());
+  PM.run(*DM.GetModule());
+  DM.EmitDxilMetadata();
+}
+
+} // namespace
+
+namespace hlsl {
+
+bool OptimizePipelineSignatures(DxilModule &Producer, DxilModule &Consumer) {
+  const ShaderModel *pProducerSM = Producer.GetShaderModel();
+  if (!(pProducerSM->IsVS() || pProducerSM->IsDS() || pProducerSM->IsGS()) ||
+      !Consumer.GetShaderModel()->IsPS())
+    return false;
+
+  DxilSignature &Outputs = Producer.GetOutputSignature();
+  DxilSignature &Inputs = Consumer.GetInputSignature();
+
+  // Only stream 0 is rasterized; other streams are for stream output.
+  for (auto &SE : Outputs.GetElements()) {
+    if (SE->GetOutputStream() != 0)
+      return false;
+  }
+
+  // Find the output read by each consumer input.
+  std::vector<SignatureLink> Links;
+  std::set<DxilSignatureElement *> ReadOutputs;
+  bool bAllInputsLinked = true;
+  for (auto &SE : Inputs.GetElements()) {
+    if (!DxilSignature::ShouldBeAllocated(SE->GetInterpretation()))
+      continue;
+    SignatureLink Link;
+    Link.pInput = SE.get();
+    Link.pOutput = FindProducerOutput(Outputs, *SE, Link.RowOffset);
+    if (!Link.pOutput) {
+      bAllInputsLinked = false;
+      continue;
+    }
+    Links.push_back(Link);
+    ReadOutputs.insert(Link.pOutput);
+  }
+
+  // System values are consumed by fixed function stages too; only arbitrary
+  // outputs are removed.
+  std::set<unsigned> DeadIDs;
+  for (auto &SE : Outputs.GetElements()) {
+    if (SE->IsArbitrary() && !ReadOutputs.count(SE.get()))
+      DeadIDs.insert(SE->GetID());
+  }
+  if (DeadIDs.empty())
+    return false;
+
+  std::vector<unsigned> NewIDs = Outputs.DeleteElements(DeadIDs);
+  RemoveDeadOutputStores(Producer, NewIDs);
+
+  // Inputs that don't match any output leave no room to move things around.
+  if (bAllInputsLinked)
+    PackPipelineSignatures(Producer, Links);
+
+  UpdateModule(Producer);
+  UpdateModule(Consumer);
+  return true;
+}
+
+} // namespace hlsl
@@ -529,6 +529,9 @@ private:
             entries.emplace_back(F);
           }
 
+          // Patch constant functions use signatures but have no props.
+          if (!DM.HasDxilFunctionProps(F))
+            continue;
           DxilFunctionProps& props = DM.GetDxilFunctionProps(F);
           if (props.IsHS() && props.ShaderProps.HS.patchConstantFunc) {
             FunctionType* PatchConstantFuncTy = props.ShaderProps.HS.patchConstantFunc->getFunctionType();
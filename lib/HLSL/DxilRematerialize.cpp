@@ -0,0 +1,295 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilRematerialize.cpp                                                     //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Lowers register pressure by recomputing cheap values next to their uses.  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilLiveness.h"
+#include "dxc/DXIL/DxilOperations.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+// Largest expression recomputed for a single value.
+const unsigned kMaxRematInstructions = 8;
+
+// Returns the most scalars live at any point of F, and adds the values live
+// wherever more than Threshold scalars are live to HighLive.
+unsigned ScanPressure(Function &F, unsigned Threshold,
+                      SetVector<Instruction *> &HighLive) {
+  DxilLiveness Liveness(F);
+  unsigned MaxLive = 0;
+  auto Visit = [&](const DxilLiveSet &Live) {
+    MaxLive = std::max(MaxLive, Live.scalars());
+    if (Live.scalars() <= Threshold)
+      return;
+    for (Value *V : Live) {
+      if (Instruction *I = dyn_cast<Instruction>(V))
+        HighLive.insert(I);
+    }
+  };
+
+  for (BasicBlock &BB : F) {
+    DxilLiveSet Live;
+    Liveness.GetLiveOut(&BB, Live);
+    Visit(Live);
+    for (auto It = BB.rbegin(), E = BB.rend(); It != E; ++It) {
+      Instruction &I = *It;
+      if (isa<PHINode>(I))
+        break;
+      // A value is live where it is defined, even if it is never used.
+      Live.insert(&I);
+      Visit(Live);
+      Live.erase(&I);
+      for (Value *Op : I.operands())
+        Live.insert(Op);
+      Visit(Live);
+    }
+  }
+  return MaxLive;
+}
+
+class DxilRematerialize : public FunctionPass {
+  unsigned m_Threshold = 64;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilRematerialize() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL rematerialize";
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionUnsigned(O, "pressure-threshold", &m_Threshold, 64);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  DominatorTree *m_DT;
+  LoopInfo *m_LI;
+  // Clones made in each block, so that values used together share them.
+  DenseMap<std::pair<BasicBlock *, Instruction *>, Instruction *> m_Clones;
+  SmallPtrSet<Instruction *, 16> m_CloneSet;
+
+  bool IsRematerializable(Instruction *I, unsigned &Budget);
+  void MoveClone(Instruction *Clone, Instruction *InsertPt);
+  Instruction *Rematerialize(Instruction *I, Instruction *InsertPt);
+  bool RematerializeUses(Instruction *I);
+};
+
+char DxilRematerialize::ID = 0;
+
+// Returns true if I can be recomputed anywhere it dominates without
+// lengthening the live range of any value that takes a register. Budget is
+// the number of instructions that may still be recomputed.
+bool DxilRematerialize::IsRematerializable(Instruction *I, unsigned &Budget) {
+  if (Budget == 0)
+    return false;
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    if (!OP::IsDxilOpFuncCallInst(CI))
+      return false;
+    switch (OP::GetOpCodeClass(OP::GetDxilOpFuncCallInst(CI))) {
+    // Constant buffers don't change while the shader runs.
+    case DXIL::OpCodeClass::CBufferLoad:
+    case DXIL::OpCodeClass::CBufferLoadLegacy:
+    case DXIL::OpCodeClass::Unary:
+    case DXIL::OpCodeClass::UnaryBits:
+    case DXIL::OpCodeClass::IsSpecialFloat:
+    case DXIL::OpCodeClass::Binary:
+    case DXIL::OpCodeClass::Tertiary:
+    case DXIL::OpCodeClass::Quaternary:
+    case DXIL::OpCodeClass::Dot2:
+    case DXIL::OpCodeClass::Dot3:
+    case DXIL::OpCodeClass::Dot4:
+      break;
+    default:
+      return false;
+    }
+  } else if (!isa<BinaryOperator>(I) && !isa<CastInst>(I) &&
+             !isa<CmpInst>(I) && !isa<SelectInst>(I) &&
+             !isa<GetElementPtrInst>(I) && !isa<ExtractValueInst>(I)) {
+    return false;
+  }
+  Budget--;
+
+  for (Value *Op : I->operands()) {
+    if (isa<Constant>(Op) || isa<BasicBlock>(Op) ||
+        GetScalarCount(Op->getType()) == 0)
+      continue;
+    Instruction *OpI = dyn_cast<Instruction>(Op);
+    if (!OpI || !IsRematerializable(OpI, Budget))
+      return false;
+  }
+  return true;
+}
+
+// Moves Clone and the clones it uses up to InsertPt. Original operands
+// dominate every use of the value they feed, so only clones have to move.
+void DxilRematerialize::MoveClone(Instruction *Clone, Instruction *InsertPt) {
+  for (Value *Op : Clone->operands()) {
+    Instruction *OpI = dyn_cast<Instruction>(Op);
+    if (OpI && m_CloneSet.count(OpI) && !m_DT->dominates(OpI, InsertPt))
+      MoveClone(OpI, InsertPt);
+  }
+  Clone->moveBefore(InsertPt);
+}
+
+// Recomputes I before InsertPt, reusing clones already in that block.
+Instruction *DxilRematerialize::Rematerialize(Instruction *I,
+                                              Instruction *InsertPt) {
+  BasicBlock *BB = InsertPt->getParent();
+  auto It = m_Clones.find(std::make_pair(BB, I));
+  if (It != m_Clones.end()) {
+    Instruction *Clone = It->second;
+    if (!m_DT->dominates(Clone, InsertPt))
+      MoveClone(Clone, InsertPt);
+    return Clone;
+  }
+
+  Instruction *Clone = I->clone();
+  Clone->setName(I->getName());
+  for (unsigned i = 0; i < Clone->getNumOperands(); ++i) {
+    Instruction *OpI = dyn_cast<Instruction>(Clone->getOperand(i));
+    if (OpI && GetScalarCount(OpI->getType()) > 0)
+      Clone->setOperand(i, Rematerialize(OpI, InsertPt));
+  }
+  Clone->insertBefore(InsertPt);
+  m_Clones[std::make_pair(BB, I)] = Clone;
+  m_CloneSet.insert(Clone);
+  return Clone;
+}
+
+// Recomputes I in each block that uses it, before the first use there.
+bool DxilRematerialize::RematerializeUses(Instruction *I) {
+  MapVector<BasicBlock *, std::vector<Use *>> BlockUses;
+  for (Use &U : I->uses()) {
+    Instruction *User = cast<Instruction>(U.getUser());
+    BasicBlock *BB = User->getParent();
+    if (PHINode *Phi = dyn_cast<PHINode>(User))
+      BB = Phi->getIncomingBlock(U);
+    BlockUses[BB].push_back(&U);
+  }
+
+  bool bUpdated = false;
+  for (auto &It : BlockUses) {
+    BasicBlock *BB = It.first;
+    // Recomputing the value in a loop it isn't defined in would run it on
+    // every iteration; keeping it live across the loop is cheaper.
+    Loop *UseLoop = m_LI->getLoopFor(BB);
+    if (UseLoop && !UseLoop->contains(I))
+      continue;
+    // Phis read the value on the edge out of BB, so their uses are fed from
+    // its end.
+    SmallPtrSet<Instruction *, 8> Users;
+    for (Use *U : It.second) {
+      Instruction *User = cast<Instruction>(U->getUser());
+      if (!isa<PHINode>(User))
+        Users.insert(User);
+    }
+
+    Instruction *InsertPt = BB->getTerminator();
+    if (!Users.empty()) {
+      for (Instruction &Inst : *BB) {
+        if (Users.count(&Inst)) {
+          InsertPt = &Inst;
+          break;
+        }
+      }
+    }
+    // Nothing to gain when the value is already computed right there.
+    if (InsertPt == I->getNextNode())
+      continue;
+
+    Instruction *Clone = Rematerialize(I, InsertPt);
+    for (Use *U : It.second)
+      U->set(Clone);
+    bUpdated = true;
+  }
+  return bUpdated;
+}
+
+bool DxilRematerialize::runOnFunction(Function &F) {
+  m_DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  m_LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  m_Clones.clear();
+  m_CloneSet.clear();
+
+  SetVector<Instruction *> HighLive;
+  unsigned PressureBefore = ScanPressure(F, m_Threshold, HighLive);
+  if (PressureBefore <= m_Threshold)
+    return false;
+
+  std::vector<WeakVH> Candidates;
+  for (Instruction *I : HighLive) {
+    unsigned Budget = kMaxRematInstructions;
+    if (IsRematerializable(I, Budget))
+      Candidates.push_back(I);
+  }
+
+  bool bUpdated = false;
+  for (WeakVH &VH : Candidates)
+    bUpdated |= RematerializeUses(cast<Instruction>(VH));
+
+  // Candidates may be deleted along with other candidates they feed.
+  for (WeakVH &VH : Candidates) {
+    if (Instruction *I = dyn_cast_or_null<Instruction>(VH))
+      RecursivelyDeleteTriviallyDeadInstructions(I);
+  }
+
+  SetVector<Instruction *> StillHighLive;
+  unsigned PressureAfter =
+      bUpdated ? ScanPressure(F, m_Threshold, StillHighLive)
+               : PressureBefore;
+  std::string Msg;
+  raw_string_ostream OS(Msg);
+  OS << "register pressure " << PressureBefore << " -> " << PressureAfter
+     << " (threshold " << m_Threshold << ")";
+  if (PressureAfter <= m_Threshold)
+    emitOptimizationRemark(F.getContext(), "dxil-remat", F, DebugLoc(),
+                           OS.str());
+  else
+    emitOptimizationRemarkMissed(F.getContext(), "dxil-remat", F, DebugLoc(),
+                                 OS.str());
+  return bUpdated;
+}
+
+}
+
+FunctionPass *llvm::createDxilRematerializePass() {
+  return new DxilRematerialize();
+}
+
+INITIALIZE_PASS_BEGIN(DxilRematerialize, "dxil-remat",
+                      "DXIL rematerialize", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(DxilRematerialize, "dxil-remat",
+                    "DXIL rematerialize", false, false)
@@ -12,6 +12,7 @@
 #include "dxc/HLSL/DxilGenerationPass.h"
 #include "dxc/DXIL/DxilOperations.h"
 
+#include "llvm/Analysis/PostDominators.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Instructions.h"
 
@@ -21,6 +22,8 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/CFG.h"
 
+#include <memory>
+
 using namespace llvm;
 using namespace hlsl;
 
@@ -91,6 +94,10 @@ class ValueTable {
 
   uint32_t nextValueNumber = 1;
 
+  // Wave operations may only be numbered when the lanes running them are
+  // known to be the same.
+  bool bWaveOpsSafe = false;
+
   Expression createExpr(Instruction *I);
   Expression createCmpExpr(unsigned Opcode, CmpInst::Predicate Predicate,
                            Value *LHS, Value *RHS);
@@ -114,6 +121,7 @@ public:
   void clear();
   void erase(Value *v);
   void setDomTree(DominatorTree *D) { DT = D; }
+  void setWaveOpsSafe(bool bSafe) { bWaveOpsSafe = bSafe; }
   uint32_t getNextUnusedValueNumber() { return nextValueNumber; }
   void verifyRemoved(const Value *) const;
 };
@@ -278,6 +286,8 @@ uint32_t ValueTable::lookupOrAddCall(CallInst *C) {
       }
     }
   }
+  if (!bSafe && bWaveOpsSafe && hlsl::OP::IsDxilOpFunc(F))
+    bSafe = hlsl::OP::IsDxilOpWave(hlsl::OP::GetDxilOpFuncCallInst(C));
   if (bSafe) {
     Expression exp = createExpr(C);
     uint32_t e = assignExpNewValueNum(exp).first;
@@ -440,6 +450,8 @@ namespace {
 //  else
 //    r = tex.Sample(ss, uv) + 3;
 // }
+// Wave operations are only hoisted out of uniform branches, where both
+// successors run with the same lanes as the branch.
 class DxilSimpleGVNHoist : public FunctionPass {
 
 public:
@@ -453,7 +465,8 @@ public:
   bool runOnFunction(Function &F) override;
 
 private:
-  bool tryToHoist(BasicBlock *BB, BasicBlock *Succ0, BasicBlock *Succ1);
+  bool tryToHoist(BasicBlock *BB, BasicBlock *Succ0, BasicBlock *Succ1,
+                  bool bUniformBranch);
 };
 
 char DxilSimpleGVNHoist::ID = 0;
@@ -470,9 +483,10 @@ bool HasOnePred(BasicBlock *BB) {
 }
 
 bool DxilSimpleGVNHoist::tryToHoist(BasicBlock *BB, BasicBlock *Succ0,
-                                    BasicBlock *Succ1) {
+                                    BasicBlock *Succ1, bool bUniformBranch) {
   // ValueNumber Succ0 and Succ1.
   ValueTable VT;
+  VT.setWaveOpsSafe(bUniformBranch);
   DenseMap<uint32_t, SmallVector<Instruction *, 2>> VNtoInsts;
   for (Instruction &I : *Succ0) {
     uint32_t V = VT.lookupOrAdd(&I);
@@ -552,9 +566,30 @@ bool DxilSimpleGVNHoist::tryToHoist(BasicBlock *BB, BasicBlock *Succ0,
   return true;
 }
 
+static bool HasWaveOps(Function &F) {
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (hlsl::OP::IsDxilOpFuncCallInst(&I) &&
+          hlsl::OP::IsDxilOpWave(hlsl::OP::GetDxilOpFuncCallInst(&I)))
+        return true;
+    }
+  }
+  return false;
+}
+
 bool DxilSimpleGVNHoist::runOnFunction(Function &F) {
   BasicBlock &Entry = F.getEntryBlock();
   bool bUpdated = false;
+
+  // Hoisting never changes a branch condition, so the analysis stays valid.
+  PostDominatorTree PDT;
+  std::unique_ptr<DxilUniformityAnalysis> Uniformity;
+  if (HasWaveOps(F)) {
+    PDT.runOnFunction(F);
+    Uniformity.reset(DxilUniformityAnalysis::create(PDT));
+    Uniformity->Analyze(&F);
+  }
+
   for (auto it = po_begin(&Entry); it != po_end(&Entry); it++) {
     BasicBlock *BB = *it;
     TerminatorInst *TI = BB->getTerminator();
@@ -571,7 +606,8 @@ bool DxilSimpleGVNHoist::runOnFunction(Function &F) {
       continue;
     if (!HasOnePred(Succ1))
       continue;
-    bUpdated |= tryToHoist(BB, Succ0, Succ1);
+    bool bUniformBranch = Uniformity && Uniformity->IsUniform(TI);
+    bUpdated |= tryToHoist(BB, Succ0, Succ1, bUniformBranch);
   }
   return bUpdated;
 }
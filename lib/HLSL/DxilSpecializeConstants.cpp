@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilSpecializeConstants.cpp                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Replaces reads of constant buffer fields with given values, so a generic  //
+// library can be specialized when linking.                                  //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilCBuffer.h"
+#include "dxc/DXIL/DxilModule.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/DXIL/DxilTypeSystem.h"
+
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <string>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+namespace {
+
+// A constant buffer field to replace, with one value per component. Min
+// precision components are laid out 4 bytes apart, whatever their size.
+struct SpecializedField {
+  unsigned Offset;
+  unsigned Stride;
+  SmallVector<Constant *, 4> Values;
+};
+
+// Each value is "name=value", where name is a scalar or vector field of a
+// constant buffer, including globals in $Globals, and vector components are
+// separated by ','. Every read of the field is replaced with the value.
+class DxilSpecializeConstants : public ModulePass {
+  std::vector<std::string> m_Values;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilSpecializeConstants(
+      const std::vector<std::string> &Values = std::vector<std::string>())
+      : ModulePass(ID), m_Values(Values) {}
+
+  const char *getPassName() const override {
+    return "DXIL specialize constants";
+  }
+
+  void applyOptions(PassOptions O) override {
+    StringRef Values;
+    if (GetPassOption(O, "values", &Values)) {
+      SmallVector<StringRef, 4> Entries;
+      Values.split(Entries, ";", -1, false);
+      for (StringRef Entry : Entries)
+        m_Values.emplace_back(Entry.str());
+    }
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool SpecializeHandle(Value *Handle, DxilCBuffer &CB,
+                        std::vector<SpecializedField> &Fields);
+};
+
+char DxilSpecializeConstants::ID = 0;
+
+Constant *ParseComponent(Type *Ty, StringRef Str) {
+  Str = Str.trim();
+  if (IntegerType *ITy = dyn_cast<IntegerType>(Ty)) {
+    if (Str.equals_lower("true"))
+      return ConstantInt::get(ITy, 1);
+    if (Str.equals_lower("false"))
+      return ConstantInt::get(ITy, 0);
+    unsigned BitWidth = ITy->getBitWidth();
+    if (Str.startswith("-")) {
+      int64_t Val;
+      if (Str.getAsInteger(0, Val) || !isIntN(BitWidth, Val))
+        return nullptr;
+      return ConstantInt::get(ITy, Val, /*isSigned*/ true);
+    }
+    uint64_t Val;
+    if (Str.getAsInteger(0, Val) || !isUIntN(BitWidth, Val))
+      return nullptr;
+    return ConstantInt::get(ITy, Val);
+  }
+  if (Ty->isFloatingPointTy()) {
+    if (Str.empty())
+      return nullptr;
+    APFloat Val(Ty->getFltSemantics());
+    if (Val.convertFromString(Str, APFloat::rmNearestTiesToEven) &
+        APFloat::opInvalidOp)
+      return nullptr;
+    return ConstantFP::get(Ty->getContext(), Val);
+  }
+  return nullptr;
+}
+
+// Replace the components of cbufferLoadLegacy results on Handle that read
+// specialized fields.
+bool DxilSpecializeConstants::SpecializeHandle(
+    Value *Handle, DxilCBuffer &CB, std::vector<SpecializedField> &Fields) {
+  bool bUpdated = false;
+  for (User *U : Handle->users()) {
+    Instruction *I = dyn_cast<Instruction>(U);
+    if (!I)
+      continue;
+    // Which buffer is read through a phi or select is only known at run time.
+    if (isa<PHINode>(I) || isa<SelectInst>(I)) {
+      I->getContext().emitError(
+          I, Twine("Cannot specialize fields of constant buffer ") +
+                 CB.GetGlobalName() + " selected at run time");
+      continue;
+    }
+    if (!OP::IsDxilOpFuncCallInst(I, DXIL::OpCode::CBufferLoadLegacy))
+      continue;
+    DxilInst_CBufferLoadLegacy Load(I);
+    ConstantInt *Row = dyn_cast<ConstantInt>(Load.get_regIndex());
+    if (!Row)
+      continue;
+    // The elements of the result split the 16 byte row evenly, so min
+    // precision results have a 4 byte stride.
+    StructType *RetTy = cast<StructType>(I->getType());
+    unsigned Stride = 16 / RetTy->getNumElements();
+    for (auto It = I->user_begin(), E = I->user_end(); It != E;) {
+      ExtractValueInst *EV = dyn_cast<ExtractValueInst>(*(It++));
+      if (!EV || EV->getNumIndices() != 1)
+        continue;
+      Type *Ty = EV->getType();
+      unsigned Offset = Row->getZExtValue() * 16 + EV->getIndices()[0] * Stride;
+      for (SpecializedField &Field : Fields) {
+        if (Offset < Field.Offset ||
+            Offset >= Field.Offset + Field.Values.size() * Field.Stride ||
+            (Offset - Field.Offset) % Field.Stride != 0)
+          continue;
+        Constant *C = Field.Values[(Offset - Field.Offset) / Field.Stride];
+        if (C->getType()->getPrimitiveSizeInBits() !=
+            Ty->getPrimitiveSizeInBits())
+          continue;
+        EV->replaceAllUsesWith(ConstantExpr::getBitCast(C, Ty));
+        EV->eraseFromParent();
+        bUpdated = true;
+        break;
+      }
+    }
+  }
+  return bUpdated;
+}
+
+bool DxilSpecializeConstants::runOnModule(Module &M) {
+  if (m_Values.empty())
+    return false;
+
+  DxilModule &DM = M.GetOrCreateDxilModule();
+  DxilTypeSystem &TypeSys = DM.GetTypeSystem();
+  LLVMContext &Ctx = M.getContext();
+
+  // Fields to replace, by constant buffer.
+  std::vector<std::vector<SpecializedField>> CBFields(DM.GetCBuffers().size());
+  for (const std::string &Entry : m_Values) {
+    std::pair<StringRef, StringRef> NameValue = StringRef(Entry).split('=');
+    StringRef Name = NameValue.first.trim();
+    bool bFound = false;
+    for (unsigned i = 0; i < DM.GetCBuffers().size() && !bFound; ++i) {
+      DxilCBuffer &CB = DM.GetCBuffer(i);
+      PointerType *PT = cast<PointerType>(CB.GetGlobalSymbol()->getType());
+      StructType *ST = dyn_cast<StructType>(PT->getElementType());
+      DxilStructAnnotation *SA = ST ? TypeSys.GetStructAnnotation(ST) : nullptr;
+      if (!SA)
+        continue;
+      for (unsigned f = 0; f < SA->GetNumFields(); ++f) {
+        DxilFieldAnnotation &FA = SA->GetFieldAnnotation(f);
+        if (FA.GetFieldName() != Name)
+          continue;
+        bFound = true;
+
+        Type *FieldTy = ST->getElementType(f);
+        unsigned NumComponents = 1;
+        if (VectorType *VT = dyn_cast<VectorType>(FieldTy)) {
+          NumComponents = VT->getNumElements();
+          FieldTy = VT->getElementType();
+        }
+        SmallVector<StringRef, 4> Components;
+        NameValue.second.split(Components, ",");
+        SpecializedField Field;
+        Field.Offset = FA.GetCBufferOffset();
+        Field.Stride = FieldTy->getPrimitiveSizeInBits() / 8;
+        if (Field.Stride == 2 && DM.GetUseMinPrecision())
+          Field.Stride = 4;
+        if (Components.size() == NumComponents && Field.Stride) {
+          for (StringRef Component : Components) {
+            if (Constant *C = ParseComponent(FieldTy, Component))
+              Field.Values.emplace_back(C);
+          }
+        }
+        if (Field.Values.size() != NumComponents) {
+          Ctx.emitError(Twine("Invalid specialization value for ") + Name +
+                        ": " + NameValue.second);
+          return false;
+        }
+        CBFields[i].emplace_back(std::move(Field));
+        break;
+      }
+    }
+    if (!bFound) {
+      Ctx.emitError(Twine("Specialized constant ") + Name +
+                    " is not a field of any constant buffer");
+      return false;
+    }
+  }
+
+  bool bUpdated = false;
+  for (unsigned i = 0; i < CBFields.size(); ++i) {
+    if (CBFields[i].empty())
+      continue;
+    DxilCBuffer &CB = DM.GetCBuffer(i);
+    // Libraries create handles from loads of the constant buffer global.
+    if (GlobalVariable *GV = dyn_cast<GlobalVariable>(CB.GetGlobalSymbol())) {
+      for (User *U : GV->users()) {
+        LoadInst *LI = dyn_cast<LoadInst>(U);
+        if (!LI)
+          continue;
+        // Handles are created from a loaded phi or select of buffers too.
+        bUpdated |= SpecializeHandle(LI, CB, CBFields[i]);
+        for (User *LU : LI->users()) {
+          Instruction *CH = dyn_cast<Instruction>(LU);
+          if (CH &&
+              OP::IsDxilOpFuncCallInst(CH, DXIL::OpCode::CreateHandleForLib))
+            bUpdated |= SpecializeHandle(CH, CB, CBFields[i]);
+        }
+      }
+    }
+    // Shaders create them from the range id.
+    for (auto &It : DM.GetOP()->GetOpFuncList(DXIL::OpCode::CreateHandle)) {
+      Function *CreateHandle = It.second;
+      if (!CreateHandle)
+        continue;
+      for (User *U : CreateHandle->users()) {
+        DxilInst_CreateHandle CH(cast<Instruction>(U));
+        ConstantInt *RC = dyn_cast<ConstantInt>(CH.get_resourceClass());
+        ConstantInt *RangeId = dyn_cast<ConstantInt>(CH.get_rangeId());
+        if (RC && RangeId &&
+            RC->getZExtValue() == (unsigned)DXIL::ResourceClass::CBuffer &&
+            RangeId->getZExtValue() == CB.GetID())
+          bUpdated |= SpecializeHandle(U, CB, CBFields[i]);
+      }
+    }
+  }
+  return bUpdated;
+}
+
+}
+
+ModulePass *
+llvm::createDxilSpecializeConstantsPass(const std::vector<std::string> &Values) {
+  return new DxilSpecializeConstants(Values);
+}
+
+INITIALIZE_PASS(DxilSpecializeConstants, "dxil-specialize-constants",
+                "DXIL specialize constants", false, false)
@@ -0,0 +1,384 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilUniformityAnalysis.cpp                                                //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Finds the values and branches of DXIL that are uniform across the active  //
+// lanes of a wave, and a pass that makes use of it.                         //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/DXIL/DxilMetadataHelper.h"
+#include "dxc/DXIL/DxilOperations.h"
+#include "dxc/DXIL/DxilInstructions.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+#include <map>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+// Uniformity is computed optimistically: every value starts out uniform and
+// divergence is propagated from its sources until nothing changes.
+// Divergence comes from per-lane inputs such as thread ids and stage inputs,
+// from wave intrinsics that aren't reductions, from memory other lanes may
+// write, from function arguments, and from NonUniformResourceIndex.
+// SV_GroupID, wave reductions and constant buffer loads with uniform operands
+// are uniform.
+// Lanes part ways at a divergent branch until its immediate post-dominator.
+// Phis where those paths meet are divergent, and so are values computed on
+// those paths when used after them, since lanes leave a loop with a
+// divergent exit at different iterations.
+class DxilUniformityAnalyzer : public DxilUniformityAnalysis {
+private:
+  PostDominatorTree *pPDT;
+  std::unordered_set<Value *> DivergentValues;
+  // The divergent branches whose paths run through each block.
+  std::map<BasicBlock *, SmallPtrSet<TerminatorInst *, 4>> BlockRegions;
+  std::unordered_set<BasicBlock *> JoinBlocks;
+  std::vector<Instruction *> WorkList;
+  bool IsInRegion(BasicBlock *BB, TerminatorInst *TI);
+  bool IsDivergentOperand(Value *V, Instruction *User);
+  bool IsWritableHandle(Value *V);
+  bool IsDivergentCall(CallInst *CI);
+  bool IsDivergent(Instruction *I);
+  void Visit(Instruction *I);
+  void MarkDivergentBranch(TerminatorInst *TI);
+public:
+  DxilUniformityAnalyzer(PostDominatorTree &PDT) : pPDT(&PDT) {}
+  void Analyze(Function *F) override;
+  bool IsUniform(Value *V) override;
+};
+
+bool DxilUniformityAnalyzer::IsInRegion(BasicBlock *BB, TerminatorInst *TI) {
+  auto it = BlockRegions.find(BB);
+  return it != BlockRegions.end() && it->second.count(TI);
+}
+
+bool DxilUniformityAnalyzer::IsDivergentOperand(Value *V, Instruction *User) {
+  if (DivergentValues.count(V))
+    return true;
+  Instruction *I = dyn_cast<Instruction>(V);
+  if (!I)
+    return false;
+  auto it = BlockRegions.find(I->getParent());
+  if (it == BlockRegions.end())
+    return false;
+  for (TerminatorInst *TI : it->second) {
+    if (!IsInRegion(User->getParent(), TI))
+      return true;
+  }
+  return false;
+}
+
+bool DxilUniformityAnalyzer::IsWritableHandle(Value *V) {
+  CallInst *CI = dyn_cast<CallInst>(V);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CreateHandle))
+    return true;
+  DxilInst_CreateHandle createHandle(CI);
+  ConstantInt *ResClass = dyn_cast<ConstantInt>(createHandle.get_resourceClass());
+  return !ResClass ||
+         ResClass->getLimitedValue() == (unsigned)DXIL::ResourceClass::UAV;
+}
+
+bool DxilUniformityAnalyzer::IsDivergentCall(CallInst *CI) {
+  if (!OP::IsDxilOpFuncCallInst(CI))
+    return true;
+
+  DXIL::OpCode opcode = OP::GetDxilOpFuncCallInst(CI);
+  switch (opcode) {
+  // The same in every lane by definition.
+  case DXIL::OpCode::GroupId:
+  case DXIL::OpCode::DispatchRaysDimensions:
+  case DXIL::OpCode::WaveGetLaneCount:
+  case DXIL::OpCode::WaveAnyTrue:
+  case DXIL::OpCode::WaveAllTrue:
+  case DXIL::OpCode::WaveActiveAllEqual:
+  case DXIL::OpCode::WaveActiveBallot:
+  case DXIL::OpCode::WaveReadLaneFirst:
+  case DXIL::OpCode::WaveActiveOp:
+  case DXIL::OpCode::WaveActiveBit:
+  case DXIL::OpCode::WaveAllBitCount:
+    return false;
+  case DXIL::OpCode::WaveReadLaneAt:
+    return IsDivergentOperand(
+        CI->getArgOperand(DxilInst_WaveReadLaneAt::arg_lane), CI);
+  // Reads are uniform when no lane may write the resource.
+  case DXIL::OpCode::BufferLoad:
+  case DXIL::OpCode::RawBufferLoad:
+  case DXIL::OpCode::TextureLoad:
+  case DXIL::OpCode::Sample:
+  case DXIL::OpCode::SampleBias:
+  case DXIL::OpCode::SampleCmp:
+  case DXIL::OpCode::SampleCmpLevelZero:
+  case DXIL::OpCode::SampleGrad:
+  case DXIL::OpCode::SampleLevel:
+  case DXIL::OpCode::TextureGather:
+  case DXIL::OpCode::TextureGatherCmp:
+  case DXIL::OpCode::CalculateLOD:
+    if (IsWritableHandle(CI->getArgOperand(1)))
+      return true;
+    break;
+  case DXIL::OpCode::CBufferLoad:
+  case DXIL::OpCode::CBufferLoadLegacy:
+  case DXIL::OpCode::CreateHandle:
+  case DXIL::OpCode::CreateHandleForLib:
+  case DXIL::OpCode::GetDimensions:
+  case DXIL::OpCode::CheckAccessFullyMapped:
+  case DXIL::OpCode::Texture2DMSGetSamplePosition:
+  case DXIL::OpCode::RenderTargetGetSampleCount:
+  case DXIL::OpCode::RenderTargetGetSamplePosition:
+    break;
+  default:
+    switch (OP::GetOpCodeClass(opcode)) {
+    // Pure functions of their operands.
+    case DXIL::OpCodeClass::Unary:
+    case DXIL::OpCodeClass::UnaryBits:
+    case DXIL::OpCodeClass::IsSpecialFloat:
+    case DXIL::OpCodeClass::Binary:
+    case DXIL::OpCodeClass::BinaryWithCarryOrBorrow:
+    case DXIL::OpCodeClass::BinaryWithTwoOuts:
+    case DXIL::OpCodeClass::Tertiary:
+    case DXIL::OpCodeClass::Quaternary:
+    case DXIL::OpCodeClass::Dot2:
+    case DXIL::OpCodeClass::Dot3:
+    case DXIL::OpCodeClass::Dot4:
+    case DXIL::OpCodeClass::Dot2AddHalf:
+    case DXIL::OpCodeClass::Dot4AddPacked:
+    case DXIL::OpCodeClass::MakeDouble:
+    case DXIL::OpCodeClass::SplitDouble:
+    case DXIL::OpCodeClass::LegacyF32ToF16:
+    case DXIL::OpCodeClass::LegacyF16ToF32:
+    case DXIL::OpCodeClass::LegacyDoubleToFloat:
+    case DXIL::OpCodeClass::LegacyDoubleToSInt32:
+    case DXIL::OpCodeClass::LegacyDoubleToUInt32:
+    case DXIL::OpCodeClass::BitcastF16toI16:
+    case DXIL::OpCodeClass::BitcastF32toI32:
+    case DXIL::OpCodeClass::BitcastF64toI64:
+    case DXIL::OpCodeClass::BitcastI16toF16:
+    case DXIL::OpCodeClass::BitcastI32toF32:
+    case DXIL::OpCodeClass::BitcastI64toF64:
+      break;
+    default:
+      return true;
+    }
+  }
+
+  for (Value *Arg : CI->arg_operands()) {
+    if (IsDivergentOperand(Arg, CI))
+      return true;
+  }
+  return false;
+}
+
+bool DxilUniformityAnalyzer::IsDivergent(Instruction *I) {
+  if (DxilMDHelper::IsMarkedNonUniform(I))
+    return true;
+
+  if (PHINode *Phi = dyn_cast<PHINode>(I)) {
+    // Lanes may reach a phi from different paths.
+    if (!Phi->hasConstantValue() &&
+        (JoinBlocks.count(Phi->getParent()) ||
+         BlockRegions.count(Phi->getParent())))
+      return true;
+  } else if (BranchInst *BI = dyn_cast<BranchInst>(I)) {
+    return BI->isConditional() &&
+           IsDivergentOperand(BI->getCondition(), BI);
+  } else if (SwitchInst *SI = dyn_cast<SwitchInst>(I)) {
+    return IsDivergentOperand(SI->getCondition(), SI);
+  } else if (isa<TerminatorInst>(I)) {
+    return false;
+  } else if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    // Only constant memory is known to be the same for every lane.
+    GlobalVariable *GV = dyn_cast<GlobalVariable>(GetUnderlyingObject(
+        LI->getPointerOperand(), I->getModule()->getDataLayout()));
+    if (!GV || !GV->isConstant())
+      return true;
+  } else if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I)) {
+    return true;
+  } else if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    return IsDivergentCall(CI);
+  }
+
+  for (Value *Op : I->operands()) {
+    if (IsDivergentOperand(Op, I))
+      return true;
+  }
+  return false;
+}
+
+void DxilUniformityAnalyzer::Visit(Instruction *I) {
+  if (DivergentValues.count(I))
+    return;
+  if (I->getType()->isVoidTy() && !isa<TerminatorInst>(I))
+    return;
+  if (!IsDivergent(I))
+    return;
+  DivergentValues.insert(I);
+  WorkList.push_back(I);
+}
+
+void DxilUniformityAnalyzer::MarkDivergentBranch(TerminatorInst *TI) {
+  BasicBlock *Join = nullptr;
+  if (DomTreeNode *Node = pPDT->getNode(TI->getParent())) {
+    if (DomTreeNode *IDom = Node->getIDom())
+      Join = IDom->getBlock();
+  }
+  if (Join)
+    JoinBlocks.insert(Join);
+
+  // Collect the blocks on the paths from the branch to its join.
+  std::vector<BasicBlock *> Region;
+  std::vector<BasicBlock *> BBWorkList(succ_begin(TI->getParent()),
+                                       succ_end(TI->getParent()));
+  while (!BBWorkList.empty()) {
+    BasicBlock *BB = BBWorkList.back();
+    BBWorkList.pop_back();
+    if (BB == Join || !BlockRegions[BB].insert(TI).second)
+      continue;
+    Region.push_back(BB);
+    BBWorkList.insert(BBWorkList.end(), succ_begin(BB), succ_end(BB));
+  }
+
+  // Revisit the phis that may now merge different paths, and the uses of
+  // values computed on those paths after them.
+  if (Join) {
+    for (Instruction &I : *Join) {
+      if (!isa<PHINode>(I))
+        break;
+      Visit(&I);
+    }
+  }
+  for (BasicBlock *BB : Region) {
+    for (Instruction &I : *BB) {
+      if (isa<PHINode>(I))
+        Visit(&I);
+      for (User *U : I.users()) {
+        Instruction *UI = cast<Instruction>(U);
+        if (!IsInRegion(UI->getParent(), TI))
+          Visit(UI);
+      }
+    }
+  }
+}
+
+void DxilUniformityAnalyzer::Analyze(Function *F) {
+  for (Argument &Arg : F->args())
+    DivergentValues.insert(&Arg);
+
+  for (BasicBlock &BB : *F) {
+    for (Instruction &I : BB)
+      Visit(&I);
+  }
+
+  while (!WorkList.empty()) {
+    Instruction *I = WorkList.back();
+    WorkList.pop_back();
+    if (TerminatorInst *TI = dyn_cast<TerminatorInst>(I))
+      MarkDivergentBranch(TI);
+    for (User *U : I->users())
+      Visit(cast<Instruction>(U));
+  }
+}
+
+bool DxilUniformityAnalyzer::IsUniform(Value *V) {
+  return DivergentValues.count(V) == 0;
+}
+
+} // namespace
+
+DxilUniformityAnalysis *DxilUniformityAnalysis::create(PostDominatorTree &PDT) {
+  return new DxilUniformityAnalyzer(PDT);
+}
+
+namespace {
+// Drops NonUniformResourceIndex from handles whose index is provably the same
+// in every active lane. With annotate=1, also marks uniform branches and
+// resource handles with dx.uniform metadata for backends to use.
+class DxilUniformity : public FunctionPass {
+  bool m_Annotate = false;
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilUniformity() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL uniformity";
+  }
+
+  void applyOptions(PassOptions O) override {
+    GetPassOptionBool(O, "annotate", &m_Annotate, false);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<PostDominatorTree>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override;
+};
+
+char DxilUniformity::ID = 0;
+
+bool DxilUniformity::runOnFunction(Function &F) {
+  std::unique_ptr<DxilUniformityAnalysis> Uniformity(
+      DxilUniformityAnalysis::create(getAnalysis<PostDominatorTree>()));
+  Uniformity->Analyze(&F);
+
+  bool bUpdated = false;
+  for (BasicBlock &BB : F) {
+    TerminatorInst *TI = BB.getTerminator();
+    if (m_Annotate && TI->getNumSuccessors() > 1 && Uniformity->IsUniform(TI)) {
+      DxilMDHelper::MarkUniform(TI);
+      bUpdated = true;
+    }
+
+    for (Instruction &I : BB) {
+      if (!OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::CreateHandle))
+        continue;
+      DxilInst_CreateHandle createHandle(&I);
+      if (!Uniformity->IsUniform(createHandle.get_index()))
+        continue;
+      ConstantInt *NonUniform =
+          dyn_cast<ConstantInt>(createHandle.get_nonUniformIndex());
+      if (NonUniform && !NonUniform->isZero()) {
+        createHandle.set_nonUniformIndex_val(false);
+        bUpdated = true;
+      }
+      if (m_Annotate) {
+        DxilMDHelper::MarkUniform(&I);
+        bUpdated = true;
+      }
+    }
+  }
+  return bUpdated;
+}
+
+}
+
+FunctionPass *llvm::createDxilUniformityPass() {
+  return new DxilUniformity();
+}
+
+INITIALIZE_PASS_BEGIN(DxilUniformity, "dxil-uniformity",
+                      "DXIL uniformity", false, false)
+INITIALIZE_PASS_DEPENDENCY(PostDominatorTree)
+INITIALIZE_PASS_END(DxilUniformity, "dxil-uniformity",
+                    "DXIL uniformity", false, false)
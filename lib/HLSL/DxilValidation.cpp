@@ -414,6 +414,7 @@ struct ValidationContext {
   const unsigned kDxilControlFlowHintMDKind;
   const unsigned kDxilPreciseMDKind;
   const unsigned kDxilNonUniformMDKind;
+  const unsigned kDxilUniformMDKind;
   const unsigned kLLVMLoopMDKind;
   unsigned m_DxilMajor, m_DxilMinor;
 
@@ -429,6 +430,8 @@ struct ValidationContext {
             DxilMDHelper::kDxilPreciseAttributeMDName)),
         kDxilNonUniformMDKind(llvmModule.getContext().getMDKindID(
             DxilMDHelper::kDxilNonUniformAttributeMDName)),
+        kDxilUniformMDKind(llvmModule.getContext().getMDKindID(
+            DxilMDHelper::kDxilUniformAttributeMDName)),
         kLLVMLoopMDKind(llvmModule.getContext().getMDKindID("llvm.loop")) {
     DxilMod.GetDxilVersion(m_DxilMajor, m_DxilMinor);
 
@@ -3145,6 +3148,27 @@ static void ValidateNonUniformMetadata(Instruction &I, MDNode *pMD,
   }
 }
 
+static void ValidateUniformMetadata(Instruction &I, MDNode *pMD,
+                                    ValidationContext &ValCtx) {
+  // Only branches and resource handles are annotated.
+  bool bIsHandle =
+      OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::CreateHandle) ||
+      OP::IsDxilOpFuncCallInst(&I, DXIL::OpCode::CreateHandleForLib);
+  if (!bIsHandle && !isa<TerminatorInst>(I)) {
+    ValCtx.EmitMetaError(pMD, ValidationRule::MetaWellFormed);
+  }
+  if (pMD->getNumOperands() != 1) {
+    ValCtx.EmitMetaError(pMD, ValidationRule::MetaWellFormed);
+  }
+  uint64_t val;
+  if (!GetNodeOperandAsInt(ValCtx, pMD, 0, &val)) {
+    ValCtx.EmitMetaError(pMD, ValidationRule::MetaWellFormed);
+  }
+  if (val != 1) {
+    ValCtx.EmitMetaError(pMD, ValidationRule::MetaValueRange);
+  }
+}
+
 static void ValidateInstructionMetadata(Instruction *I,
                                         ValidationContext &ValCtx) {
   SmallVector<std::pair<unsigned, MDNode *>, 2> MDNodes;
@@ -3168,6 +3192,8 @@ static void ValidateInstructionMetadata(Instruction *I,
       // noalias for DXIL validator >= 1.2
     } else if (MD.first == ValCtx.kDxilNonUniformMDKind) {
       ValidateNonUniformMetadata(*I, MD.second, ValCtx);
+    } else if (MD.first == ValCtx.kDxilUniformMDKind) {
+      ValidateUniformMetadata(*I, MD.second, ValCtx);
     } else {
       ValCtx.EmitMetaError(MD.second, ValidationRule::MetaUsed);
     }
@@ -5926,6 +5952,7 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
     case DFCC_DXIL:
     case DFCC_ShaderDebugInfoDXIL:
     case DFCC_ShaderDebugName:
+    case DFCC_ShaderCost:
       continue;
 
     case DFCC_ShaderHash:
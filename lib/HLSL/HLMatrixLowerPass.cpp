@@ -22,6 +22,8 @@
 #include "dxc/DXIL/DxilUtil.h"
 #include "HLMatrixSubscriptUseReplacer.h"
 
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/DebugInfo.h"
@@ -120,6 +122,12 @@ void TempOverloadPool::clear() {
 // After lowering MatInst2: MatInst1(VecToMat(VecInst2(MatToVec(MatInst3))))
 // After lowering MatInst1: VecInst1(VecInst2(MatToVec(MatInst3)))
 // After lowering MatInst3: VecInst1(VecInst2(VecInst3))
+//
+// Instructions are lowered in program order, so most operands have already
+// been lowered when their consumer is. Lowered values are remembered and
+// used directly by consumers, and the uses of the original instructions are
+// only replaced once the whole function is lowered, so stubs are only needed
+// for operands that are lowered after their consumers.
 class HLMatrixLowerPass : public ModulePass {
 public:
   static char ID; // Pass identification, replacement for typeid
@@ -139,6 +147,7 @@ private:
   Value *tryGetLoweredPtrOperand(Value *Ptr, IRBuilder<> &Builder, bool DiscardStub = false);
   Value *bitCastValue(Value *SrcVal, Type* DstTy, bool DstTyAlloca, IRBuilder<> &Builder);
   void replaceAllUsesByLoweredValue(Instruction *MatInst, Value *VecVal);
+  void replaceAllUsesByLoweredValues();
   void replaceAllVariableUses(Value* MatPtr, Value* LoweredPtr);
   void replaceAllVariableUses(SmallVectorImpl<Value*> &GEPIdxStack, Value *StackTopPtr, Value* LoweredPtr);
   Value *translateScalarMatMul(Value *scalar, Value *mat, IRBuilder<> &Builder, bool isLhsScalar = true);
@@ -179,6 +188,9 @@ private:
   TempOverloadPool *m_vecToMatStubs = nullptr;
 
   std::vector<Instruction *> m_deadInsts;
+
+  // Lowered values of matrix instructions whose uses haven't been replaced yet.
+  MapVector<Instruction *, Value *> m_loweredValues;
 };
 }
 
@@ -254,6 +266,7 @@ void HLMatrixLowerPass::runOnFunction(Function &Func) {
   for (Instruction *MatInst : MatInsts)
     lowerInstruction(MatInst);
 
+  replaceAllUsesByLoweredValues();
   deleteDeadInsts();
 }
 
@@ -356,6 +369,13 @@ Value* HLMatrixLowerPass::getLoweredByValOperand(Value *Val, IRBuilder<> &Builde
   if (!MatTy) return Val;
 
   Type *LoweredTy = MatTy.getLoweredVectorTypeForReg();
+
+  // Use the lowered value directly if the operand was already lowered.
+  if (Instruction *Inst = dyn_cast<Instruction>(Val)) {
+    auto It = m_loweredValues.find(Inst);
+    if (It != m_loweredValues.end())
+      return It->second;
+  }
   
   // Check if the value is already a vec-to-mat translation stub
   if (CallInst *Call = dyn_cast<CallInst>(Val)) {
@@ -481,6 +501,25 @@ void HLMatrixLowerPass::replaceAllUsesByLoweredValue(Instruction* MatInst, Value
   }
 }
 
+// Replaces the uses of all lowered matrix instructions by their lowered values.
+// Consumers that were lowered using the lowered values directly are dead,
+// whether already marked or lowered themselves, and must not get stubs.
+void HLMatrixLowerPass::replaceAllUsesByLoweredValues() {
+  SmallPtrSet<Instruction *, 32> DeadInsts(m_deadInsts.begin(), m_deadInsts.end());
+  for (auto &It : m_loweredValues) {
+    Instruction *MatInst = It.first;
+    for (auto UseIt = MatInst->use_begin(); UseIt != MatInst->use_end();) {
+      Use &MatUse = *(UseIt++);
+      Instruction *User = dyn_cast<Instruction>(MatUse.getUser());
+      if (User && (DeadInsts.count(User) || m_loweredValues.count(User)))
+        MatUse.set(UndefValue::get(MatInst->getType()));
+    }
+    replaceAllUsesByLoweredValue(MatInst, It.second);
+    addToDeadInsts(MatInst);
+  }
+  m_loweredValues.clear();
+}
+
 // Replaces all uses of a matrix or matrix array alloca or global variable by its lowered equivalent.
 // This doesn't lower the users, but will insert a translation stub from the lowered value pointer
 // back to the matrix value pointer, and recreate any GEPs around the new pointer.
@@ -651,10 +690,8 @@ void HLMatrixLowerPass::lowerInstruction(Instruction* Inst) {
     // lowerCall returns the lowered value iff we should discard
     // the original matrix instruction and replace all of its uses
     // by the lowered value. It returns nullptr to opt-out of this.
-    if (LoweredValue != nullptr) {
-      replaceAllUsesByLoweredValue(Call, LoweredValue);
-      addToDeadInsts(Inst);
-    }
+    if (LoweredValue != nullptr && LoweredValue != Call)
+      m_loweredValues[Call] = LoweredValue;
   }
   else if (ReturnInst *Return = dyn_cast<ReturnInst>(Inst)) {
     lowerReturn(Return);
@@ -921,6 +958,13 @@ Value *HLMatrixLowerPass::lowerHLMulIntrinsic(Value* Lhs, Value *Rhs,
   Function *MadFunc = GetOrCreateHLFunction(*m_pModule, MadFuncTy, HLOpcodeGroup::HLIntrinsic, (unsigned)MadOpcode);
   Constant *MadOpcodeVal = Builder.getInt32((unsigned)MadOpcode);
 
+  // Extract every element once, they are each used by a full row or column.
+  SmallVector<Value*, 16> LhsElems, RhsElems;
+  for (unsigned ElemIdx = 0; ElemIdx < LhsNumRows * LhsNumCols; ++ElemIdx)
+    LhsElems.emplace_back(Builder.CreateExtractElement(LoweredLhs, static_cast<uint64_t>(ElemIdx)));
+  for (unsigned ElemIdx = 0; ElemIdx < RhsNumRows * RhsNumCols; ++ElemIdx)
+    RhsElems.emplace_back(Builder.CreateExtractElement(LoweredRhs, static_cast<uint64_t>(ElemIdx)));
+
   // Perform the multiplication!
   Value *Result = UndefValue::get(VectorType::get(ElemTy, LhsNumRows * RhsNumCols));
   for (unsigned ResultRowIdx = 0; ResultRowIdx < ResultMatTy.getNumRows(); ++ResultRowIdx) {
@@ -931,8 +975,8 @@ Value *HLMatrixLowerPass::lowerHLMulIntrinsic(Value* Lhs, Value *Rhs,
       for (unsigned AccIdx = 0; AccIdx < AccCount; ++AccIdx) {
         unsigned LhsElemIdx = HLMatrixType::getRowMajorIndex(ResultRowIdx, AccIdx, LhsNumRows, LhsNumCols);
         unsigned RhsElemIdx = HLMatrixType::getRowMajorIndex(AccIdx, ResultColIdx, RhsNumRows, RhsNumCols);
-        Value* LhsElem = Builder.CreateExtractElement(LoweredLhs, static_cast<uint64_t>(LhsElemIdx));
-        Value* RhsElem = Builder.CreateExtractElement(LoweredRhs, static_cast<uint64_t>(RhsElemIdx));
+        Value* LhsElem = LhsElems[LhsElemIdx];
+        Value* RhsElem = RhsElems[RhsElemIdx];
         if (ResultElem == nullptr) {
           ResultElem = ElemTy->isFloatingPointTy()
             ? Builder.CreateFMul(LhsElem, RhsElem)
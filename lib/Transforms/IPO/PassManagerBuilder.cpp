@@ -29,6 +29,7 @@
 #include "dxc/HLSL/DxilGenerationPass.h" // HLSL Change
 #include "dxc/HLSL/HLMatrixLowerPass.h" // HLSL Change
 #include "dxc/HLSL/ComputeViewIdState.h" // HLSL Change
+#include <memory> // HLSL Change
 
 using namespace llvm;
 
@@ -306,81 +307,10 @@ static void addHLSLPasses(bool HLSLHighLevel, unsigned OptLevel, hlsl::HLSLExten
 }
 // HLSL Change Ends
 
-void PassManagerBuilder::populateModulePassManager(
+// HLSL Change - the call graph SCC and function passes of the module
+// pipeline. Each function is only changed while it is visited.
+void PassManagerBuilder::addFunctionSimplificationPasses(
     legacy::PassManagerBase &MPM) {
-  // If all optimizations are disabled, just run the always-inline pass and,
-  // if enabled, the function merging pass.
-  if (OptLevel == 0) {
-    if (!HLSLHighLevel) {
-      MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
-    }
-
-    if (Inliner) {
-      MPM.add(Inliner);
-      Inliner = nullptr;
-    }
-
-    // FIXME: The BarrierNoopPass is a HACK! The inliner pass above implicitly
-    // creates a CGSCC pass manager, but we don't want to add extensions into
-    // that pass manager. To prevent this we insert a no-op module pass to reset
-    // the pass manager to get the same behavior as EP_OptimizerLast in non-O0
-    // builds. The function merging pass is 
-    if (MergeFunctions)
-      MPM.add(createMergeFunctionsPass());
-    else if (!Extensions.empty()) // HLSL Change - GlobalExtensions not considered
-      MPM.add(createBarrierNoopPass());
-
-    addExtensionsToPM(EP_EnabledOnOptLevel0, MPM);
-    // HLSL Change Begins.
-    addHLSLPasses(HLSLHighLevel, OptLevel, HLSLExtensionsCodeGen, MPM);
-    if (!HLSLHighLevel) {
-      MPM.add(createDxilConvergentClearPass());
-      MPM.add(createMultiDimArrayToOneDimArrayPass());
-      MPM.add(createDxilLowerCreateHandleForLibPass());
-      MPM.add(createDxilTranslateRawBuffer());
-      MPM.add(createDxilLegalizeSampleOffsetPass());
-      MPM.add(createDxilFinalizeModulePass());
-      MPM.add(createComputeViewIdStatePass());
-      MPM.add(createDxilDeadFunctionEliminationPass());
-      MPM.add(createNoPausePassesPass());
-      MPM.add(createDxilEmitMetadataPass());
-    }
-    // HLSL Change Ends.
-    return;
-  }
-
-  if (!HLSLHighLevel) {
-    MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
-  }
-
-  // HLSL Change Begins
-  MPM.add(createAlwaysInlinerPass(/*InsertLifeTime*/false));
-  if (Inliner) {
-    delete Inliner;
-    Inliner = nullptr;
-  }
-  addHLSLPasses(HLSLHighLevel, OptLevel, HLSLExtensionsCodeGen, MPM); // HLSL Change
-  // HLSL Change Ends
-
-  // Add LibraryInfo if we have some.
-  if (LibraryInfo)
-    MPM.add(new TargetLibraryInfoWrapperPass(*LibraryInfo));
-
-  addInitialAliasAnalysisPasses(MPM);
-
-  if (!DisableUnitAtATime) {
-    addExtensionsToPM(EP_ModuleOptimizerEarly, MPM);
-
-    MPM.add(createIPSCCPPass());              // IP SCCP
-    MPM.add(createGlobalOptimizerPass());     // Optimize out global vars
-
-    MPM.add(createDeadArgEliminationPass());  // Dead argument elimination
-
-    MPM.add(createInstructionCombiningPass());// Clean up after IPCP & DAE
-    addExtensionsToPM(EP_Peephole, MPM);
-    MPM.add(createCFGSimplificationPass());   // Clean up after IPCP & DAE
-  }
-
   // Start of CallGraph SCC passes.
   if (!DisableUnitAtATime)
     MPM.add(createPruneEHPass());             // Remove dead EH info
@@ -487,6 +417,102 @@ void PassManagerBuilder::populateModulePassManager(
 
   if (LoadCombine)
     MPM.add(createLoadCombinePass());
+}
+
+void PassManagerBuilder::populateModulePassManager(
+    legacy::PassManagerBase &MPM) {
+  // If all optimizations are disabled, just run the always-inline pass and,
+  // if enabled, the function merging pass.
+  if (OptLevel == 0) {
+    if (!HLSLHighLevel) {
+      MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
+    }
+
+    if (Inliner) {
+      MPM.add(Inliner);
+      Inliner = nullptr;
+    }
+
+    // FIXME: The BarrierNoopPass is a HACK! The inliner pass above implicitly
+    // creates a CGSCC pass manager, but we don't want to add extensions into
+    // that pass manager. To prevent this we insert a no-op module pass to reset
+    // the pass manager to get the same behavior as EP_OptimizerLast in non-O0
+    // builds. The function merging pass is 
+    if (MergeFunctions)
+      MPM.add(createMergeFunctionsPass());
+    else if (!Extensions.empty()) // HLSL Change - GlobalExtensions not considered
+      MPM.add(createBarrierNoopPass());
+
+    addExtensionsToPM(EP_EnabledOnOptLevel0, MPM);
+    // HLSL Change Begins.
+    addHLSLPasses(HLSLHighLevel, OptLevel, HLSLExtensionsCodeGen, MPM);
+    if (!HLSLHighLevel) {
+      MPM.add(createDxilConvergentClearPass());
+      MPM.add(createMultiDimArrayToOneDimArrayPass());
+      MPM.add(createDxilLowerCreateHandleForLibPass());
+      MPM.add(createDxilTranslateRawBuffer());
+      MPM.add(createDxilLegalizeSampleOffsetPass());
+      MPM.add(createDxilFinalizeModulePass());
+      MPM.add(createComputeViewIdStatePass());
+      MPM.add(createDxilDeadFunctionEliminationPass());
+      MPM.add(createNoPausePassesPass());
+      MPM.add(createDxilEmitMetadataPass());
+    }
+    // HLSL Change Ends.
+    return;
+  }
+
+  if (!HLSLHighLevel) {
+    MPM.add(createHLEnsureMetadataPass()); // HLSL Change - rehydrate metadata from high-level codegen
+  }
+
+  // HLSL Change Begins
+  MPM.add(createAlwaysInlinerPass(/*InsertLifeTime*/false));
+  if (Inliner) {
+    delete Inliner;
+    Inliner = nullptr;
+  }
+  addHLSLPasses(HLSLHighLevel, OptLevel, HLSLExtensionsCodeGen, MPM); // HLSL Change
+  // HLSL Change Ends
+
+  // Add LibraryInfo if we have some.
+  if (LibraryInfo)
+    MPM.add(new TargetLibraryInfoWrapperPass(*LibraryInfo));
+
+  addInitialAliasAnalysisPasses(MPM);
+
+  if (!DisableUnitAtATime) {
+    addExtensionsToPM(EP_ModuleOptimizerEarly, MPM);
+
+    MPM.add(createIPSCCPPass());              // IP SCCP
+    MPM.add(createGlobalOptimizerPass());     // Optimize out global vars
+
+    MPM.add(createDeadArgEliminationPass());  // Dead argument elimination
+
+    MPM.add(createInstructionCombiningPass());// Clean up after IPCP & DAE
+    addExtensionsToPM(EP_Peephole, MPM);
+    MPM.add(createCFGSimplificationPass());   // Clean up after IPCP & DAE
+  }
+
+  // HLSL Change Begins - libraries can run these on several threads, one
+  // group of functions each.
+  if (HLSLLibThreads > 1 && !DisableUnitAtATime) {
+    std::shared_ptr<PassManagerBuilder> Builder =
+        std::make_shared<PassManagerBuilder>(*this);
+    Builder->LibraryInfo =
+        LibraryInfo ? new TargetLibraryInfoImpl(*LibraryInfo) : nullptr;
+    Builder->Inliner = nullptr;
+    MPM.add(createDxilParallelFunctionPassesPass(
+        HLSLLibThreads, [Builder](legacy::PassManagerBase &PM) {
+          if (Builder->LibraryInfo)
+            PM.add(new TargetLibraryInfoWrapperPass(*Builder->LibraryInfo));
+          Builder->addInitialAliasAnalysisPasses(PM);
+          Builder->addFunctionSimplificationPasses(PM);
+        }));
+  } else {
+    addFunctionSimplificationPasses(MPM);
+  }
+  // HLSL Change Ends
 
   MPM.add(createHoistConstantArrayPass()); // HLSL change
 
@@ -614,8 +640,10 @@ void PassManagerBuilder::populateModulePassManager(
 
   // HLSL Change Begins.
   if (!HLSLHighLevel) {
-    if (OptLevel > 0)
+    if (OptLevel > 0) {
       MPM.add(createDxilEraseDeadRegionPass());
+      MPM.add(createDxilCoalesceBufferLoadsPass());
+    }
 
     MPM.add(createDxilConvergentClearPass());
     MPM.add(createDeadCodeEliminationPass()); // DCE needed after clearing convergence
@@ -626,6 +654,12 @@ void PassManagerBuilder::populateModulePassManager(
     MPM.add(createDxilLowerCreateHandleForLibPass());
     MPM.add(createDxilTranslateRawBuffer());
     MPM.add(createDeadCodeEliminationPass());
+    if (OptLevel > 0) {
+      MPM.add(createDxilUniformityPass());
+      MPM.add(createDxilLoopInvariantHoistPass());
+      MPM.add(createDxilGroupSharedLayoutPass());
+      MPM.add(createDxilRematerializePass());
+    }
     // Always try to legalize sample offsets as loop unrolling
     // is not guaranteed for higher opt levels.
     MPM.add(createDxilLegalizeSampleOffsetPass());
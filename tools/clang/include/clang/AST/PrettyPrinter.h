@@ -16,9 +16,11 @@
 
 #include "clang/Basic/LLVM.h"
 #include "clang/Basic/LangOptions.h"
+#include "llvm/ADT/SmallPtrSet.h" // HLSL Change
 
 namespace clang {
 
+class Decl; // HLSL Change
 class LangOptions;
 class SourceManager;
 class Stmt;
@@ -43,7 +45,8 @@ struct PrintingPolicy {
       Bool(LO.Bool), TerseOutput(false), PolishForDeclaration(false),
       Half(LO.HLSL || LO.Half), // HLSL Change - always print 'half' for HLSL
       MSWChar(LO.MicrosoftExt && !LO.WChar),
-      IncludeNewlines(true) { }
+      IncludeNewlines(true),
+      SkippedDecls(nullptr) { } // HLSL Change
 
   /// \brief What language we're printing.
   LangOptions LangOpts;
@@ -164,6 +167,12 @@ struct PrintingPolicy {
 
   /// \brief When true, include newlines after statements like "break", etc.
   unsigned IncludeNewlines : 1;
+
+  // HLSL Change Begin
+  /// \brief Declarations to leave out when printing a declaration context, as
+  /// if they had been removed from it.
+  const llvm::SmallPtrSetImpl<const Decl *> *SkippedDecls;
+  // HLSL Change End
 };
 
 } // end namespace clang
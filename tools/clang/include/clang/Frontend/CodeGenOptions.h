@@ -214,6 +214,8 @@ public:
   hlsl::DXIL::DefaultLinkage DefaultLinkage = hlsl::DXIL::DefaultLinkage::Default;
   /// Assume UAVs/SRVs may alias.
   bool HLSLResMayAlias = false;
+  /// Threads to optimize the functions of a library on. 0 or 1 == serial
+  unsigned HLSLLibThreads = 0;
   // HLSL Change Ends
 
   // SPIRV Change Starts
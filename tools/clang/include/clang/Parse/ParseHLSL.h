@@ -33,6 +33,13 @@ bool ParseHLSLRootSignature(_In_count_(Len) const char *pData, unsigned Len,
                             hlsl::DxilVersionedRootSignatureDesc **ppDesc,
                             clang::SourceLocation Loc,
                             clang::DiagnosticsEngine &Diags);
+// Parses a root signature without a preprocessor or diagnostics engine;
+// the parser error, if any, is written to Errors.
+bool ParseHLSLRootSignature(_In_count_(Len) const char *pData, unsigned Len,
+                            hlsl::DxilRootSignatureVersion Ver,
+                            hlsl::DxilRootSignatureCompilationFlags Flags,
+                            hlsl::DxilVersionedRootSignatureDesc **ppDesc,
+                            llvm::raw_ostream &Errors);
 void ReportHLSLRootSigError(clang::DiagnosticsEngine &Diags,
                             clang::SourceLocation Loc,
                             _In_count_(Len) const char *pData, unsigned Len);
@@ -299,6 +299,11 @@ void DeclPrinter::VisitDeclContext(DeclContext *DC, bool Indent) {
     if (D->isImplicit())
       continue;
 
+    // HLSL Change Begin - skip declarations the caller left out.
+    if (Policy.SkippedDecls && Policy.SkippedDecls->count(*D))
+      continue;
+    // HLSL Change End
+
     // The next bits of code handles stuff like "struct {int x;} a,b"; we're
     // forced to merge the declarations because there's no other way to
     // refer to the struct in question.  This limited merging is safe without
@@ -1677,9 +1677,27 @@ bool clang::ParseHLSLRootSignature(
     const char *pData, unsigned Len, hlsl::DxilRootSignatureVersion Ver,
     hlsl::DxilRootSignatureCompilationFlags Flags, hlsl::DxilVersionedRootSignatureDesc **ppDesc, 
     SourceLocation Loc, clang::DiagnosticsEngine &Diags) {
-  *ppDesc = nullptr;
   std::string OSStr;
   llvm::raw_string_ostream OS(OSStr);
+  if (ParseHLSLRootSignature(pData, Len, Ver, Flags, ppDesc, OS))
+    return true;
+
+  // Create diagnostic error message.
+  OS.flush();
+  if (OSStr.empty()) {
+    Diags.Report(Loc, clang::diag::err_hlsl_rootsig) << "unexpected";
+  }
+  else {
+    Diags.Report(Loc, clang::diag::err_hlsl_rootsig) << OSStr.c_str();
+  }
+  return false;
+}
+
+bool clang::ParseHLSLRootSignature(
+    const char *pData, unsigned Len, hlsl::DxilRootSignatureVersion Ver,
+    hlsl::DxilRootSignatureCompilationFlags Flags,
+    hlsl::DxilVersionedRootSignatureDesc **ppDesc, llvm::raw_ostream &OS) {
+  *ppDesc = nullptr;
   hlsl::RootSignatureTokenizer RST(pData, Len);
   hlsl::RootSignatureParser RSP(&RST, Ver, Flags, OS);
   hlsl::DxilVersionedRootSignatureDesc *D = nullptr;
@@ -1687,17 +1705,7 @@ bool clang::ParseHLSLRootSignature(
     *ppDesc = D;
     return true;
   }
-  else {
-    // Create diagnostic error message.
-    OS.flush();
-    if (OSStr.empty()) {
-      Diags.Report(Loc, clang::diag::err_hlsl_rootsig) << "unexpected";
-    }
-    else {
-      Diags.Report(Loc, clang::diag::err_hlsl_rootsig) << OSStr.c_str();
-    }
-    return false;
-  }
+  return false;
 }
 
 _Use_decl_annotations_
@@ -5,8 +5,8 @@
 // CHECK: groupId
 
 // check intrinsic used.
+// CHECK: cbufferLoadLegacy
 // CHECK: textureLoad
-// CHECK: bufferLoad
 // CHECK: IMin
 // CHECK: IMax
 // CHECK: dot3
@@ -0,0 +1,21 @@
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s
+
+// Linked with -specialize UseFog=0 and -specialize Tint=2 in LinkerTest, the
+// fog branch and every constant buffer read are removed.
+
+// CHECK: @dx.op.cbufferLoadLegacy.i32
+// CHECK: @dx.op.cbufferLoadLegacy.f16
+
+cbuffer Params {
+  uint UseFog;
+  min16float Tint;
+  float4 FogColor;
+};
+
+[shader("pixel")]
+float4 ps_main(float4 c : COLOR) : SV_Target {
+  float4 r = c * Tint;
+  if (UseFog)
+    r = lerp(r, FogColor, c.w);
+  return r;
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -T lib_6_3 %s | FileCheck %s
+
+// Which buffer ps_main reads is only known at run time, so LinkerTest expects
+// linking with -specialize Tint=2 to fail.
+
+// CHECK: @dx.op.createHandleForLib
+
+struct Params {
+  float Tint;
+};
+
+ConstantBuffer<Params> Day;
+ConstantBuffer<Params> Night;
+
+[shader("pixel")]
+float4 ps_main(float4 c : COLOR) : SV_Target {
+  ConstantBuffer<Params> P = c.w > 0.5 ? Day : Night;
+  return c * P.Tint;
+}
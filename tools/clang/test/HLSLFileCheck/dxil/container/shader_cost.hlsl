@@ -0,0 +1,25 @@
+// RUN: %dxc -E main -T cs_6_0 -Qembed_cost %s | FileCheck %s
+
+// CHECK: ; Shader cost estimate:
+// CHECK: ; main (cs)
+// CHECK-NEXT: ;   ALU operations:
+// CHECK-NEXT: ;   Texture operations: 16
+// CHECK-NEXT: ;   Memory operations:
+// CHECK-NEXT: ;   Max live scalars:
+// CHECK-NEXT: ;   Loops:              1 (0 unbounded, max trip count 16)
+// CHECK-NEXT: ;   Groupshared bytes:  256
+
+Texture2D<float4> tex;
+RWStructuredBuffer<float4> output;
+groupshared float4 cache[16];
+
+[numthreads(16, 1, 1)]
+void main(uint tid : SV_GroupIndex) {
+  float4 sum = 0;
+  [loop]
+  for (uint i = 0; i < 16; ++i)
+    sum += tex.Load(int3(i, tid, 0));
+  cache[tid] = sum;
+  GroupMemoryBarrierWithGroupSync();
+  output[tid] = cache[15 - tid];
+}
@@ -1,6 +1,7 @@
 // RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
 
-// CHECK: addrspace(3) global [512 x float]
+// Only dataC[0..7][0..7] is indexed, so it shrinks to 120 matrices.
+// CHECK: addrspace(3) global [480 x float]
 // CHECK: threadId
 // CHECK: groupId
 // CHECK: threadIdInGroup
@@ -0,0 +1,29 @@
+// RUN: %dxc -E main -T vs_6_0 %s | FileCheck %s
+// RUN: %dxc -E main -T vs_6_0 -Od %s | FileCheck %s
+
+// Chains of 4x4 multiplies, transposes and element accesses, as in skinning
+// shaders. Lowered matrix values feed their consumers directly, without
+// translation stubs.
+
+// CHECK: define void @main()
+// CHECK-NOT: hlmatrixlower
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 1
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 2
+// CHECK: call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 3
+// CHECK-NOT: hlmatrixlower
+
+float4x4 World;
+float4x4 View;
+float4x4 Proj;
+float4x4 Bones[4];
+
+float4 main(float4 pos : POSITION, uint4 idx : BLENDINDICES, float4 w : BLENDWEIGHT) : SV_Position {
+  float4x4 skin = Bones[idx.x] * w.x + Bones[idx.y] * w.y
+                + Bones[idx.z] * w.z + Bones[idx.w] * w.w;
+  float4x4 worldViewProj = mul(mul(World, View), Proj);
+  float4x4 m = mul(skin, worldViewProj);
+  m = transpose(transpose(m));
+  m._44 += m[0][0] * m._22;
+  return mul(pos, m);
+}
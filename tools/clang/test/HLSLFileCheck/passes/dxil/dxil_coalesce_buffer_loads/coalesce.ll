@@ -0,0 +1,113 @@
+; RUN: %opt %s -dxil-coalesce-buffer-loads -S | FileCheck %s
+
+; Adjacent raw buffer loads are merged into one load.
+; CHECK-LABEL: @raw
+; CHECK: %[[RAW:.*]] = call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %h, i32 %base, i32 undef, i8 7, i32 4)
+; CHECK-NOT: rawBufferLoad
+; CHECK: extractvalue %dx.types.ResRet.f32 %[[RAW]], 0
+; CHECK: extractvalue %dx.types.ResRet.f32 %[[RAW]], 2
+; CHECK: extractvalue %dx.types.ResRet.f32 %[[RAW]], 1
+; CHECK: ret void
+
+; Structured buffer loads of the same element are merged; loads across a
+; store are not.
+; CHECK-LABEL: @structured
+; CHECK: %[[SB:.*]] = call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32 139, %dx.types.Handle %h, i32 %i, i32 8, i8 15, i32 4)
+; CHECK: extractvalue %dx.types.ResRet.i32 %[[SB]], 0
+; CHECK: extractvalue %dx.types.ResRet.i32 %[[SB]], 2
+; CHECK: call void @dx.op.rawBufferStore.i32
+; CHECK: call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32 139, %dx.types.Handle %h, i32 %i, i32 24, i8 1, i32 4)
+; CHECK: ret void
+
+; Loads whose status is used are left alone.
+; CHECK-LABEL: @status
+; CHECK: rawBufferLoad.f32(i32 139, %dx.types.Handle %h, i32 0, i32 undef, i8 1, i32 4)
+; CHECK: rawBufferLoad.f32(i32 139, %dx.types.Handle %h, i32 4, i32 undef, i8 1, i32 4)
+
+; The same cbuffer row loaded on both sides of a branch is loaded once.
+; CHECK-LABEL: @cbuffer
+; CHECK: entry:
+; CHECK: %[[CB:.*]] = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cb, i32 1)
+; CHECK-NEXT: br i1
+; CHECK-NOT: cbufferLoadLegacy
+; CHECK: extractvalue %dx.types.CBufRet.f32 %[[CB]], 0
+; CHECK: extractvalue %dx.types.CBufRet.f32 %[[CB]], 2
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.ResRet.f32 = type { float, float, float, float, i32 }
+%dx.types.ResRet.i32 = type { i32, i32, i32, i32, i32 }
+%dx.types.CBufRet.f32 = type { float, float, float, float }
+
+define void @raw(%dx.types.Handle %h, i32 %base, float* %out) {
+entry:
+  %a = call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %h, i32 %base, i32 undef, i8 1, i32 4)
+  %a.x = extractvalue %dx.types.ResRet.f32 %a, 0
+  %off8 = add i32 %base, 8
+  %c = call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %h, i32 %off8, i32 undef, i8 1, i32 4)
+  %c.x = extractvalue %dx.types.ResRet.f32 %c, 0
+  %off4 = add i32 %base, 4
+  %b = call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %h, i32 %off4, i32 undef, i8 1, i32 4)
+  %b.x = extractvalue %dx.types.ResRet.f32 %b, 0
+  %ab = fadd float %a.x, %b.x
+  %abc = fadd float %ab, %c.x
+  store float %abc, float* %out
+  ret void
+}
+
+define void @structured(%dx.types.Handle %h, i32 %i) {
+entry:
+  %a = call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32 139, %dx.types.Handle %h, i32 %i, i32 8, i8 3, i32 4)
+  %a.x = extractvalue %dx.types.ResRet.i32 %a, 0
+  %b = call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32 139, %dx.types.Handle %h, i32 %i, i32 16, i8 3, i32 4)
+  %b.x = extractvalue %dx.types.ResRet.i32 %b, 0
+  %s = add i32 %a.x, %b.x
+  call void @dx.op.rawBufferStore.i32(i32 140, %dx.types.Handle %h, i32 %i, i32 20, i32 %s, i32 undef, i32 undef, i32 undef, i8 1, i32 4)
+  %c = call %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32 139, %dx.types.Handle %h, i32 %i, i32 24, i8 1, i32 4)
+  %c.x = extractvalue %dx.types.ResRet.i32 %c, 0
+  call void @dx.op.rawBufferStore.i32(i32 140, %dx.types.Handle %h, i32 %i, i32 0, i32 %c.x, i32 undef, i32 undef, i32 undef, i8 1, i32 4)
+  ret void
+}
+
+define void @status(%dx.types.Handle %h, float* %out, i32* %outStatus) {
+entry:
+  %a = call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %h, i32 0, i32 undef, i8 1, i32 4)
+  %a.x = extractvalue %dx.types.ResRet.f32 %a, 0
+  %a.s = extractvalue %dx.types.ResRet.f32 %a, 4
+  %b = call %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32 139, %dx.types.Handle %h, i32 4, i32 undef, i8 1, i32 4)
+  %b.x = extractvalue %dx.types.ResRet.f32 %b, 0
+  %ab = fadd float %a.x, %b.x
+  store float %ab, float* %out
+  store i32 %a.s, i32* %outStatus
+  ret void
+}
+
+define float @cbuffer(%dx.types.Handle %cb, i1 %cond) {
+entry:
+  br i1 %cond, label %then, label %else
+
+then:
+  %r0 = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cb, i32 1)
+  %x = extractvalue %dx.types.CBufRet.f32 %r0, 0
+  br label %exit
+
+else:
+  %r1 = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cb, i32 1)
+  %z = extractvalue %dx.types.CBufRet.f32 %r1, 2
+  br label %exit
+
+exit:
+  %v = phi float [ %x, %then ], [ %z, %else ]
+  ret float %v
+}
+
+declare %dx.types.ResRet.f32 @dx.op.rawBufferLoad.f32(i32, %dx.types.Handle, i32, i32, i8, i32) #0
+declare %dx.types.ResRet.i32 @dx.op.rawBufferLoad.i32(i32, %dx.types.Handle, i32, i32, i8, i32) #0
+declare void @dx.op.rawBufferStore.i32(i32, %dx.types.Handle, i32, i32, i32, i32, i32, i32, i8, i32) #1
+declare %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32, %dx.types.Handle, i32) #2
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind }
+attributes #2 = { nounwind readnone }
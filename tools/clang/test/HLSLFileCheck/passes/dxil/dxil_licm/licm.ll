@@ -0,0 +1,102 @@
+; RUN: %opt %s -dxil-licm -S | FileCheck %s
+
+; The sample in the loop header and the constant buffer load read resources
+; the loop can't write, so they move out of the loop even though it stores to
+; a UAV. The UAV load stays. So do the sample and sampleLevel under the branch,
+; which don't run on every iteration.
+; CHECK-LABEL: entry:
+; CHECK: %s = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60,
+; CHECK-NEXT: %s.x = extractvalue %dx.types.ResRet.f32 %s, 0
+; CHECK-NEXT: %row = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cb, i32 1)
+; CHECK-NEXT: %scale = extractvalue %dx.types.CBufRet.f32 %row, 0
+; CHECK-NOT: @dx.op.sampleLevel
+; CHECK: br label %loop
+
+; CHECK-LABEL: loop:
+; CHECK-NOT: @dx.op.sample
+; CHECK: %l = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68,
+; CHECK-LABEL: then:
+; CHECK-NEXT: %g = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60,
+; CHECK: %sl = call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62,
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.i32 = type { i32, i32, i32, i32 }
+%dx.types.CBufRet.f32 = type { float, float, float, float }
+%dx.types.ResRet.f32 = type { float, float, float, float, i32 }
+
+define void @main() {
+entry:
+  %tex = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 0, i1 false)
+  %uav = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)
+  %cb = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %smp = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 3, i32 0, i32 0, i1 false)
+  %u = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 0, i32 undef)
+  %v = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 1, i32 undef)
+  %count = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cb, i32 0)
+  %n = extractvalue %dx.types.CBufRet.i32 %count, 0
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  %acc = phi float [ 0.000000e+00, %entry ], [ %acc.next, %latch ]
+  %s = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60, %dx.types.Handle %tex, %dx.types.Handle %smp, float %u, float %v, float undef, float undef, i32 0, i32 0, i32 undef, float undef)
+  %s.x = extractvalue %dx.types.ResRet.f32 %s, 0
+  %row = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cb, i32 1)
+  %scale = extractvalue %dx.types.CBufRet.f32 %row, 0
+  %l = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %uav, i32 0, i32 undef)
+  %l.x = extractvalue %dx.types.ResRet.f32 %l, 0
+  %cond = fcmp fast ogt float %u, 5.000000e-01
+  br i1 %cond, label %then, label %latch
+
+then:
+  %g = call %dx.types.ResRet.f32 @dx.op.sample.f32(i32 60, %dx.types.Handle %tex, %dx.types.Handle %smp, float %v, float %u, float undef, float undef, i32 0, i32 0, i32 undef, float undef)
+  %g.x = extractvalue %dx.types.ResRet.f32 %g, 0
+  %sl = call %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32 62, %dx.types.Handle %tex, %dx.types.Handle %smp, float %v, float %u, float undef, float undef, i32 0, i32 0, i32 undef, float 0.000000e+00)
+  %sl.x = extractvalue %dx.types.ResRet.f32 %sl, 0
+  %t = fadd fast float %g.x, %sl.x
+  br label %latch
+
+latch:
+  %p = phi float [ %t, %then ], [ 0.000000e+00, %loop ]
+  %a1 = fadd fast float %acc, %s.x
+  %a2 = fmul fast float %a1, %scale
+  %a3 = fadd fast float %a2, %l.x
+  %acc.next = fadd fast float %a3, %p
+  call void @dx.op.bufferStore.f32(i32 69, %dx.types.Handle %uav, i32 %i, i32 undef, float %acc.next, float undef, float undef, float undef, i8 1)
+  %i.next = add i32 %i, 1
+  %done = icmp uge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float %acc.next)
+  ret void
+}
+
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #0
+declare float @dx.op.loadInput.f32(i32, i32, i32, i8, i32) #1
+declare %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32, %dx.types.Handle, i32) #0
+declare %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32, %dx.types.Handle, i32) #0
+declare %dx.types.ResRet.f32 @dx.op.sample.f32(i32, %dx.types.Handle, %dx.types.Handle, float, float, float, float, i32, i32, i32, float) #0
+declare %dx.types.ResRet.f32 @dx.op.sampleLevel.f32(i32, %dx.types.Handle, %dx.types.Handle, float, float, float, float, i32, i32, i32, float) #0
+declare %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32, %dx.types.Handle, i32, i32) #0
+declare void @dx.op.bufferStore.f32(i32, %dx.types.Handle, i32, i32, float, float, float, float, i8) #2
+declare void @dx.op.storeOutput.f32(i32, i32, i32, i8, float) #2
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind readnone }
+attributes #2 = { nounwind }
+
+!llvm.ident = !{!0}
+!dx.version = !{!1}
+!dx.valver = !{!2}
+!dx.shaderModel = !{!3}
+!dx.entryPoints = !{!4}
+
+!0 = !{!"clang version 3.7 (tags/RELEASE_370/final)"}
+!1 = !{i32 1, i32 0}
+!2 = !{i32 1, i32 4}
+!3 = !{!"ps", i32 6, i32 0}
+!4 = !{void ()* @main, !"main", null, null, null}
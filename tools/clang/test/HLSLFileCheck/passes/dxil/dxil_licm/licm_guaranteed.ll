@@ -0,0 +1,74 @@
+; RUN: %opt %s -dxil-licm -S | FileCheck %s
+
+; The loop doesn't write memory, but the UAV load still stays: other threads
+; may write the buffer, and globallycoherent reads must see those writes. The
+; SRV load after the early exit doesn't run on the iteration that breaks out,
+; so it stays too. The SRV load in the header runs before every exit and
+; moves out.
+; CHECK-LABEL: entry:
+; CHECK: %h = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %srv, i32 0, i32 undef)
+; CHECK-NOT: @dx.op.bufferLoad
+; CHECK: br label %loop
+
+; CHECK-LABEL: loop:
+; CHECK: %l = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %uav, i32 0, i32 undef)
+; CHECK-LABEL: body:
+; CHECK-NEXT: %b = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %srv, i32 1, i32 undef)
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.ResRet.f32 = type { float, float, float, float, i32 }
+
+define void @main() {
+entry:
+  %srv = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 0, i1 false)
+  %uav = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)
+  %n = call i32 @dx.op.loadInput.i32(i32 4, i32 0, i32 0, i8 0, i32 undef)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %body ]
+  %acc = phi float [ 0.000000e+00, %entry ], [ %acc.next, %body ]
+  %h = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %srv, i32 0, i32 undef)
+  %h.x = extractvalue %dx.types.ResRet.f32 %h, 0
+  %l = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %uav, i32 0, i32 undef)
+  %l.x = extractvalue %dx.types.ResRet.f32 %l, 0
+  %stop = fcmp fast ogt float %l.x, %h.x
+  br i1 %stop, label %exit, label %body
+
+body:
+  %b = call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68, %dx.types.Handle %srv, i32 1, i32 undef)
+  %b.x = extractvalue %dx.types.ResRet.f32 %b, 0
+  %acc.next = fadd fast float %acc, %b.x
+  %i.next = add i32 %i, 1
+  %done = icmp uge i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi float [ %acc, %loop ], [ %acc.next, %body ]
+  call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float %r)
+  ret void
+}
+
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #0
+declare i32 @dx.op.loadInput.i32(i32, i32, i32, i8, i32) #1
+declare %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32, %dx.types.Handle, i32, i32) #0
+declare void @dx.op.storeOutput.f32(i32, i32, i32, i8, float) #2
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind readnone }
+attributes #2 = { nounwind }
+
+!llvm.ident = !{!0}
+!dx.version = !{!1}
+!dx.valver = !{!2}
+!dx.shaderModel = !{!3}
+!dx.entryPoints = !{!4}
+
+!0 = !{!"clang version 3.7 (tags/RELEASE_370/final)"}
+!1 = !{i32 1, i32 0}
+!2 = !{i32 1, i32 4}
+!3 = !{!"ps", i32 6, i32 0}
+!4 = !{void ()* @main, !"main", null, null, null}
@@ -0,0 +1,45 @@
+; RUN: %opt %s -dxil-remat,pressure-threshold=4 -pass-remarks=dxil-remat -pass-remarks-missed=dxil-remat -S 2>&1 | FileCheck %s
+
+; %scaled is live while all four inputs are, so it is recomputed from the
+; constant buffer right before its use.
+; CHECK: remark: {{.*}}register pressure 5 -> 4 (threshold 4)
+; CHECK-LABEL: @main
+; CHECK: %cd = fadd fast float %c, %d
+; CHECK-NEXT: %sum = fadd fast float %ab, %cd
+; CHECK-NEXT: %row{{[0-9]*}} = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cb, i32 0)
+; CHECK-NEXT: %x{{[0-9]*}} = extractvalue %dx.types.CBufRet.f32 %row{{[0-9]*}}, 0
+; CHECK-NEXT: %scaled{{[0-9]*}} = fmul fast float %x{{[0-9]*}}, 2.000000e+00
+; CHECK-NEXT: %r = fadd fast float %sum, %scaled{{[0-9]*}}
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.f32 = type { float, float, float, float }
+
+define void @main() {
+entry:
+  %cb = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %row = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cb, i32 0)
+  %x = extractvalue %dx.types.CBufRet.f32 %row, 0
+  %scaled = fmul fast float %x, 2.000000e+00
+  %a = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 0, i32 undef)
+  %b = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 1, i32 undef)
+  %c = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 2, i32 undef)
+  %d = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 3, i32 undef)
+  %ab = fadd fast float %a, %b
+  %cd = fadd fast float %c, %d
+  %sum = fadd fast float %ab, %cd
+  %r = fadd fast float %sum, %scaled
+  call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float %r)
+  ret void
+}
+
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #0
+declare %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32, %dx.types.Handle, i32) #0
+declare float @dx.op.loadInput.f32(i32, i32, i32, i8, i32) #1
+declare void @dx.op.storeOutput.f32(i32, i32, i32, i8, float) #2
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind readnone }
+attributes #2 = { nounwind }
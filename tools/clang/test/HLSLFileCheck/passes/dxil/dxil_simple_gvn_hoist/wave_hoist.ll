@@ -0,0 +1,77 @@
+; RUN: %opt %s -dxil-gvn-hoist -S | FileCheck %s
+
+; Both sides of a uniform branch run with the same lanes as the branch, so
+; the same wave operation on each side is hoisted above it.
+; CHECK-LABEL: @uniform_branch
+; CHECK: call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1)
+; CHECK-NEXT: br i1 %cond
+; CHECK-NOT: waveActiveOp
+; CHECK: ret void
+
+; Each side of a divergent branch runs with a different set of lanes.
+; CHECK-LABEL: @divergent_branch
+; CHECK: br i1 %cond
+; CHECK: call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1)
+; CHECK: call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1)
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.i32 = type { i32, i32, i32, i32 }
+
+define void @uniform_branch(i32* %out) {
+entry:
+  %cb = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %row = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cb, i32 0)
+  %count = extractvalue %dx.types.CBufRet.i32 %row, 0
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)
+  %cond = icmp ugt i32 %count, 4
+  br i1 %cond, label %then, label %else
+
+then:
+  %s0 = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1)
+  %a = add i32 %s0, 1
+  br label %exit
+
+else:
+  %s1 = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1)
+  %b = add i32 %s1, 2
+  br label %exit
+
+exit:
+  %r = phi i32 [ %a, %then ], [ %b, %else ]
+  store i32 %r, i32* %out
+  ret void
+}
+
+define void @divergent_branch(i32* %out) {
+entry:
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)
+  %cond = icmp ugt i32 %tid, 4
+  br i1 %cond, label %then, label %else
+
+then:
+  %s0 = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1)
+  %a = add i32 %s0, 1
+  br label %exit
+
+else:
+  %s1 = call i32 @dx.op.waveActiveOp.i32(i32 119, i32 %tid, i8 0, i8 1)
+  %b = add i32 %s1, 2
+  br label %exit
+
+exit:
+  %r = phi i32 [ %a, %then ], [ %b, %else ]
+  store i32 %r, i32* %out
+  ret void
+}
+
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #0
+declare %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32, %dx.types.Handle, i32) #0
+declare i32 @dx.op.threadId.i32(i32, i32) #1
+declare i32 @dx.op.waveActiveOp.i32(i32, i32, i8, i8) #2
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind readnone }
+attributes #2 = { nounwind }
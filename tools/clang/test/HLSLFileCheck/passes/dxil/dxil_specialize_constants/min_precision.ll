@@ -0,0 +1,84 @@
+; RUN: %opt %s -dxil-specialize-constants,values=Scale=2 -S | FileCheck %s
+
+; Min precision fields are 4 bytes apart, so Scale is read from element 1 of
+; the row, while Bias in element 0 and Offset in element 2 are left alone.
+; CHECK: %bias = extractvalue %dx.types.CBufRet.f16 %row0, 0
+; CHECK-NEXT: %offset = extractvalue %dx.types.CBufRet.f16 %row0, 2
+; CHECK-NEXT: %sx = fmul fast half %x, 0xH4000
+
+;min16float Bias;
+;min16float Scale;
+;min16float Offset;
+;min16float main(min16float x : A) : SV_Target {
+;  return x * Scale + Offset + Bias;
+;}
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f:64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.f16 = type { half, half, half, half }
+%"$Globals" = type { half, half, half }
+
+define void @main() {
+entry:
+  %cb = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)  ; CreateHandle(resourceClass,rangeId,index,nonUniformIndex)
+  %x = call half @dx.op.loadInput.f16(i32 4, i32 0, i32 0, i8 0, i32 undef)  ; LoadInput(inputSigId,rowIndex,colIndex,gsSampleIndex)
+  %row0 = call %dx.types.CBufRet.f16 @dx.op.cbufferLoadLegacy.f16(i32 59, %dx.types.Handle %cb, i32 0)  ; CBufferLoadLegacy(handle,regIndex)
+  %bias = extractvalue %dx.types.CBufRet.f16 %row0, 0
+  %scale = extractvalue %dx.types.CBufRet.f16 %row0, 1
+  %offset = extractvalue %dx.types.CBufRet.f16 %row0, 2
+  %sx = fmul fast half %x, %scale
+  %sum = fadd fast half %sx, %offset
+  %r = fadd fast half %sum, %bias
+  call void @dx.op.storeOutput.f16(i32 5, i32 0, i32 0, i8 0, half %r)  ; StoreOutput(outputSigId,rowIndex,colIndex,value)
+  ret void
+}
+
+; Function Attrs: nounwind readnone
+declare half @dx.op.loadInput.f16(i32, i32, i32, i8, i32) #2
+
+; Function Attrs: nounwind
+declare void @dx.op.storeOutput.f16(i32, i32, i32, i8, half) #0
+
+; Function Attrs: nounwind readonly
+declare %dx.types.CBufRet.f16 @dx.op.cbufferLoadLegacy.f16(i32, %dx.types.Handle, i32) #1
+
+; Function Attrs: nounwind readonly
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #1
+
+attributes #0 = { nounwind }
+attributes #1 = { nounwind readonly }
+attributes #2 = { nounwind readnone }
+
+!llvm.ident = !{!0}
+!dx.version = !{!1}
+!dx.valver = !{!2}
+!dx.shaderModel = !{!3}
+!dx.resources = !{!4}
+!dx.typeAnnotations = !{!7, !11}
+!dx.entryPoints = !{!15}
+
+!0 = !{!"clang version 3.7 (tags/RELEASE_370/final)"}
+!1 = !{i32 1, i32 0}
+!2 = !{i32 1, i32 4}
+!3 = !{!"ps", i32 6, i32 0}
+!4 = !{null, null, !5, null}
+!5 = !{!6}
+!6 = !{i32 0, %"$Globals"* undef, !"$Globals", i32 0, i32 0, i32 1, i32 12, null}
+!7 = !{i32 0, %"$Globals" undef, !8}
+!8 = !{i32 12, !9, !10, !22}
+!9 = !{i32 6, !"Bias", i32 3, i32 0, i32 7, i32 8}
+!10 = !{i32 6, !"Scale", i32 3, i32 4, i32 7, i32 8}
+!11 = !{i32 1, void ()* @main, !12}
+!12 = !{!13}
+!13 = !{i32 0, !14, !14}
+!14 = !{}
+!15 = !{void ()* @main, !"main", !16, !4, null}
+!16 = !{!17, !19, null}
+!17 = !{!18}
+!18 = !{i32 0, !"A", i8 8, i8 0, !20, i8 2, i32 1, i8 1, i32 0, i8 0, null}
+!19 = !{!21}
+!20 = !{i32 0}
+!21 = !{i32 0, !"SV_Target", i8 8, i8 16, !20, i8 0, i32 1, i8 1, i32 0, i8 0, null}
+!22 = !{i32 6, !"Offset", i32 3, i32 8, i32 7, i32 8}
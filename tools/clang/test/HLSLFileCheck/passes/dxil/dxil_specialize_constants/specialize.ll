@@ -0,0 +1,99 @@
+; RUN: %opt %s -dxil-specialize-constants,values=UseFog=0 -dxil-specialize-constants,values=Tint=0.5 -S | FileCheck %s
+
+; Reads of UseFog and Tint are replaced; Bias is left alone.
+; CHECK: %row0 = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cb, i32 0)
+; CHECK-NEXT: %bias = extractvalue %dx.types.CBufRet.i32 %row0, 2
+; CHECK-NEXT: %fog = icmp ne i32 0, 0
+; CHECK: %tinted = fmul fast float %x, 5.000000e-01
+
+;uint UseFog;
+;float Tint;
+;uint Bias;
+;float main(float x : A) : SV_Target {
+;  float r = x * Tint;
+;  if (UseFog) r += Bias;
+;  return r;
+;}
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f:64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.i32 = type { i32, i32, i32, i32 }
+%dx.types.CBufRet.f32 = type { float, float, float, float }
+%"$Globals" = type { i32, float, i32 }
+
+define void @main() {
+entry:
+  %cb = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)  ; CreateHandle(resourceClass,rangeId,index,nonUniformIndex)
+  %x = call float @dx.op.loadInput.f32(i32 4, i32 0, i32 0, i8 0, i32 undef)  ; LoadInput(inputSigId,rowIndex,colIndex,gsSampleIndex)
+  %row0 = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cb, i32 0)  ; CBufferLoadLegacy(handle,regIndex)
+  %usefog = extractvalue %dx.types.CBufRet.i32 %row0, 0
+  %bias = extractvalue %dx.types.CBufRet.i32 %row0, 2
+  %fog = icmp ne i32 %usefog, 0
+  %row0f = call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59, %dx.types.Handle %cb, i32 0)  ; CBufferLoadLegacy(handle,regIndex)
+  %tint = extractvalue %dx.types.CBufRet.f32 %row0f, 1
+  %tinted = fmul fast float %x, %tint
+  br i1 %fog, label %then, label %exit
+
+then:
+  %biasf = uitofp i32 %bias to float
+  %fogged = fadd fast float %tinted, %biasf
+  br label %exit
+
+exit:
+  %r = phi float [ %tinted, %entry ], [ %fogged, %then ]
+  call void @dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float %r)  ; StoreOutput(outputSigId,rowIndex,colIndex,value)
+  ret void
+}
+
+; Function Attrs: nounwind readnone
+declare float @dx.op.loadInput.f32(i32, i32, i32, i8, i32) #2
+
+; Function Attrs: nounwind
+declare void @dx.op.storeOutput.f32(i32, i32, i32, i8, float) #0
+
+; Function Attrs: nounwind readonly
+declare %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32, %dx.types.Handle, i32) #1
+
+; Function Attrs: nounwind readonly
+declare %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32, %dx.types.Handle, i32) #1
+
+; Function Attrs: nounwind readonly
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #1
+
+attributes #0 = { nounwind }
+attributes #1 = { nounwind readonly }
+attributes #2 = { nounwind readnone }
+
+!llvm.ident = !{!0}
+!dx.version = !{!1}
+!dx.valver = !{!2}
+!dx.shaderModel = !{!3}
+!dx.resources = !{!4}
+!dx.typeAnnotations = !{!7, !12}
+!dx.entryPoints = !{!16}
+
+!0 = !{!"clang version 3.7 (tags/RELEASE_370/final)"}
+!1 = !{i32 1, i32 0}
+!2 = !{i32 1, i32 4}
+!3 = !{!"ps", i32 6, i32 0}
+!4 = !{null, null, !5, null}
+!5 = !{!6}
+!6 = !{i32 0, %"$Globals"* undef, !"$Globals", i32 0, i32 0, i32 1, i32 12, null}
+!7 = !{i32 0, %"$Globals" undef, !8}
+!8 = !{i32 12, !9, !10, !11}
+!9 = !{i32 6, !"UseFog", i32 3, i32 0, i32 7, i32 5}
+!10 = !{i32 6, !"Tint", i32 3, i32 4, i32 7, i32 9}
+!11 = !{i32 6, !"Bias", i32 3, i32 8, i32 7, i32 5}
+!12 = !{i32 1, void ()* @main, !13}
+!13 = !{!14}
+!14 = !{i32 0, !15, !15}
+!15 = !{}
+!16 = !{void ()* @main, !"main", !17, !4, null}
+!17 = !{!18, !21, null}
+!18 = !{!19}
+!19 = !{i32 0, !"A", i8 9, i8 0, !20, i8 2, i32 1, i8 1, i32 0, i8 0, null}
+!20 = !{i32 0}
+!21 = !{!22}
+!22 = !{i32 0, !"SV_Target", i8 9, i8 16, !20, i8 0, i32 1, i8 1, i32 0, i8 0, null}
@@ -0,0 +1,74 @@
+; RUN: %opt %s -dxil-tgsm-layout,banks=32 -pass-remarks=dxil-tgsm-layout -S 2>&1 | FileCheck %s
+
+; a is only indexed by SV_GroupThreadID.x, so it shrinks to numthreads.x.
+; b and c are accessed on different sides of a barrier, so they share storage.
+; d is read with a stride of 32 elements, so it gets one padding element per
+; row.
+; CHECK: remark: {{.*}}groupshared memory 5632 -> 4732 bytes
+; CHECK-DAG: @"\01?a@@3PAMA" = addrspace(3) global [64 x float] undef, align 4
+; CHECK-DAG: @"\01?b@@3PAHA.shared" = addrspace(3) global [64 x i32] undef, align 4
+; CHECK-DAG: @"\01?d@@3PAMA" = addrspace(3) global [1055 x float] undef, align 4
+; CHECK-NOT: @"\01?c@@3PAHA"
+
+; CHECK-LABEL: @main
+; CHECK: %row = shl i32 %tid, 5
+; CHECK-NEXT: [[PAD:%[0-9]+]] = lshr i32 %row, 5
+; CHECK-NEXT: [[IDX:%[0-9]+]] = add i32 %row, [[PAD]]
+; CHECK-NEXT: %pd = getelementptr [1055 x float], [1055 x float] addrspace(3)* @"\01?d@@3PAMA", i32 0, i32 [[IDX]]
+; CHECK: %pc = getelementptr [64 x i32], [64 x i32] addrspace(3)* @"\01?b@@3PAHA.shared", i32 0, i32 %tid
+; CHECK: load i32, i32 addrspace(3)* getelementptr ([64 x i32], [64 x i32] addrspace(3)* @"\01?b@@3PAHA.shared", i32 0, i32 1)
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+@"\01?a@@3PAMA" = addrspace(3) global [256 x float] undef, align 4
+@"\01?b@@3PAHA" = addrspace(3) global [64 x i32] undef, align 4
+@"\01?c@@3PAHA" = addrspace(3) global [64 x i32] undef, align 4
+@"\01?d@@3PAMA" = addrspace(3) global [1024 x float] undef, align 4
+
+define void @main() {
+entry:
+  %tid = call i32 @dx.op.threadIdInGroup.i32(i32 95, i32 0)
+  %pa = getelementptr [256 x float], [256 x float] addrspace(3)* @"\01?a@@3PAMA", i32 0, i32 %tid
+  store float 1.000000e+00, float addrspace(3)* %pa, align 4
+  %pb = getelementptr [64 x i32], [64 x i32] addrspace(3)* @"\01?b@@3PAHA", i32 0, i32 %tid
+  store i32 %tid, i32 addrspace(3)* %pb, align 4
+  %row = shl i32 %tid, 5
+  %pd = getelementptr [1024 x float], [1024 x float] addrspace(3)* @"\01?d@@3PAMA", i32 0, i32 %row
+  store float 2.000000e+00, float addrspace(3)* %pd, align 4
+  call void @dx.op.barrier(i32 80, i32 9)
+  %other = xor i32 %tid, 1
+  %pb2 = getelementptr [64 x i32], [64 x i32] addrspace(3)* @"\01?b@@3PAHA", i32 0, i32 %other
+  %vb = load i32, i32 addrspace(3)* %pb2, align 4
+  call void @dx.op.barrier(i32 80, i32 9)
+  %pc = getelementptr [64 x i32], [64 x i32] addrspace(3)* @"\01?c@@3PAHA", i32 0, i32 %tid
+  store i32 %vb, i32 addrspace(3)* %pc, align 4
+  %vc = load i32, i32 addrspace(3)* getelementptr ([64 x i32], [64 x i32] addrspace(3)* @"\01?c@@3PAHA", i32 0, i32 1), align 4
+  %pd2 = getelementptr [1024 x float], [1024 x float] addrspace(3)* @"\01?d@@3PAMA", i32 0, i32 %tid
+  %vd = load float, float addrspace(3)* %pd2, align 4
+  %vcf = uitofp i32 %vc to float
+  %sum = fadd fast float %vd, %vcf
+  %pa2 = getelementptr [256 x float], [256 x float] addrspace(3)* @"\01?a@@3PAMA", i32 0, i32 %other
+  store float %sum, float addrspace(3)* %pa2, align 4
+  ret void
+}
+
+declare i32 @dx.op.threadIdInGroup.i32(i32, i32) #0
+declare void @dx.op.barrier(i32, i32) #1
+
+attributes #0 = { nounwind readnone }
+attributes #1 = { nounwind noduplicate }
+
+!llvm.ident = !{!0}
+!dx.version = !{!1}
+!dx.valver = !{!2}
+!dx.shaderModel = !{!3}
+!dx.entryPoints = !{!4}
+
+!0 = !{!"clang version 3.7 (tags/RELEASE_370/final)"}
+!1 = !{i32 1, i32 0}
+!2 = !{i32 1, i32 4}
+!3 = !{!"cs", i32 6, i32 0}
+!4 = !{void ()* @main, !"main", null, null, !5}
+!5 = !{i32 4, !6}
+!6 = !{i32 64, i32 1, i32 1}
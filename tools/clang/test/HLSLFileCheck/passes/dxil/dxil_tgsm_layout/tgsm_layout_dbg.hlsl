@@ -0,0 +1,22 @@
+// RUN: %dxc -E main -T cs_6_0 -Zi %s | FileCheck %s
+
+// b and c share storage, and each keeps its own debug variable on it.
+// CHECK: @"\01?b@@3PAHA.shared" = addrspace(3) global [64 x i32]
+// CHECK-NOT: @"\01?c@@3PAHA" =
+// CHECK-DAG: !DIGlobalVariable(name: "b", {{.*}}variable: [64 x i32] addrspace(3)* @"\01?b@@3PAHA.shared")
+// CHECK-DAG: !DIGlobalVariable(name: "c", {{.*}}variable: [64 x i32] addrspace(3)* @"\01?b@@3PAHA.shared")
+
+RWBuffer<int> Out : register(u0);
+groupshared int b[64];
+groupshared int c[64];
+
+[numthreads(64, 1, 1)]
+void main(uint tid : SV_GroupThreadID) {
+  b[tid] = tid;
+  GroupMemoryBarrierWithGroupSync();
+  Out[tid] = b[tid ^ 1];
+  GroupMemoryBarrierWithGroupSync();
+  c[tid] = tid * 2;
+  GroupMemoryBarrierWithGroupSync();
+  Out[tid + 64] = c[tid ^ 1];
+}
@@ -0,0 +1,19 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+// RUN: %dxc -E main -T ps_6_0 -Od %s | FileCheck %s -check-prefix=OD
+
+// An index read from a constant buffer is the same in every lane, so it drops
+// NonUniformResourceIndex. One read from an input keeps it.
+// CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %{{[0-9]+}}, i1 false)
+// CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %{{[0-9]+}}, i1 true)
+
+// The pass only runs when optimizing.
+// OD: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %{{[0-9]+}}, i1 true)
+// OD: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %{{[0-9]+}}, i1 true)
+
+Texture2D<float4> t[8] : register(t0);
+cbuffer CB : register(b0) { uint i; };
+
+float4 main(uint id : ID) : SV_Target {
+  return t[NonUniformResourceIndex(i)].Load(0) +
+         t[NonUniformResourceIndex(id)].Load(0);
+}
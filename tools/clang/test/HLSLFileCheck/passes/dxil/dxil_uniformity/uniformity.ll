@@ -0,0 +1,85 @@
+; RUN: %opt %s -dxil-uniformity,annotate=1 -S | FileCheck %s
+
+; Handles indexed by values that are the same in every lane drop
+; NonUniformResourceIndex and are marked uniform.
+; CHECK-LABEL: @handles
+; CHECK: @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false), !dx.uniform
+; CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %idx, i1 false), !dx.uniform
+; CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %gid, i1 false), !dx.uniform
+; CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %tid, i1 true){{$}}
+; CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %first, i1 false), !dx.uniform
+; CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %tex.x, i1 false), !dx.uniform
+; CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %buf.x, i1 true){{$}}
+
+; Lanes leave a loop with a divergent exit at different iterations, so values
+; from the loop differ after it.
+; CHECK-LABEL: @branches
+; CHECK: br i1 %c0, label %loop, label %exit, !dx.uniform
+; CHECK: br i1 %c1, label %loop, label %after{{$}}
+; CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %inc, i1 true){{$}}
+; CHECK: @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %count, i1 false), !dx.uniform
+
+target datalayout = "e-m:e-p:32:32-i1:32-i8:32-i16:32-i32:32-i64:64-f16:32-f32:32-f64:64-n8:16:32:64"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%dx.types.CBufRet.i32 = type { i32, i32, i32, i32 }
+%dx.types.ResRet.i32 = type { i32, i32, i32, i32, i32 }
+
+define void @handles() {
+entry:
+  %cb = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %row = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cb, i32 0)
+  %idx = extractvalue %dx.types.CBufRet.i32 %row, 0
+  %gid = call i32 @dx.op.groupId.i32(i32 94, i32 0)
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)
+  %first = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %tid)
+  %h0 = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %idx, i1 true)
+  %h1 = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %gid, i1 true)
+  %h2 = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %tid, i1 true)
+  %h3 = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %first, i1 true)
+  %srv = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 1, i32 0, i1 false)
+  %tex = call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68, %dx.types.Handle %srv, i32 %idx, i32 undef)
+  %tex.x = extractvalue %dx.types.ResRet.i32 %tex, 0
+  %h4 = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %tex.x, i1 true)
+  %uav = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)
+  %buf = call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68, %dx.types.Handle %uav, i32 %idx, i32 undef)
+  %buf.x = extractvalue %dx.types.ResRet.i32 %buf, 0
+  %h5 = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %buf.x, i1 true)
+  ret void
+}
+
+define void @branches() {
+entry:
+  %cb = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 2, i32 0, i32 0, i1 false)
+  %row = call %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32 59, %dx.types.Handle %cb, i32 0)
+  %count = extractvalue %dx.types.CBufRet.i32 %row, 0
+  %tid = call i32 @dx.op.threadId.i32(i32 93, i32 0)
+  %c0 = icmp ugt i32 %count, 4
+  br i1 %c0, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %inc, %loop ]
+  %inc = add i32 %i, 1
+  %c1 = icmp ult i32 %inc, %tid
+  br i1 %c1, label %loop, label %after
+
+after:
+  %h0 = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %inc, i1 true)
+  %h1 = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 0, i32 0, i32 %count, i1 true)
+  br label %exit
+
+exit:
+  ret void
+}
+
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #0
+declare %dx.types.CBufRet.i32 @dx.op.cbufferLoadLegacy.i32(i32, %dx.types.Handle, i32) #0
+declare %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32, %dx.types.Handle, i32, i32) #0
+declare i32 @dx.op.groupId.i32(i32, i32) #1
+declare i32 @dx.op.threadId.i32(i32, i32) #1
+declare i32 @dx.op.waveReadLaneFirst.i32(i32, i32) #2
+
+attributes #0 = { nounwind readonly }
+attributes #1 = { nounwind readnone }
+attributes #2 = { nounwind }
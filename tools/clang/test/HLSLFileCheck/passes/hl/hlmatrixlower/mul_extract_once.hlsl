@@ -0,0 +1,24 @@
+// RUN: %dxc -E main -T vs_6_0 -fcgl %s | %opt -hlmatrixlower -S | FileCheck %s
+
+// Matrix lowering of mul extracts each element of both operands once, and
+// builds every element of the product from those extracts, instead of
+// extracting operand elements again for each product term.
+
+// CHECK: extractelement <4 x float> [[LHS:%[^,]+]], i64 0
+// CHECK-NEXT: extractelement <4 x float> [[LHS]], i64 1
+// CHECK-NEXT: extractelement <4 x float> [[LHS]], i64 2
+// CHECK-NEXT: extractelement <4 x float> [[LHS]], i64 3
+// CHECK-NEXT: extractelement <4 x float> [[RHS:%[^,]+]], i64 0
+// CHECK-NEXT: extractelement <4 x float> [[RHS]], i64 1
+// CHECK-NEXT: extractelement <4 x float> [[RHS]], i64 2
+// CHECK-NEXT: extractelement <4 x float> [[RHS]], i64 3
+// CHECK-NOT: extractelement
+// CHECK: insertelement <4 x float> %{{.*}}, float %{{.*}}, i64 3
+
+float2x2 A;
+float2x2 B;
+
+float main() : OUT {
+  float2x2 m = mul(A, B);
+  return m._11 + m._12 + m._21 + m._22;
+}
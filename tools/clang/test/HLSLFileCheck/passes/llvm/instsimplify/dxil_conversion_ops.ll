@@ -0,0 +1,125 @@
+; RUN: %opt %s -hlsl-dxilload -instsimplify -S | FileCheck %s
+
+target datalayout = "e-m:e-p:32:32-i64:64-f80:32-n8:16:32-a:0:32-S32"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%struct.RWByteAddressBuffer = type { i32 }
+%dx.types.splitdouble = type { i32, i32 }
+
+define void @main() {
+entry:
+  %buf_UAV_rawbuf = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)  ; CreateHandle(resourceClass,rangeId,index,nonUniformIndex)
+
+  ; isNaN(NaN)
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 1,
+  %nan = call i1 @dx.op.isSpecialFloat.f32(i32 8, float 0x7FF8000000000000)
+  %nan.i = zext i1 %nan to i32
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 0, i32 undef, i32 %nan.i, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; isFinite(+INF)
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 0,
+  %fin = call i1 @dx.op.isSpecialFloat.f32(i32 10, float 0x7FF0000000000000)
+  %fin.i = zext i1 %fin to i32
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 4, i32 undef, i32 %fin.i, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; isNormal of the smallest denormal
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 0,
+  %norm = call i1 @dx.op.isSpecialFloat.f32(i32 11, float 0x36A0000000000000)
+  %norm.i = zext i1 %norm to i32
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 8, i32 undef, i32 %norm.i, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; splitdouble(1.0) = {lo, hi}
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 0,
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 1072693248,
+  %split = call %dx.types.splitdouble @dx.op.splitDouble.f64(i32 102, double 1.000000e+00)
+  %split.lo = extractvalue %dx.types.splitdouble %split, 0
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 12, i32 undef, i32 %split.lo, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  %split.hi = extractvalue %dx.types.splitdouble %split, 1
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 16, i32 undef, i32 %split.hi, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; asdouble(0, 0xc0090000) = -3.125, truncated to -3
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 -3,
+  %make = call double @dx.op.makeDouble.f64(i32 101, i32 0, i32 -1072103424)
+  %dtoi = call i32 @dx.op.legacyDoubleToSInt32(i32 133, double %make)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 20, i32 undef, i32 %dtoi, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; Out of range for uint, so left to the hardware.
+  ; CHECK: call i32 @dx.op.legacyDoubleToUInt32(i32 134, double -1.000000e+00)
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 %dtou,
+  %dtou = call i32 @dx.op.legacyDoubleToUInt32(i32 134, double -1.000000e+00)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 24, i32 undef, i32 %dtou, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; f32tof16(1.5) = 0x3e00
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 15872,
+  %f16 = call i32 @dx.op.legacyF32ToF16(i32 130, float 1.500000e+00)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 28, i32 undef, i32 %f16, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; 0.1 has no exact half, so the rounding is left to the hardware.
+  ; CHECK: call i32 @dx.op.legacyF32ToF16(i32 130, float 0x3FB99999A0000000)
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 %f16.inexact,
+  %f16.inexact = call i32 @dx.op.legacyF32ToF16(i32 130, float 0x3FB99999A0000000)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 32, i32 undef, i32 %f16.inexact, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; asuint(f16tof32(0x4500)) = asuint(5.0)
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 1084227584,
+  %f32 = call float @dx.op.legacyF16ToF32(i32 131, i32 17664)
+  %f32.i = call i32 @dx.op.bitcastF32toI32(i32 127, float %f32)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 36, i32 undef, i32 %f32.i, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  call void @dx.op.storeOutput.i32(i32 5, i32 0, i32 0, i8 0, i32 0)  ; StoreOutput(outputSigId,rowIndex,colIndex,value)
+  ret void
+}
+
+; Function Attrs: nounwind
+declare void @dx.op.storeOutput.i32(i32, i32, i32, i8, i32) #1
+
+; Function Attrs: nounwind
+declare void @dx.op.bufferStore.i32(i32, %dx.types.Handle, i32, i32, i32, i32, i32, i32, i8) #1
+
+; Function Attrs: nounwind readonly
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #2
+
+declare i1 @dx.op.isSpecialFloat.f32(i32, float) #0
+declare %dx.types.splitdouble @dx.op.splitDouble.f64(i32, double) #0
+declare double @dx.op.makeDouble.f64(i32, i32, i32) #0
+declare i32 @dx.op.legacyDoubleToSInt32(i32, double) #0
+declare i32 @dx.op.legacyDoubleToUInt32(i32, double) #0
+declare i32 @dx.op.legacyF32ToF16(i32, float) #0
+declare float @dx.op.legacyF16ToF32(i32, i32) #0
+declare i32 @dx.op.bitcastF32toI32(i32, float) #0
+
+attributes #0 = { nounwind readnone }
+attributes #1 = { nounwind }
+attributes #2 = { nounwind readonly }
+
+!llvm.ident = !{!0}
+!dx.valver = !{!1}
+!dx.version = !{!1}
+!dx.shaderModel = !{!2}
+!dx.resources = !{!3}
+!dx.typeAnnotations = !{!6, !9}
+!dx.entryPoints = !{!13}
+
+!0 = !{!"clang version 3.7 (tags/RELEASE_370/final)"}
+!1 = !{i32 1, i32 0}
+!2 = !{!"ps", i32 6, i32 4}
+!3 = !{null, !4, null, null}
+!4 = !{!5}
+!5 = !{i32 0, %struct.RWByteAddressBuffer* undef, !"buf", i32 0, i32 0, i32 1, i32 11, i1 false, i1 false, i1 false, null}
+!6 = !{i32 0, %struct.RWByteAddressBuffer undef, !7}
+!7 = !{i32 4, !8}
+!8 = !{i32 6, !"h", i32 3, i32 0, i32 7, i32 4}
+!9 = !{i32 1, void ()* @main, !10}
+!10 = !{!11}
+!11 = !{i32 0, !12, !12}
+!12 = !{}
+!13 = !{void ()* @main, !"main", !14, !3, !20}
+!14 = !{!15, !18, null}
+!15 = !{!16}
+!16 = !{i32 0, !"A", i8 4, i8 0, !17, i8 1, i32 1, i8 1, i32 0, i8 0, null}
+!17 = !{i32 0}
+!18 = !{!19}
+!19 = !{i32 0, !"SV_Target", i8 4, i8 16, !17, i8 0, i32 1, i8 1, i32 0, i8 0, null}
+!20 = !{i32 0, i64 16}
\ No newline at end of file
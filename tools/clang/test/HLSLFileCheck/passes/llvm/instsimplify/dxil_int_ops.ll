@@ -0,0 +1,142 @@
+; RUN: %opt %s -hlsl-dxilload -instsimplify -S | FileCheck %s
+
+target datalayout = "e-m:e-p:32:32-i64:64-f80:32-n8:16:32-a:0:32-S32"
+target triple = "dxil-ms-dx"
+
+%dx.types.Handle = type { i8* }
+%struct.RWByteAddressBuffer = type { i32 }
+%dx.types.twoi32 = type { i32, i32 }
+%dx.types.i32c = type { i32, i1 }
+
+define void @main() {
+entry:
+  %buf_UAV_rawbuf = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 0, i32 0, i1 false)  ; CreateHandle(resourceClass,rangeId,index,nonUniformIndex)
+
+  ; imul(-3, 5) = {hi, lo} of the signed product
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 -1,
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 -15,
+  %imul = call %dx.types.twoi32 @dx.op.binaryWithTwoOuts(i32 41, i32 -3, i32 5)
+  %imul.hi = extractvalue %dx.types.twoi32 %imul, 0
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 0, i32 undef, i32 %imul.hi, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  %imul.lo = extractvalue %dx.types.twoi32 %imul, 1
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 4, i32 undef, i32 %imul.lo, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; umul(0x80000000, 4) = {hi, lo} of the unsigned product
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 2,
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 0,
+  %umul = call %dx.types.twoi32 @dx.op.binaryWithTwoOuts(i32 42, i32 -2147483648, i32 4)
+  %umul.hi = extractvalue %dx.types.twoi32 %umul, 0
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 8, i32 undef, i32 %umul.hi, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  %umul.lo = extractvalue %dx.types.twoi32 %umul, 1
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 12, i32 undef, i32 %umul.lo, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; udiv(17, 5) = {quotient, remainder}
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 3,
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 2,
+  %udiv = call %dx.types.twoi32 @dx.op.binaryWithTwoOuts(i32 43, i32 17, i32 5)
+  %udiv.q = extractvalue %dx.types.twoi32 %udiv, 0
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 16, i32 undef, i32 %udiv.q, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  %udiv.r = extractvalue %dx.types.twoi32 %udiv, 1
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 20, i32 undef, i32 %udiv.r, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; Dividing by zero returns all ones.
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 -1,
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 -1,
+  %udiv0 = call %dx.types.twoi32 @dx.op.binaryWithTwoOuts(i32 43, i32 7, i32 0)
+  %udiv0.q = extractvalue %dx.types.twoi32 %udiv0, 0
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 24, i32 undef, i32 %udiv0.q, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  %udiv0.r = extractvalue %dx.types.twoi32 %udiv0, 1
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 28, i32 undef, i32 %udiv0.r, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; uaddc(0xffffffff, 2) = {1, carry}
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 1,
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 1,
+  %uaddc = call %dx.types.i32c @dx.op.binaryWithCarryOrBorrow.i32(i32 44, i32 -1, i32 2)
+  %uaddc.v = extractvalue %dx.types.i32c %uaddc, 0
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 32, i32 undef, i32 %uaddc.v, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  %uaddc.c = extractvalue %dx.types.i32c %uaddc, 1
+  %uaddc.ci = zext i1 %uaddc.c to i32
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 36, i32 undef, i32 %uaddc.ci, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; usubb(1, 2) = {0xffffffff, borrow}
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 -1,
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 1,
+  %usubb = call %dx.types.i32c @dx.op.binaryWithCarryOrBorrow.i32(i32 45, i32 1, i32 2)
+  %usubb.v = extractvalue %dx.types.i32c %usubb, 0
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 40, i32 undef, i32 %usubb.v, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  %usubb.b = extractvalue %dx.types.i32c %usubb, 1
+  %usubb.bi = zext i1 %usubb.b to i32
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 44, i32 undef, i32 %usubb.bi, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; msad(0x00ff0010, 0x10200030, 5) skips the zero bytes of the reference.
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 260,
+  %msad = call i32 @dx.op.tertiary.i32(i32 50, i32 16711696, i32 270532656, i32 5)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 48, i32 undef, i32 %msad, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; dot4add_i8packed(10, 0x01ff02fe, 0x03020180)
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 269,
+  %dot4i = call i32 @dx.op.dot4AddPacked.i32(i32 163, i32 10, i32 33489662, i32 50463104)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 52, i32 undef, i32 %dot4i, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  ; dot4add_u8packed(10, 0x01ff02fe, 0x03020180)
+  ; CHECK: @dx.op.bufferStore{{.*}}, i32 33037,
+  %dot4u = call i32 @dx.op.dot4AddPacked.i32(i32 164, i32 10, i32 33489662, i32 50463104)
+  call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %buf_UAV_rawbuf, i32 56, i32 undef, i32 %dot4u, i32 undef, i32 undef, i32 undef, i8 1)  ; BufferStore(uav,coord0,coord1,value0,value1,value2,value3,mask)
+
+  call void @dx.op.storeOutput.i32(i32 5, i32 0, i32 0, i8 0, i32 0)  ; StoreOutput(outputSigId,rowIndex,colIndex,value)
+  ret void
+}
+
+; Function Attrs: nounwind
+declare void @dx.op.storeOutput.i32(i32, i32, i32, i8, i32) #1
+
+; Function Attrs: nounwind
+declare void @dx.op.bufferStore.i32(i32, %dx.types.Handle, i32, i32, i32, i32, i32, i32, i8) #1
+
+; Function Attrs: nounwind readonly
+declare %dx.types.Handle @dx.op.createHandle(i32, i8, i32, i32, i1) #2
+
+declare %dx.types.twoi32 @dx.op.binaryWithTwoOuts(i32, i32, i32) #0
+declare %dx.types.i32c @dx.op.binaryWithCarryOrBorrow.i32(i32, i32, i32) #0
+declare i32 @dx.op.tertiary.i32(i32, i32, i32, i32) #0
+declare i32 @dx.op.dot4AddPacked.i32(i32, i32, i32, i32) #0
+
+attributes #0 = { nounwind readnone }
+attributes #1 = { nounwind }
+attributes #2 = { nounwind readonly }
+
+!llvm.ident = !{!0}
+!dx.valver = !{!1}
+!dx.version = !{!1}
+!dx.shaderModel = !{!2}
+!dx.resources = !{!3}
+!dx.typeAnnotations = !{!6, !9}
+!dx.entryPoints = !{!13}
+
+!0 = !{!"clang version 3.7 (tags/RELEASE_370/final)"}
+!1 = !{i32 1, i32 0}
+!2 = !{!"ps", i32 6, i32 4}
+!3 = !{null, !4, null, null}
+!4 = !{!5}
+!5 = !{i32 0, %struct.RWByteAddressBuffer* undef, !"buf", i32 0, i32 0, i32 1, i32 11, i1 false, i1 false, i1 false, null}
+!6 = !{i32 0, %struct.RWByteAddressBuffer undef, !7}
+!7 = !{i32 4, !8}
+!8 = !{i32 6, !"h", i32 3, i32 0, i32 7, i32 4}
+!9 = !{i32 1, void ()* @main, !10}
+!10 = !{!11}
+!11 = !{i32 0, !12, !12}
+!12 = !{}
+!13 = !{void ()* @main, !"main", !14, !3, !20}
+!14 = !{!15, !18, null}
+!15 = !{!16}
+!16 = !{i32 0, !"A", i8 4, i8 0, !17, i8 1, i32 1, i8 1, i32 0, i8 0, null}
+!17 = !{i32 0}
+!18 = !{!19}
+!19 = !{i32 0, !"SV_Target", i8 4, i8 16, !17, i8 0, i32 1, i8 1, i32 0, i8 0, null}
+!20 = !{i32 0, i64 16}
\ No newline at end of file
@@ -0,0 +1,35 @@
+// RUN: %dxc -ECSMain -Tcs_6_0 %s | %opt -S -hlsl-dxil-pix-shader-access-instrumentation,config=S0:1:1i1;U0:2:10i0;.,aggregate=1 | %FileCheck %s
+
+// Check we added the UAV:
+// CHECK:  %PIX_CountUAV_Handle = call %dx.types.Handle @dx.op.createHandle(i32 57, i8 1, i32 1, i32 0, i1 false)
+
+// The loop-invariant read of inBuffer is hoisted out of the loop and recorded once,
+// by the first lane of the wave:
+// CHECK: %IsFirstLane = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_CountUAV_Handle, i32 12,
+// CHECK-NOT: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_CountUAV_Handle, i32 12,
+
+// The dynamically indexed write is recorded by each lane with a slot that differs
+// from the first lane's:
+// CHECK: slotIndex = mul i32
+// CHECK: %IsFirstLane{{[0-9]*}} = call i1 @dx.op.waveIsFirstLane(i32 110)
+// CHECK: %FirstLaneByteIndex = call i32 @dx.op.waveReadLaneFirst.i32(i32 118, i32 %OffsetByteIndex
+// CHECK: %DiffersFromFirstLane = icmp ne i32 %OffsetByteIndex{{[0-9]*}}, %FirstLaneByteIndex
+// CHECK: %ShouldWriteAccess = or i1 %IsFirstLane{{[0-9]*}}, %DiffersFromFirstLane
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_CountUAV_Handle
+
+ByteAddressBuffer inBuffer : register(t0);
+RWByteAddressBuffer bufferArray[] : register(u0);
+
+[numthreads(1, 1, 1)]
+void CSMain(uint3 tid : SV_DispatchThreadID)
+{
+  uint sum = 0;
+  [loop]
+  for (uint i = 0; i < tid.x; ++i) {
+    sum += inBuffer.Load(i * 4);
+  }
+
+  // Dynamically indexed write
+  bufferArray[sum].Store(0, 1);
+}
@@ -0,0 +1,34 @@
+// RUN: %dxc -Emain -Tps_6_0 %s | %opt -S -dxil-annotate-with-virtual-regs -hlsl-dxil-debug-instrumentation,minimal=1 | %FileCheck %s
+
+// Check that minimal instrumentation only records values that can't be
+// recomputed offline, and the entry to blocks reached through a branch.
+
+// The cbuffer value comes from outside the shader, so it is recorded:
+// CHECK: %[[CB:.*]] = extractvalue %dx.types.CBufRet.i32
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{.*}}, i32 undef, i32 64771,
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{.*}}, i32 undef, i32 %[[CB]],
+
+// The comparison is recomputed from it, so it isn't:
+// CHECK: icmp sgt i32 %[[CB]], 10
+// CHECK-NEXT: br i1
+
+// Both branch targets record a void step on entry:
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{.*}}, i32 undef, i32 64257,
+// CHECK: call void @dx.op.bufferStore.i32(i32 69, %dx.types.Handle %PIX_DebugUAV_Handle, i32 %{{.*}}, i32 undef, i32 64257,
+
+int i32;
+
+float4 main() : SV_Target
+{
+  float4 ret = { 0, 0, 0, 1 };
+  [branch]
+  if (i32 > 10)
+  {
+    ret.r = (float)(i32 * 3);
+  }
+  else
+  {
+    ret.g = (float)(i32 + 7);
+  }
+  return ret;
+}
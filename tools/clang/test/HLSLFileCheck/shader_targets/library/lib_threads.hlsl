@@ -0,0 +1,25 @@
+// RUN: %dxc -T lib_6_3 -lib-threads 2 %s | FileCheck %s
+
+// Functions optimized on separate threads are put back into one library, with
+// shared resources declared once and the helper inlined into both shaders.
+// CHECK: @"\01?Out@@3V?$RWStructuredBuffer@M@@A" = external constant
+// CHECK-NOT: @"\01?Out@@3V?$RWStructuredBuffer@M@@A.{{[0-9]+}}"
+// CHECK: define void @"\01?RayGen1@@YAXXZ"()
+// CHECK: float 2.000000e+00
+// CHECK: define void @"\01?RayGen2@@YAXXZ"()
+// CHECK: float 4.000000e+00
+// CHECK-NOT: define float @"\01?helper@@YAMM@Z"
+
+RWStructuredBuffer<float> Out;
+
+float helper(float f) { return f * 2.0; }
+
+[shader("raygeneration")]
+void RayGen1() {
+  Out[DispatchRaysIndex().x] = helper(1.0);
+}
+
+[shader("raygeneration")]
+void RayGen2() {
+  Out[DispatchRaysIndex().y] = helper(2.0);
+}
@@ -0,0 +1,31 @@
+// RUN: %dxilver 1.5 | %dxc -T lib_6_3 %s | FileCheck %s -check-prefix=VAL
+// RUN: %dxc -T lib_6_x %s | FileCheck %s -check-prefix=NOVAL
+
+// Identical root signatures share their RDAT raw bytes when the module won't
+// be validated; validators up to 1.5 expect a copy for each subobject.
+// VAL: ; Runtime Data (RDAT) parts:
+// VAL: ; RawBytes {{ +}}96
+// NOVAL: ; Runtime Data (RDAT) parts:
+// NOVAL: ; RawBytes {{ +}}48
+
+// VAL: ; LocalRootSignature lrs1 = { <48 bytes> };
+// VAL: ; LocalRootSignature lrs2 = { <48 bytes> };
+// NOVAL: ; LocalRootSignature lrs1 = { <48 bytes> };
+// NOVAL: ; LocalRootSignature lrs2 = { <48 bytes> };
+
+LocalRootSignature lrs1 = {"CBV(b0), RootFlags(LOCAL_ROOT_SIGNATURE)"};
+LocalRootSignature lrs2 = {"CBV(b0), RootFlags(LOCAL_ROOT_SIGNATURE)"};
+SubobjectToExportsAssociation sea1 = { "lrs1", "RayGen1" };
+SubobjectToExportsAssociation sea2 = { "lrs2", "RayGen2" };
+
+RWByteAddressBuffer Output : register(u0);
+
+[shader("raygeneration")]
+void RayGen1() {
+  Output.Store(0, 1);
+}
+
+[shader("raygeneration")]
+void RayGen2() {
+  Output.Store(4, 2);
+}
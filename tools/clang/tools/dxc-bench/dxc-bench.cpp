@@ -0,0 +1,584 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxc-bench.cpp                                                             //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides the entry point for the dxc-bench console program, which         //
+// measures compiler throughput over a corpus of shaders.                    //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/WinIncludes.h"
+
+#include "dxc/dxcapi.h"
+#include "dxc/Support/dxcapi.use.h"
+#include "dxc/Support/HLSLOptions.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace llvm;
+using namespace dxc;
+using namespace hlsl::options;
+
+static cl::opt<bool> Help("h", cl::desc("Alias for -help"), cl::Hidden);
+
+static cl::list<std::string>
+    Inputs(cl::Positional, cl::desc("<input .hlsl files or directories>"));
+
+static cl::opt<std::string>
+    Corpus("corpus", cl::desc("File listing the inputs, one per line, "
+                              "relative to the file"),
+           cl::value_desc("filename"));
+
+static cl::opt<unsigned> Iterations("n", cl::desc("Compiles per input"),
+                                    cl::init(5));
+
+static cl::opt<std::string>
+    TargetProfile("T", cl::desc("Target profile for inputs without a %dxc "
+                                "RUN line"),
+                  cl::value_desc("profile"), cl::init("ps_6_0"));
+
+static cl::opt<std::string>
+    LinkProfile("link-T", cl::desc("Also link library inputs to this target "
+                                   "profile"),
+                cl::value_desc("profile"));
+
+static cl::opt<std::string> LinkEntry("link-E",
+                                      cl::desc("Entry function to link"),
+                                      cl::value_desc("entryfunction"),
+                                      cl::init("main"));
+
+static cl::opt<std::string> OutputFilename("o",
+                                           cl::desc("Override output filename"),
+                                           cl::value_desc("filename"),
+                                           cl::init("-"));
+
+namespace {
+
+#ifdef _WIN32
+// Tracks the bytes the compiler has allocated through it, so the peak for a
+// compile can be reported. Each allocation is prefixed with its size.
+class PeakTrackingMalloc : public IMalloc {
+  static const size_t HeaderSize = 16;
+  ULONG m_RefCount = 0; // Not used for lifetime.
+  size_t m_Size = 0;
+  size_t m_PeakSize = 0;
+
+  static size_t &AllocSize(void *pv) {
+    return *(size_t *)((char *)pv - HeaderSize);
+  }
+
+public:
+  void ResetPeak() { m_PeakSize = m_Size; }
+  size_t GetPeak() const { return m_PeakSize; }
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid,
+                                           void **ppvObject) override {
+    if (ppvObject == nullptr)
+      return E_POINTER;
+    if (IsEqualIID(iid, __uuidof(IUnknown)) ||
+        IsEqualIID(iid, __uuidof(IMalloc))) {
+      *ppvObject = static_cast<IMalloc *>(this);
+      AddRef();
+      return S_OK;
+    }
+    return E_NOINTERFACE;
+  }
+  ULONG STDMETHODCALLTYPE AddRef() override { return ++m_RefCount; }
+  ULONG STDMETHODCALLTYPE Release() override { return --m_RefCount; }
+
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) override {
+    char *p = (char *)malloc(cb + HeaderSize);
+    if (p == nullptr)
+      return nullptr;
+    p += HeaderSize;
+    AllocSize(p) = cb;
+    m_Size += cb;
+    m_PeakSize = std::max(m_PeakSize, m_Size);
+    return p;
+  }
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) override {
+    if (pv == nullptr)
+      return Alloc(cb);
+    if (cb == 0) {
+      Free(pv);
+      return nullptr;
+    }
+    size_t oldSize = AllocSize(pv);
+    char *p = (char *)realloc((char *)pv - HeaderSize, cb + HeaderSize);
+    if (p == nullptr)
+      return nullptr;
+    p += HeaderSize;
+    AllocSize(p) = cb;
+    m_Size = m_Size - oldSize + cb;
+    m_PeakSize = std::max(m_PeakSize, m_Size);
+    return p;
+  }
+  void STDMETHODCALLTYPE Free(void *pv) override {
+    if (pv == nullptr)
+      return;
+    m_Size -= AllocSize(pv);
+    free((char *)pv - HeaderSize);
+  }
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) override {
+    return pv ? AllocSize(pv) : (SIZE_T)-1;
+  }
+  int STDMETHODCALLTYPE DidAlloc(void *pv) override { return -1; }
+  void STDMETHODCALLTYPE HeapMinimize() override {}
+};
+#endif
+
+struct BenchResult {
+  std::string Status = "ok";
+  std::string Error;
+  std::vector<double> TotalMs;
+  std::vector<double> PreprocessMs;
+  std::vector<double> CompileMs;
+  std::vector<double> ValidateMs;
+  std::vector<double> LinkMs;
+  uint64_t PeakMemory = 0;
+};
+
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+double Median(std::vector<double> values) {
+  if (values.empty())
+    return 0;
+  std::sort(values.begin(), values.end());
+  size_t mid = values.size() / 2;
+  if (values.size() % 2)
+    return values[mid];
+  return (values[mid - 1] + values[mid]) / 2;
+}
+
+void WriteJsonString(raw_ostream &OS, StringRef str) {
+  OS << '"';
+  for (char c : str) {
+    switch (c) {
+    case '"': OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\r': OS << "\\r"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if ((unsigned char)c < 0x20)
+        OS << format("\\u%04x", (unsigned)(unsigned char)c);
+      else
+        OS << c;
+    }
+  }
+  OS << '"';
+}
+
+// Returns the arguments of the first %dxc RUN line in text, without the
+// input file, or an empty string if there isn't one.
+std::string GetDxcRunArgs(StringRef text) {
+  while (!text.empty()) {
+    std::pair<StringRef, StringRef> split = text.split('\n');
+    text = split.second;
+    StringRef line = split.first;
+    size_t run = line.find("RUN:");
+    if (run == StringRef::npos)
+      continue;
+    line = line.substr(run + 4).ltrim();
+    if (!line.startswith("%dxc "))
+      continue;
+    line = line.substr(5).split('|').first;
+    std::string args;
+    SmallVector<StringRef, 8> parts;
+    line.split(parts, " ", -1, false);
+    for (StringRef part : parts) {
+      part = part.trim();
+      if (part.empty() || part == "%s")
+        continue;
+      args += part;
+      args += ' ';
+    }
+    return args;
+  }
+  return std::string();
+}
+
+class BenchContext {
+  DxcDllSupport &m_dxcSupport;
+#ifdef _WIN32
+  PeakTrackingMalloc m_Malloc;
+#endif
+
+  template <typename TInterface>
+  HRESULT CreateInstance(REFCLSID clsid, _Outptr_ TInterface **pResult) {
+#ifdef _WIN32
+    return m_dxcSupport.CreateInstance2(&m_Malloc, clsid, pResult);
+#else
+    return m_dxcSupport.CreateInstance(clsid, pResult);
+#endif
+  }
+
+public:
+  BenchContext(DxcDllSupport &dxcSupport) : m_dxcSupport(dxcSupport) {}
+
+  void WriteHeader(raw_ostream &OS);
+  BenchResult Run(const std::string &file);
+  void WriteResult(raw_ostream &OS, const std::string &file,
+                   const BenchResult &result);
+};
+
+// The output is one JSON object per line: first the compiler version and
+// settings, then one per input with its status, the median, min and max of
+// the total time, the median time of each phase, and the peak memory. On
+// Windows that is the peak of the compiler heap for the input; elsewhere it is
+// the high-water mark of the whole process so far, which only grows from one
+// input to the next, and is written as process_peak_rss_bytes. Phases
+// are timed through the API: preprocess on its own, compile with -Vd,
+// validate, then link for libraries when -link-T is given.
+void BenchContext::WriteHeader(raw_ostream &OS) {
+  UINT32 major = 1, minor = 0, commitCount = 0;
+  CComHeapPtr<char> commitHash;
+  CComPtr<IDxcVersionInfo> pVersionInfo;
+  CComPtr<IDxcVersionInfo2> pVersionInfo2;
+  if (SUCCEEDED(CreateInstance(CLSID_DxcCompiler, &pVersionInfo))) {
+    pVersionInfo->GetVersion(&major, &minor);
+    if (SUCCEEDED(pVersionInfo->QueryInterface(&pVersionInfo2)))
+      pVersionInfo2->GetCommitInfo(&commitCount, &commitHash);
+  }
+  OS << "{\"compiler_version\":\"" << major << "." << minor
+     << "\",\"commit_count\":" << commitCount << ",\"commit_hash\":";
+  WriteJsonString(OS, commitHash.m_pData ? commitHash.m_pData : "");
+  OS << ",\"iterations\":" << Iterations << ",\"link_profile\":";
+  WriteJsonString(OS, LinkProfile);
+  OS << ",\"memory\":"
+#ifdef _WIN32
+     << "\"peak_heap\""
+#else
+     << "\"process_peak_rss\""
+#endif
+     << "}\n";
+}
+
+BenchResult BenchContext::Run(const std::string &file) {
+  BenchResult result;
+  std::wstring wFile = Unicode::UTF8ToUTF16StringOrThrow(file.c_str());
+
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcIncludeHandler> pIncludeHandler;
+  IFT(CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  IFT(pLibrary->CreateBlobFromFile(wFile.c_str(), nullptr, &pSource));
+  IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+
+  StringRef text((const char *)pSource->GetBufferPointer(),
+                 pSource->GetBufferSize());
+  std::string args = GetDxcRunArgs(text);
+  if (args.empty())
+    args = "-E main -T " + TargetProfile;
+
+  SmallVector<StringRef, 8> splitArgs;
+  StringRef(args).split(splitArgs, " ", -1, false);
+  MainArgs argStrings(splitArgs);
+  DxcOpts opts;
+  std::string errorString;
+  raw_string_ostream errorStream(errorString);
+  if (ReadDxcOpts(getHlslOptTable(), /*flagsToInclude*/ 0, argStrings, opts,
+                  errorStream)) {
+    result.Status = "invalid arguments";
+    result.Error = errorStream.str();
+    return result;
+  }
+
+  std::wstring entry =
+      Unicode::UTF8ToUTF16StringOrThrow(opts.EntryPoint.str().c_str());
+  std::wstring profile =
+      Unicode::UTF8ToUTF16StringOrThrow(opts.TargetProfile.str().c_str());
+  std::vector<std::wstring> argWStrings;
+  CopyArgsToWStrings(opts.Args, CoreOption, argWStrings);
+  std::vector<LPCWSTR> flags;
+  for (const std::wstring &a : argWStrings)
+    flags.push_back(a.c_str());
+  // Validation is timed on its own, unless the compile wouldn't validate.
+  bool bValidate = !opts.DisableValidation && opts.ValVerMajor != 0;
+  std::vector<LPCWSTR> compileFlags(flags);
+  if (bValidate)
+    compileFlags.push_back(L"-Vd");
+
+  std::wstring linkEntry = Unicode::UTF8ToUTF16StringOrThrow(LinkEntry.c_str());
+  std::wstring linkProfile =
+      Unicode::UTF8ToUTF16StringOrThrow(LinkProfile.c_str());
+
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcValidator> pValidator;
+  IFT(CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  IFT(CreateInstance(CLSID_DxcValidator, &pValidator));
+
+  for (unsigned i = 0; i < Iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    CComPtr<IDxcOperationResult> pPreprocessResult;
+    IFT(pCompiler->Preprocess(pSource, wFile.c_str(), flags.data(),
+                              flags.size(), nullptr, 0, pIncludeHandler,
+                              &pPreprocessResult));
+    result.PreprocessMs.push_back(ElapsedMs(start));
+
+#ifdef _WIN32
+    m_Malloc.ResetPeak();
+#endif
+    start = std::chrono::steady_clock::now();
+    CComPtr<IDxcOperationResult> pResult;
+    IFT(pCompiler->Compile(pSource, wFile.c_str(), entry.c_str(),
+                           profile.c_str(), compileFlags.data(),
+                           compileFlags.size(), nullptr, 0, pIncludeHandler,
+                           &pResult));
+    double compileMs = ElapsedMs(start);
+    result.CompileMs.push_back(compileMs);
+
+    HRESULT status;
+    IFT(pResult->GetStatus(&status));
+    if (FAILED(status)) {
+      CComPtr<IDxcBlobEncoding> pErrors;
+      IFT(pResult->GetErrorBuffer(&pErrors));
+      result.Status = "compile failed";
+      if (pErrors)
+        result.Error.assign((const char *)pErrors->GetBufferPointer(),
+                            pErrors->GetBufferSize());
+      return result;
+    }
+
+    double validateMs = 0;
+    CComPtr<IDxcBlob> pProgram;
+    IFT(pResult->GetResult(&pProgram));
+    if (bValidate && pProgram &&
+        hlsl::IsValidDxilContainer(
+            (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer(),
+            pProgram->GetBufferSize())) {
+      start = std::chrono::steady_clock::now();
+      CComPtr<IDxcOperationResult> pValResult;
+      IFT(pValidator->Validate(pProgram, DxcValidatorFlags_Default,
+                               &pValResult));
+      validateMs = ElapsedMs(start);
+      result.ValidateMs.push_back(validateMs);
+      IFT(pValResult->GetStatus(&status));
+      if (FAILED(status)) {
+        CComPtr<IDxcBlobEncoding> pErrors;
+        IFT(pValResult->GetErrorBuffer(&pErrors));
+        result.Status = "validation failed";
+        if (pErrors)
+          result.Error.assign((const char *)pErrors->GetBufferPointer(),
+                              pErrors->GetBufferSize());
+        return result;
+      }
+    }
+
+    double linkMs = 0;
+    if (!LinkProfile.empty() && opts.IsLibraryProfile()) {
+      start = std::chrono::steady_clock::now();
+      CComPtr<IDxcLinker> pLinker;
+      CComPtr<IDxcOperationResult> pLinkResult;
+      LPCWSTR libName = L"lib";
+      IFT(CreateInstance(CLSID_DxcLinker, &pLinker));
+      IFT(pLinker->RegisterLibrary(libName, pProgram));
+      IFT(pLinker->Link(linkEntry.c_str(), linkProfile.c_str(), &libName, 1,
+                        nullptr, 0, &pLinkResult));
+      linkMs = ElapsedMs(start);
+      result.LinkMs.push_back(linkMs);
+      IFT(pLinkResult->GetStatus(&status));
+      if (FAILED(status)) {
+        CComPtr<IDxcBlobEncoding> pErrors;
+        IFT(pLinkResult->GetErrorBuffer(&pErrors));
+        result.Status = "link failed";
+        if (pErrors)
+          result.Error.assign((const char *)pErrors->GetBufferPointer(),
+                              pErrors->GetBufferSize());
+        return result;
+      }
+    }
+    result.TotalMs.push_back(compileMs + validateMs + linkMs);
+
+#ifdef _WIN32
+    result.PeakMemory = std::max<uint64_t>(result.PeakMemory,
+                                           m_Malloc.GetPeak());
+#endif
+  }
+
+#ifndef _WIN32
+  // The process high-water mark, in KB on Linux and bytes on macOS.
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    result.PeakMemory = usage.ru_maxrss;
+#else
+    result.PeakMemory = (uint64_t)usage.ru_maxrss * 1024;
+#endif
+  }
+#endif
+  return result;
+}
+
+void BenchContext::WriteResult(raw_ostream &OS, const std::string &file,
+                               const BenchResult &result) {
+  OS << "{\"file\":";
+  WriteJsonString(OS, file);
+  OS << ",\"status\":";
+  WriteJsonString(OS, result.Status);
+  if (!result.Error.empty()) {
+    OS << ",\"error\":";
+    WriteJsonString(OS, StringRef(result.Error).split('\n').first);
+  }
+  if (!result.TotalMs.empty()) {
+    OS << format(",\"median_ms\":%.3f,\"min_ms\":%.3f,\"max_ms\":%.3f",
+                 Median(result.TotalMs),
+                 *std::min_element(result.TotalMs.begin(),
+                                   result.TotalMs.end()),
+                 *std::max_element(result.TotalMs.begin(),
+                                   result.TotalMs.end()));
+    OS << format(",\"phases_ms\":{\"preprocess\":%.3f,\"compile\":%.3f,"
+                 "\"validate\":%.3f,\"link\":%.3f}",
+                 Median(result.PreprocessMs), Median(result.CompileMs),
+                 Median(result.ValidateMs), Median(result.LinkMs));
+#ifdef _WIN32
+    OS << ",\"peak_memory_bytes\":" << result.PeakMemory;
+#else
+    OS << ",\"process_peak_rss_bytes\":" << result.PeakMemory;
+#endif
+  }
+  OS << "}\n";
+}
+
+// Adds file, or the .hlsl files under it if it is a directory, to files.
+void AddInputs(StringRef path, std::vector<std::string> &files) {
+  if (!sys::fs::is_directory(path)) {
+    files.push_back(path);
+    return;
+  }
+  std::vector<std::string> dirFiles;
+  std::error_code EC;
+  for (sys::fs::recursive_directory_iterator Dir(path, EC), DirEnd;
+       Dir != DirEnd && !EC; Dir.increment(EC)) {
+    if (sys::path::extension(Dir->path()) == ".hlsl")
+      dirFiles.push_back(Dir->path());
+  }
+  // Keep the output in a stable order.
+  std::sort(dirFiles.begin(), dirFiles.end());
+  files.insert(files.end(), dirFiles.begin(), dirFiles.end());
+}
+
+void ReadCorpus(StringRef corpusFile, std::vector<std::string> &files) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> corpus =
+      MemoryBuffer::getFile(corpusFile);
+  IFTLLVM(corpus.getError());
+  StringRef baseDir = sys::path::parent_path(corpusFile);
+  SmallVector<StringRef, 32> lines;
+  corpus.get()->getBuffer().split(lines, "\n", -1, false);
+  for (StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#"))
+      continue;
+    SmallString<128> path(baseDir);
+    sys::path::append(path, line);
+    AddInputs(path, files);
+  }
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  const char *pStage = "Operation";
+  int retVal = 0;
+  if (llvm::sys::fs::SetupPerThreadFileSystem())
+    return 1;
+  llvm::sys::fs::AutoCleanupPerThreadFileSystem auto_cleanup_fs;
+  if (FAILED(DxcInitThreadMalloc())) return 1;
+  DxcSetThreadMallocToDefault();
+  try {
+    llvm::sys::fs::MSFileSystem *msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    pStage = "Argument processing";
+    if (initHlslOptTable()) throw std::bad_alloc();
+
+    // Parse command line options.
+    cl::ParseCommandLineOptions(argc, argv, "dxc benchmark\n");
+
+    if ((Inputs.empty() && Corpus.empty()) || Help || Iterations == 0) {
+      cl::PrintHelpMessage();
+      return 2;
+    }
+
+    std::vector<std::string> files;
+    if (!Corpus.empty())
+      ReadCorpus(Corpus, files);
+    for (const std::string &input : Inputs)
+      AddInputs(input, files);
+
+    std::error_code EC;
+    raw_fd_ostream OS(OutputFilename, EC, sys::fs::F_Text);
+    IFTLLVM(EC);
+
+    DxcDllSupport dxcSupport;
+    dxc::EnsureEnabled(dxcSupport);
+    BenchContext context(dxcSupport);
+
+    pStage = "Benchmarking";
+    context.WriteHeader(OS);
+    for (const std::string &file : files) {
+      BenchResult result = context.Run(file);
+      context.WriteResult(OS, file, result);
+      OS.flush();
+      if (result.Status != "ok")
+        retVal = 1;
+    }
+  } catch (const ::hlsl::Exception &hlslException) {
+    try {
+      const char *msg = hlslException.what();
+      Unicode::acp_char printBuffer[128]; // printBuffer is safe to treat as
+                                          // UTF-8 because we use ASCII only errors
+                                          // only
+      if (msg == nullptr || *msg == '\0') {
+        sprintf_s(printBuffer, _countof(printBuffer),
+                  "%s failed - error code 0x%08x.", pStage, hlslException.hr);
+        msg = printBuffer;
+      }
+      printf("%s\n", msg);
+    } catch (...) {
+      printf("%s failed - unable to retrieve error message.\n", pStage);
+    }
+
+    return 1;
+  } catch (std::bad_alloc &) {
+    printf("%s failed - out of memory.\n", pStage);
+    return 1;
+  } catch (...) {
+    printf("%s failed - unknown error.\n", pStage);
+    return 1;
+  }
+
+  return retVal;
+}
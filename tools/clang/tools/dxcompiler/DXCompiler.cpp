@@ -22,6 +22,7 @@
 namespace hlsl {
 HRESULT SetupRegistryPassForHLSL();
 HRESULT SetupRegistryPassForPIX();
+HRESULT SetupRegistryPassForDxrFallback();
 } // namespace hlsl
 
 // C++ exception specification ignored except to indicate a function is not __declspec(nothrow)
@@ -60,6 +61,7 @@ static HRESULT InitMaybeFail() throw() {
   fsSetup = true;
   IFC(hlsl::SetupRegistryPassForHLSL());
   IFC(hlsl::SetupRegistryPassForPIX());
+  IFC(hlsl::SetupRegistryPassForDxrFallback());
   IFC(DxilLibInitialize());
   if (hlsl::options::initHlslOptTable()) {
     hr = E_FAIL;
@@ -35,6 +35,7 @@ DEFINE_CROSS_PLATFORM_UUIDOF(IDxcBlob)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIncludeHandler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcCompiler2)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRootSignatureCompiler)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcVersionInfo)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcVersionInfo2)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcValidator)
@@ -43,6 +44,7 @@ DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizerPass)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcOptimizer)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRewriter)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRewriter2)
+DEFINE_CROSS_PLATFORM_UUIDOF(IDxcRewriter3)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcIntelliSense)
 DEFINE_CROSS_PLATFORM_UUIDOF(IDxcLinker)
 
@@ -1545,6 +1545,97 @@ void PrintPipelineStateValidationRuntimeInfo(const char *pBuffer,
 
   OS << comment << "\n";
 }
+
+void PrintShaderCost(const DxilPartHeader *pPart, raw_string_ostream &OS,
+                     StringRef comment) {
+  const char *pData = GetDxilPartData(pPart);
+  const DxilShaderCostHeader *pHeader =
+      reinterpret_cast<const DxilShaderCostHeader *>(pData);
+  if (pPart->PartSize < sizeof(DxilShaderCostHeader) ||
+      pHeader->EntrySize < sizeof(DxilShaderCostEntry) ||
+      (pPart->PartSize - sizeof(DxilShaderCostHeader)) / pHeader->EntrySize <
+          pHeader->EntryCount) {
+    OS << comment << " shader cost present; corruption detected\n";
+    return;
+  }
+
+  OS << comment << "\n"
+     << comment << " Shader cost estimate:\n";
+  for (uint32_t i = 0; i < pHeader->EntryCount; ++i) {
+    const DxilShaderCostEntry *pEntry =
+        reinterpret_cast<const DxilShaderCostEntry *>(
+            pData + sizeof(DxilShaderCostHeader) + i * pHeader->EntrySize);
+    StringRef Name;
+    if (pEntry->NameOffset < pPart->PartSize)
+      Name = StringRef(pData + pEntry->NameOffset,
+                       strnlen(pData + pEntry->NameOffset,
+                               pPart->PartSize - pEntry->NameOffset));
+    const char *pKindName =
+        pEntry->ShaderKind <= (uint32_t)DXIL::ShaderKind::Invalid
+            ? ShaderModel::GetKindName((DXIL::ShaderKind)pEntry->ShaderKind)
+            : "invalid";
+    OS << comment << "\n"
+       << comment << " " << Name << " (" << pKindName << ")\n"
+       << comment << "   ALU operations:     " << pEntry->AluOps << "\n"
+       << comment << "   Texture operations: " << pEntry->TextureOps << "\n"
+       << comment << "   Memory operations:  " << pEntry->MemoryOps << "\n"
+       << comment << "   Max live scalars:   " << pEntry->MaxLiveScalars << "\n"
+       << comment << "   Loops:              " << pEntry->LoopCount
+       << " (" << pEntry->UnboundedLoopCount << " unbounded, max trip count "
+       << pEntry->MaxLoopTripCount << ")\n"
+       << comment << "   Groupshared bytes:  " << pEntry->GroupSharedBytes
+       << "\n";
+  }
+  OS << comment << "\n";
+}
+
+static const char *RuntimeDataPartTypeToString(RDAT::RuntimeDataPartType type) {
+  switch (type) {
+  case RDAT::RuntimeDataPartType::StringBuffer:   return "StringBuffer";
+  case RDAT::RuntimeDataPartType::IndexArrays:    return "IndexArrays";
+  case RDAT::RuntimeDataPartType::ResourceTable:  return "ResourceTable";
+  case RDAT::RuntimeDataPartType::FunctionTable:  return "FunctionTable";
+  case RDAT::RuntimeDataPartType::RawBytes:       return "RawBytes";
+  case RDAT::RuntimeDataPartType::SubobjectTable: return "SubobjectTable";
+  default: return "<unknown>";
+  }
+}
+
+void PrintRuntimeDataParts(const DxilPartHeader *pPart, raw_string_ostream &OS,
+                           StringRef comment) {
+  const char *pData = GetDxilPartData(pPart);
+  const RDAT::RuntimeDataHeader *pHeader =
+      reinterpret_cast<const RDAT::RuntimeDataHeader *>(pData);
+  if (pPart->PartSize < sizeof(RDAT::RuntimeDataHeader) ||
+      pHeader->Version < RDAT::RDAT_Version_10 ||
+      (pPart->PartSize - sizeof(RDAT::RuntimeDataHeader)) / sizeof(uint32_t) <
+          pHeader->PartCount) {
+    OS << comment << " runtime data present; corruption detected\n";
+    return;
+  }
+
+  OS << comment << "\n"
+     << comment << " Runtime Data (RDAT) parts:\n"
+     << comment << "\n"
+     << comment << " Part                 Size\n"
+     << comment << " ---------------- --------\n";
+  const uint32_t *pOffsets = reinterpret_cast<const uint32_t *>(pHeader + 1);
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    if (pOffsets[i] > pPart->PartSize - sizeof(RDAT::RuntimeDataPartHeader)) {
+      OS << comment << " runtime data present; corruption detected\n";
+      return;
+    }
+    const RDAT::RuntimeDataPartHeader *pRDATPart =
+        reinterpret_cast<const RDAT::RuntimeDataPartHeader *>(pData +
+                                                              pOffsets[i]);
+    OS << comment << " "
+       << left_justify(RuntimeDataPartTypeToString(pRDATPart->Type), 16)
+       << format(" %8u", pRDATPart->Size) << "\n";
+  }
+  OS << comment << " Total            " << format("%8u", pPart->PartSize)
+     << "\n"
+     << comment << "\n";
+}
 }
 
 
@@ -1628,6 +1719,12 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
       Stream << "\n";
     }
 
+    it = std::find_if(begin(pContainer), end(pContainer),
+                      DxilPartIsType(DFCC_ShaderCost));
+    if (it != end(pContainer)) {
+      PrintShaderCost(*it, Stream, /*comment*/ ";");
+    }
+
     it = std::find_if(begin(pContainer), end(pContainer),
                       DxilPartIsType(DFCC_DXIL));
 
@@ -1730,6 +1827,7 @@ HRESULT Disassemble(IDxcBlob *pProgram, raw_string_ostream &Stream) {
     PrintViewIdState(dxilReflectionModule, Stream, /*comment*/ ";");
 
     if (pRDATPart) {
+      PrintRuntimeDataParts(pRDATPart, Stream, /*comment*/ ";");
       RDAT::DxilRuntimeData runtimeData(GetDxilPartData(pRDATPart), pRDATPart->PartSize);
       // TODO: Print the rest of the RDAT info
       if (RDAT::SubobjectTableReader *pSubobjectTableReader =
@@ -217,6 +217,7 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
     if (opts.ValVerMajor != UINT32_MAX) {
       m_pLinker->SetValidatorVersion(opts.ValVerMajor, opts.ValVerMinor);
     }
+    m_pLinker->SetSpecializationConstants(opts.Specializations);
 
     bool needsValidation = !opts.DisableValidation;
     // Disable validation if ValVerMajor is 0 (offline target, never validate),
@@ -291,7 +292,8 @@ HRESULT STDMETHODCALLTYPE DxcLinker::Link(
           // TODO: DFCC_ShaderDebugName
         }
 
-        hasErrorOccurred = Diag.hasErrorOccurred();
+        // Passes run by the linker report errors through the LLVM context.
+        hasErrorOccurred = Diag.hasErrorOccurred() || DiagContext.HasErrors();
 
       } else {
         hasErrorOccurred = true;
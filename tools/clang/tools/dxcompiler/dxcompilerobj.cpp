@@ -22,8 +22,11 @@
 #include "clang/Sema/SemaHLSL.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "clang/Frontend/FrontendActions.h"
+#include "clang/Parse/ParseHLSL.h"
 #include "clang/CodeGen/CodeGenAction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/MD5.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
 #include "dxc/DxilRootSignature/DxilRootSignature.h"
@@ -33,6 +36,9 @@
 #include "dxc/DxilContainer/DxilContainerAssembler.h"
 #include "dxc/dxcapi.internal.h"
 #include "dxc/DXIL/DxilPDB.h"
+#include "dxc/DXIL/DxilUtil.h"
+#include "dxc/HLSL/HLModule.h"
+#include "dxc/HLSL/HLOperations.h"
 
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/Global.h"
@@ -47,7 +53,12 @@
 #endif
 #include "dxillib.h"
 #include <algorithm>
+#include <atomic>
 #include <cfloat>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
 
 // SPIRV change starts
 #ifdef ENABLE_SPIRV_CODEGEN
@@ -70,6 +81,8 @@ DEFINE_CROSS_PLATFORM_UUIDOF(IDxcLangExtensions)
 
 // This declaration is used for the locally-linked validator.
 HRESULT CreateDxcValidator(_In_ REFIID riid, _Out_ LPVOID *ppv);
+// This declaration is used to link libraries compiled in parallel.
+HRESULT CreateDxcLinker(_In_ REFIID riid, _Out_ LPVOID *ppv);
 
 // This internal call allows the validator to avoid having to re-deserialize
 // the module. It trusts that the caller didn't make any changes and is
@@ -377,6 +390,7 @@ public:
 };
 
 class DxcCompiler : public IDxcCompiler2,
+                    public IDxcRootSignatureCompiler,
                     public IDxcLangExtensions,
                     public IDxcContainerEvent,
 #ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
@@ -389,6 +403,11 @@ private:
   DXC_MICROCOM_TM_REF_FIELDS()
   DxcLangExtensionsHelper m_langExtensionsHelper;
   CComPtr<IDxcContainerEventsHandler> m_pDxcContainerEventsHandler;
+  // Containers returned by CompileRootSignature, by version and text. Holds
+  // at most kRootSigCacheSize entries.
+  static const size_t kRootSigCacheSize = 256;
+  std::mutex m_rootSigCacheMutex;
+  std::unordered_map<std::string, CComPtr<IDxcBlob>> m_rootSigCache;
 
   void CreateDefineStrings(_In_count_(defineCount) const DxcDefine *pDefines,
                            UINT defineCount,
@@ -404,6 +423,430 @@ private:
     }
   }
 
+  // Appends the error buffer of pResult to text.
+  static void AppendErrors(IDxcOperationResult *pResult, std::string &text) {
+    CComPtr<IDxcBlobEncoding> pErrors;
+    CComPtr<IDxcBlobEncoding> pErrorsUtf8;
+    IFT(pResult->GetErrorBuffer(&pErrors));
+    if (!pErrors || pErrors->GetBufferSize() == 0)
+      return;
+    IFT(hlsl::DxcGetBlobAsUtf8(pErrors, &pErrorsUtf8));
+    StringRef errors((const char *)pErrorsUtf8->GetBufferPointer(),
+                     pErrorsUtf8->GetBufferSize());
+    while (!errors.empty() && errors.back() == '\0')
+      errors = errors.drop_back();
+    text += errors;
+  }
+
+  // Whether a library compile can use the export cache. Anything that needs
+  // the whole translation unit in one module, or options that already pick
+  // the exports, keep the serial path.
+  bool CanCompileLibraryByExports(hlsl::options::DxcOpts &opts,
+                                  IDxcBlob **ppDebugBlob) {
+    StringRef profile = opts.TargetProfile;
+    return opts.IsLibraryProfile() && !opts.LibCache.empty() &&
+           profile != "lib_6_1" && profile != "lib_6_2" &&
+           !opts.CodeGenHighLevel && !opts.AstDump && !opts.OptDump &&
+           !opts.DebugInfo && !ppDebugBlob &&
+#ifdef ENABLE_SPIRV_CODEGEN
+           !opts.GenSPIRV &&
+#endif
+           opts.Exports.empty();
+  }
+
+  // Removes every -name or /name option from args along with its value.
+  static void RemoveSeparateArg(std::vector<LPCWSTR> &args, LPCWSTR name) {
+    for (size_t i = 0; i < args.size();) {
+      LPCWSTR arg = args[i];
+      if ((arg[0] == L'-' || arg[0] == L'/') && wcscmp(arg + 1, name) == 0)
+        args.erase(args.begin() + i,
+                   args.begin() + std::min(i + 2, args.size()));
+      else
+        ++i;
+    }
+  }
+
+  // Returns the arguments that can change the code of a library: all but the
+  // output files, where the cache is and how many threads compile.
+  static std::vector<std::string>
+  GetLibraryCacheArgs(hlsl::options::DxcOpts &opts) {
+    llvm::opt::ArgStringList argList;
+    for (const llvm::opt::Arg *A : opts.Args) {
+      const llvm::opt::Option &O = A->getOption();
+      if (O.matches(options::OPT_Fo) || O.matches(options::OPT_Fe) ||
+          O.matches(options::OPT_Fd) || O.matches(options::OPT_lib_cache) ||
+          O.matches(options::OPT_lib_threads))
+        continue;
+      A->renderAsInput(opts.Args, argList);
+    }
+    return std::vector<std::string>(argList.begin(), argList.end());
+  }
+
+  // Returns what every export of the high-level module depends on besides
+  // its own code: the compiler and options, globals, and module metadata.
+  static std::string GetLibraryCacheContext(llvm::Module &M,
+                                            ArrayRef<std::string> args,
+                                            LPCWSTR pTargetProfile) {
+    std::string context;
+    raw_string_ostream os(context);
+#ifdef SUPPORT_QUERY_GIT_COMMIT_INFO
+    os << getGitCommitHash() << "\n";
+#endif // SUPPORT_QUERY_GIT_COMMIT_INFO
+    UINT32 valMajor, valMinor;
+    dxcutil::GetValidatorVersion(&valMajor, &valMinor);
+    os << valMajor << "." << valMinor << "\n";
+    os << CW2A(pTargetProfile, CP_UTF8).m_psz << "\n";
+    for (const std::string &arg : args)
+      os << arg << "\n";
+    os << M.getDataLayoutStr() << "\n";
+    for (GlobalVariable &GV : M.globals())
+      GV.print(os);
+    for (NamedMDNode &NMD : M.named_metadata())
+      NMD.print(os);
+    return os.str();
+  }
+
+  // Hashes the high-level code reachable from the functions of an export,
+  // so changing a function changes the key of every export that calls it.
+  static std::string HashLibraryExport(StringRef context,
+                                       ArrayRef<Function *> functions) {
+    MD5 md5;
+    md5.update(context);
+    SmallPtrSet<Function *, 16> visited;
+    SmallVector<Function *, 16> worklist(functions.rbegin(),
+                                         functions.rend());
+    while (!worklist.empty()) {
+      Function *F = worklist.pop_back_val();
+      if (!visited.insert(F).second)
+        continue;
+      std::string text;
+      raw_string_ostream os(text);
+      F->print(os);
+      md5.update(os.str());
+      for (BasicBlock &BB : *F) {
+        for (Instruction &I : BB) {
+          for (Value *op : I.operands()) {
+            if (Function *callee = dyn_cast<Function>(op))
+              worklist.push_back(callee);
+          }
+        }
+      }
+    }
+    MD5::MD5Result result;
+    SmallString<32> hash;
+    md5.final(result);
+    MD5::stringifyResult(result, hash);
+    return hash.str();
+  }
+
+  // Writes a cache entry to a temporary file and renames it into place, so
+  // a compile running at the same time never reads a partial entry.
+  static void WriteLibraryCacheEntry(const std::wstring &path, IDxcBlob *pLib) {
+    std::random_device rd;
+    std::wstring tempPath =
+        path + L"." + std::to_wstring(rd()) + std::to_wstring(rd()) + L".tmp";
+    WriteBinaryFile(tempPath.c_str(), pLib->GetBufferPointer(),
+                    pLib->GetBufferSize());
+#ifdef _WIN32
+    if (!MoveFileExW(tempPath.c_str(), path.c_str(),
+                     MOVEFILE_REPLACE_EXISTING)) {
+      HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+      DeleteFileW(tempPath.c_str());
+      IFT(hr);
+    }
+#else
+    CW2A utf8TempPath(tempPath.c_str(), CP_UTF8);
+    if (rename(utf8TempPath.m_psz, CW2A(path.c_str(), CP_UTF8).m_psz) != 0) {
+      remove(utf8TempPath.m_psz);
+      IFT(E_FAIL);
+    }
+#endif
+  }
+
+  // An export of a library and its entry in the cache.
+  struct LibraryExportGroup {
+    std::wstring Exports;
+    std::wstring CachePath;
+    CComPtr<IDxcBlob> pLib;
+    CComPtr<IDxcOperationResult> pResult;
+    HRESULT hr = S_OK;
+  };
+
+  // Compiles a library reusing the exports found in the -lib-cache directory.
+  // Each export is keyed by a hash of the high-level code it reaches, which
+  // is read from a -fcgl compile of the source.
+  //
+  // Exports missing from the cache are compiled together in one library. When
+  // all of them are missing, that is the same compile as without -lib-cache,
+  // and its output is returned as is. Otherwise the cached exports are linked
+  // with it. Each missed export is then linked out of that library into its
+  // own entry, on up to -lib-threads threads.
+  void CompileLibraryByExports(
+      _In_ IDxcBlob *pSource, _In_opt_ LPCWSTR pSourceName,
+      _In_ LPCWSTR pEntryPoint, _In_ LPCWSTR pTargetProfile,
+      _In_count_(argCount) LPCWSTR *pArguments, _In_ UINT32 argCount,
+      _In_count_(defineCount) const DxcDefine *pDefines,
+      _In_ UINT32 defineCount, _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+      hlsl::options::DxcOpts &opts,
+      _COM_Outptr_ IDxcOperationResult **ppResult) {
+    HRESULT status;
+
+    // Nested compiles must not use the cache again.
+    std::vector<LPCWSTR> args(pArguments, pArguments + argCount);
+    RemoveSeparateArg(args, L"lib-cache");
+
+    std::vector<LPCWSTR> hlArgs(args);
+    hlArgs.push_back(L"-fcgl");
+    CComPtr<IDxcOperationResult> pHLResult;
+    CComPtr<IDxcBlob> pHLBitcode;
+    IFT(CompileWithDebug(pSource, pSourceName, pEntryPoint, pTargetProfile,
+                         hlArgs.data(), (UINT32)hlArgs.size(), pDefines,
+                         defineCount, pIncludeHandler, &pHLResult, nullptr,
+                         nullptr));
+    IFT(pHLResult->GetStatus(&status));
+    if (FAILED(status)) {
+      *ppResult = pHLResult.Detach();
+      return;
+    }
+    IFT(pHLResult->GetResult(&pHLBitcode));
+
+    // Exported functions are grouped by name, so overloads stay together.
+    std::vector<LibraryExportGroup> groups;
+    {
+      llvm::LLVMContext Ctx;
+      std::string diagStr;
+      std::unique_ptr<llvm::Module> pHLModule = dxilutil::LoadModuleFromBitcode(
+          StringRef((const char *)pHLBitcode->GetBufferPointer(),
+                    pHLBitcode->GetBufferSize()),
+          Ctx, diagStr);
+      IFTBOOL(pHLModule, DXC_E_GENERAL_INTERNAL_ERROR);
+
+      // Hull shaders are grouped with their patch constant functions, since
+      // neither links without the other. Shaders sharing one are grouped by
+      // the first of them.
+      HLModule &HLM = pHLModule->GetOrCreateHLModule();
+      DenseMap<Function *, Function *> groupLeaders;
+      for (Function &F : pHLModule->functions()) {
+        if (!HLM.HasDxilFunctionProps(&F))
+          continue;
+        DxilFunctionProps &props = HLM.GetDxilFunctionProps(&F);
+        if (!props.IsHS() || !props.ShaderProps.HS.patchConstantFunc)
+          continue;
+        Function *patchConstantFunc = props.ShaderProps.HS.patchConstantFunc;
+        Function *leader =
+            groupLeaders.insert(std::make_pair(patchConstantFunc, &F))
+                .first->second;
+        groupLeaders[&F] = leader;
+      }
+
+      std::vector<SmallVector<Function *, 1>> exportFunctions;
+      StringMap<unsigned> groupIndex;
+      StringSet<> exportNames;
+      for (Function &F : pHLModule->functions()) {
+        if (F.isDeclaration() || F.isIntrinsic() || !F.hasExternalLinkage() ||
+            GetHLOpcodeGroup(&F) != HLOpcodeGroup::NotHL)
+          continue;
+        StringRef name = dxilutil::DemangleFunctionName(F.getName());
+        Function *leader = groupLeaders.lookup(&F);
+        StringRef groupName =
+            leader ? dxilutil::DemangleFunctionName(leader->getName()) : name;
+        auto it = groupIndex.insert(
+            std::make_pair(groupName, (unsigned)groups.size()));
+        if (it.second) {
+          groups.emplace_back();
+          exportFunctions.emplace_back();
+        }
+        LibraryExportGroup &group = groups[it.first->second];
+        // Overloads share a name, so each name is exported once.
+        if (exportNames.insert(name).second) {
+          std::wstring wname;
+          Unicode::UTF8ToUTF16String(name.str().c_str(), &wname);
+          if (!group.Exports.empty())
+            group.Exports += L';';
+          group.Exports += wname;
+        }
+        exportFunctions[it.first->second].push_back(&F);
+      }
+
+      std::string context =
+          GetLibraryCacheContext(*pHLModule, GetLibraryCacheArgs(opts),
+                                 pTargetProfile);
+      std::wstring cacheDir;
+      Unicode::UTF8ToUTF16String(opts.LibCache.str().c_str(), &cacheDir);
+      if (cacheDir.back() != L'/' && cacheDir.back() != L'\\')
+        cacheDir += L'/';
+      for (size_t i = 0; i < groups.size(); ++i) {
+        std::string hash = HashLibraryExport(context, exportFunctions[i]);
+        groups[i].CachePath =
+            cacheDir + std::wstring(hash.begin(), hash.end()) + L".dxil";
+      }
+    }
+
+    if (groups.empty()) {
+      IFT(CompileWithDebug(pSource, pSourceName, pEntryPoint, pTargetProfile,
+                           args.data(), (UINT32)args.size(), pDefines,
+                           defineCount, pIncludeHandler, ppResult, nullptr,
+                           nullptr));
+      return;
+    }
+
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < groups.size(); ++i) {
+      LibraryExportGroup &group = groups[i];
+      CComPtr<IDxcBlobEncoding> pCached;
+      if (SUCCEEDED(DxcCreateBlobFromFile(m_pMalloc, group.CachePath.c_str(),
+                                          nullptr, &pCached)) &&
+          IsValidDxilContainer(
+              (const DxilContainerHeader *)pCached->GetBufferPointer(),
+              pCached->GetBufferSize()))
+        group.pLib = pCached;
+      else
+        pending.push_back(i);
+    }
+
+    CComPtr<IDxcOperationResult> pCompileResult;
+    CComPtr<IDxcBlob> pCompiled;
+    if (!pending.empty()) {
+      std::vector<LPCWSTR> compileArgs(args);
+      std::wstring exports;
+      if (pending.size() < groups.size()) {
+        for (size_t i : pending) {
+          if (!exports.empty())
+            exports += L';';
+          exports += groups[i].Exports;
+        }
+        // The linked library is validated instead.
+        compileArgs.push_back(L"-exports");
+        compileArgs.push_back(exports.c_str());
+        compileArgs.push_back(L"-Vd");
+      }
+      IFT(CompileWithDebug(pSource, pSourceName, pEntryPoint, pTargetProfile,
+                           compileArgs.data(), (UINT32)compileArgs.size(),
+                           pDefines, defineCount, pIncludeHandler,
+                           &pCompileResult, nullptr, nullptr));
+      IFT(pCompileResult->GetStatus(&status));
+      if (FAILED(status)) {
+        *ppResult = pCompileResult.Detach();
+        return;
+      }
+      IFT(pCompileResult->GetResult(&pCompiled));
+    }
+
+    if (pending.size() == 1) {
+      groups[pending[0]].pLib = pCompiled;
+    } else if (!pending.empty()) {
+      std::atomic<size_t> next(0);
+      auto linkGroups = [&]() {
+        DxcThreadMalloc TM(m_pMalloc);
+        for (size_t p = next++; p < pending.size(); p = next++) {
+          LibraryExportGroup &group = groups[pending[p]];
+          try {
+            CComPtr<IDxcLinker> pLinker;
+            IFT(CreateDxcLinker(__uuidof(IDxcLinker), (void **)&pLinker));
+            IFT(pLinker->RegisterLibrary(L"lib", pCompiled));
+            LPCWSTR libName = L"lib";
+            LPCWSTR linkArgs[] = {L"-exports", group.Exports.c_str(), L"-Vd"};
+            group.hr = pLinker->Link(L"", pTargetProfile, &libName, 1,
+                                     linkArgs, _countof(linkArgs),
+                                     &group.pResult);
+          } catch (hlsl::Exception &e) {
+            group.hr = e.hr;
+          } catch (...) {
+            group.hr = E_FAIL;
+          }
+        }
+      };
+      std::vector<std::thread> threads;
+      size_t threadCount =
+          std::min<size_t>(std::max<unsigned long>(opts.LibThreads, 1),
+                           pending.size());
+      for (size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(linkGroups);
+      linkGroups();
+      for (std::thread &thread : threads)
+        thread.join();
+      for (size_t i : pending) {
+        LibraryExportGroup &group = groups[i];
+        IFT(group.hr);
+        IFT(group.pResult->GetStatus(&status));
+        if (FAILED(status)) {
+          *ppResult = group.pResult.Detach();
+          return;
+        }
+        IFT(group.pResult->GetResult(&group.pLib));
+      }
+    }
+
+    std::string errors;
+    for (size_t i : pending) {
+      try {
+        WriteLibraryCacheEntry(groups[i].CachePath, groups[i].pLib);
+      } catch (hlsl::Exception &) {
+        errors += "warning: could not write library cache entry ";
+        errors += CW2A(groups[i].CachePath.c_str(), CP_UTF8).m_psz;
+        errors += "\n";
+      }
+    }
+
+    std::string warnings;
+    CComPtr<IDxcBlobEncoding> pErrorBlob;
+    if (pending.size() == groups.size()) {
+      AppendErrors(pCompileResult, warnings);
+      warnings += errors;
+      IFT(DxcCreateBlobWithEncodingOnHeapCopy(warnings.data(), warnings.size(),
+                                              CP_UTF8, &pErrorBlob));
+      IFT(DxcOperationResult::CreateFromResultErrorStatus(
+          pCompiled, pErrorBlob, S_OK, ppResult));
+      return;
+    }
+
+    // The missed exports are linked from the library they were compiled in.
+    std::vector<IDxcBlob *> libs;
+    for (size_t i = 0, p = 0; i < groups.size(); ++i) {
+      if (p < pending.size() && pending[p] == i)
+        ++p;
+      else
+        libs.push_back(groups[i].pLib);
+    }
+    if (pCompiled)
+      libs.push_back(pCompiled);
+
+    CComPtr<IDxcLinker> pLinker;
+    std::vector<std::wstring> libNames(libs.size());
+    std::vector<LPCWSTR> libNamePtrs;
+    IFT(CreateDxcLinker(__uuidof(IDxcLinker), (void **)&pLinker));
+    for (size_t i = 0; i < libs.size(); ++i) {
+      libNames[i] = L"lib" + std::to_wstring(i) + L".";
+      IFT(pLinker->RegisterLibrary(libNames[i].c_str(), libs[i]));
+      libNamePtrs.push_back(libNames[i].c_str());
+    }
+
+    CComPtr<IDxcOperationResult> pLinkResult;
+    CComPtr<IDxcBlob> pOutputBlob;
+    IFT(pLinker->Link(L"", pTargetProfile, libNamePtrs.data(),
+                      (UINT32)libNamePtrs.size(), args.data(),
+                      (UINT32)args.size(), &pLinkResult));
+    IFT(pLinkResult->GetStatus(&status));
+    IFT(pLinkResult->GetResult(&pOutputBlob));
+    if (SUCCEEDED(status) && m_pDxcContainerEventsHandler != nullptr) {
+      CComPtr<IDxcBlob> pTargetBlob;
+      HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(
+          pOutputBlob, &pTargetBlob);
+      if (SUCCEEDED(hr) && pTargetBlob != nullptr)
+        std::swap(pOutputBlob, pTargetBlob);
+    }
+
+    // Front end warnings are reported once, from the last compile of the
+    // source.
+    AppendErrors(pCompileResult ? pCompileResult : pHLResult, warnings);
+    warnings += errors;
+    AppendErrors(pLinkResult, warnings);
+    IFT(DxcCreateBlobWithEncodingOnHeapCopy(warnings.data(), warnings.size(),
+                                            CP_UTF8, &pErrorBlob));
+    IFT(DxcOperationResult::CreateFromResultErrorStatus(
+        pOutputBlob, pErrorBlob, status, ppResult));
+  }
+
 public:
   DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
   DXC_MICROCOM_TM_CTOR(DxcCompiler)
@@ -424,6 +867,7 @@ public:
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
     return DoBasicQueryInterface<IDxcCompiler,
                                  IDxcCompiler2,
+                                 IDxcRootSignatureCompiler,
                                  IDxcLangExtensions,
                                  IDxcContainerEvent,
                                  IDxcVersionInfo
@@ -507,6 +951,15 @@ public:
         goto Cleanup;
       }
 
+      if (CanCompileLibraryByExports(opts, ppDebugBlob)) {
+        CompileLibraryByExports(pSource, pSourceName, pEntryPoint,
+                                pTargetProfile, pArguments, argCount,
+                                pDefines, defineCount, pIncludeHandler, opts,
+                                ppResult);
+        hr = S_OK;
+        goto Cleanup;
+      }
+
 #ifdef ENABLE_SPIRV_CODEGEN
       // We want to embed the preprocessed source code in the final SPIR-V if
       // debug information is enabled. Therefore, we invoke Preprocess() here
@@ -752,6 +1205,9 @@ public:
         if (!opts.StripReflection) {
           SerializeFlags |= SerializeDxilFlags::IncludeReflectionPart;
         }
+        if (opts.EmbedShaderCost) {
+          SerializeFlags |= SerializeDxilFlags::IncludeShaderCostPart;
+        }
 
         // Don't do work to put in a container if an error has occurred
         // Do not create a container when there is only a a high-level representation in the module.
@@ -995,6 +1451,112 @@ public:
     return hr;
   }
 
+  // Compile a root signature string without running the frontend.
+  HRESULT STDMETHODCALLTYPE CompileRootSignature(
+    _In_ IDxcBlob *pRootSignature,                // Root signature text
+    _In_ LPCWSTR pTargetProfile,                  // rootsig_1_0 or rootsig_1_1
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Compiler output status, buffer, and errors
+    ) override {
+    if (pRootSignature == nullptr || pTargetProfile == nullptr ||
+        ppResult == nullptr)
+      return E_INVALIDARG;
+    *ppResult = nullptr;
+
+    DxilRootSignatureVersion rootSigVer;
+    if (wcscmp(pTargetProfile, L"rootsig_1_1") == 0)
+      rootSigVer = DxilRootSignatureVersion::Version_1_1;
+    else if (wcscmp(pTargetProfile, L"rootsig_1_0") == 0)
+      rootSigVer = DxilRootSignatureVersion::Version_1_0;
+    else
+      return E_INVALIDARG;
+
+    HRESULT hr = S_OK;
+    DxcThreadMalloc TM(m_pMalloc);
+    try {
+      DefaultFPEnvScope fpEnvScope;
+
+      CComPtr<IDxcBlobEncoding> utf8RootSig;
+      IFT(hlsl::DxcGetBlobAsUtf8(pRootSignature, &utf8RootSig));
+      StringRef rootSigStr((LPCSTR)utf8RootSig->GetBufferPointer(),
+                           utf8RootSig->GetBufferSize());
+      while (!rootSigStr.empty() && rootSigStr.back() == '\0')
+        rootSigStr = rootSigStr.drop_back();
+
+      // The serialized container only depends on the version and the text.
+      std::string key(1, (char)rootSigVer);
+      key.append(rootSigStr.data(), rootSigStr.size());
+      {
+        std::lock_guard<std::mutex> lock(m_rootSigCacheMutex);
+        auto it = m_rootSigCache.find(key);
+        if (it != m_rootSigCache.end())
+          return DxcOperationResult::CreateFromResultErrorStatus(
+              it->second, nullptr, S_OK, ppResult);
+      }
+
+      std::string errors;
+      raw_string_ostream errorStream(errors);
+      DxilVersionedRootSignatureDesc *pDesc = nullptr;
+      CComPtr<IDxcBlob> pSignature;
+      CComPtr<IDxcBlobEncoding> pErrorBlob;
+      if (ParseHLSLRootSignature(rootSigStr.data(), rootSigStr.size(),
+                                 rootSigVer,
+                                 DxilRootSignatureCompilationFlags::None,
+                                 &pDesc, errorStream)) {
+        SerializeRootSignature(pDesc, &pSignature, &pErrorBlob, false);
+        if (pSignature == nullptr)
+          DeleteRootSignature(pDesc);
+      }
+      if (pSignature == nullptr) {
+        if (pErrorBlob == nullptr) {
+          errorStream.flush();
+          if (errors.empty())
+            errors = "unexpected";
+          errors = "root signature error - " + errors;
+          IFT(DxcCreateBlobWithEncodingOnHeapCopy(
+              errors.c_str(), errors.size(), CP_UTF8, &pErrorBlob));
+        }
+        return DxcOperationResult::CreateFromResultErrorStatus(
+            nullptr, pErrorBlob, E_FAIL, ppResult);
+      }
+
+      RootSignatureHandle rootSigHandle;
+      rootSigHandle.Assign(pDesc, pSignature);
+      CComPtr<AbstractMemoryStream> pContainerStream;
+      IFT(CreateMemoryStream(m_pMalloc, &pContainerStream));
+      SerializeDxilContainerForRootSignature(&rootSigHandle, pContainerStream);
+      CComPtr<IDxcBlob> pContainer;
+      IFT(pContainerStream.QueryInterface(&pContainer));
+
+      // Validate and sign the container in place, as the rootsig_1_x profiles
+      // do.
+      CComPtr<IDxcBlobEncoding> pValErrors;
+      if (FAILED(dxcutil::ValidateRootSignatureInContainer(
+              pContainer, nullptr, &pValErrors)))
+        return DxcOperationResult::CreateFromResultErrorStatus(
+            nullptr, pValErrors, E_FAIL, ppResult);
+
+      {
+        // Another thread may have compiled the same root signature meanwhile;
+        // keep handing out the first blob.
+        std::lock_guard<std::mutex> lock(m_rootSigCacheMutex);
+        auto it = m_rootSigCache.find(key);
+        if (it != m_rootSigCache.end()) {
+          pContainer = it->second;
+        } else {
+          // Root signatures are usually few and reused; when an application
+          // cycles through many, drop an arbitrary one to make room.
+          if (m_rootSigCache.size() >= kRootSigCacheSize)
+            m_rootSigCache.erase(m_rootSigCache.begin());
+          m_rootSigCache.insert(std::make_pair(std::move(key), pContainer));
+        }
+      }
+      IFT(DxcOperationResult::CreateFromResultErrorStatus(pContainer, nullptr,
+                                                          S_OK, ppResult));
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+    return hr;
+  }
+
   void SetupCompilerForCompile(CompilerInstance &compiler,
                                _In_ DxcLangExtensionsHelper *helper,
                                _In_ LPCSTR pMainFile, _In_ TextDiagnosticPrinter *diagPrinter,
@@ -1111,6 +1673,9 @@ public:
 
     compiler.getCodeGenOpts().HLSLHighLevel = Opts.CodeGenHighLevel;
     compiler.getCodeGenOpts().HLSLResMayAlias = Opts.ResMayAlias;
+    // The optimized module is the same, so printing the passes stays serial.
+    if (Opts.IsLibraryProfile() && !Opts.OptDump)
+      compiler.getCodeGenOpts().HLSLLibThreads = Opts.LibThreads;
     compiler.getCodeGenOpts().HLSLAllResourcesBound = Opts.AllResourcesBound;
     compiler.getCodeGenOpts().HLSLDefaultRowMajor = Opts.DefaultRowMajor;
     compiler.getCodeGenOpts().HLSLPreferControlFlow = Opts.PreferFlowControl;
@@ -48,11 +48,23 @@ public:
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
 
+  // Parts from the loaded container refer to its data in place; only added
+  // parts hold a blob.
   class DxilPart {
   public:
     UINT32 m_fourCC;
+    const void *m_pData;
+    UINT32 m_Size;
     CComPtr<IDxcBlob> m_Blob;
-    DxilPart(UINT32 fourCC, IDxcBlob *pSource) : m_fourCC(fourCC), m_Blob(pSource) {}
+    DxilPart(UINT32 fourCC, const void *pData, UINT32 size)
+        : m_fourCC(fourCC), m_pData(pData), m_Size(size) {}
+    DxilPart(UINT32 fourCC, IDxcBlob *pSource)
+        : m_fourCC(fourCC), m_pData(pSource->GetBufferPointer()),
+          m_Size((UINT32)pSource->GetBufferSize()), m_Blob(pSource) {}
+    // The part header precedes the data of loaded parts.
+    const DxilPartHeader *GetLoadedHeader() const {
+      return m_Blob ? nullptr : (const DxilPartHeader *)m_pData - 1;
+    }
   };
   typedef llvm::SmallVector<DxilPart, 8> PartList;
 
@@ -65,6 +77,7 @@ private:
   HRESULT UpdateContainerHeader(AbstractMemoryStream *pStream, uint32_t containerSize);
   HRESULT UpdateOffsetTable(AbstractMemoryStream *pStream);
   HRESULT UpdateParts(AbstractMemoryStream *pStream);
+  bool IsUnchanged(const void *pHeaderAndOffsets, size_t size);
 };
 
 HRESULT STDMETHODCALLTYPE DxcContainerBuilder::Load(_In_ IDxcBlob *pSource) {
@@ -76,15 +89,14 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::Load(_In_ IDxcBlob *pSource) {
       E_INVALIDARG);
     m_pContainer = pSource;
     const DxilContainerHeader *pHeader = (DxilContainerHeader *)pSource->GetBufferPointer();
+    m_parts.reserve(pHeader->PartCount);
     for (DxilPartIterator it = begin(pHeader), itEnd = end(pHeader); it != itEnd; ++it) {
       const DxilPartHeader *pPartHeader = *it;
-      CComPtr<IDxcBlobEncoding> pBlob;
-      IFT(DxcCreateBlobWithEncodingFromPinned((const void *)(pPartHeader + 1), pPartHeader->PartSize, CP_UTF8, &pBlob));
-      PartList::iterator itPartList = std::find_if(m_parts.begin(), m_parts.end(), [&](DxilPart part) {
+      PartList::iterator itPartList = std::find_if(m_parts.begin(), m_parts.end(), [&](const DxilPart &part) {
         return part.m_fourCC == pPartHeader->PartFourCC;
       });
       IFTBOOL(itPartList == m_parts.end(), DXC_E_DUPLICATE_PART);
-      m_parts.emplace_back(DxilPart(pPartHeader->PartFourCC, pBlob));
+      m_parts.emplace_back(DxilPart(pPartHeader->PartFourCC, pPartHeader + 1, pPartHeader->PartSize));
     }
     return S_OK;
   }
@@ -104,7 +116,7 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::AddPart(_In_ UINT32 fourCC, _In_
         fourCC == DxilFourCC::DFCC_ShaderDebugName ||
         fourCC == DxilFourCC::DFCC_PrivateData, 
       E_INVALIDARG);
-    PartList::iterator it = std::find_if(m_parts.begin(), m_parts.end(), [&](DxilPart part) {
+    PartList::iterator it = std::find_if(m_parts.begin(), m_parts.end(), [&](const DxilPart &part) {
       return part.m_fourCC == fourCC;
     });
     IFTBOOL(it == m_parts.end(), DXC_E_DUPLICATE_PART);
@@ -124,12 +136,16 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::RemovePart(_In_ UINT32 fourCC) {
                 fourCC == DxilFourCC::DFCC_ShaderDebugName ||
                 fourCC == DxilFourCC::DFCC_RootSignature ||
                 fourCC == DxilFourCC::DFCC_PrivateData ||
-                fourCC == DxilFourCC::DFCC_ShaderStatistics,
+                fourCC == DxilFourCC::DFCC_ShaderStatistics ||
+                fourCC == DxilFourCC::DFCC_ShaderCost,
             E_INVALIDARG); // You can only remove debug info, debug info name, rootsignature, or private data blob
     PartList::iterator it =
       std::find_if(m_parts.begin(), m_parts.end(),
-        [&](DxilPart part) { return part.m_fourCC == fourCC; });
+        [&](const DxilPart &part) { return part.m_fourCC == fourCC; });
     IFTBOOL(it != m_parts.end(), DXC_E_MISSING_PART);
+    // A root signature that was added and removed again needs no validation.
+    if (fourCC == DxilFourCC::DFCC_RootSignature && it->m_Blob)
+      m_RequireValidation = false;
     m_parts.erase(it);
     return S_OK;
   }
@@ -152,9 +168,15 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
 
     // Update offset Table
     IFT(UpdateOffsetTable(pMemoryStream));
-    
-    // Update Parts
-    IFT(UpdateParts(pMemoryStream));
+
+    // If the loaded container would be rebuilt as is, return it instead.
+    if (IsUnchanged(pMemoryStream->GetPtr(), pMemoryStream->GetPtrSize()) &&
+        m_pContainer->GetBufferSize() == ContainerSize) {
+      pResult = m_pContainer;
+    } else {
+      // Update Parts
+      IFT(UpdateParts(pMemoryStream));
+    }
 
     CComPtr<IDxcBlobEncoding> pErrorBlob;
     HRESULT valHR = S_OK;
@@ -194,8 +216,8 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
 
 UINT32 DxcContainerBuilder::ComputeContainerSize() {
   UINT32 partsSize = 0;
-  for (DxilPart part : m_parts) {
-    partsSize += part.m_Blob->GetBufferSize();
+  for (const DxilPart &part : m_parts) {
+    partsSize += part.m_Size;
   }
   return GetDxilContainerSizeFromParts(m_parts.size(), partsSize);
 }
@@ -217,26 +239,52 @@ HRESULT DxcContainerBuilder::UpdateOffsetTable(AbstractMemoryStream *pStream) {
     ULONG cbWritten;
     IFR(pStream->Write(&offset, sizeof(UINT32), &cbWritten));
     if (cbWritten != sizeof(UINT32)) { return E_FAIL; }
-    offset += sizeof(DxilPartHeader) + m_parts[i].m_Blob->GetBufferSize();
+    offset += sizeof(DxilPartHeader) + m_parts[i].m_Size;
   }
   return S_OK;
 }
 
 HRESULT DxcContainerBuilder::UpdateParts(AbstractMemoryStream *pStream) {
-  for (size_t i = 0; i < m_parts.size(); ++i) {
+  for (size_t i = 0; i < m_parts.size();) {
     ULONG cbWritten;
-    CComPtr<IDxcBlob> pBlob = m_parts[i].m_Blob;
+    // Loaded parts that are still adjacent in the loaded container are
+    // copied with their headers in one write.
+    if (const DxilPartHeader *pFirst = m_parts[i].GetLoadedHeader()) {
+      const char *pEnd = (const char *)m_parts[i].m_pData + m_parts[i].m_Size;
+      for (++i; i < m_parts.size() &&
+                m_parts[i].GetLoadedHeader() == (const DxilPartHeader *)pEnd;
+           ++i)
+        pEnd = (const char *)m_parts[i].m_pData + m_parts[i].m_Size;
+      ULONG size = (ULONG)(pEnd - (const char *)pFirst);
+      IFR(pStream->Write(pFirst, size, &cbWritten));
+      if (cbWritten != size) { return E_FAIL; }
+      continue;
+    }
+    const DxilPart &part = m_parts[i++];
     // Write part header
-    DxilPartHeader partHeader = { m_parts[i].m_fourCC, (uint32_t) pBlob->GetBufferSize() };
+    DxilPartHeader partHeader = { part.m_fourCC, part.m_Size };
     IFR(pStream->Write(&partHeader, sizeof(DxilPartHeader), &cbWritten));
     if (cbWritten != sizeof(DxilPartHeader)) { return E_FAIL; }
     // Write part content
-    IFR(pStream->Write(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &cbWritten));
-    if (cbWritten != pBlob->GetBufferSize()) { return E_FAIL; }
+    IFR(pStream->Write(part.m_pData, part.m_Size, &cbWritten));
+    if (cbWritten != part.m_Size) { return E_FAIL; }
   }
   return S_OK;
 }
 
+// Whether the loaded container starts with the given header and offset table,
+// and so has the same parts in the same places.
+bool DxcContainerBuilder::IsUnchanged(const void *pHeaderAndOffsets,
+                                      size_t size) {
+  if (m_pContainer == nullptr || m_pContainer->GetBufferSize() < size)
+    return false;
+  for (const DxilPart &part : m_parts) {
+    if (part.m_Blob)
+      return false;
+  }
+  return memcmp(m_pContainer->GetBufferPointer(), pHeaderAndOffsets, size) == 0;
+}
+
 HRESULT CreateDxcContainerBuilder(_In_ REFIID riid, _Out_ LPVOID *ppv) {
   // Call dxil.dll's containerbuilder 
   *ppv = nullptr;
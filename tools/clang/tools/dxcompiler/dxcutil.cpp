@@ -268,7 +268,8 @@ HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs) {
 }
 
 HRESULT ValidateRootSignatureInContainer(
-    IDxcBlob *pRootSigContainer, clang::DiagnosticsEngine *pDiag) {
+    IDxcBlob *pRootSigContainer, clang::DiagnosticsEngine *pDiag,
+    IDxcBlobEncoding **ppErrors) {
   HRESULT valHR = S_OK;
   CComPtr<IDxcValidator> pValidator;
   CComPtr<IDxcOperationResult> pValResult;
@@ -295,6 +296,8 @@ HRESULT ValidateRootSignatureInContainer(
       pDiag->Report(DiagID) << errRef;
     }
   }
+  if (ppErrors && FAILED(valHR))
+    IFT(pValResult->GetErrorBuffer(ppErrors));
   return valHR;
 }
 
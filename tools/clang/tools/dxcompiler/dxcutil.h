@@ -62,7 +62,8 @@ struct AssembleInputs {
 
 HRESULT ValidateAndAssembleToContainer(AssembleInputs &inputs);
 HRESULT ValidateRootSignatureInContainer(
-    IDxcBlob *pRootSigContainer, clang::DiagnosticsEngine *pDiag = nullptr);
+    IDxcBlob *pRootSigContainer, clang::DiagnosticsEngine *pDiag = nullptr,
+    IDxcBlobEncoding **ppErrors = nullptr);
 void GetValidatorVersion(unsigned *pMajor, unsigned *pMinor);
 void AssembleToContainer(AssembleInputs &inputs);
 HRESULT Disassemble(IDxcBlob *pProgram, llvm::raw_string_ostream &Stream);
@@ -30,9 +30,13 @@
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/Support/Global.h"
 #include "dxcisenseimpl.h"
+#include "CXTranslationUnit.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MSFileSystem.h"
 
+#include <chrono>
+
 ///////////////////////////////////////////////////////////////////////////////
 
 HRESULT CreateDxcIntelliSense(_In_ REFIID riid, _Out_ LPVOID* ppv) throw()
@@ -221,6 +225,36 @@ void CleanupUnsavedFiles(
   delete[] files;
 }
 
+// Hashes the names and contents of unsaved files, so a reparse with the same
+// files can be detected.
+static
+std::string HashUnsavedFiles(
+  _In_count_(file_count) CXUnsavedFile * files,
+  unsigned file_count)
+{
+  llvm::MD5 md5;
+  for (unsigned i = 0; i < file_count; ++i)
+  {
+    llvm::StringRef name(files[i].Filename);
+    md5.update(llvm::ArrayRef<uint8_t>((const uint8_t *)name.data(), name.size() + 1));
+    uint64_t length = files[i].Length;
+    md5.update(llvm::ArrayRef<uint8_t>((const uint8_t *)&length, sizeof(length)));
+    md5.update(llvm::ArrayRef<uint8_t>((const uint8_t *)files[i].Contents, files[i].Length));
+  }
+  llvm::MD5::MD5Result result;
+  md5.final(result);
+  llvm::SmallString<32> hash;
+  llvm::MD5::stringifyResult(result, hash);
+  return hash.str();
+}
+
+static
+double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
 static
 HRESULT CoTaskMemAllocString(_In_z_ const char* src, _Outptr_ LPSTR* pResult) throw()
 {
@@ -1094,6 +1128,7 @@ HRESULT DxcInclusion::GetStackItem(unsigned index, _Outptr_result_nullonfailure_
 DxcIndex::DxcIndex() : m_index(0), m_options(DxcGlobalOpt_None)
 {
   m_pMalloc = DxcGetThreadMallocNoRef();
+  memset(m_latency, 0, sizeof(m_latency));
 }
 
 DxcIndex::~DxcIndex()
@@ -1148,6 +1183,40 @@ HRESULT DxcIndex::GetGlobalOptions(_Out_ DxcGlobalOptions* options)
   return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT DxcIndex::GetLatency(DxcIntelliSenseOperation operation, DxcIntelliSenseLatency* pResult)
+{
+  if (pResult == nullptr) return E_POINTER;
+  if ((unsigned)operation >= DxcIntelliSenseOperation_Count) return E_INVALIDARG;
+  std::lock_guard<std::mutex> lock(m_latencyLock);
+  *pResult = m_latency[operation];
+  return S_OK;
+}
+
+HRESULT DxcIndex::ResetLatency()
+{
+  std::lock_guard<std::mutex> lock(m_latencyLock);
+  memset(m_latency, 0, sizeof(m_latency));
+  return S_OK;
+}
+
+void DxcIndex::RecordLatency(DxcIntelliSenseOperation operation, double milliseconds)
+{
+  std::lock_guard<std::mutex> lock(m_latencyLock);
+  DxcIntelliSenseLatency &latency = m_latency[operation];
+  ++latency.Count;
+  latency.LastMilliseconds = milliseconds;
+  latency.TotalMilliseconds += milliseconds;
+  if (milliseconds > latency.MaxMilliseconds)
+    latency.MaxMilliseconds = milliseconds;
+}
+
+void DxcIndex::RecordSkippedReparse()
+{
+  std::lock_guard<std::mutex> lock(m_latencyLock);
+  ++m_latency[DxcIntelliSenseOperation_Reparse].SkippedCount;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 _Use_decl_annotations_
@@ -1180,9 +1249,12 @@ HRESULT DxcIndex::ParseTranslationUnit(
 
     ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
     IFTLLVM(pts.error_code());
+    std::string unsavedFilesHash = HashUnsavedFiles(files, num_unsaved_files);
+    auto start = std::chrono::steady_clock::now();
     CXTranslationUnit tu = clang_parseTranslationUnit(m_index, source_filename,
       command_line_args, num_command_line_args,
       files, num_unsaved_files, options);
+    RecordLatency(DxcIntelliSenseOperation_Parse, MillisecondsSince(start));
     CleanupUnsavedFiles(files, num_unsaved_files);
     if (tu == nullptr)
     {
@@ -1195,7 +1267,7 @@ HRESULT DxcIndex::ParseTranslationUnit(
       clang_disposeTranslationUnit(tu);
       return E_OUTOFMEMORY;
     }
-    localTU->Initialize(tu);
+    localTU->Initialize(tu, this, unsavedFilesHash);
     *pTranslationUnit = localTU.Detach();
 
     return S_OK;
@@ -1534,9 +1606,46 @@ DxcTranslationUnit::~DxcTranslationUnit() {
   }
 }
 
-void DxcTranslationUnit::Initialize(CXTranslationUnit tu)
+void DxcTranslationUnit::Initialize(CXTranslationUnit tu, DxcIndex *index,
+                                    const std::string &unsavedFilesHash)
 {
   m_tu = tu;
+  m_index = index;
+  m_unsavedFilesHash = unsavedFilesHash;
+}
+
+bool DxcTranslationUnit::NeedsReparse(const std::string &unsavedFilesHash)
+{
+  if (unsavedFilesHash != m_unsavedFilesHash)
+    return true;
+
+  // Errors such as missing includes may be fixed by files that weren't read.
+  unsigned numDiagnostics = clang_getNumDiagnostics(m_tu);
+  for (unsigned i = 0; i < numDiagnostics; ++i) {
+    CXDiagnostic diag = clang_getDiagnostic(m_tu, i);
+    CXDiagnosticSeverity severity = clang_getDiagnosticSeverity(diag);
+    clang_disposeDiagnostic(diag);
+    if (severity >= CXDiagnostic_Error)
+      return true;
+  }
+
+  // Files read from disk must be unchanged since they were read.
+  clang::ASTUnit *unit = clang::cxtu::getASTUnit(m_tu);
+  if (unit == nullptr)
+    return true;
+  clang::SourceManager &SM = unit->getSourceManager();
+  for (auto it = SM.fileinfo_begin(), end = SM.fileinfo_end(); it != end; ++it) {
+    const clang::FileEntry *FE = it->first;
+    if (SM.isFileOverridden(FE))
+      continue;
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(FE->getName(), status))
+      return true;
+    if ((off_t)status.getSize() != FE->getSize() ||
+        status.getLastModificationTime().toEpochTime() != FE->getModificationTime())
+      return true;
+  }
+  return false;
 }
 
 _Use_decl_annotations_
@@ -1668,10 +1777,36 @@ HRESULT DxcTranslationUnit::Reparse(
   DxcThreadMalloc TM(m_pMalloc);
   hr = SetupUnsavedFiles(unsaved_files, num_unsaved_files, &local_unsaved_files);
   if (FAILED(hr)) return hr;
-  int reparseResult = clang_reparseTranslationUnit(
-    m_tu, num_unsaved_files, local_unsaved_files, clang_defaultReparseOptions(m_tu));
+
+  try
+  {
+    // TODO: until an interface to file access is defined and implemented, simply fall back to pure Win32/CRT calls.
+    ::llvm::sys::fs::MSFileSystem* msfPtr;
+    IFT(CreateMSFileSystemForDisk(&msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    // Editors reparse on idle; when nothing changed, the last results stand.
+    std::string unsavedFilesHash = HashUnsavedFiles(local_unsaved_files, num_unsaved_files);
+    if (!NeedsReparse(unsavedFilesHash))
+    {
+      m_index->RecordSkippedReparse();
+    }
+    else
+    {
+      auto start = std::chrono::steady_clock::now();
+      int reparseResult = clang_reparseTranslationUnit(
+        m_tu, num_unsaved_files, local_unsaved_files, clang_defaultReparseOptions(m_tu));
+      m_index->RecordLatency(DxcIntelliSenseOperation_Reparse, MillisecondsSince(start));
+      m_unsavedFilesHash = reparseResult == 0 ? unsavedFilesHash : std::string();
+      hr = reparseResult == 0 ? S_OK : E_FAIL;
+    }
+  }
+  CATCH_CPP_ASSIGN_HRESULT();
   CleanupUnsavedFiles(local_unsaved_files, num_unsaved_files);
-  return reparseResult == 0 ? S_OK : E_FAIL;
+  return hr;
 }
 
 _Use_decl_annotations_
@@ -1858,8 +1993,10 @@ HRESULT DxcTranslationUnit::CodeCompleteAt(
   if (FAILED(hr))
     return hr;
 
+  auto start = std::chrono::steady_clock::now();
   CXCodeCompleteResults *results = clang_codeCompleteAt(
       m_tu, fileName, line, column, files, numUnsavedFiles, options);
+  m_index->RecordLatency(DxcIntelliSenseOperation_CodeComplete, MillisecondsSince(start));
 
   CleanupUnsavedFiles(files, numUnsavedFiles);
 
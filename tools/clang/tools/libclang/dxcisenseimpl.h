@@ -18,6 +18,9 @@
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
 
+#include <mutex>
+#include <string>
+
 // Forward declarations.
 class DxcCursor;
 class DxcDiagnostic;
@@ -157,18 +160,20 @@ public:
   HRESULT STDMETHODCALLTYPE GetStackItem(unsigned index, _Outptr_result_nullonfailure_ IDxcSourceLocation **pResult) override;
 };
 
-class DxcIndex : public IDxcIndex
+class DxcIndex : public IDxcIndex2
 {
 private:
     DXC_MICROCOM_TM_REF_FIELDS()
     CXIndex m_index;
     DxcGlobalOptions m_options;
     hlsl::DxcLangExtensionsHelper m_langHelper;
+    std::mutex m_latencyLock;
+    DxcIntelliSenseLatency m_latency[DxcIntelliSenseOperation_Count];
 public:
     DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override
     {
-      return DoBasicQueryInterface<IDxcIndex>(this, iid, ppvObject);
+      return DoBasicQueryInterface<IDxcIndex, IDxcIndex2>(this, iid, ppvObject);
     }
 
     DxcIndex();
@@ -186,6 +191,16 @@ public:
       unsigned num_unsaved_files,
       DxcTranslationUnitFlags options,
       _Outptr_result_nullonfailure_ IDxcTranslationUnit** pTranslationUnit) override;
+
+    HRESULT STDMETHODCALLTYPE GetLatency(
+      DxcIntelliSenseOperation operation,
+      _Out_ DxcIntelliSenseLatency* pResult) override;
+    HRESULT STDMETHODCALLTYPE ResetLatency() override;
+
+    // Records an operation on a translation unit parsed by this index.
+    void RecordLatency(DxcIntelliSenseOperation operation, double milliseconds);
+    // Records a reparse skipped because none of its inputs changed.
+    void RecordSkippedReparse();
 };
 
 class DxcIntelliSense : public IDxcIntelliSense, public IDxcLangExtensions {
@@ -303,6 +318,12 @@ class DxcTranslationUnit : public IDxcTranslationUnit
 private:
     DXC_MICROCOM_TM_REF_FIELDS()
     CXTranslationUnit m_tu;
+    CComPtr<DxcIndex> m_index;
+    // Hash of the unsaved files of the last parse.
+    std::string m_unsavedFilesHash;
+
+    // Whether parsing again with the given unsaved files may change the results.
+    bool NeedsReparse(const std::string &unsavedFilesHash);
 public:
     DXC_MICROCOM_TM_ADDREF_RELEASE_IMPL()
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject) override
@@ -312,7 +333,8 @@ public:
 
     DxcTranslationUnit();
     ~DxcTranslationUnit();
-    void Initialize(CXTranslationUnit tu);
+    void Initialize(CXTranslationUnit tu, DxcIndex *index,
+                    const std::string &unsavedFilesHash);
 
     HRESULT STDMETHODCALLTYPE GetCursor(_Outptr_ IDxcCursor** pCursor) override;
     HRESULT STDMETHODCALLTYPE Tokenize(
@@ -43,6 +43,9 @@
 #include "dxc/Support/dxcfilesystem.h"
 #include "dxc/Support/HLSLOptions.h"
 
+#include <atomic>
+#include <thread>
+
 #define CP_UTF16 1200
 
 using namespace llvm;
@@ -357,6 +360,121 @@ HRESULT ReadOptsAndValidate(LPCWSTR *pArguments, _In_ UINT32 argCount,
 }
 
 
+// Globals that are not in cbuffers and functions with bodies, which are
+// removed unless an entry point uses them.
+struct UnusedCandidates {
+  SmallPtrSet<VarDecl*, 128> Globals;
+  SmallPtrSet<FunctionDecl*, 128> Functions;
+  DenseMap<RecordDecl*, unsigned> AnonymousRecordRefCounts;
+};
+
+static
+void CollectUnusedCandidates(TranslationUnitDecl *tu, UnusedCandidates &candidates) {
+  for (Decl *tuDecl : tu->decls()) {
+    if (tuDecl->isImplicit()) continue;
+
+    VarDecl* varDecl = dyn_cast_or_null<VarDecl>(tuDecl);
+    if (varDecl != nullptr && varDecl->getFormalLinkage() == clang::Linkage::InternalLinkage) {
+      candidates.Globals.insert(varDecl);
+      if (const RecordType *recordType = varDecl->getType()->getAs<RecordType>()) {
+        RecordDecl *recordDecl = recordType->getDecl();
+        if (recordDecl && recordDecl->getName().empty()) {
+          candidates.AnonymousRecordRefCounts[recordDecl]++; // Zero initialized if non-existing
+        }
+      }
+      continue;
+    }
+
+    FunctionDecl* fnDecl = dyn_cast_or_null<FunctionDecl>(tuDecl);
+    if (fnDecl != nullptr) {
+      if (fnDecl->doesThisDeclarationHaveABody()) {
+        candidates.Functions.insert(fnDecl);
+      }
+    }
+  }
+}
+
+// Traverses the functions reachable from the entry point, removing the globals
+// they reference from unusedGlobals. With stopWhenAllUsed, stops early once no
+// globals are left, as the entry point alone removes nothing then; the
+// visited functions are incomplete, so they can't be combined with others.
+static
+void CollectReachable(FunctionDecl *entryFnDecl,
+                      SmallPtrSetImpl<VarDecl*> &unusedGlobals,
+                      SmallPtrSetImpl<FunctionDecl*> &visitedFunctions,
+                      bool stopWhenAllUsed) {
+  SmallVector<FunctionDecl*, 32> pendingFunctions;
+  VarReferenceVisitor visitor(unusedGlobals, visitedFunctions, pendingFunctions);
+  pendingFunctions.push_back(entryFnDecl);
+  while (!pendingFunctions.empty() &&
+         !(stopWhenAllUsed && unusedGlobals.empty())) {
+    FunctionDecl* pendingDecl = pendingFunctions.pop_back_val();
+    if (!visitedFunctions.insert(pendingDecl).second)
+      continue; // Called from several places before being visited.
+    visitor.TraverseDecl(pendingDecl);
+  }
+}
+
+// Writes the translation unit without the unused globals and the functions
+// that weren't visited. These are skipped when printing rather than removed
+// from the AST, so one parse can be written for several entry points.
+static
+void WriteUnusedRemoved(CompilerInstance &compiler,
+                        _In_ DxcLangExtensionsHelper *pHelper,
+                        const UnusedCandidates &candidates,
+                        const SmallPtrSetImpl<VarDecl*> &unusedGlobals,
+                        const SmallPtrSetImpl<FunctionDecl*> &visitedFunctions,
+                        raw_string_ostream &o, raw_string_ostream &w) {
+  ASTContext& C = compiler.getASTContext();
+
+  // Don't bother doing work if there are no globals to remove.
+  if (unusedGlobals.empty()) {
+    w << "//no unused globals found - no work to be done\n";
+    StringRef contents = C.getSourceManager().getBufferData(C.getSourceManager().getMainFileID());
+    o << contents;
+    return;
+  }
+  w << "//found " << unusedGlobals.size() << " globals to remove\n";
+
+  // Don't remove visited functions.
+  SmallPtrSet<const Decl*, 128> removedDecls;
+  for (FunctionDecl *unusedFn : candidates.Functions) {
+    if (!visitedFunctions.count(unusedFn))
+      removedDecls.insert(unusedFn);
+  }
+  w << "//found " << removedDecls.size() << " functions to remove\n";
+
+  // Remove all unused variables and functions.
+  DenseMap<RecordDecl*, unsigned> anonymousRecordRefCounts(candidates.AnonymousRecordRefCounts);
+  for (VarDecl *unusedGlobal : unusedGlobals) {
+    if (const RecordType *recordTy = unusedGlobal->getType()->getAs<RecordType>()) {
+      RecordDecl *recordDecl = recordTy->getDecl();
+      if (recordDecl && recordDecl->getName().empty()) {
+        // Anonymous structs can only be referenced by the variable they declare.
+        // If we've removed all declared variables of such a struct, remove it too,
+        // because anonymous structs without variable declarations in global scope are illegal.
+        auto recordRefCountIter = anonymousRecordRefCounts.find(recordDecl);
+        DXASSERT_NOMSG(recordRefCountIter != anonymousRecordRefCounts.end() && recordRefCountIter->second > 0);
+        recordRefCountIter->second--;
+        if (recordRefCountIter->second == 0) {
+          removedDecls.insert(recordDecl);
+          anonymousRecordRefCounts.erase(recordRefCountIter);
+        }
+      }
+    }
+
+    removedDecls.insert(unusedGlobal);
+  }
+
+  o << "// Rewrite unused globals result:\n";
+  PrintingPolicy p = PrintingPolicy(C.getPrintingPolicy());
+  p.Indentation = 1;
+  p.SkippedDecls = &removedDecls;
+  C.getTranslationUnitDecl()->print(o, p);
+
+  WriteSemanticDefines(compiler, pHelper, o);
+}
+
 static
 HRESULT DoRewriteUnused(_In_ DxcLangExtensionsHelper *pHelper,
                      _In_ LPCSTR pFileName,
@@ -387,34 +505,11 @@ HRESULT DoRewriteUnused(_In_ DxcLangExtensionsHelper *pHelper,
   TranslationUnitDecl *tu = C.getTranslationUnitDecl();
 
   // Gather all global variables that are not in cbuffers and all functions.
-  SmallPtrSet<VarDecl*, 128> unusedGlobals;
-  DenseMap<RecordDecl*, unsigned> anonymousRecordRefCounts;
-  SmallPtrSet<FunctionDecl*, 128> unusedFunctions;
-  for (Decl *tuDecl : tu->decls()) {
-    if (tuDecl->isImplicit()) continue;
+  UnusedCandidates candidates;
+  CollectUnusedCandidates(tu, candidates);
 
-    VarDecl* varDecl = dyn_cast_or_null<VarDecl>(tuDecl);
-    if (varDecl != nullptr && varDecl->getFormalLinkage() == clang::Linkage::InternalLinkage) {
-      unusedGlobals.insert(varDecl);
-      if (const RecordType *recordType = varDecl->getType()->getAs<RecordType>()) {
-        RecordDecl *recordDecl = recordType->getDecl();
-        if (recordDecl && recordDecl->getName().empty()) {
-          anonymousRecordRefCounts[recordDecl]++; // Zero initialized if non-existing
-        }
-      }
-      continue;
-    }
-
-    FunctionDecl* fnDecl = dyn_cast_or_null<FunctionDecl>(tuDecl);
-    if (fnDecl != nullptr) {
-      if (fnDecl->doesThisDeclarationHaveABody()) {
-        unusedFunctions.insert(fnDecl);
-      }
-    }
-  }
-
-  w << "//found " << unusedGlobals.size() << " globals as candidates for removal\n";
-  w << "//found " << unusedFunctions.size() << " functions as candidates for removal\n";
+  w << "//found " << candidates.Globals.size() << " globals as candidates for removal\n";
+  w << "//found " << candidates.Functions.size() << " functions as candidates for removal\n";
 
   DeclContext::lookup_result l = tu->lookup(DeclarationName(&C.Idents.get(StringRef(pEntryPoint))));
   if (l.empty()) {
@@ -429,63 +524,158 @@ HRESULT DoRewriteUnused(_In_ DxcLangExtensionsHelper *pHelper,
     }
     else {
       // Traverse reachable functions and variables.
+      SmallPtrSet<VarDecl*, 128> unusedGlobals(candidates.Globals.begin(), candidates.Globals.end());
       SmallPtrSet<FunctionDecl*, 128> visitedFunctions;
-      SmallVector<FunctionDecl*, 32> pendingFunctions;
-      VarReferenceVisitor visitor(unusedGlobals, visitedFunctions, pendingFunctions);
-      pendingFunctions.push_back(entryFnDecl);
-      while (!pendingFunctions.empty() && !unusedGlobals.empty()) {
-        FunctionDecl* pendingDecl = pendingFunctions.pop_back_val();
-        visitedFunctions.insert(pendingDecl);
-        visitor.TraverseDecl(pendingDecl);
-      }
+      CollectReachable(entryFnDecl, unusedGlobals, visitedFunctions,
+                       /*stopWhenAllUsed*/ true);
+      WriteUnusedRemoved(compiler, pHelper, candidates, unusedGlobals, visitedFunctions, o, w);
+    }
+  }
 
-      // Don't bother doing work if there are no globals to remove.
-      if (unusedGlobals.empty()) {
-        w << "//no unused globals found - no work to be done\n";
-        StringRef contents = C.getSourceManager().getBufferData(C.getSourceManager().getMainFileID());
-        o << contents;
-      }
-      else {
-        w << "//found " << unusedGlobals.size() << " globals to remove\n";
+  // Flush and return results.
+  o.flush();
+  w.flush();
 
-        // Don't remove visited functions.
-        for (FunctionDecl *visitedFn : visitedFunctions) {
-          unusedFunctions.erase(visitedFn);
-        }
-        w << "//found " << unusedFunctions.size() << " functions to remove\n";
-
-        // Remove all unused variables and functions.
-        for (VarDecl *unusedGlobal : unusedGlobals) {
-          if (const RecordType *recordTy = unusedGlobal->getType()->getAs<RecordType>()) {
-            RecordDecl *recordDecl = recordTy->getDecl();
-            if (recordDecl && recordDecl->getName().empty()) {
-              // Anonymous structs can only be referenced by the variable they declare.
-              // If we've removed all declared variables of such a struct, remove it too,
-              // because anonymous structs without variable declarations in global scope are illegal.
-              auto recordRefCountIter = anonymousRecordRefCounts.find(recordDecl);
-              DXASSERT_NOMSG(recordRefCountIter != anonymousRecordRefCounts.end() && recordRefCountIter->second > 0);
-              recordRefCountIter->second--;
-              if (recordRefCountIter->second == 0) {
-                tu->removeDecl(recordDecl);
-                anonymousRecordRefCounts.erase(recordRefCountIter);
-              }
-            }
-          }
-
-          tu->removeDecl(unusedGlobal);
-        }
+  if (compiler.getDiagnosticClient().getNumErrors() > 0)
+    return E_FAIL;
+  return S_OK;
+}
 
-        for (FunctionDecl *unusedFn : unusedFunctions) {
-          tu->removeDecl(unusedFn);
-        }
+// An entry point of DoRewriteUnusedForEntryPoints, with what it reaches.
+struct EntryPointRewrite {
+  std::string EntryPoint;
+  NamedDecl *EntryDecl = nullptr;
+  FunctionDecl *EntryFnDecl = nullptr;
+  SmallPtrSet<VarDecl*, 128> UnusedGlobals;
+  SmallPtrSet<FunctionDecl*, 128> VisitedFunctions;
+  HRESULT hr = S_OK;
+  std::string Warnings;
+  std::string Result;
+};
+
+// Like DoRewriteUnused, but keeps what any of the entry points use, with one
+// parse for all of them. The traversals for each entry point run on separate
+// threads. With writeEntryPoints, each entry point also gets the source with
+// only what it uses.
+static
+HRESULT DoRewriteUnusedForEntryPoints(_In_ IMalloc *pMalloc,
+                                      _In_ DxcLangExtensionsHelper *pHelper,
+                                      _In_ LPCSTR pFileName,
+                                      _In_ ASTUnit::RemappedFile *pRemap,
+                                      std::vector<EntryPointRewrite> &entries,
+                                      bool writeEntryPoints,
+                                      _In_ LPCSTR pDefines,
+                                      std::string &warnings,
+                                      std::string &result) {
+
+  raw_string_ostream o(result);
+  raw_string_ostream w(warnings);
+
+  // Setup a compiler instance.
+  CompilerInstance compiler;
+  std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
+      llvm::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
+
+  hlsl::options::DxcOpts opts;
+  opts.HLSLVersion = 2015;
+
+  SetupCompilerForRewrite(compiler, pHelper, pFileName, diagPrinter.get(), pRemap, opts, pDefines);
+
+  // Parse the source file.
+  compiler.getDiagnosticClient().BeginSourceFile(compiler.getLangOpts(), &compiler.getPreprocessor());
+  ParseAST(compiler.getSema(), false, false);
+
+  ASTContext& C = compiler.getASTContext();
+  TranslationUnitDecl *tu = C.getTranslationUnitDecl();
 
-        o << "// Rewrite unused globals result:\n";
-        PrintingPolicy p = PrintingPolicy(C.getPrintingPolicy());
-        p.Indentation = 1;
-        tu->print(o, p);
+  UnusedCandidates candidates;
+  CollectUnusedCandidates(tu, candidates);
+
+  w << "//found " << candidates.Globals.size() << " globals as candidates for removal\n";
+  w << "//found " << candidates.Functions.size() << " functions as candidates for removal\n";
+  w.flush();
+  std::string parseWarnings = warnings;
+
+  // Look up all entry points first; lookups may build tables in the AST,
+  // while the traversals only read it.
+  std::vector<size_t> pending;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EntryPointRewrite &entry = entries[i];
+    DeclContext::lookup_result l = tu->lookup(DeclarationName(&C.Idents.get(entry.EntryPoint)));
+    if (l.empty()) {
+      w << "//entry point " << entry.EntryPoint << " not found\n";
+      continue;
+    }
+    w << "//entry point " << entry.EntryPoint << " found\n";
+    entry.EntryDecl = l.front();
+    entry.EntryFnDecl = dyn_cast_or_null<FunctionDecl>(entry.EntryDecl);
+    if (entry.EntryFnDecl == nullptr) {
+      w << "//entry point " << entry.EntryPoint << " is not a function declaration\n";
+      continue;
+    }
+    entry.UnusedGlobals.insert(candidates.Globals.begin(), candidates.Globals.end());
+    pending.push_back(i);
+  }
 
-        WriteSemanticDefines(compiler, pHelper, o);
+  // Traverse reachable functions and variables.
+  std::atomic<size_t> next(0);
+  auto collectEntryPoints = [&]() {
+    DxcThreadMalloc TM(pMalloc);
+    for (size_t p = next++; p < pending.size(); p = next++) {
+      EntryPointRewrite &entry = entries[pending[p]];
+      try {
+        CollectReachable(entry.EntryFnDecl, entry.UnusedGlobals,
+                         entry.VisitedFunctions, /*stopWhenAllUsed*/ false);
+      } catch (hlsl::Exception &e) {
+        entry.hr = e.hr;
+      } catch (...) {
+        entry.hr = E_FAIL;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  size_t threadCount = std::min<size_t>(
+      std::max(std::thread::hardware_concurrency(), 1u), pending.size());
+  for (size_t i = 0; i < threadCount; ++i)
+    threads.emplace_back(collectEntryPoints);
+  for (std::thread &thread : threads)
+    thread.join();
+
+  // Keep the globals and functions used by any entry point.
+  SmallPtrSet<VarDecl*, 128> unusedGlobals;
+  SmallPtrSet<FunctionDecl*, 128> visitedFunctions;
+  for (VarDecl *global : candidates.Globals) {
+    bool used = false;
+    for (size_t i : pending)
+      used |= entries[i].UnusedGlobals.count(global) == 0;
+    if (!used)
+      unusedGlobals.insert(global);
+  }
+  for (size_t i : pending) {
+    IFT(entries[i].hr);
+    visitedFunctions.insert(entries[i].VisitedFunctions.begin(), entries[i].VisitedFunctions.end());
+  }
+  if (!pending.empty())
+    WriteUnusedRemoved(compiler, pHelper, candidates, unusedGlobals, visitedFunctions, o, w);
+
+  if (writeEntryPoints) {
+    for (EntryPointRewrite &entry : entries) {
+      raw_string_ostream eo(entry.Result);
+      raw_string_ostream ew(entry.Warnings);
+      ew << parseWarnings;
+      if (entry.EntryDecl == nullptr) {
+        ew << "//entry point not found\n";
       }
+      else {
+        ew << "//entry point found\n";
+        if (entry.EntryFnDecl == nullptr)
+          eo << "//entry point found but is not a function declaration\n";
+        else
+          WriteUnusedRemoved(compiler, pHelper, candidates, entry.UnusedGlobals,
+                             entry.VisitedFunctions, eo, ew);
+      }
+      eo.flush();
+      ew.flush();
     }
   }
 
@@ -596,7 +786,7 @@ HRESULT DoSimpleReWrite(_In_ DxcLangExtensionsHelper *pHelper,
   return S_OK;
 }
 
-class DxcRewriter : public IDxcRewriter2, public IDxcLangExtensions {
+class DxcRewriter : public IDxcRewriter3, public IDxcLangExtensions {
 private:
   DXC_MICROCOM_TM_REF_FIELDS()
   DxcLangExtensionsHelper m_langExtensionsHelper;
@@ -606,7 +796,7 @@ public:
   DXC_LANGEXTENSIONS_HELPER_IMPL(m_langExtensionsHelper)
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) override {
-    return DoBasicQueryInterface<IDxcRewriter2, IDxcRewriter, IDxcLangExtensions>(this, iid, ppvObject);
+    return DoBasicQueryInterface<IDxcRewriter3, IDxcRewriter2, IDxcRewriter, IDxcLangExtensions>(this, iid, ppvObject);
   }
 
   HRESULT STDMETHODCALLTYPE RemoveUnusedGlobals(_In_ IDxcBlobEncoding *pSource,
@@ -653,6 +843,75 @@ public:
     CATCH_CPP_RETURN_HRESULT();
   }
 
+  HRESULT STDMETHODCALLTYPE RemoveUnusedGlobalsForEntryPoints(_In_ IDxcBlobEncoding *pSource,
+                                                _In_count_(entryPointCount) LPCWSTR *pEntryPoints,
+                                                _In_ UINT32 entryPointCount,
+                                                _In_count_(defineCount) DxcDefine *pDefines,
+                                                _In_ UINT32 defineCount,
+                                                _Out_writes_opt_(entryPointCount) IDxcOperationResult **ppEntryPointResults,
+                                                _COM_Outptr_ IDxcOperationResult **ppResult) override
+  {
+    if (pSource == nullptr || ppResult == nullptr || pEntryPoints == nullptr ||
+        entryPointCount == 0 || (defineCount > 0 && pDefines == nullptr))
+      return E_INVALIDARG;
+
+    *ppResult = nullptr;
+    if (ppEntryPointResults != nullptr) {
+      for (UINT32 i = 0; i < entryPointCount; ++i)
+        ppEntryPointResults[i] = nullptr;
+    }
+
+    DxcThreadMalloc TM(m_pMalloc);
+
+    CComPtr<IDxcBlobEncoding> utf8Source;
+    IFR(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
+
+    LPCSTR fakeName = "input.hlsl";
+
+    try {
+      ::llvm::sys::fs::MSFileSystem* msfPtr;
+      IFT(CreateMSFileSystemForDisk(&msfPtr));
+      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+      IFTLLVM(pts.error_code());
+
+      StringRef Data((LPSTR)utf8Source->GetBufferPointer(), utf8Source->GetBufferSize());
+      std::unique_ptr<llvm::MemoryBuffer> pBuffer(llvm::MemoryBuffer::getMemBufferCopy(Data, fakeName));
+      std::unique_ptr<ASTUnit::RemappedFile> pRemap(new ASTUnit::RemappedFile(fakeName, pBuffer.release()));
+
+      std::vector<EntryPointRewrite> entries(entryPointCount);
+      for (UINT32 i = 0; i < entryPointCount; ++i) {
+        IFTPTR(pEntryPoints[i]);
+        CW2A utf8EntryPoint(pEntryPoints[i], CP_UTF8);
+        entries[i].EntryPoint = utf8EntryPoint.m_psz;
+      }
+      std::string definesStr = DefinesToString(pDefines, defineCount);
+
+      std::string errors;
+      std::string rewrite;
+      HRESULT status = DoRewriteUnusedForEntryPoints(
+          m_pMalloc, &m_langExtensionsHelper, fakeName, pRemap.get(), entries,
+          ppEntryPointResults != nullptr,
+          defineCount > 0 ? definesStr.c_str() : nullptr, errors, rewrite);
+
+      std::vector<CComPtr<IDxcOperationResult>> entryPointResults(entryPointCount);
+      if (ppEntryPointResults != nullptr) {
+        for (UINT32 i = 0; i < entryPointCount; ++i)
+          IFT(DxcOperationResult::CreateFromUtf8Strings(
+              entries[i].Warnings.c_str(), entries[i].Result.c_str(), status,
+              &entryPointResults[i]));
+      }
+      IFT(DxcOperationResult::CreateFromUtf8Strings(errors.c_str(), rewrite.c_str(), status,
+                                                    ppResult));
+      if (ppEntryPointResults != nullptr) {
+        for (UINT32 i = 0; i < entryPointCount; ++i)
+          ppEntryPointResults[i] = entryPointResults[i].Detach();
+      }
+      return S_OK;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+
   HRESULT STDMETHODCALLTYPE 
   RewriteUnchanged(_In_ IDxcBlobEncoding *pSource,
                    _In_count_(defineCount) DxcDefine *pDefines,
@@ -547,6 +547,7 @@ public:
   TEST_METHOD(Intersections)
   TEST_METHOD(GapFilling)
   TEST_METHOD(Allocate)
+  TEST_METHOD(ManyRangesStress)
 
   void InitScenarios() {
     struct P {
@@ -766,3 +767,100 @@ TEST_F(AllocatorTest, Allocate) {
     TestSizesFn();
   }
 }
+
+// Stress binding allocation and overlap checking the way resource condensing
+// and validation use it: thousands of explicit and automatic ranges mixed in
+// the same spaces, so automatic ranges search fragmented spaces that explicit
+// ranges keep filling in. Each position is checked against a naive first fit.
+TEST_F(AllocatorTest, ManyRangesStress) {
+  WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
+  const unsigned NumSpaces = 8;
+  const unsigned NumPerSpace = 1024;
+  const unsigned ExplicitLimit = 4096;
+  std::mt19937 rng(0);
+
+  ElementVector elements;
+  elements.reserve(NumSpaces * NumPerSpace);
+  for (unsigned i = 0; i < NumSpaces * NumPerSpace; ++i)
+    elements.emplace_back(i, 0, 0);
+
+  SpacesAllocator<unsigned, Element> reserved;
+  SpacesAllocator<unsigned, Element> allocated;
+  std::vector<std::vector<bool>> used(NumSpaces);
+
+  auto isFree = [&](unsigned space, unsigned start, unsigned end) {
+    std::vector<bool> &bits = used[space];
+    for (unsigned i = start; i <= end && i < bits.size(); ++i) {
+      if (bits[i])
+        return false;
+    }
+    return true;
+  };
+  auto markUsed = [&](unsigned space, unsigned start, unsigned end) {
+    std::vector<bool> &bits = used[space];
+    if (bits.size() <= end)
+      bits.resize(end + 1);
+    for (unsigned i = start; i <= end; ++i)
+      bits[i] = true;
+  };
+  auto naiveFirstFit = [&](unsigned space, unsigned size, unsigned align) {
+    unsigned pos = 0;
+    while (!isFree(space, pos, pos + size - 1))
+      pos += align;
+    return pos;
+  };
+
+  for (unsigned i = 0; i < elements.size(); ++i) {
+    Element &e = elements[i];
+    unsigned space = i % NumSpaces;
+    SpanAllocator<unsigned, Element> &spaceReserved = reserved.Get(space);
+    switch (rng() % 4) {
+    case 0: {
+      // Explicitly bound, into a hole if there is one.
+      unsigned start, end;
+      do {
+        start = rng() % ExplicitLimit;
+        end = start + rng() % 4;
+      } while (!isFree(space, start, end));
+      e.start = start;
+      e.end = end;
+      VERIFY_IS_NULL(spaceReserved.Insert(&e, e.start, e.end));
+      break;
+    }
+    case 1: {
+      // Found, then inserted, as resource condensing does.
+      unsigned size = 1 + rng() % 6;
+      unsigned align = (rng() % 3 == 0) ? 4 : 1;
+      unsigned pos = 0;
+      VERIFY_IS_TRUE(spaceReserved.Find(size, pos, align));
+      VERIFY_ARE_EQUAL(naiveFirstFit(space, size, align), pos);
+      e.start = pos;
+      e.end = pos + size - 1;
+      VERIFY_IS_NULL(spaceReserved.Insert(&e, e.start, e.end));
+      break;
+    }
+    default: {
+      unsigned size = 1 + rng() % 6;
+      unsigned align = (rng() % 3 == 0) ? 4 : 1;
+      unsigned pos = 0;
+      VERIFY_IS_TRUE(spaceReserved.Allocate(&e, size, pos, align));
+      VERIFY_ARE_EQUAL(naiveFirstFit(space, size, align), pos);
+      e.start = pos;
+      e.end = pos + size - 1;
+      break;
+    }
+    }
+    markUsed(space, e.start, e.end);
+    VERIFY_IS_NULL(allocated.Get(space).Insert(&e, e.start, e.end));
+  }
+
+  // Every range must now conflict with itself and nothing else.
+  for (auto &e : elements) {
+    const Element *conflict =
+        allocated.Get(e.id % NumSpaces).Insert(&e, e.start, e.end);
+    VERIFY_IS_TRUE(conflict != nullptr);
+    if (conflict) {
+      VERIFY_ARE_EQUAL(conflict->id, e.id);
+    }
+  }
+}
@@ -21,6 +21,9 @@
 #include <sstream>
 #include <algorithm>
 #include <cfloat>
+#include <chrono>
+#include <atomic>
+#include <thread>
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
@@ -217,6 +220,10 @@ public:
   TEST_METHOD(CompileWhenWorksThenAddRemovePrivate)
   TEST_METHOD(CompileThenAddCustomDebugName)
   TEST_METHOD(CompileWithRootSignatureThenStripRootSignature)
+  TEST_METHOD(CompileWhenDebugWorksThenRemovePartKeepsOtherParts)
+  BEGIN_TEST_METHOD(ContainerBuilderPerf)
+    TEST_METHOD_PROPERTY(L"Priority", L"2")
+  END_TEST_METHOD()
 
   TEST_METHOD(CompileWhenIncludeThenLoadInvoked)
   TEST_METHOD(CompileWhenIncludeThenLoadUsed)
@@ -232,6 +239,8 @@ public:
   TEST_METHOD(CompileWhenODumpThenPassConfig)
   TEST_METHOD(CompileWhenODumpThenOptimizerMatch)
   TEST_METHOD(CompileWhenVdThenProducesDxilContainer)
+  TEST_METHOD(CompileLibWhenThreadsThenSameAsSerial)
+  TEST_METHOD(CompileLibWhenCacheThenReuseUnchangedExports)
 
 #if _ITERATOR_DEBUG_LEVEL==0 
   // CompileWhenNoMemThenOOM can properly detect leaks only when debug iterators are disabled
@@ -275,6 +284,11 @@ public:
   TEST_METHOD(CodeGenRootSigProfile)
   TEST_METHOD(CodeGenRootSigProfile2)
   TEST_METHOD(CodeGenRootSigProfile5)
+  TEST_METHOD(CompileRootSignatureThenMatchRootSigProfile)
+  TEST_METHOD(CompileRootSignatureWhenInvalidThenFail)
+  BEGIN_TEST_METHOD(CompileRootSignaturePerf)
+    TEST_METHOD_PROPERTY(L"Priority", L"2")
+  END_TEST_METHOD()
   TEST_METHOD(PreprocessWhenValidThenOK)
   TEST_METHOD(LibGVStore)
   TEST_METHOD(PreprocessWhenExpandTokenPastingOperandThenAccept)
@@ -772,6 +786,49 @@ public:
     CodeGenTestCheckFullPath(path.c_str());
   }
 
+  struct BatchTestResult {
+    std::string Path;
+    FileRunTestResult Result;
+    double Milliseconds;
+  };
+
+  unsigned GetBatchOption(LPCWSTR name, unsigned defaultValue) {
+    WEX::Common::String value;
+    if (FAILED(WEX::TestExecution::RuntimeParameters::TryGetValue(name, value)))
+      return defaultValue;
+    return (unsigned)wcstoul(value, nullptr, 10);
+  }
+
+  // Runs the tests in results, taking the next one from next, until there
+  // are none left. Each test gets its own allocator and file system.
+  void RunBatchTests(std::vector<BatchTestResult> &results,
+                     std::atomic<size_t> &next) {
+    for (size_t i = next++; i < results.size(); i = next++) {
+      BatchTestResult &test = results[i];
+      auto start = std::chrono::steady_clock::now();
+      try {
+        DxcThreadMalloc TM(nullptr);
+        ::llvm::sys::fs::MSFileSystem *msfPtr;
+        IFT(CreateMSFileSystemForDisk(&msfPtr));
+        std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+        ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+        IFTLLVM(pts.error_code());
+        test.Result = FileRunTestResult::RunFromFileCommands(
+            CA2W(test.Path.c_str()), m_dllSupport);
+      } catch (const std::exception &e) {
+        test.Result.RunResult = 1;
+        test.Result.ErrorMessage = e.what();
+      }
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      test.Milliseconds = elapsed.count();
+    }
+  }
+
+  // Runs the FileCheck tests under suitePath on BatchThreads threads
+  // (default: one per core), then logs each test in directory order with the
+  // time taken by it and its RUN lines, followed by the SlowestTests
+  // (default: 10) slowest tests.
   void CodeGenTestCheckBatchDir(std::wstring suitePath, bool implicitDir = true) {
     using namespace llvm;
     using namespace WEX::TestExecution;
@@ -791,7 +848,7 @@ public:
 
     CW2A utf8SuitePath(suitePath.c_str());
 
-    unsigned numTestsRun = 0;
+    std::vector<BatchTestResult> results;
 
     std::error_code EC;
     llvm::SmallString<128> DirNative;
@@ -803,17 +860,59 @@ public:
       if (!llvm::StringSwitch<bool>(llvm::sys::path::extension(Dir->path()))
           .Cases(".hlsl", ".ll", true).Default(false))
         continue;
-      StringRef filename = Dir->path();
-      CA2W wRelPath(filename.data());
+      results.push_back(BatchTestResult());
+      results.back().Path = Dir->path();
+    }
 
+    VERIFY_IS_GREATER_THAN(results.size(), (size_t)0, L"No test files found in batch directory.");
+
+    unsigned numThreads = GetBatchOption(L"BatchThreads",
+                                         std::thread::hardware_concurrency());
+    numThreads = std::max(1u, std::min(numThreads, (unsigned)results.size()));
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < numThreads; ++i)
+      threads.emplace_back([&] { RunBatchTests(results, next); });
+    for (std::thread &thread : threads)
+      thread.join();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    for (const BatchTestResult &test : results) {
+      CA2W wRelPath(test.Path.c_str());
       WEX::Logging::Log::StartGroup(wRelPath);
-      CodeGenTestCheck(wRelPath, /*implicitDir*/ false);
+      if (test.Result.RunResult != 0) {
+        CA2W commentWide(test.Result.ErrorMessage.c_str(), CP_UTF8);
+        WEX::Logging::Log::Comment(commentWide);
+        WEX::Logging::Log::Error(L"Run result is not zero");
+      }
+      LogCommentFmt(L"%.1f ms", test.Milliseconds);
+      for (const FileRunLineTiming &timing : test.Result.RunLineTimings) {
+        CA2W commandsWide(timing.Commands.c_str(), CP_UTF8);
+        LogCommentFmt(L"  %.1f ms: %ls", timing.Milliseconds,
+                      commandsWide.m_psz);
+      }
       WEX::Logging::Log::EndGroup(wRelPath);
-
-      numTestsRun++;
     }
 
-    VERIFY_IS_GREATER_THAN(numTestsRun, (unsigned)0, L"No test files found in batch directory.");
+    std::vector<const BatchTestResult *> slowest;
+    for (const BatchTestResult &test : results)
+      slowest.push_back(&test);
+    size_t numSlowest = std::min((size_t)GetBatchOption(L"SlowestTests", 10),
+                                 slowest.size());
+    std::partial_sort(slowest.begin(), slowest.begin() + numSlowest,
+                      slowest.end(),
+                      [](const BatchTestResult *a, const BatchTestResult *b) {
+                        return a->Milliseconds > b->Milliseconds;
+                      });
+    LogCommentFmt(L"Ran %u tests on %u threads in %.1f ms; slowest:",
+                  (unsigned)results.size(), numThreads, elapsed.count());
+    for (size_t i = 0; i < numSlowest; ++i) {
+      CA2W wRelPath(slowest[i]->Path.c_str());
+      LogCommentFmt(L"  %.1f ms: %ls", slowest[i]->Milliseconds,
+                    wRelPath.m_psz);
+    }
   }
 
   std::string VerifyCompileFailed(LPCSTR pText, LPCWSTR pTargetProfile, LPCSTR pErrorMsg) {
@@ -1602,6 +1701,103 @@ TEST_F(CompilerTest, CompileWithRootSignatureThenStripRootSignature) {
                                         hlsl::DxilFourCC::DFCC_RootSignature);
   VERIFY_IS_NOT_NULL(pPartHeader);
 }
+
+TEST_F(CompilerTest, CompileWhenDebugWorksThenRemovePartKeepsOtherParts) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pNewProgram;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return abs(pos);\r\n"
+                     "}",
+                     &pSource);
+  LPCWSTR args[] = {L"/Zi", L"/Qembed_debug"};
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args), nullptr,
+                                      0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  pResult.Release();
+
+  CComPtr<IDxcContainerBuilder> pBuilder;
+  VERIFY_SUCCEEDED(CreateContainerBuilder(&pBuilder));
+  VERIFY_SUCCEEDED(pBuilder->Load(pProgram));
+  VERIFY_SUCCEEDED(pBuilder->RemovePart(hlsl::DxilFourCC::DFCC_ShaderDebugName));
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pNewProgram));
+
+  // Every other part is copied unchanged, in order.
+  const hlsl::DxilContainerHeader *pHeader =
+      (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer();
+  const hlsl::DxilContainerHeader *pNewHeader =
+      (const hlsl::DxilContainerHeader *)pNewProgram->GetBufferPointer();
+  VERIFY_ARE_EQUAL(pHeader->PartCount - 1, pNewHeader->PartCount);
+  VERIFY_ARE_EQUAL((size_t)pNewHeader->ContainerSizeInBytes,
+                   (size_t)pNewProgram->GetBufferSize());
+  uint32_t newIndex = 0;
+  for (uint32_t i = 0; i < pHeader->PartCount; ++i) {
+    const hlsl::DxilPartHeader *pPart = hlsl::GetDxilContainerPart(pHeader, i);
+    if (pPart->PartFourCC == hlsl::DxilFourCC::DFCC_ShaderDebugName)
+      continue;
+    const hlsl::DxilPartHeader *pNewPart =
+        hlsl::GetDxilContainerPart(pNewHeader, newIndex++);
+    VERIFY_ARE_EQUAL(pPart->PartFourCC, pNewPart->PartFourCC);
+    VERIFY_ARE_EQUAL(pPart->PartSize, pNewPart->PartSize);
+    VERIFY_ARE_EQUAL(0, memcmp(hlsl::GetDxilPartData(pPart),
+                               hlsl::GetDxilPartData(pNewPart),
+                               pPart->PartSize));
+  }
+}
+
+TEST_F(CompilerTest, ContainerBuilderPerf) {
+  // Throughput of adding a small part to a container and removing it again,
+  // as done when stamping or stripping many containers.
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+                     "  return abs(pos);\r\n"
+                     "}",
+                     &pSource);
+  LPCWSTR args[] = {L"/Zi", L"/Qembed_debug"};
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                      L"ps_6_0", args, _countof(args), nullptr,
+                                      0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  std::string privateTxt("private data");
+  CComPtr<IDxcBlobEncoding> pPrivate;
+  CreateBlobFromText(privateTxt.c_str(), &pPrivate);
+
+  const unsigned Count = 100000;
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < Count; ++i) {
+    CComPtr<IDxcContainerBuilder> pBuilder;
+    CComPtr<IDxcOperationResult> pAddResult;
+    CComPtr<IDxcBlob> pAdded;
+    VERIFY_SUCCEEDED(CreateContainerBuilder(&pBuilder));
+    VERIFY_SUCCEEDED(pBuilder->Load(pProgram));
+    VERIFY_SUCCEEDED(pBuilder->AddPart(hlsl::DxilFourCC::DFCC_PrivateData, pPrivate));
+    VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pAddResult));
+    VERIFY_SUCCEEDED(pAddResult->GetResult(&pAdded));
+
+    CComPtr<IDxcContainerBuilder> pStripBuilder;
+    CComPtr<IDxcOperationResult> pStripResult;
+    VERIFY_SUCCEEDED(CreateContainerBuilder(&pStripBuilder));
+    VERIFY_SUCCEEDED(pStripBuilder->Load(pAdded));
+    VERIFY_SUCCEEDED(pStripBuilder->RemovePart(hlsl::DxilFourCC::DFCC_PrivateData));
+    VERIFY_SUCCEEDED(pStripBuilder->SerializeContainer(&pStripResult));
+  }
+  unsigned ms = (unsigned)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  LogCommentFmt(L"%u add/remove part round trips on a %u byte container: %u ms",
+                Count, (unsigned)pProgram->GetBufferSize(), ms);
+}
 #endif // Container builder unsupported
 
 TEST_F(CompilerTest, CompileWhenIncludeThenLoadInvoked) {
@@ -1890,6 +2086,130 @@ TEST_F(CompilerTest, CompileWhenVdThenProducesDxilContainer) {
   VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(reinterpret_cast<hlsl::DxilContainerHeader *>(pResultBlob->GetBufferPointer()), pResultBlob->GetBufferSize()));
 }
 
+TEST_F(CompilerTest, CompileLibWhenThreadsThenSameAsSerial) {
+  LPCWSTR Files[] = { L"..\\CodeGenHLSL\\lib_entries2.hlsl",
+                      L"..\\CodeGenHLSL\\lib_resource2.hlsl",
+                      L"..\\CodeGenHLSL\\lib_unused_func.hlsl" };
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+
+  for (LPCWSTR File : Files) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CreateBlobFromFile(File, &pSource);
+    CComPtr<IDxcBlob> pResultBlobs[2];
+    for (unsigned i = 0; i < 2; ++i) {
+      LPCWSTR Args[] = { L"-auto-binding-space", L"11",
+                         L"-default-linkage", L"external",
+                         L"-lib-threads", L"4" };
+      CComPtr<IDxcOperationResult> pResult;
+      VERIFY_SUCCEEDED(pCompiler->Compile(pSource, File, L"", L"lib_6_3",
+        Args, i ? _countof(Args) : _countof(Args) - 2, nullptr, 0, nullptr,
+        &pResult));
+      VerifyOperationSucceeded(pResult);
+      VERIFY_SUCCEEDED(pResult->GetResult(&pResultBlobs[i]));
+    }
+    VERIFY_ARE_EQUAL(pResultBlobs[0]->GetBufferSize(),
+                     pResultBlobs[1]->GetBufferSize());
+    VERIFY_ARE_EQUAL(0, memcmp(pResultBlobs[0]->GetBufferPointer(),
+                               pResultBlobs[1]->GetBufferPointer(),
+                               pResultBlobs[0]->GetBufferSize()));
+  }
+}
+
+static unsigned CountLibraryCacheEntries(const std::wstring &Dir) {
+  WIN32_FIND_DATAW FindData;
+  HANDLE hFind = FindFirstFileW((Dir + L"*.dxil").c_str(), &FindData);
+  if (hFind == INVALID_HANDLE_VALUE)
+    return 0;
+  unsigned Count = 0;
+  do {
+    ++Count;
+  } while (FindNextFileW(hFind, &FindData));
+  FindClose(hFind);
+  return Count;
+}
+
+TEST_F(CompilerTest, CompileLibWhenCacheThenReuseUnchangedExports) {
+  const char *Sources[] = {
+    "RWBuffer<float> Out : register(u0);\n"
+    "float helper(float f) { return f * 3; }\n"
+    "[shader(\"compute\")] [numthreads(1, 1, 1)]\n"
+    "void CSMain1() { Out[0] = helper(1); }\n"
+    "[shader(\"compute\")] [numthreads(1, 1, 1)]\n"
+    "void CSMain2() { Out[1] = helper(2); }\n",
+    // CSMain1 changed.
+    "RWBuffer<float> Out : register(u0);\n"
+    "float helper(float f) { return f * 3; }\n"
+    "[shader(\"compute\")] [numthreads(1, 1, 1)]\n"
+    "void CSMain1() { Out[0] = helper(5); }\n"
+    "[shader(\"compute\")] [numthreads(1, 1, 1)]\n"
+    "void CSMain2() { Out[1] = helper(2); }\n" };
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+
+  // Start from an empty cache directory.
+  wchar_t TempPath[MAX_PATH];
+  VERIFY_WIN32_BOOL_SUCCEEDED(GetTempPathW(MAX_PATH, TempPath) != 0);
+  std::wstring CacheDir = std::wstring(TempPath) + L"dxc_lib_cache_test\\";
+  CreateDirectoryW(CacheDir.c_str(), nullptr);
+  WIN32_FIND_DATAW FindData;
+  HANDLE hFind = FindFirstFileW((CacheDir + L"*.dxil").c_str(), &FindData);
+  if (hFind != INVALID_HANDLE_VALUE) {
+    do {
+      DeleteFileW((CacheDir + FindData.cFileName).c_str());
+    } while (FindNextFileW(hFind, &FindData));
+    FindClose(hFind);
+  }
+
+  auto Compile = [&](const char *pText, bool bCache, IDxcBlob **ppBlob) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CreateBlobFromText(pText, &pSource);
+    LPCWSTR Args[] = { L"-auto-binding-space", L"11",
+                       L"-lib-cache", CacheDir.c_str() };
+    CComPtr<IDxcOperationResult> pResult;
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"",
+      L"lib_6_3", Args, bCache ? _countof(Args) : _countof(Args) - 2,
+      nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(ppBlob));
+  };
+  auto VerifySameBlob = [](IDxcBlob *pA, IDxcBlob *pB) {
+    VERIFY_ARE_EQUAL(pA->GetBufferSize(), pB->GetBufferSize());
+    VERIFY_ARE_EQUAL(0, memcmp(pA->GetBufferPointer(), pB->GetBufferPointer(),
+                               pA->GetBufferSize()));
+  };
+  // Libraries linked from cache entries store the same values.
+  auto VerifyStores = [&](IDxcBlob *pBlob, const char *pValue1,
+                          const char *pValue2) {
+    CComPtr<IDxcBlobEncoding> pDisassembly;
+    VERIFY_SUCCEEDED(pCompiler->Disassemble(pBlob, &pDisassembly));
+    std::string Text = BlobToUtf8(pDisassembly);
+    VERIFY_ARE_NOT_EQUAL(std::string::npos, Text.find(pValue1));
+    VERIFY_ARE_NOT_EQUAL(std::string::npos, Text.find(pValue2));
+  };
+
+  // A cold cache gives the serial output and stores every export.
+  CComPtr<IDxcBlob> pSerial, pCold, pWarm;
+  Compile(Sources[0], false, &pSerial);
+  Compile(Sources[0], true, &pCold);
+  VerifySameBlob(pSerial, pCold);
+  VERIFY_ARE_EQUAL(2u, CountLibraryCacheEntries(CacheDir));
+
+  // A warm cache adds nothing.
+  Compile(Sources[0], true, &pWarm);
+  VERIFY_ARE_EQUAL(2u, CountLibraryCacheEntries(CacheDir));
+  VerifyStores(pWarm, "float 3.000000e+00", "float 6.000000e+00");
+
+  // Changing one body only misses that export.
+  CComPtr<IDxcBlob> pChanged, pChangedWarm;
+  Compile(Sources[1], true, &pChanged);
+  VERIFY_ARE_EQUAL(3u, CountLibraryCacheEntries(CacheDir));
+  VerifyStores(pChanged, "float 1.500000e+01", "float 6.000000e+00");
+  Compile(Sources[1], true, &pChangedWarm);
+  VERIFY_ARE_EQUAL(3u, CountLibraryCacheEntries(CacheDir));
+  VerifySameBlob(pChanged, pChangedWarm);
+}
+
 TEST_F(CompilerTest, CompileWhenODumpThenOptimizerMatch) {
   LPCWSTR OptLevels[] = { L"/Od", L"/O1", L"/O2" };
   CComPtr<IDxcCompiler> pCompiler;
@@ -2629,6 +2949,131 @@ TEST_F(CompilerTest, CodeGenRootSigProfile5) {
   CodeGenTest(L"rootSigProfile5.hlsl");
 }
 
+static const char RootSigText[] =
+    "RootFlags(ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT), CBV(b0), "
+    "DescriptorTable(SRV(t0, numDescriptors = 4), UAV(u1)), "
+    "StaticSampler(s0, filter = FILTER_MIN_MAG_MIP_LINEAR)";
+
+TEST_F(CompilerTest, CompileRootSignatureThenMatchRootSigProfile) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcRootSignatureCompiler> pRootSigCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlobEncoding> pRootSig;
+  CComPtr<IDxcBlob> pExpected;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcBlob> pProgram2;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pRootSigCompiler));
+
+  std::string source = std::string("#define RS \"") + RootSigText + "\"\r\n";
+  CreateBlobFromText(source.c_str(), &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"RS",
+                                      L"rootsig_1_1", nullptr, 0, nullptr, 0,
+                                      nullptr, &pResult));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pExpected));
+  pResult.Release();
+
+  CreateBlobFromText(RootSigText, &pRootSig);
+  VERIFY_SUCCEEDED(pRootSigCompiler->CompileRootSignature(
+      pRootSig, L"rootsig_1_1", &pResult));
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_SUCCEEDED(status);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  pResult.Release();
+  VERIFY_ARE_EQUAL(pExpected->GetBufferSize(), pProgram->GetBufferSize());
+  VERIFY_ARE_EQUAL(0, memcmp(pExpected->GetBufferPointer(),
+                             pProgram->GetBufferPointer(),
+                             pProgram->GetBufferSize()));
+
+  // Identical root signatures share the serialized container.
+  VERIFY_SUCCEEDED(pRootSigCompiler->CompileRootSignature(
+      pRootSig, L"rootsig_1_1", &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram2));
+  pResult.Release();
+  VERIFY_ARE_EQUAL(pProgram.p, pProgram2.p);
+
+  // The version is part of the description.
+  pProgram2.Release();
+  VERIFY_SUCCEEDED(pRootSigCompiler->CompileRootSignature(
+      pRootSig, L"rootsig_1_0", &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram2));
+  VERIFY_ARE_NOT_EQUAL(pProgram.p, pProgram2.p);
+}
+
+TEST_F(CompilerTest, CompileRootSignatureWhenInvalidThenFail) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcRootSignatureCompiler> pRootSigCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pRootSig;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pRootSigCompiler));
+
+  CreateBlobFromText("CBV(t0)", &pRootSig);
+  VERIFY_ARE_EQUAL(E_INVALIDARG, pRootSigCompiler->CompileRootSignature(
+                                     pRootSig, L"ps_6_0", &pResult));
+  VERIFY_SUCCEEDED(pRootSigCompiler->CompileRootSignature(
+      pRootSig, L"rootsig_1_1", &pResult));
+  HRESULT status;
+  VERIFY_SUCCEEDED(pResult->GetStatus(&status));
+  VERIFY_FAILED(status);
+  LPCSTR pErrorMsg = "root signature error";
+  CheckOperationResultMsgs(pResult, &pErrorMsg, 1, false, false);
+}
+
+TEST_F(CompilerTest, CompileRootSignaturePerf) {
+  // Compare the standalone root signature compiler with the rootsig_1_1
+  // profile on distinct root signatures, then on repeated ones.
+  const unsigned Count = 1000;
+  std::vector<std::string> rootSigs;
+  for (unsigned i = 0; i < Count; ++i) {
+    rootSigs.emplace_back(std::string(RootSigText) + ", CBV(b" +
+                          std::to_string(i + 1) + ")");
+  }
+
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcRootSignatureCompiler> pRootSigCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pRootSigCompiler));
+
+  auto start = std::chrono::steady_clock::now();
+  for (const std::string &rootSig : rootSigs) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    std::string source = "#define RS \"" + rootSig + "\"\r\n";
+    CreateBlobFromText(source.c_str(), &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"RS",
+                                        L"rootsig_1_1", nullptr, 0, nullptr,
+                                        0, nullptr, &pResult));
+  }
+  auto profileDur = std::chrono::steady_clock::now() - start;
+
+  unsigned standaloneMs[2];
+  for (unsigned pass = 0; pass < 2; ++pass) {
+    start = std::chrono::steady_clock::now();
+    for (const std::string &rootSig : rootSigs) {
+      CComPtr<IDxcBlobEncoding> pRootSig;
+      CComPtr<IDxcOperationResult> pResult;
+      CreateBlobFromText(rootSig.c_str(), &pRootSig);
+      VERIFY_SUCCEEDED(pRootSigCompiler->CompileRootSignature(
+          pRootSig, L"rootsig_1_1", &pResult));
+    }
+    standaloneMs[pass] = (unsigned)std::chrono::duration_cast<
+        std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  LogCommentFmt(L"%u root signatures: rootsig_1_1 profile %u ms, "
+                L"CompileRootSignature %u ms, cached %u ms",
+                Count,
+                (unsigned)std::chrono::duration_cast<std::chrono::milliseconds>(
+                    profileDur).count(),
+                standaloneMs[0], standaloneMs[1]);
+}
+
 TEST_F(CompilerTest, LibGVStore) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -117,6 +117,7 @@ protected:
   TEST_METHOD(TUWhenRegionInactiveThenEndIsBeforeEndifHash)
   TEST_METHOD(TUWhenRegionInactiveThenStartIsAtIfdefEol)
   TEST_METHOD(TUWhenUnsaveFileThenOK)
+  TEST_METHOD(TUWhenReparseUnchangedThenSkipped)
 
   TEST_METHOD(QualifiedNameClass)
   TEST_METHOD(QualifiedNameVariable)
@@ -879,3 +880,57 @@ TEST_F(DXIntellisenseTest, CompletionWhenResultsAvailable)
   VERIFY_SUCCEEDED(completionString->GetCompletionChunkText(0, &completionChunkText));
   VERIFY_ARE_EQUAL_STR("MyStruct", completionChunkText);
 }
+
+TEST_F(DXIntellisenseTest, TUWhenReparseUnchangedThenSkipped)
+{
+  const char fileName[] = "filename.hlsl";
+  char program[] =
+    "float4 main() : SV_Target { return 0; }";
+  char changedProgram[] =
+    "float4 main() : SV_Target { return 1; }";
+
+  HlslIntellisenseSupport support;
+  VERIFY_SUCCEEDED(support.Initialize());
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> tuIndex;
+  CComPtr<IDxcIndex2> tuIndex2;
+  CComPtr<IDxcTranslationUnit> tu;
+  CComPtr<IDxcUnsavedFile> unsavedFile;
+  CComPtr<IDxcUnsavedFile> changedFile;
+  DxcTranslationUnitFlags localOptions;
+  VERIFY_SUCCEEDED(support.CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&tuIndex));
+  VERIFY_SUCCEEDED(tuIndex.QueryInterface(&tuIndex2));
+  VERIFY_SUCCEEDED(isense->GetDefaultEditingTUOptions(&localOptions));
+  VERIFY_SUCCEEDED(TrivialDxcUnsavedFile::Create(fileName, program, &unsavedFile));
+  VERIFY_SUCCEEDED(TrivialDxcUnsavedFile::Create(fileName, changedProgram, &changedFile));
+  VERIFY_SUCCEEDED(tuIndex->ParseTranslationUnit(fileName, nullptr, 0,
+    &(unsavedFile.p), 1, localOptions, &tu));
+
+  DxcIntelliSenseLatency latency;
+  VERIFY_SUCCEEDED(tuIndex2->GetLatency(DxcIntelliSenseOperation_Parse, &latency));
+  VERIFY_ARE_EQUAL(1u, latency.Count);
+
+  // The same contents don't need to be parsed again.
+  VERIFY_SUCCEEDED(tu->Reparse(&(unsavedFile.p), 1));
+  VERIFY_SUCCEEDED(tuIndex2->GetLatency(DxcIntelliSenseOperation_Reparse, &latency));
+  VERIFY_ARE_EQUAL(0u, latency.Count);
+  VERIFY_ARE_EQUAL(1u, latency.SkippedCount);
+
+  VERIFY_SUCCEEDED(tu->Reparse(&(changedFile.p), 1));
+  VERIFY_SUCCEEDED(tuIndex2->GetLatency(DxcIntelliSenseOperation_Reparse, &latency));
+  VERIFY_ARE_EQUAL(1u, latency.Count);
+  VERIFY_ARE_EQUAL(1u, latency.SkippedCount);
+  VERIFY_IS_TRUE(latency.MaxMilliseconds >= latency.LastMilliseconds);
+
+  CComPtr<IDxcCodeCompleteResults> codeCompleteResults;
+  VERIFY_SUCCEEDED(tu->CodeCompleteAt((char *)fileName, 1, 1, &(changedFile.p), 1,
+    DxcCodeCompleteFlags_None, &codeCompleteResults));
+  VERIFY_SUCCEEDED(tuIndex2->GetLatency(DxcIntelliSenseOperation_CodeComplete, &latency));
+  VERIFY_ARE_EQUAL(1u, latency.Count);
+
+  VERIFY_SUCCEEDED(tuIndex2->ResetLatency());
+  VERIFY_SUCCEEDED(tuIndex2->GetLatency(DxcIntelliSenseOperation_Reparse, &latency));
+  VERIFY_ARE_EQUAL(0u, latency.Count);
+  VERIFY_ARE_EQUAL(0u, latency.SkippedCount);
+}
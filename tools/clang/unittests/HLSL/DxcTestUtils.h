@@ -118,10 +118,17 @@ private:
 void ParseCommandParts(LPCSTR commands, LPCWSTR fileName, std::vector<FileRunCommandPart> &parts);
 void ParseCommandPartsFromFile(LPCWSTR fileName, std::vector<FileRunCommandPart> &parts);
 
+struct FileRunLineTiming {
+  std::string Commands;
+  double Milliseconds;
+};
+
 class FileRunTestResult {
 public:
   std::string ErrorMessage;
   int RunResult;
+  // Time taken by each RUN line that was run, in file order.
+  std::vector<FileRunLineTiming> RunLineTimings;
   static FileRunTestResult RunHashTestFromFileCommands(LPCWSTR fileName);
   static FileRunTestResult RunFromFileCommands(LPCWSTR fileName);
   static FileRunTestResult RunFromFileCommands(LPCWSTR fileName, dxc::DxcDllSupport &dllSupport);
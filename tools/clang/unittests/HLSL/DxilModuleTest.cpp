@@ -18,6 +18,7 @@
 #include "dxc/DXIL/DxilInstructions.h"
 #include "dxc/DxilContainer/DxilContainer.h"
 #include "dxc/DXIL/DxilModule.h"
+#include "dxc/HLSL/DxilPipelineSignature.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/MSFileSystem.h"
 #include "llvm/Support/FileSystem.h"
@@ -68,6 +69,8 @@ public:
 
   TEST_METHOD(SetValidatorVersion)
 
+  TEST_METHOD(OptimizePipelineSignatures)
+
   void VerifyValidatorVersionFails(
     LPCWSTR shaderModel, const std::vector<LPCWSTR> &arguments,
     const std::vector<LPCSTR> &expectedErrors);
@@ -578,3 +581,64 @@ TEST_F(DxilModuleTest, SetValidatorVersion) {
   VerifyValidatorVersionFails(L"lib_6_x", {L"-validator-version", L"1.3"}, {
     "Offline library profile cannot be used with non-zero -validator-version."});
 }
+
+TEST_F(DxilModuleTest, OptimizePipelineSignatures) {
+  Compiler vs(m_dllSupport);
+  vs.Compile(
+    "struct VSOut {\n"
+    "  float4 pos : SV_Position;\n"
+    "  float4 color : COLOR;\n"
+    "  float3 normal : NORMAL;\n"
+    "  float2 uv : TEXCOORD0;\n"
+    "};\n"
+    "VSOut main(float4 p : POSITION, float3 n : NORMAL) {\n"
+    "  VSOut o;\n"
+    "  o.pos = p;\n"
+    "  o.color = p * 2;\n"
+    "  o.normal = normalize(n);\n"
+    "  o.uv = p.zw;\n"
+    "  return o;\n"
+    "}\n"
+    ,
+    L"vs_6_0"
+  );
+  Compiler ps(m_dllSupport);
+  ps.Compile(
+    "float4 main(float4 pos : SV_Position, float2 uv : TEXCOORD0) : SV_Target {\n"
+    "  return pos * uv.xyxy;\n"
+    "}\n"
+    ,
+    L"ps_6_0"
+  );
+
+  DxilModule &VS = vs.GetDxilModule();
+  DxilModule &PS = ps.GetDxilModule();
+  VERIFY_IS_TRUE(OptimizePipelineSignatures(VS, PS));
+
+  // COLOR and NORMAL are never read, so only the position and uv are left.
+  DxilSignature &Outputs = VS.GetOutputSignature();
+  VERIFY_ARE_EQUAL(2u, Outputs.GetElements().size());
+  for (auto &Input : PS.GetInputSignature().GetElements()) {
+    const DxilSignatureElement *pOutput = nullptr;
+    for (auto &Output : Outputs.GetElements()) {
+      if (Output->GetKind() == Input->GetKind() &&
+          Output->GetSemanticName() == Input->GetSemanticName())
+        pOutput = Output.get();
+    }
+    VERIFY_IS_NOT_NULL(pOutput);
+    VERIFY_ARE_EQUAL(pOutput->GetStartRow(), Input->GetStartRow());
+    VERIFY_ARE_EQUAL(pOutput->GetStartCol(), Input->GetStartCol());
+  }
+
+  // The remaining stores refer to the renumbered outputs, and the code that
+  // computed the removed ones is gone.
+  Function *F = VS.GetEntryFunction();
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    Instruction *Inst = &*I;
+    if (DxilInst_StoreOutput SO = DxilInst_StoreOutput(Inst)) {
+      unsigned ID = cast<ConstantInt>(SO.get_outputSigId())->getLimitedValue();
+      VERIFY_IS_TRUE(ID < Outputs.GetElements().size());
+    }
+    VERIFY_IS_FALSE(DxilInst_Dot3(Inst));
+  }
+}
@@ -19,6 +19,7 @@
 #include <cctype>
 #include <cassert>
 #include <algorithm>
+#include <chrono>
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
 #ifdef _WIN32
@@ -721,7 +722,11 @@ public:
     auto cmds = GetRunLines(fileName);
     // Iterate over all RUN lines
     for (auto &cmd : cmds) {
+      auto start = std::chrono::steady_clock::now();
       RunFileCheckFromCommands(cmd.c_str(), fileName);
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      this->RunLineTimings.push_back({strtrim(cmd), elapsed.count()});
       // If any of the RUN cmd fails then skip executing remaining cmds
       // and report the error
       if (this->RunResult != 0) break;
@@ -37,7 +37,9 @@ namespace testOptions {
     ARGOP(ExperimentalShaders)\
     ARGOP(DebugLayer)\
     ARGOP(SuitePath)\
-    ARGOP(InputFile)
+    ARGOP(InputFile)\
+    ARGOP(BatchThreads)\
+    ARGOP(SlowestTests)
 
 ARG_LIST(ARG_DECLARE)
 
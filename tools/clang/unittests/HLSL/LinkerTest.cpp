@@ -62,6 +62,8 @@ public:
   TEST_METHOD(RunLinkToLibWithNoExports);
   TEST_METHOD(RunLinkWithPotentialIntrinsicNameCollisions);
   TEST_METHOD(RunLinkWithValidatorVersion);
+  TEST_METHOD(RunLinkSpecialize);
+  TEST_METHOD(RunLinkSpecializeFailSelectedBuffer);
 
 
   dxc::DxcDllSupport m_dllSupport;
@@ -662,3 +664,35 @@ TEST_F(LinkerTest, RunLinkWithValidatorVersion) {
        {"!dx.valver = !{(![0-9]+)}.*\n\\1 = !{i32 1, i32 3}"},
        {}, {L"-validator-version", L"1.3"}, /*regex*/ true);
 }
+
+TEST_F(LinkerTest, RunLinkSpecialize) {
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_specialize.hlsl", &pLib);
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"lib";
+  RegisterDxcModule(libName, pLib, pLinker);
+
+  // Min precision Tint is 4 bytes after UseFog, not 2.
+  Link(L"ps_main", L"ps_6_0", pLinker, {libName},
+       {"2.000000e+00"}, {"cbufferLoadLegacy"},
+       {L"-specialize", L"UseFog=0", L"-specialize", L"Tint=2"});
+}
+
+TEST_F(LinkerTest, RunLinkSpecializeFailSelectedBuffer) {
+  CComPtr<IDxcBlob> pLib;
+  CompileLib(L"..\\CodeGenHLSL\\linker\\lib_specialize_select.hlsl",
+             &pLib);
+
+  CComPtr<IDxcLinker> pLinker;
+  CreateLinker(&pLinker);
+
+  LPCWSTR libName = L"lib";
+  RegisterDxcModule(libName, pLib, pLinker);
+
+  LinkCheckMsg(L"ps_main", L"ps_6_0", pLinker, {libName},
+               {"Cannot specialize fields of constant buffer"},
+               {L"-specialize", L"Tint=2"});
+}
@@ -0,0 +1,310 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// PixTest.cpp                                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides tests for the CPU-side helpers of the PIX instrumentation passes.//
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/Support/WinIncludes.h"
+#ifdef _WIN32
+#include "WexTestClass.h"
+#endif
+#include "HlslTestUtils.h"
+#include "DxcTestUtils.h"
+
+#include "dxc/dxcapi.h"
+#include "dxc/DxilContainer/DxilContainer.h"
+#include "dxc/DxilPIXPasses/DxilDebugTraceReplay.h"
+#include "dxc/DxilPIXPasses/DxilPIXVirtualRegisters.h"
+#include "dxc/DxilPIXPasses/DxilShaderAccessTrackingDecoder.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <map>
+#include <vector>
+
+using namespace pix_dxil;
+
+#ifdef _WIN32
+class PixTest {
+#else
+class PixTest : public ::testing::Test {
+#endif
+public:
+  BEGIN_TEST_CLASS(PixTest)
+    TEST_CLASS_PROPERTY(L"Parallel", L"true")
+    TEST_METHOD_PROPERTY(L"Priority", L"0")
+  END_TEST_CLASS()
+
+  TEST_CLASS_SETUP(InitSupport);
+
+  TEST_METHOD(AccessTrackingParseSlotAssignments)
+  TEST_METHOD(AccessTrackingParseMalformedSlotAssignments)
+  TEST_METHOD(AccessTrackingDecodeBuffer)
+  TEST_METHOD(AccessTrackingDecodeShortBuffer)
+  TEST_METHOD(DebugMinimalReplayRebuildsFullTrace)
+  TEST_METHOD(DebugMinimalReplayWhenBlockUnnumberedThenFail)
+
+  dxc::DxcDllSupport m_dllSupport;
+
+  // Compiles pText and numbers its instructions the way the debug
+  // instrumentation expects.
+  std::unique_ptr<llvm::Module> CompileAndAnnotate(const char *pText,
+                                                   llvm::LLVMContext &Ctx) {
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcOptimizer> pOptimizer;
+    CComPtr<IDxcContainerReflection> pReflection;
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    CComPtr<IDxcBlob> pDxil;
+    CComPtr<IDxcBlob> pAnnotated;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerReflection,
+                                                 &pReflection));
+
+    Utf8ToBlob(m_dllSupport, pText, &pSource);
+    LPCWSTR args[] = { L"-enable-16bit-types" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"ps_6_2", args, _countof(args),
+                                        nullptr, 0, nullptr, &pResult));
+    CheckOperationSucceeded(pResult, &pProgram);
+
+    UINT32 index;
+    VERIFY_SUCCEEDED(pReflection->Load(pProgram));
+    VERIFY_SUCCEEDED(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &index));
+    VERIFY_SUCCEEDED(pReflection->GetPartContent(index, &pDxil));
+
+    LPCWSTR passes[] = { L"-dxil-annotate-with-virtual-regs" };
+    VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(pDxil, passes, _countof(passes),
+                                              &pAnnotated, nullptr));
+
+    std::unique_ptr<llvm::MemoryBuffer> pBitcodeBuf(
+        llvm::MemoryBuffer::getMemBuffer(
+            llvm::StringRef((const char *)pAnnotated->GetBufferPointer(),
+                            pAnnotated->GetBufferSize()),
+            "", false));
+    llvm::ErrorOr<std::unique_ptr<llvm::Module>> pModule(
+        llvm::parseBitcodeFile(pBitcodeBuf->getMemBufferRef(), Ctx));
+    VERIFY_IS_FALSE((bool)pModule.getError());
+    return std::move(pModule.get());
+  }
+
+  // The steps a minimal instrumentation of BB records, with the value each
+  // instruction of a recorded type would have on the GPU.
+  void RecordBlock(llvm::BasicBlock &BB, const MinimalDebugTracePlan &Plan,
+                   const std::map<llvm::Type *, uint64_t> &Values,
+                   std::vector<DebugTraceStep> &Recorded) {
+    for (llvm::Instruction &I : BB) {
+      if (!Plan.IsInstructionRecorded(&I))
+        continue;
+      auto It = Values.find(I.getType());
+      VERIFY_IS_TRUE(It != Values.end());
+      DebugTraceStep Step;
+      VERIFY_IS_TRUE(PixDxilInstNum::FromInst(&I, &Step.InstNum));
+      Step.HasValue = true;
+      Step.Value = It->second;
+      Recorded.push_back(Step);
+    }
+  }
+};
+
+bool PixTest::InitSupport() {
+  if (!m_dllSupport.IsEnabled()) {
+    VERIFY_SUCCEEDED(m_dllSupport.Initialize());
+  }
+  return true;
+}
+
+TEST_F(PixTest, AccessTrackingParseSlotAssignments) {
+  SlotAssignments slots;
+  VERIFY_IS_TRUE(ParseSlotAssignments("S0:1:1i1;U2:2:10i0;.", slots));
+  VERIFY_ARE_EQUAL(2u, slots.size());
+
+  SlotRange &srv = slots[{ RegisterType::SRV, 0 }];
+  VERIFY_ARE_EQUAL(1u, srv.startSlot);
+  VERIFY_ARE_EQUAL(1u, srv.numSlots);
+  VERIFY_ARE_EQUAL(1u, srv.numInvariableSlots);
+
+  SlotRange &uav = slots[{ RegisterType::UAV, 2 }];
+  VERIFY_ARE_EQUAL(2u, uav.startSlot);
+  VERIFY_ARE_EQUAL(10u, uav.numSlots);
+  VERIFY_ARE_EQUAL(0u, uav.numInvariableSlots);
+
+  slots.clear();
+  VERIFY_IS_TRUE(ParseSlotAssignments(".", slots));
+  VERIFY_ARE_EQUAL(0u, slots.size());
+}
+
+TEST_F(PixTest, AccessTrackingParseMalformedSlotAssignments) {
+  SlotAssignments slots;
+  VERIFY_IS_FALSE(ParseSlotAssignments("", slots));
+  VERIFY_IS_FALSE(ParseSlotAssignments("S0:1:1i1;", slots));
+  VERIFY_IS_FALSE(ParseSlotAssignments("S0:1;.", slots));
+  VERIFY_IS_FALSE(ParseSlotAssignments("S0:1:1;.", slots));
+  VERIFY_IS_FALSE(ParseSlotAssignments("S0:1:1i1.", slots));
+}
+
+TEST_F(PixTest, AccessTrackingDecodeBuffer) {
+  SlotAssignments slots;
+  VERIFY_IS_TRUE(ParseSlotAssignments("S0:1:1i1;U0:2:3i3;.", slots));
+
+  // Slot zero collects out-of-bounds accesses.
+  std::vector<uint32_t> buffer(5 * DWORDsPerResource, 0);
+  buffer[0 * DWORDsPerResource + 1] = 1;  // out-of-bounds write
+  buffer[1 * DWORDsPerResource + 0] = 1;  // t0 read
+  buffer[3 * DWORDsPerResource + 1] = 1;  // u1 write
+  buffer[3 * DWORDsPerResource + 2] = 7;  // u1 counter
+  buffer[4 * DWORDsPerResource + 0] = 1;  // u2 read
+
+  DecodedShaderAccesses decoded;
+  VERIFY_IS_TRUE(DecodeShaderAccessTrackingBuffer(
+      slots, buffer.data(), buffer.size() * BytesPerDWORD, decoded));
+  VERIFY_ARE_EQUAL((uint32_t)ShaderAccessFlags::Write, decoded.OutOfBoundsFlags);
+  VERIFY_ARE_EQUAL(3u, decoded.Accesses.size());
+
+  VERIFY_IS_TRUE(decoded.Accesses[0].Type == RegisterType::SRV);
+  VERIFY_ARE_EQUAL(0u, decoded.Accesses[0].Index);
+  VERIFY_ARE_EQUAL((uint32_t)ShaderAccessFlags::Read, decoded.Accesses[0].Flags);
+
+  VERIFY_IS_TRUE(decoded.Accesses[1].Type == RegisterType::UAV);
+  VERIFY_ARE_EQUAL(1u, decoded.Accesses[1].Index);
+  VERIFY_ARE_EQUAL((uint32_t)ShaderAccessFlags::Write | (uint32_t)ShaderAccessFlags::Counter,
+                   decoded.Accesses[1].Flags);
+
+  VERIFY_IS_TRUE(decoded.Accesses[2].Type == RegisterType::UAV);
+  VERIFY_ARE_EQUAL(2u, decoded.Accesses[2].Index);
+  VERIFY_ARE_EQUAL((uint32_t)ShaderAccessFlags::Read, decoded.Accesses[2].Flags);
+}
+
+TEST_F(PixTest, AccessTrackingDecodeShortBuffer) {
+  SlotAssignments slots;
+  VERIFY_IS_TRUE(ParseSlotAssignments("U0:2:3i3;.", slots));
+
+  std::vector<uint32_t> buffer(4 * DWORDsPerResource, 0);
+  DecodedShaderAccesses decoded;
+  VERIFY_IS_FALSE(DecodeShaderAccessTrackingBuffer(
+      slots, buffer.data(), buffer.size() * BytesPerDWORD, decoded));
+}
+
+TEST_F(PixTest, DebugMinimalReplayRebuildsFullTrace) {
+  // Every value the shader reads comes from outside of it, and is the only
+  // thing a minimal trace records; doubles, halves and integers are
+  // recomputed from them.
+  const char *pText =
+      "cbuffer C { double dv; half hv; int iv; };\n"
+      "float main(float x : IN) : SV_Target {\n"
+      "  double d = dv * (double)x;\n"
+      "  half h = hv * (half)x;\n"
+      "  int i = iv * 3 + 1;\n"
+      "  return (float)d + (float)h + (float)i;\n"
+      "}\n";
+  llvm::LLVMContext Ctx;
+  std::unique_ptr<llvm::Module> M = CompileAndAnnotate(pText, Ctx);
+  llvm::Function *F = M->getFunction("main");
+  VERIFY_IS_NOT_NULL(F);
+  VERIFY_ARE_EQUAL(1u, F->size());
+
+  // x = 1.5, dv = 4.0, hv = 2.0 (recorded widened to float), iv = 2.
+  std::map<llvm::Type *, uint64_t> Values;
+  Values[llvm::Type::getFloatTy(Ctx)] = 0x3FC00000;
+  Values[llvm::Type::getDoubleTy(Ctx)] = 0x4010000000000000ULL;
+  Values[llvm::Type::getHalfTy(Ctx)] = 0x40000000;
+  Values[llvm::Type::getInt32Ty(Ctx)] = 2;
+
+  MinimalDebugTracePlan Plan(*F);
+  std::vector<DebugTraceStep> Recorded;
+  RecordBlock(F->getEntryBlock(), Plan, Values, Recorded);
+
+  std::vector<DebugTraceStep> Full;
+  std::string Error;
+  VERIFY_IS_TRUE(ReplayMinimalDebugTrace(*F, Recorded, Full, Error));
+  VERIFY_IS_TRUE(Error.empty());
+
+  // The full trace has a step for every instruction a full instrumentation
+  // steps, with the values that instruction computes.
+  std::map<uint32_t, llvm::Instruction *> ByNum;
+  unsigned StepCount = 0;
+  for (llvm::Instruction &I : llvm::inst_range(F)) {
+    uint32_t Num;
+    if (PixDxilInstNum::FromInst(&I, &Num))
+      ByNum[Num] = &I;
+    if (MinimalDebugTracePlan::HasStep(&I))
+      ++StepCount;
+  }
+  VERIFY_ARE_EQUAL(StepCount, Full.size());
+  VERIFY_IS_TRUE(Recorded.size() < Full.size());
+
+  bool bFoundDouble = false, bFoundHalf = false, bFoundInt = false;
+  uint64_t LastFloat = 0;
+  for (const DebugTraceStep &Step : Full) {
+    llvm::Instruction *I = ByNum[Step.InstNum];
+    VERIFY_IS_NOT_NULL(I);
+    VERIFY_IS_TRUE(Step.HasValue);
+    if (!llvm::isa<llvm::BinaryOperator>(I))
+      continue;
+    if (I->getType()->isDoubleTy()) {
+      VERIFY_ARE_EQUAL(0x4018000000000000ULL, Step.Value); // 6.0
+      bFoundDouble = true;
+    } else if (I->getType()->isHalfTy()) {
+      VERIFY_ARE_EQUAL(0x40400000ULL, Step.Value); // 3.0 widened to float
+      bFoundHalf = true;
+    } else if (I->getType()->isIntegerTy(32) &&
+               I->getOpcode() == llvm::Instruction::Add) {
+      VERIFY_ARE_EQUAL(7ULL, Step.Value);
+      bFoundInt = true;
+    } else if (I->getType()->isFloatTy()) {
+      LastFloat = Step.Value;
+    }
+  }
+  VERIFY_IS_TRUE(bFoundDouble);
+  VERIFY_IS_TRUE(bFoundHalf);
+  VERIFY_IS_TRUE(bFoundInt);
+  VERIFY_ARE_EQUAL(0x41800000ULL, LastFloat); // 6 + 3 + 7
+}
+
+TEST_F(PixTest, DebugMinimalReplayWhenBlockUnnumberedThenFail) {
+  const char *pText =
+      "int iv;\n"
+      "float main(float x : IN) : SV_Target {\n"
+      "  float r = x;\n"
+      "  [branch] if (iv > 10) r = r * 3; else r = r + 7;\n"
+      "  return r;\n"
+      "}\n";
+  llvm::LLVMContext Ctx;
+  std::unique_ptr<llvm::Module> M = CompileAndAnnotate(pText, Ctx);
+  llvm::Function *F = M->getFunction("main");
+  VERIFY_IS_NOT_NULL(F);
+
+  std::map<llvm::Type *, uint64_t> Values;
+  Values[llvm::Type::getFloatTy(Ctx)] = 0x3FC00000;
+  Values[llvm::Type::getInt32Ty(Ctx)] = 20;
+  MinimalDebugTracePlan Plan(*F);
+  std::vector<DebugTraceStep> Recorded;
+  RecordBlock(F->getEntryBlock(), Plan, Values, Recorded);
+
+  // Drop the number of the first instruction of each branch target, so the
+  // block entry step can't name it.
+  llvm::TerminatorInst *T = F->getEntryBlock().getTerminator();
+  VERIFY_IS_TRUE(T->getNumSuccessors() > 1);
+  uint32_t Num;
+  VERIFY_IS_TRUE(PixDxilInstNum::FromInst(&T->getSuccessor(0)->front(), &Num));
+  DebugTraceStep Entry;
+  Entry.InstNum = Num;
+  Recorded.push_back(Entry);
+  for (unsigned i = 0; i < T->getNumSuccessors(); ++i)
+    T->getSuccessor(i)->front().setMetadata(PixDxilInstNum::MDName, nullptr);
+
+  std::vector<DebugTraceStep> Full;
+  std::string Error;
+  VERIFY_IS_FALSE(ReplayMinimalDebugTrace(*F, Recorded, Full, Error));
+  VERIFY_IS_TRUE(Error.find("has no number") != std::string::npos);
+}
@@ -86,6 +86,8 @@ public:
   TEST_METHOD(RunNoFunctionBodyInclude);
   TEST_METHOD(RunNoStatic);
   TEST_METHOD(RunKeepUserMacro);
+  TEST_METHOD(RunRemoveUnusedGlobalsForEntryPoints);
+  TEST_METHOD(RunRemoveUnusedGlobalsForEntryPointsAllUsed);
   TEST_METHOD(RunRewriterFails)
 
   dxc::DxcDllSupport m_dllSupport;
@@ -639,6 +641,101 @@ float test(float a, float b) {\n\
 ") == 0);
 }
 
+TEST_F(RewriterTest, RunRemoveUnusedGlobalsForEntryPoints) {
+  CComPtr<IDxcRewriter> pRewriter;
+  CComPtr<IDxcRewriter3> pRewriter3;
+  VERIFY_SUCCEEDED(CreateRewriter(&pRewriter));
+  VERIFY_SUCCEEDED(pRewriter->QueryInterface(&pRewriter3));
+
+  char program[] =
+    "static float a = 1;\n"
+    "static float b = 2;\n"
+    "static float c = 3;\n"
+    "float useA() { return a; }\n"
+    "float4 PS1() : SV_Target { return useA(); }\n"
+    "float4 PS2() : SV_Target { return b; }\n";
+  CComPtr<IDxcBlobEncoding> source;
+  CreateBlobPinned(program, strlen(program), CP_UTF8, &source);
+
+  LPCWSTR entryPoints[] = { L"PS1", L"PS2" };
+  CComPtr<IDxcOperationResult> pEntryPointResults[_countof(entryPoints)];
+  CComPtr<IDxcOperationResult> pRewriteResult;
+  VERIFY_SUCCEEDED(pRewriter3->RemoveUnusedGlobalsForEntryPoints(
+      source, entryPoints, _countof(entryPoints), nullptr, 0,
+      &pEntryPointResults[0].p, &pRewriteResult));
+
+  // Everything but c is used by one of the entry points.
+  CComPtr<IDxcBlob> result;
+  VERIFY_SUCCEEDED(pRewriteResult->GetResult(&result));
+  std::string combined = BlobToUtf8(result);
+  VERIFY_IS_TRUE(combined.find("a = 1") != std::string::npos);
+  VERIFY_IS_TRUE(combined.find("b = 2") != std::string::npos);
+  VERIFY_IS_TRUE(combined.find("c = 3") == std::string::npos);
+  VERIFY_IS_TRUE(combined.find("useA") != std::string::npos);
+
+  // Each entry point keeps only what it uses.
+  CComPtr<IDxcBlob> ps1Result;
+  VERIFY_SUCCEEDED(pEntryPointResults[0]->GetResult(&ps1Result));
+  std::string ps1 = BlobToUtf8(ps1Result);
+  VERIFY_IS_TRUE(ps1.find("a = 1") != std::string::npos);
+  VERIFY_IS_TRUE(ps1.find("b = 2") == std::string::npos);
+  VERIFY_IS_TRUE(ps1.find("PS2") == std::string::npos);
+
+  CComPtr<IDxcBlob> ps2Result;
+  VERIFY_SUCCEEDED(pEntryPointResults[1]->GetResult(&ps2Result));
+  std::string ps2 = BlobToUtf8(ps2Result);
+  VERIFY_IS_TRUE(ps2.find("b = 2") != std::string::npos);
+  VERIFY_IS_TRUE(ps2.find("a = 1") == std::string::npos);
+  VERIFY_IS_TRUE(ps2.find("useA") == std::string::npos);
+}
+
+TEST_F(RewriterTest, RunRemoveUnusedGlobalsForEntryPointsAllUsed) {
+  CComPtr<IDxcRewriter> pRewriter;
+  CComPtr<IDxcRewriter3> pRewriter3;
+  VERIFY_SUCCEEDED(CreateRewriter(&pRewriter));
+  VERIFY_SUCCEEDED(pRewriter->QueryInterface(&pRewriter3));
+
+  // PS1 uses every global before calling helper, so the helper is only
+  // found by walking past the point where all globals are used.
+  char program[] =
+    "static float a = 1;\n"
+    "static float b = 2;\n"
+    "float helper() { return 3; }\n"
+    "float4 PS1() : SV_Target { return a + b + helper(); }\n"
+    "float4 PS2() : SV_Target { return a; }\n"
+    "float4 PS3() : SV_Target { return 0; }\n";
+  CComPtr<IDxcBlobEncoding> source;
+  CreateBlobPinned(program, strlen(program), CP_UTF8, &source);
+
+  LPCWSTR entryPoints[] = { L"PS1", L"PS2" };
+  CComPtr<IDxcOperationResult> pRewriteResult;
+  VERIFY_SUCCEEDED(pRewriter3->RemoveUnusedGlobalsForEntryPoints(
+      source, entryPoints, _countof(entryPoints), nullptr, 0, nullptr,
+      &pRewriteResult));
+  HRESULT hrStatus;
+  VERIFY_SUCCEEDED(pRewriteResult->GetStatus(&hrStatus));
+  VERIFY_SUCCEEDED(hrStatus);
+
+  CComPtr<IDxcBlob> result;
+  VERIFY_SUCCEEDED(pRewriteResult->GetResult(&result));
+  std::string combined = BlobToUtf8(result);
+  VERIFY_IS_TRUE(combined.find("float helper()") != std::string::npos);
+  VERIFY_IS_TRUE(combined.find("PS3") == std::string::npos);
+
+  // The combined result still compiles.
+  CComPtr<IDxcBlobEncoding> rewritten;
+  CreateBlobPinned(result->GetBufferPointer(), result->GetBufferSize(),
+                   CP_UTF8, &rewritten);
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pCompileResult;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+  VERIFY_SUCCEEDED(pCompiler->Compile(rewritten, L"input.hlsl", L"PS1", L"ps_6_0",
+                                      nullptr, 0, nullptr, 0, nullptr,
+                                      &pCompileResult));
+  VERIFY_SUCCEEDED(pCompileResult->GetStatus(&hrStatus));
+  VERIFY_SUCCEEDED(hrStatus);
+}
+
 TEST_F(RewriterTest, RunRewriterFails) {
   CComPtr<IDxcRewriter> pRewriter;
   CComPtr<IDxcRewriter2> pRewriter2;
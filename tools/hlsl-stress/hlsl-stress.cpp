@@ -0,0 +1,296 @@
+//===-- hlsl-stress.cpp - Generate HLSL programs to stress-test DXC -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program generates HLSL programs that grow along one axis, such as the
+// number of functions in a library or the number of cases in a switch, to
+// measure how compile time and memory scale with it. Each program starts with
+// a %dxc RUN line, so dxc-bench compiles it with the right arguments.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MSFileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+enum class Shape {
+  Functions,
+  Resources,
+  Switch,
+  Nesting,
+  CBuffer,
+  Loop,
+};
+
+const Shape AllShapes[] = {Shape::Functions, Shape::Resources, Shape::Switch,
+                           Shape::Nesting,   Shape::CBuffer,   Shape::Loop};
+
+static cl::opt<Shape> ShapeCL(
+    "shape", cl::desc("The axis the program grows along"),
+    cl::values(
+        clEnumValN(Shape::Functions, "functions",
+                   "Exported library functions calling each other"),
+        clEnumValN(Shape::Resources, "resources", "Textures sampled by a PS"),
+        clEnumValN(Shape::Switch, "switch", "Cases in a switch statement"),
+        clEnumValN(Shape::Nesting, "nesting",
+                   "Depth of nested structs and calls"),
+        clEnumValN(Shape::CBuffer, "cbuffer", "Fields in a constant buffer"),
+        clEnumValN(Shape::Loop, "loop", "Iterations of an unrolled loop"),
+        clEnumValEnd),
+    cl::init(Shape::Functions));
+
+static cl::opt<unsigned> SeedCL("seed", cl::desc("Seed used for randomness"),
+                                cl::init(0));
+static cl::opt<unsigned> SizeCL("size",
+                                cl::desc("The size along the chosen axis"),
+                                cl::init(100));
+static cl::opt<unsigned>
+    SweepCL("sweep",
+            cl::desc("Write programs of every shape, with sizes doubling up "
+                     "to this value, to the directory given by -o"),
+            cl::init(0));
+static cl::opt<std::string>
+    OutputFilename("o", cl::desc("Override output filename"),
+                   cl::value_desc("filename"), cl::init("-"));
+
+/// A pseudo-random number generator which is the same across all platforms,
+/// so a seed always generates the same program.
+class Random {
+public:
+  Random(unsigned _seed) : Seed(_seed) {}
+
+  /// Return a random integer, up to a maximum of 2**19 - 1.
+  uint32_t Rand() {
+    uint32_t Val = Seed + 0x000b07a1;
+    Seed = (Val * 0x3c7c0ac1);
+    // Only lowest 19 bits are random-ish.
+    return Seed & 0x7ffff;
+  }
+
+  /// Return a random integer below Max.
+  uint32_t operator()(uint32_t Max) { return Rand() % Max; }
+
+private:
+  unsigned Seed;
+};
+
+const char *GetShapeName(Shape S) {
+  switch (S) {
+  case Shape::Functions: return "functions";
+  case Shape::Resources: return "resources";
+  case Shape::Switch:    return "switch";
+  case Shape::Nesting:   return "nesting";
+  case Shape::CBuffer:   return "cbuffer";
+  case Shape::Loop:      return "loop";
+  }
+  return "";
+}
+
+/// Writes a random arithmetic expression over X.
+void GenExpr(raw_ostream &OS, Random &R, StringRef X) {
+  static const char *Ops[] = {" + ", " - ", " * "};
+  static const char *Funcs[] = {"sin", "cos", "sqrt", "abs", "frac", "exp2"};
+  OS << Funcs[R(6)] << "(" << X << Ops[R(3)] << R(100) << ".0f)" << Ops[R(3)]
+     << X;
+}
+
+// Exported functions, each calling a random earlier one, so the library has
+// a call graph to link and none of them can be removed.
+void GenFunctions(raw_ostream &OS, Random &R, unsigned Size) {
+  OS << "// RUN: %dxc -T lib_6_3 %s\n\n";
+  OS << "RWStructuredBuffer<float> Output : register(u0);\n\n";
+  for (unsigned i = 0; i < Size; ++i) {
+    OS << "export float f" << i << "(float x) {\n  float y = ";
+    GenExpr(OS, R, "x");
+    OS << ";\n";
+    if (i)
+      OS << "  y += f" << R(i) << "(y);\n";
+    OS << "  return y;\n}\n\n";
+  }
+  OS << "[shader(\"compute\")]\n[numthreads(64, 1, 1)]\n"
+        "void main(uint id : SV_DispatchThreadID) {\n"
+        "  Output[id] = f"
+     << Size - 1 << "(Output[id]);\n}\n";
+}
+
+// Separately bound textures, all sampled by one pixel shader.
+void GenResources(raw_ostream &OS, Random &R, unsigned Size) {
+  OS << "// RUN: %dxc -E main -T ps_6_0 %s\n\n";
+  OS << "SamplerState Samp : register(s0);\n";
+  for (unsigned i = 0; i < Size; ++i)
+    OS << "Texture2D<float4> Tex" << i << " : register(t" << i << ");\n";
+  OS << "\nfloat4 main(float2 uv : TEXCOORD) : SV_Target {\n"
+        "  float4 c = 0;\n";
+  for (unsigned i = 0; i < Size; ++i)
+    OS << "  c += Tex" << i << ".Sample(Samp, uv * " << R(100) + 1
+       << ".0f);\n";
+  OS << "  return c;\n}\n";
+}
+
+// A switch on a value read from memory, so no case can be folded away.
+void GenSwitch(raw_ostream &OS, Random &R, unsigned Size) {
+  OS << "// RUN: %dxc -E main -T cs_6_0 %s\n\n";
+  OS << "RWStructuredBuffer<uint> Input : register(u0);\n"
+        "RWStructuredBuffer<float> Output : register(u1);\n\n"
+        "[numthreads(64, 1, 1)]\n"
+        "void main(uint id : SV_DispatchThreadID) {\n"
+        "  float x = Output[id];\n"
+        "  switch (Input[id]) {\n";
+  for (unsigned i = 0; i < Size; ++i) {
+    OS << "  case " << i << ":\n    x = ";
+    GenExpr(OS, R, "x");
+    OS << ";\n    break;\n";
+  }
+  OS << "  default:\n    x = 0;\n    break;\n  }\n"
+        "  Output[id] = x;\n}\n";
+}
+
+// Structs nested Size deep, built by a chain of Size calls. HLSL has no
+// templates, so nested aggregates and call depth stand in for template
+// nesting.
+void GenNesting(raw_ostream &OS, Random &R, unsigned Size) {
+  OS << "// RUN: %dxc -E main -T cs_6_0 %s\n\n";
+  OS << "RWStructuredBuffer<float> Output : register(u0);\n\n";
+  OS << "struct S0 {\n  float v;\n};\n\n"
+        "S0 make0(float x) {\n  S0 s;\n  s.v = x;\n  return s;\n}\n\n";
+  for (unsigned i = 1; i < Size; ++i) {
+    OS << "struct S" << i << " {\n  S" << i - 1 << " inner;\n  float v;\n};\n\n";
+    OS << "S" << i << " make" << i << "(float x) {\n  S" << i << " s;\n"
+       << "  s.inner = make" << i - 1 << "(x);\n  s.v = ";
+    GenExpr(OS, R, "s.inner.v");
+    OS << ";\n  return s;\n}\n\n";
+  }
+  OS << "[numthreads(64, 1, 1)]\n"
+        "void main(uint id : SV_DispatchThreadID) {\n"
+        "  Output[id] = make"
+     << Size - 1 << "(Output[id]).v;\n}\n";
+}
+
+// A constant buffer with fields of mixed types, all read by a pixel shader.
+void GenCBuffer(raw_ostream &OS, Random &R, unsigned Size) {
+  static const char *Types[] = {"float", "float2", "float3", "float4",
+                                "int",   "uint2",  "float4x4"};
+  static const char *Targets[] = {"c",   "c.xy", "c.xyz", "c",
+                                  "c.x", "c.zw", "c"};
+  OS << "// RUN: %dxc -E main -T ps_6_0 %s\n\n";
+  OS << "cbuffer Constants : register(b0) {\n";
+  std::vector<unsigned> FieldTypes;
+  for (unsigned i = 0; i < Size; ++i) {
+    FieldTypes.push_back(R(7));
+    OS << "  " << Types[FieldTypes.back()] << " c" << i << ";\n";
+  }
+  OS << "};\n\nfloat4 main() : SV_Target {\n  float4 c = 0;\n";
+  for (unsigned i = 0; i < Size; ++i) {
+    OS << "  " << Targets[FieldTypes[i]] << " += c" << i;
+    // Matrices are read a row at a time.
+    if (FieldTypes[i] == 6)
+      OS << "[" << R(4) << "]";
+    OS << ";\n";
+  }
+  OS << "  return c;\n}\n";
+}
+
+// A loop unrolled Size times, with a body that depends on the iteration.
+void GenLoop(raw_ostream &OS, Random &R, unsigned Size) {
+  OS << "// RUN: %dxc -E main -T cs_6_0 %s\n\n";
+  OS << "RWStructuredBuffer<float> Output : register(u0);\n\n"
+        "[numthreads(64, 1, 1)]\n"
+        "void main(uint id : SV_DispatchThreadID) {\n"
+        "  float x = Output[id];\n"
+        "  [unroll]\n"
+        "  for (uint i = 0; i < "
+     << Size << "; ++i) {\n    x = ";
+  GenExpr(OS, R, "x");
+  OS << " + Output[id + i];\n  }\n  Output[id] = x;\n}\n";
+}
+
+void GenProgram(raw_ostream &OS, Shape S, unsigned Size, unsigned Seed) {
+  Random R(Seed);
+  Size = std::max(Size, 1u);
+  OS << "// Generated by hlsl-stress -shape=" << GetShapeName(S)
+     << " -size=" << Size << " -seed=" << Seed << "\n";
+  switch (S) {
+  case Shape::Functions: GenFunctions(OS, R, Size); break;
+  case Shape::Resources: GenResources(OS, R, Size); break;
+  case Shape::Switch:    GenSwitch(OS, R, Size); break;
+  case Shape::Nesting:   GenNesting(OS, R, Size); break;
+  case Shape::CBuffer:   GenCBuffer(OS, R, Size); break;
+  case Shape::Loop:      GenLoop(OS, R, Size); break;
+  }
+}
+
+bool WriteProgram(StringRef FileName, Shape S, unsigned Size, unsigned Seed) {
+  std::error_code EC;
+  raw_fd_ostream OS(FileName, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << FileName << ": " << EC.message() << '\n';
+    return false;
+  }
+  GenProgram(OS, S, Size, Seed);
+  return true;
+}
+
+// Writes <shape>_<size>.hlsl for every shape, with sizes doubling up to Max.
+// Sizes are zero-padded, so the files sort in order.
+bool WriteSweep(StringRef Dir, unsigned Max, unsigned Seed) {
+  if (std::error_code EC = sys::fs::create_directories(Dir)) {
+    errs() << Dir << ": " << EC.message() << '\n';
+    return false;
+  }
+  for (Shape S : AllShapes) {
+    for (unsigned Size = 1; Size <= Max; Size *= 2) {
+      SmallString<128> Path(Dir);
+      SmallString<32> Name;
+      raw_svector_ostream(Name) << GetShapeName(S) << "_"
+                                << format("%06u", Size) << ".hlsl";
+      sys::path::append(Path, Name);
+      if (!WriteProgram(Path, S, Size, Seed))
+        return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int __cdecl main(int argc, char **argv) {
+  if (sys::fs::SetupPerThreadFileSystem())
+    return 1;
+  sys::fs::AutoCleanupPerThreadFileSystem auto_cleanup_fs;
+  sys::fs::MSFileSystem *msfPtr;
+  if (FAILED(CreateMSFileSystemForDisk(&msfPtr)))
+    return 1;
+  std::unique_ptr<sys::fs::MSFileSystem> msf(msfPtr);
+  sys::fs::AutoPerThreadSystem pts(msf.get());
+  if (pts.error_code())
+    return 1;
+
+  cl::ParseCommandLineOptions(argc, argv, "HLSL compiler stress-tester\n");
+
+  if (SweepCL) {
+    if (OutputFilename == "-") {
+      errs() << "-sweep requires an output directory\n";
+      return 1;
+    }
+    return WriteSweep(OutputFilename, SweepCL, SeedCL) ? 0 : 1;
+  }
+  return WriteProgram(OutputFilename, ShapeCL, SizeCL, SeedCL) ? 0 : 1;
+}
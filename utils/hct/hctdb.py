@@ -1924,15 +1924,21 @@ class db_dxil(object):
         add_pass('hlsl-dxil-force-early-z', 'DxilForceEarlyZ', 'HLSL DXIL Force the early Z global flag, if shader has no discard calls', [])
         add_pass('hlsl-dxil-pix-shader-access-instrumentation', 'DxilShaderAccessTracking', 'HLSL DXIL shader access tracking for PIX', [
             {'n':'config','t':'int','c':1},
-            {'n':'checkForDynamicIndexing','t':'bool','c':1}])
+            {'n':'checkForDynamicIndexing','t':'bool','c':1},
+            {'n':'aggregate','t':'bool','c':1}])
         add_pass('hlsl-dxil-debug-instrumentation', 'DxilDebugInstrumentation', 'HLSL DXIL debug instrumentation for PIX', [
             {'n':'UAVSize','t':'int','c':1},
             {'n':'parameter0','t':'int','c':1},
             {'n':'parameter1','t':'int','c':1},
-            {'n':'parameter2','t':'int','c':1}])
+            {'n':'parameter2','t':'int','c':1},
+            {'n':'minimal','t':'bool','c':1}])
         add_pass('dxil-annotate-with-virtual-regs', 'DxilAnnotateWithVirtualRegister', 'Annotates each instruction in the DXIL module with a virtual register number', [])
         add_pass('hlsl-dxil-reduce-msaa-to-single', 'DxilReduceMSAAToSingleSample', 'HLSL DXIL Reduce all MSAA reads to single-sample reads', [])
 
+        category_lib="dxrfallback"
+        add_pass('hlsl-dxr-state-functions', 'DxrStateFunctionTransform', 'DXR fallback state function transform', [
+            {'n':'candidates','t':'string','c':1,'d':'Functions that are or will be state functions: name[;name...]'}])
+
         category_lib="dxil_gen"
 
         add_pass('hlsl-hlemit', 'HLEmitMetadata', 'HLSL High-Level Metadata Emit.', [])
@@ -1957,6 +1963,16 @@ class db_dxil(object):
         add_pass('hlsl-dxil-precise', 'DxilPrecisePropagatePass', 'DXIL precise attribute propagate', [])
         add_pass('dxil-legalize-sample-offset', 'DxilLegalizeSampleOffsetPass', 'DXIL legalize sample offset', [])
         add_pass('dxil-gvn-hoist', 'DxilSimpleGVNHoist', 'DXIL simple gvn hoist', [])
+        add_pass('dxil-coalesce-buffer-loads', 'DxilCoalesceBufferLoads', 'DXIL coalesce buffer loads', [])
+        add_pass('dxil-uniformity', 'DxilUniformity', 'DXIL uniformity', [
+            {'n':'annotate','t':'bool','c':1}])
+        add_pass('dxil-remat', 'DxilRematerialize', 'DXIL rematerialize', [
+            {'n':'pressure-threshold','t':'unsigned','c':1,'d':'Live scalars above which cheap values are recomputed at their uses (default = 64)'}])
+        add_pass('dxil-licm', 'DxilLoopInvariantHoist', 'DXIL loop invariant hoist', [])
+        add_pass('dxil-tgsm-layout', 'DxilGroupSharedLayout', 'DXIL groupshared layout', [
+            {'n':'banks','t':'unsigned','c':1,'d':'Number of 32-bit groupshared memory banks strides are padded for; 0 disables padding (default = 32)'}])
+        add_pass('dxil-specialize-constants', 'DxilSpecializeConstants', 'DXIL specialize constants', [
+            {'n':'values','t':'string','c':1,'d':'Fields to replace: name=value[,component...][;...]'}])
         add_pass('hlsl-hlensure', 'HLEnsureMetadata', 'HLSL High-Level Metadata Ensure', [])
         add_pass('multi-dim-one-dim', 'MultiDimArrayToOneDimArray', 'Flatten multi-dim array into one-dim array', [])
         add_pass('resource-handle', 'ResourceToHandle', 'Lower resource into handle', [])
@@ -1160,6 +1160,7 @@ if __name__ == "__main__":
             'include/dxc/DXIL/DxilInstructions.h',
             'lib/HLSL/DxcOptimizer.cpp',
             'lib/DxilPIXPasses/DxilPIXPasses.cpp',
+            'lib/DxrFallback/DxrFallbackPasses.cpp',
             'lib/HLSL/DxilValidation.cpp',
             'tools/clang/lib/Sema/gen_intrin_main_tables_15.h',
             'include/dxc/HlslIntrinsicOp.h',